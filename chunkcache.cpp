@@ -0,0 +1,127 @@
+#include "include/chunkcache.h"
+
+bool ChunkCache::takeGpu(const ChunkKey &key, Chunk &chunk)
+{
+    auto it = gpu.entries.find(key);
+    if (it == gpu.entries.end())
+    {
+        counters.gpuMisses++;
+        return false;
+    }
+    chunk = it->second->second;
+    counters.gpuBytes -= gpuBytes(chunk);
+    gpu.order.erase(it->second);
+    gpu.entries.erase(it);
+    counters.gpuHits++;
+    counters.gpuEntries--;
+    return true;
+}
+
+void ChunkCache::putGpu(const ChunkKey &key, const Chunk &chunk, size_t limit, std::vector<Chunk> &evicted)
+{
+    // a chunk is only retired from view once, but an older copy under the same key may still be here
+    auto it = gpu.entries.find(key);
+    if (it != gpu.entries.end())
+    {
+        counters.gpuBytes -= gpuBytes(it->second->second);
+        evicted.push_back(it->second->second);
+        gpu.order.erase(it->second);
+        gpu.entries.erase(it);
+        counters.gpuEntries--;
+    }
+    gpu.order.emplace_front(key, chunk);
+    gpu.entries[key] = gpu.order.begin();
+    counters.gpuBytes += gpuBytes(chunk);
+    counters.gpuEntries++;
+    trimGpu(limit, evicted);
+}
+
+void ChunkCache::trimGpu(size_t limit, std::vector<Chunk> &evicted)
+{
+    while (counters.gpuBytes > limit && !gpu.order.empty())
+    {
+        const auto &last = gpu.order.back();
+        counters.gpuBytes -= gpuBytes(last.second);
+        evicted.push_back(last.second);
+        gpu.entries.erase(last.first);
+        gpu.order.pop_back();
+        counters.gpuEvictions++;
+        counters.gpuEntries--;
+    }
+}
+
+void ChunkCache::clearGpu(std::vector<Chunk> &evicted)
+{
+    for (const auto &entry : gpu.order)
+        evicted.push_back(entry.second);
+    gpu.order.clear();
+    gpu.entries.clear();
+    counters.gpuBytes = 0;
+    counters.gpuEntries = 0;
+}
+
+const ChunkData *ChunkCache::findCpu(const ChunkKey &key)
+{
+    auto it = cpu.entries.find(key);
+    if (it == cpu.entries.end())
+    {
+        counters.cpuMisses++;
+        return nullptr;
+    }
+    cpu.order.splice(cpu.order.begin(), cpu.order, it->second);
+    counters.cpuHits++;
+    return &cpu.order.front().second;
+}
+
+bool ChunkCache::putCpu(const ChunkKey &key, ChunkData &&data, size_t limit)
+{
+    auto it = cpu.entries.find(key);
+    if (it != cpu.entries.end())
+    {
+        counters.cpuBytes -= it->second->second.bytes();
+        cpu.order.erase(it->second);
+        cpu.entries.erase(it);
+        counters.cpuEntries--;
+    }
+    if (data.bytes() > limit)
+    {
+        counters.cpuRejected++;
+        return false;
+    }
+    counters.cpuBytes += data.bytes();
+    cpu.order.emplace_front(key, std::move(data));
+    cpu.entries[key] = cpu.order.begin();
+    counters.cpuEntries++;
+    trimCpu(limit);
+    return true;
+}
+
+void ChunkCache::trimCpu(size_t limit)
+{
+    while (counters.cpuBytes > limit && !cpu.order.empty())
+    {
+        counters.cpuBytes -= cpu.order.back().second.bytes();
+        cpu.entries.erase(cpu.order.back().first);
+        cpu.order.pop_back();
+        counters.cpuEvictions++;
+        counters.cpuEntries--;
+    }
+}
+
+void ChunkCache::clearCpu()
+{
+    cpu.order.clear();
+    cpu.entries.clear();
+    counters.cpuBytes = 0;
+    counters.cpuEntries = 0;
+}
+
+void ChunkCache::resetCounters()
+{
+    Stats cleared;
+    cleared.gpuBytes = counters.gpuBytes;
+    cleared.cpuBytes = counters.cpuBytes;
+    cleared.gpuEntries = counters.gpuEntries;
+    cleared.cpuEntries = counters.cpuEntries;
+    counters = cleared;
+}
@@ -0,0 +1,138 @@
+#include "include/chunkmanager.h"
+#include <algorithm>
+#include <cmath>
+
+ChunkManager::ChunkManager(int chunkSize) : chunkSize(chunkSize)
+{
+}
+
+glm::ivec2 ChunkManager::chunkAt(const glm::vec3 &position) const
+{
+    return glm::ivec2((int)std::floor(position.x / chunkSize), (int)std::floor(position.z / chunkSize));
+}
+
+glm::vec3 ChunkManager::origin(const glm::ivec2 &coord) const
+{
+    return glm::vec3((float)(coord.x * chunkSize), 0.0f, (float)(coord.y * chunkSize));
+}
+
+void ChunkManager::missing(const glm::ivec2 &centre, std::vector<glm::ivec2> &coords) const
+{
+    coords.clear();
+    for (int dz = -radius; dz <= radius; ++dz)
+    {
+        for (int dx = -radius; dx <= radius; ++dx)
+        {
+            glm::ivec2 coord = centre + glm::ivec2(dx, dz);
+            if (dx * dx + dz * dz <= radius * radius && chunks.find(key(coord)) == chunks.end() && building.find(key(coord)) == building.end())
+                coords.push_back(coord);
+        }
+    }
+    // stable, so equal distances keep the scan order and the load order is the same every run
+    std::stable_sort(coords.begin(), coords.end(), [&](const glm::ivec2 &a, const glm::ivec2 &b)
+                     {
+        glm::ivec2 da = a - centre;
+        glm::ivec2 db = b - centre;
+        return da.x * da.x + da.y * da.y < db.x * db.x + db.y * db.y; });
+}
+
+void ChunkManager::stale(const glm::ivec2 &centre, uint64_t paramHash, std::vector<glm::ivec2> &coords) const
+{
+    coords.clear();
+    for (const auto &entry : chunks)
+    {
+        glm::ivec2 d = entry.second.coord - centre;
+        if (entry.second.paramHash != paramHash && d.x * d.x + d.y * d.y <= radius * radius && building.find(entry.first) == building.end())
+            coords.push_back(entry.second.coord);
+    }
+    // the map's order is arbitrary, so sort by distance and then by coordinate
+    std::sort(coords.begin(), coords.end(), [&](const glm::ivec2 &a, const glm::ivec2 &b)
+              {
+        glm::ivec2 da = a - centre;
+        glm::ivec2 db = b - centre;
+        int la = da.x * da.x + da.y * da.y;
+        int lb = db.x * db.x + db.y * db.y;
+        if (la != lb)
+            return la < lb;
+        return a.y != b.y ? a.y < b.y : a.x < b.x; });
+}
+
+void ChunkManager::outOfRange(const glm::ivec2 &centre, std::vector<glm::ivec2> &coords) const
+{
+    coords.clear();
+    int limit = (radius + 1) * (radius + 1);
+    for (const auto &entry : chunks)
+    {
+        glm::ivec2 d = entry.second.coord - centre;
+        if (d.x * d.x + d.y * d.y > limit)
+            coords.push_back(entry.second.coord);
+    }
+}
+
+glm::ivec2 ChunkManager::keyCoord(int64_t key)
+{
+    return glm::ivec2((int)(uint32_t)((uint64_t)key >> 32), (int)(uint32_t)key);
+}
+
+glm::ivec2 ChunkManager::tagCoord(uint64_t tag)
+{
+    return keyCoord((int64_t)(tag ^ (1ull << 63)));
+}
+
+void ChunkManager::markBuilding(const glm::ivec2 &coord, const CancellationToken &token)
+{
+    building[key(coord)] = token;
+}
+
+bool ChunkManager::finishBuilding(const glm::ivec2 &coord, const CancellationToken &token)
+{
+    // a cancelled build's entry is already gone, and may since belong to a newer build of the same chunk
+    if (token.cancelled())
+        return false;
+    building.erase(key(coord));
+    return true;
+}
+
+int ChunkManager::cancelOutOfRange(const glm::ivec2 &centre)
+{
+    int cancelled = 0;
+    int limit = (radius + 1) * (radius + 1);
+    for (auto it = building.begin(); it != building.end();)
+    {
+        glm::ivec2 d = keyCoord(it->first) - centre;
+        if (d.x * d.x + d.y * d.y > limit)
+        {
+            it->second.cancel();
+            it = building.erase(it);
+            cancelled++;
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    return cancelled;
+}
+
+void ChunkManager::cancelAll()
+{
+    for (auto &entry : building)
+        entry.second.cancel();
+    building.clear();
+}
+
+Chunk *ChunkManager::find(const glm::ivec2 &coord)
+{
+    auto it = chunks.find(key(coord));
+    return it == chunks.end() ? nullptr : &it->second;
+}
+
+Chunk &ChunkManager::insert(const Chunk &chunk)
+{
+    return chunks[key(chunk.coord)] = chunk;
+}
+
+void ChunkManager::erase(const glm::ivec2 &coord)
+{
+    chunks.erase(key(coord));
+}
@@ -0,0 +1,658 @@
+#include "include/chunkstore.h"
+#include "include/paramhash.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// bump when the record layout or what the chunk builds produce changes, old files then start over
+static const uint32_t storeVersion = 2;
+static const char packMagic[8] = {'M', 'C', 'P', 'A', 'C', 'K', 0, 0};
+static const char indexMagic[8] = {'M', 'C', 'I', 'N', 'D', 'E', 'X', 0};
+static const uint64_t recordMagic = 0x4B4E554843434D00ull; // "\0MCCHUNK"
+// the mapping grows in steps, so appends rarely need a new one
+static const uint64_t mapStep = 64ull << 20;
+
+struct FileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t vertexSize; // sizeof(VertexNormal), so a layout change is caught too
+    uint64_t generation; // the same in both files; a compaction writes both anew with a new one
+    uint64_t reserved;
+};
+static_assert(sizeof(FileHeader) == 32, "FileHeader must stay 32 bytes");
+
+// sections follow the header in this order, each 16-byte aligned from the record start, which is
+// 16-byte aligned in the file
+struct RecordHeader
+{
+    uint64_t magic;
+    uint64_t paramHash;
+    int32_t x, y, lod;
+    uint32_t packedVertices;
+    uint64_t vertexCount;
+    uint64_t indexCount;
+    uint64_t densityWordCount;
+    uint64_t size; // the whole record, padding included
+};
+static_assert(sizeof(RecordHeader) == 64, "RecordHeader must stay 64 bytes");
+
+struct IndexEntry
+{
+    uint64_t paramHash;
+    int32_t x, y, lod, pad;
+    uint64_t offset;
+    uint64_t size;
+    uint64_t checksum; // of the fields above, a torn entry fails it
+};
+static_assert(sizeof(IndexEntry) == 48, "IndexEntry must stay 48 bytes");
+
+static uint64_t align16(uint64_t value)
+{
+    return (value + 15) & ~15ull;
+}
+
+// where the indices and the density words start, and the end of the density words. false if the
+// counts do not fit in the record, which only a damaged file gets past the header checks with
+static bool recordLayout(const RecordHeader &record, uint64_t &indexOffset, uint64_t &densityOffset, uint64_t &end)
+{
+    if (record.packedVertices > 1 || record.vertexCount > record.size || record.indexCount > record.size ||
+        record.densityWordCount > record.size)
+        return false;
+    size_t vertexSize = record.packedVertices ? sizeof(PackedVertex) : sizeof(VertexNormal);
+    indexOffset = align16(sizeof(RecordHeader) + record.vertexCount * vertexSize);
+    densityOffset = align16(indexOffset + record.indexCount * sizeof(uint32_t));
+    end = densityOffset + record.densityWordCount * sizeof(uint32_t);
+    return end <= record.size;
+}
+
+static uint64_t entryChecksum(const IndexEntry &entry)
+{
+    ParamHash hash;
+    hash.add(entry.paramHash).add(entry.x).add(entry.y).add(entry.lod).add(entry.pad);
+    hash.add(entry.offset).add(entry.size);
+    return hash.value();
+}
+
+static FileHeader fileHeader(const char *magic, uint64_t generation)
+{
+    FileHeader header = {};
+    std::memcpy(header.magic, magic, sizeof(header.magic));
+    header.version = storeVersion;
+    header.vertexSize = (uint32_t)sizeof(VertexNormal);
+    header.generation = generation;
+    return header;
+}
+
+static uint64_t newGeneration()
+{
+    static std::atomic<uint64_t> count{0};
+    return (uint64_t)std::chrono::system_clock::now().time_since_epoch().count() * 31 + ++count;
+}
+
+static bool writeAll(int file, const void *data, size_t size, uint64_t offset)
+{
+    const char *bytes = (const char *)data;
+    while (size > 0)
+    {
+        ssize_t written = pwrite(file, bytes, size, (off_t)offset);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return false;
+        bytes += written;
+        size -= (size_t)written;
+        offset += (uint64_t)written;
+    }
+    return true;
+}
+
+static bool readAll(int file, void *data, size_t size, uint64_t offset)
+{
+    char *bytes = (char *)data;
+    while (size > 0)
+    {
+        ssize_t got = pread(file, bytes, size, (off_t)offset);
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got <= 0)
+            return false;
+        bytes += got;
+        size -= (size_t)got;
+        offset += (uint64_t)got;
+    }
+    return true;
+}
+
+static uint64_t fileSize(int file)
+{
+    struct stat info;
+    return fstat(file, &info) == 0 ? (uint64_t)info.st_size : 0;
+}
+
+static bool headerMatches(int file, const char *magic, uint64_t &generation)
+{
+    FileHeader header;
+    if (fileSize(file) < sizeof(header) || !readAll(file, &header, sizeof(header), 0))
+        return false;
+    FileHeader expected = fileHeader(magic, header.generation);
+    generation = header.generation;
+    return std::memcmp(&header, &expected, sizeof(header)) == 0;
+}
+
+static bool resetFile(int file, const char *magic, uint64_t generation)
+{
+    FileHeader header = fileHeader(magic, generation);
+    return ftruncate(file, 0) == 0 && writeAll(file, &header, sizeof(header), 0) && fsync(file) == 0;
+}
+
+static bool syncDirectory(const std::string &path)
+{
+    int directory = ::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (directory < 0)
+        return false;
+    bool synced = fsync(directory) == 0;
+    ::close(directory);
+    return synced;
+}
+
+ChunkStore::~ChunkStore()
+{
+    close();
+}
+
+bool ChunkStore::open(const std::string &directory)
+{
+    close();
+    if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST)
+        return false;
+    directoryPath = directory;
+    packPath = directory + "/chunks.pack";
+    indexPath = directory + "/chunks.idx";
+    // left by a compaction that did not finish, the files themselves are still whole
+    unlink((packPath + ".new").c_str());
+    unlink((indexPath + ".new").c_str());
+    packFile = ::open(packPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    indexFile = ::open(indexPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (packFile < 0 || indexFile < 0)
+    {
+        close();
+        return false;
+    }
+
+    // either file from another version or generation, or missing, makes the other useless too. the
+    // index goes first, an empty index over a full pack is consistent
+    uint64_t packGeneration = 0, indexGeneration = 0;
+    if (!headerMatches(packFile, packMagic, packGeneration) || !headerMatches(indexFile, indexMagic, indexGeneration) ||
+        packGeneration != indexGeneration)
+    {
+        uint64_t generation = newGeneration();
+        if (!resetFile(indexFile, indexMagic, generation) || !resetFile(packFile, packMagic, generation))
+        {
+            close();
+            return false;
+        }
+    }
+    if (!loadIndex())
+    {
+        close();
+        return false;
+    }
+    {
+        // files left over budget by an earlier run are compacted first thing
+        std::lock_guard<std::mutex> lock(queueMutex);
+        budgetChanged = true;
+    }
+    writer = std::thread([this]()
+                         { writeQueued(); });
+    opened = true;
+    return true;
+}
+
+bool ChunkStore::loadIndex()
+{
+    std::lock_guard<std::mutex> writeLock(writeMutex);
+    std::lock_guard<std::mutex> lock(indexMutex);
+    uint64_t packSize = fileSize(packFile);
+    uint64_t indexSize = fileSize(indexFile);
+    std::vector<IndexEntry> loaded((indexSize - sizeof(FileHeader)) / sizeof(IndexEntry));
+    if (!loaded.empty() && !readAll(indexFile, loaded.data(), loaded.size() * sizeof(IndexEntry), sizeof(FileHeader)))
+        loaded.clear();
+    if (!mapPack(packSize))
+        return false;
+
+    // entries are appended one record at a time, so the first bad one starts the torn tail
+    indexedBytes = sizeof(FileHeader);
+    size_t valid = 0;
+    for (; valid < loaded.size(); ++valid)
+    {
+        const IndexEntry &entry = loaded[valid];
+        if (entry.checksum != entryChecksum(entry) || entry.offset < sizeof(FileHeader) || entry.offset % 16 != 0 ||
+            entry.size < sizeof(RecordHeader) || entry.offset + entry.size > packSize)
+            break;
+        const RecordHeader *record = (const RecordHeader *)((const char *)mapping.get() + entry.offset);
+        if (record->magic != recordMagic || record->size != entry.size || record->paramHash != entry.paramHash ||
+            record->x != entry.x || record->y != entry.y || record->lod != entry.lod)
+            break;
+        // find turns the counts into pointers for glBufferData, they must stay inside the record
+        uint64_t indexOffset, densityOffset, end;
+        if (!recordLayout(*record, indexOffset, densityOffset, end))
+            break;
+        // a later entry for the same key replaces the earlier one
+        // in file order, so the oldest records go first when the pack is compacted
+        entries[{entry.paramHash, glm::ivec2(entry.x, entry.y), entry.lod}] = {entry.offset, entry.size, ++useClock};
+        indexedBytes = std::max(indexedBytes, entry.offset + entry.size);
+    }
+    uint64_t indexBytes = sizeof(FileHeader) + valid * sizeof(IndexEntry);
+    counters.droppedOnOpen = (indexSize - indexBytes + sizeof(IndexEntry) - 1) / sizeof(IndexEntry);
+
+    // whatever follows the last indexed record was being written when the program stopped
+    if (indexSize != indexBytes && ftruncate(indexFile, (off_t)indexBytes) != 0)
+        return false;
+    if (packSize != indexedBytes && ftruncate(packFile, (off_t)indexedBytes) != 0)
+        return false;
+    packEnd = indexedBytes;
+    indexEnd = indexBytes;
+    counters.records = (int)entries.size();
+    counters.packBytes = (size_t)packEnd;
+    return true;
+}
+
+bool ChunkStore::mapPack(uint64_t size)
+{
+    // past the end of the file is fine to map, only never read: reads stay below indexedBytes
+    uint64_t capacity = std::max(mapStep, (size + mapStep - 1) / mapStep * mapStep);
+    void *address = mmap(nullptr, (size_t)capacity, PROT_READ, MAP_SHARED, packFile, 0);
+    if (address == MAP_FAILED)
+        return false;
+    mapping = std::shared_ptr<const void>(address, [capacity](const void *base)
+                                          { munmap(const_cast<void *>(base), (size_t)capacity); });
+    mappedBytes = capacity;
+    return true;
+}
+
+void ChunkStore::close()
+{
+    // what is queued is written first
+    opened = false;
+    if (writer.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            stopping = true;
+        }
+        queueReady.notify_all();
+        writer.join();
+        stopping = false;
+    }
+    {
+        // anything queued since the writer stopped
+        std::lock_guard<std::mutex> lock(queueMutex);
+        queue.clear();
+        queuedKeys.clear();
+        queuedBytes = 0;
+    }
+    std::lock_guard<std::mutex> writeLock(writeMutex);
+    std::lock_guard<std::mutex> lock(indexMutex);
+    if (packFile >= 0)
+        ::close(packFile);
+    if (indexFile >= 0)
+        ::close(indexFile);
+    packFile = -1;
+    indexFile = -1;
+    entries.clear();
+    mapping.reset();
+    mappedBytes = 0;
+    indexedBytes = 0;
+    useClock = 0;
+    packEnd = 0;
+    indexEnd = 0;
+    counters.records = 0;
+    counters.packBytes = 0;
+}
+
+bool ChunkStore::find(const ChunkKey &key, StoredChunk &chunk)
+{
+    std::lock_guard<std::mutex> lock(indexMutex);
+    auto it = entries.find(key);
+    if (it == entries.end())
+    {
+        counters.misses++;
+        return false;
+    }
+    Entry &entry = it->second;
+    entry.lastUse = ++useClock;
+    if (entry.offset + entry.size > mappedBytes && !mapPack(indexedBytes))
+    {
+        counters.misses++;
+        return false;
+    }
+
+    const char *base = (const char *)mapping.get() + entry.offset;
+    const RecordHeader &record = *(const RecordHeader *)base;
+    uint64_t indexOffset, densityOffset, end;
+    recordLayout(record, indexOffset, densityOffset, end); // checked by loadIndex, or written by put
+    chunk.mapping = mapping;
+    chunk.packedVertices = record.packedVertices != 0;
+    chunk.vertices = base + sizeof(RecordHeader);
+    chunk.vertexCount = (size_t)record.vertexCount;
+    chunk.indices = (const uint32_t *)(base + indexOffset);
+    chunk.indexCount = (size_t)record.indexCount;
+    chunk.densityWords = (const uint32_t *)(base + densityOffset);
+    chunk.densityWordCount = (size_t)record.densityWordCount;
+    counters.hits++;
+    return true;
+}
+
+bool ChunkStore::contains(const ChunkKey &key) const
+{
+    std::lock_guard<std::mutex> lock(indexMutex);
+    return entries.count(key) != 0;
+}
+
+// the whole record as it goes into the pack, padding zeroed, so it is written with one call
+static std::vector<char> encodeRecord(const ChunkKey &key, const ChunkData &data)
+{
+    RecordHeader record = {};
+    record.magic = recordMagic;
+    record.paramHash = key.paramHash;
+    record.x = key.coord.x;
+    record.y = key.coord.y;
+    record.lod = key.lod;
+    record.packedVertices = data.packedVertices ? 1 : 0;
+    record.vertexCount = data.packedVertices ? data.packed.size() : data.vertices.size();
+    record.indexCount = data.indices.size();
+    record.densityWordCount = data.densityWords.size();
+    size_t vertexBytes = data.packedVertices ? data.packed.size() * sizeof(PackedVertex) : data.vertices.size() * sizeof(VertexNormal);
+    uint64_t indexOffset = align16(sizeof(RecordHeader) + vertexBytes);
+    uint64_t densityOffset = align16(indexOffset + data.indices.size() * sizeof(uint32_t));
+    record.size = align16(densityOffset + data.densityWords.size() * sizeof(uint32_t));
+
+    std::vector<char> buffer((size_t)record.size, 0);
+    std::memcpy(buffer.data(), &record, sizeof(record));
+    if (vertexBytes > 0)
+        std::memcpy(buffer.data() + sizeof(record), data.packedVertices ? (const void *)data.packed.data() : (const void *)data.vertices.data(), vertexBytes);
+    if (!data.indices.empty())
+        std::memcpy(buffer.data() + indexOffset, data.indices.data(), data.indices.size() * sizeof(uint32_t));
+    if (!data.densityWords.empty())
+        std::memcpy(buffer.data() + densityOffset, data.densityWords.data(), data.densityWords.size() * sizeof(uint32_t));
+    return buffer;
+}
+
+bool ChunkStore::enqueue(const ChunkKey &key, const ChunkData &data)
+{
+    if (!isOpen() || contains(key))
+        return false;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (queuedKeys.count(key) != 0)
+            return false;
+    }
+    // encoded here, on the caller's thread, so the writer only waits on the disk
+    std::vector<char> record = encodeRecord(key, data);
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (queuedBytes + record.size() > maxQueuedBytes || !queuedKeys.insert(key).second)
+        {
+            std::lock_guard<std::mutex> statsLock(indexMutex);
+            counters.droppedWrites++;
+            return false;
+        }
+        queuedBytes += record.size();
+        queue.push_back({key, std::move(record)});
+    }
+    queueReady.notify_one();
+    return true;
+}
+
+void ChunkStore::writeQueued()
+{
+    std::unique_lock<std::mutex> lock(queueMutex);
+    while (true)
+    {
+        queueReady.wait(lock, [&]()
+                        { return stopping || budgetChanged || !queue.empty(); });
+        // stopping drains the queue first
+        if (queue.empty() && !budgetChanged)
+            return;
+        PendingRecord pending;
+        bool hasRecord = !queue.empty();
+        if (hasRecord)
+        {
+            pending = std::move(queue.front());
+            queue.pop_front();
+        }
+        budgetChanged = false;
+        writing = true;
+        lock.unlock();
+
+        if (hasRecord)
+            append(pending.key, pending.record);
+        uint64_t limit = budget;
+        if (limit != 0)
+        {
+            std::lock_guard<std::mutex> writeLock(writeMutex);
+            // down to three quarters, so the next compaction is a while off
+            auto start = std::chrono::high_resolution_clock::now();
+            size_t dropped = 0;
+            if (packEnd > limit && rewrite(limit / 4 * 3, dropped))
+            {
+                double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+                std::lock_guard<std::mutex> statsLock(indexMutex);
+                counters.compactions++;
+                counters.compactedRecords += dropped;
+                counters.compactMs += ms;
+            }
+        }
+
+        lock.lock();
+        if (hasRecord)
+        {
+            queuedBytes -= pending.record.size();
+            queuedKeys.erase(pending.key);
+        }
+        writing = false;
+        queueIdle.notify_all();
+    }
+}
+
+bool ChunkStore::append(const ChunkKey &key, const std::vector<char> &record)
+{
+    std::lock_guard<std::mutex> writeLock(writeMutex);
+    if (packFile < 0 || contains(key))
+        return packFile >= 0;
+    auto start = std::chrono::high_resolution_clock::now();
+
+    IndexEntry entry = {};
+    entry.paramHash = key.paramHash;
+    entry.x = key.coord.x;
+    entry.y = key.coord.y;
+    entry.lod = key.lod;
+    entry.offset = packEnd;
+    entry.size = record.size();
+    entry.checksum = entryChecksum(entry);
+
+    // the record is on disk before anything points at it. the index is not synced: an entry lost in a
+    // crash only means building that chunk again
+    bool written = writeAll(packFile, record.data(), record.size(), packEnd) && fdatasync(packFile) == 0 &&
+                   writeAll(indexFile, &entry, sizeof(entry), indexEnd);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    if (!written)
+    {
+        // the ends stay where they were, so the next append writes over whatever got through
+        std::lock_guard<std::mutex> lock(indexMutex);
+        counters.writeFailures++;
+        return false;
+    }
+    packEnd += entry.size;
+    indexEnd += sizeof(entry);
+
+    std::lock_guard<std::mutex> lock(indexMutex);
+    entries[key] = {entry.offset, entry.size, ++useClock};
+    indexedBytes = packEnd;
+    counters.records = (int)entries.size();
+    counters.packBytes = (size_t)packEnd;
+    counters.writes++;
+    counters.writeMs += ms;
+    return true;
+}
+
+void ChunkStore::clear()
+{
+    {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        for (const PendingRecord &pending : queue)
+        {
+            queuedBytes -= pending.record.size();
+            queuedKeys.erase(pending.key);
+        }
+        queue.clear();
+        // a record the writer took before the queue was emptied is written first, then dropped with the rest
+        queueIdle.wait(lock, [&]()
+                       { return !writing; });
+    }
+    // new empty files in place of the old ones, not truncated ones: chunks found before still point
+    // into the old pack
+    std::lock_guard<std::mutex> writeLock(writeMutex);
+    size_t dropped = 0;
+    if (rewrite(0, dropped))
+    {
+        std::lock_guard<std::mutex> lock(indexMutex);
+        useClock = 0;
+    }
+}
+
+bool ChunkStore::rewrite(uint64_t target, size_t &dropped)
+{
+    // writeMutex is held, so nothing is appended meanwhile; finds go on against the old files
+    if (packFile < 0)
+        return false;
+    std::vector<std::pair<ChunkKey, Entry>> kept;
+    std::shared_ptr<const void> source;
+    {
+        std::lock_guard<std::mutex> lock(indexMutex);
+        if (indexedBytes > mappedBytes && !mapPack(indexedBytes))
+            return false;
+        source = mapping;
+        kept.assign(entries.begin(), entries.end());
+    }
+    // the most recently used that fit; records of settings no longer in use are found no more and
+    // fall to the back. then back in pack order, so the old pack is read front to back
+    std::sort(kept.begin(), kept.end(), [](const std::pair<ChunkKey, Entry> &a, const std::pair<ChunkKey, Entry> &b)
+              { return a.second.lastUse > b.second.lastUse; });
+    uint64_t keptBytes = sizeof(FileHeader);
+    size_t count = 0;
+    while (count < kept.size() && keptBytes + kept[count].second.size <= target)
+        keptBytes += kept[count++].second.size;
+    dropped = kept.size() - count;
+    kept.resize(count);
+    std::sort(kept.begin(), kept.end(), [](const std::pair<ChunkKey, Entry> &a, const std::pair<ChunkKey, Entry> &b)
+              { return a.second.offset < b.second.offset; });
+
+    std::string newPackPath = packPath + ".new";
+    std::string newIndexPath = indexPath + ".new";
+    int newPack = ::open(newPackPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    int newIndex = ::open(newIndexPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    uint64_t generation = newGeneration();
+    bool written = newPack >= 0 && newIndex >= 0 && resetFile(newIndex, indexMagic, generation) &&
+                   resetFile(newPack, packMagic, generation);
+    std::vector<IndexEntry> index;
+    index.reserve(kept.size());
+    uint64_t offset = sizeof(FileHeader);
+    for (size_t i = 0; written && i < kept.size(); ++i)
+    {
+        const ChunkKey &key = kept[i].first;
+        Entry &moved = kept[i].second;
+        written = writeAll(newPack, (const char *)source.get() + moved.offset, (size_t)moved.size, offset);
+        moved.offset = offset;
+        offset += moved.size;
+
+        IndexEntry entry = {};
+        entry.paramHash = key.paramHash;
+        entry.x = key.coord.x;
+        entry.y = key.coord.y;
+        entry.lod = key.lod;
+        entry.offset = moved.offset;
+        entry.size = moved.size;
+        entry.checksum = entryChecksum(entry);
+        index.push_back(entry);
+    }
+    // both new files are whole on disk before either replaces an old one. a crash between the renames
+    // leaves files of two generations, which open starts over from
+    written = written &&
+              (index.empty() || writeAll(newIndex, index.data(), index.size() * sizeof(IndexEntry), sizeof(FileHeader))) &&
+              fdatasync(newPack) == 0 && fdatasync(newIndex) == 0 && rename(newPackPath.c_str(), packPath.c_str()) == 0 &&
+              rename(newIndexPath.c_str(), indexPath.c_str()) == 0;
+    if (!written)
+    {
+        if (newPack >= 0)
+            ::close(newPack);
+        if (newIndex >= 0)
+            ::close(newIndex);
+        unlink(newPackPath.c_str());
+        unlink(newIndexPath.c_str());
+        std::lock_guard<std::mutex> lock(indexMutex);
+        counters.writeFailures++;
+        return false;
+    }
+    syncDirectory(directoryPath);
+
+    // chunks found before keep the old mapping, and with it the old pack, until they are dropped
+    std::lock_guard<std::mutex> lock(indexMutex);
+    ::close(packFile);
+    ::close(indexFile);
+    packFile = newPack;
+    indexFile = newIndex;
+    entries.clear();
+    for (const std::pair<ChunkKey, Entry> &entry : kept)
+        entries[entry.first] = entry.second;
+    packEnd = offset;
+    indexEnd = sizeof(FileHeader) + index.size() * sizeof(IndexEntry);
+    indexedBytes = offset;
+    mapping.reset();
+    mappedBytes = 0;
+    mapPack(indexedBytes); // if this fails, the next find tries again
+    counters.records = (int)entries.size();
+    counters.packBytes = (size_t)packEnd;
+    return true;
+}
+
+void ChunkStore::setBudget(uint64_t bytes)
+{
+    if (budget.exchange(bytes) == bytes)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        budgetChanged = true;
+    }
+    queueReady.notify_one();
+}
+
+ChunkStore::Stats ChunkStore::stats() const
+{
+    Stats stats;
+    {
+        std::lock_guard<std::mutex> lock(indexMutex);
+        stats = counters;
+    }
+    std::lock_guard<std::mutex> lock(queueMutex);
+    stats.queuedWrites = (int)queue.size() + (writing ? 1 : 0);
+    stats.queuedBytes = queuedBytes;
+    return stats;
+}
+
+void ChunkStore::resetCounters()
+{
+    std::lock_guard<std::mutex> lock(indexMutex);
+    Stats cleared;
+    cleared.records = counters.records;
+    cleared.packBytes = counters.packBytes;
+    counters = cleared;
+}
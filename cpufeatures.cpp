@@ -0,0 +1,96 @@
+#include "include/cpufeatures.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#define CPUFEATURES_X86_GNU
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#include <immintrin.h>
+#define CPUFEATURES_X86_MSVC
+#endif
+
+#if defined(CPUFEATURES_X86_GNU) || defined(CPUFEATURES_X86_MSVC)
+static void cpuid(unsigned int leaf, unsigned int subleaf, unsigned int regs[4])
+{
+#if defined(CPUFEATURES_X86_GNU)
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#else
+    int out[4];
+    __cpuidex(out, (int)leaf, (int)subleaf);
+    for (int i = 0; i < 4; ++i)
+        regs[i] = (unsigned int)out[i];
+#endif
+}
+
+// which register states the OS saves on context switch; a CPU flag alone is not enough
+static unsigned long long xgetbv0()
+{
+#if defined(CPUFEATURES_X86_GNU)
+    unsigned int eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((unsigned long long)edx << 32) | eax;
+#else
+    return _xgetbv(0);
+#endif
+}
+
+static SimdLevel queryCpu()
+{
+    unsigned int regs[4];
+    cpuid(0, 0, regs);
+    unsigned int maxLeaf = regs[0];
+    if (maxLeaf < 1)
+        return SimdLevel::Scalar;
+
+    cpuid(1, 0, regs);
+    bool sse41 = (regs[2] & (1u << 19)) != 0;
+    bool osxsave = (regs[2] & (1u << 27)) != 0;
+    bool avx = (regs[2] & (1u << 28)) != 0;
+    bool fma = (regs[2] & (1u << 12)) != 0;
+    if (!sse41)
+        return SimdLevel::Scalar;
+    if (!osxsave || !avx || maxLeaf < 7)
+        return SimdLevel::SSE41;
+
+    unsigned long long xcr0 = xgetbv0();
+    bool ymmState = (xcr0 & 0x6) == 0x6;
+    bool zmmState = (xcr0 & 0xE6) == 0xE6;
+
+    cpuid(7, 0, regs);
+    bool avx2 = (regs[1] & (1u << 5)) != 0;
+    bool avx512f = (regs[1] & (1u << 16)) != 0;
+
+    if (!avx2 || !ymmState)
+        return SimdLevel::SSE41;
+    // -mavx512f lets the compiler use AVX2 and FMA in those files too, so they must be there as well
+    if (avx512f && fma && zmmState)
+        return SimdLevel::AVX512;
+    return SimdLevel::AVX2;
+}
+#else
+static SimdLevel queryCpu()
+{
+    return SimdLevel::Scalar;
+}
+#endif
+
+SimdLevel detectSimdLevel()
+{
+    static const SimdLevel level = queryCpu();
+    return level;
+}
+
+const char *simdLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::SSE41:
+        return "SSE4.1";
+    case SimdLevel::AVX2:
+        return "AVX2";
+    case SimdLevel::AVX512:
+        return "AVX-512";
+    default:
+        return "Scalar";
+    }
+}
@@ -0,0 +1,586 @@
+#include "include/cpumesher.h"
+#include "include/cubeclassify.h"
+#include "include/edgetable.h"
+#include "include/tritable.h"
+#include "include/glslmath.h"
+#include "include/parallel.h"
+#include <algorithm>
+#include <cmath>
+
+static const float isoLevel = 0.0f;
+
+// cube corner offsets in the order marchingCube.comp.glsl uses; edgeCorners comes with tritable
+static const int cornerOffsets[8][3] = {
+    {0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0}, {0, 0, 1}, {1, 0, 1}, {1, 1, 1}, {0, 1, 1}};
+// sample owning each edge (relative to the cell) and the edge's axis, as edgeOwners in meshIndices.comp.glsl
+static const int edgeOwners[12][4] = {
+    {0, 0, 0, 0}, {1, 0, 0, 1}, {0, 1, 0, 0}, {0, 0, 0, 1}, {0, 0, 1, 0}, {1, 0, 1, 1},
+    {0, 1, 1, 0}, {0, 0, 1, 1}, {0, 0, 0, 2}, {1, 0, 0, 2}, {1, 1, 0, 2}, {0, 1, 0, 2}};
+
+static glm::vec3 mixv(const glm::vec3 &a, const glm::vec3 &b, float t)
+{
+    return glm::vec3(mixf(a.x, b.x, t), mixf(a.y, b.y, t), mixf(a.z, b.z, t));
+}
+
+static float lengthv(const glm::vec3 &v)
+{
+    return std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+}
+
+static glm::vec3 interpolateVertex(const glm::vec3 &p1, const glm::vec3 &p2, float val1, float val2)
+{
+    if (std::fabs(isoLevel - val1) < 0.00001f)
+        return p1;
+    if (std::fabs(isoLevel - val2) < 0.00001f)
+        return p2;
+    if (std::fabs(val1 - val2) < 0.00001f)
+        return p1;
+    float t = (isoLevel - val1) / (val2 - val1);
+    return mixv(p1, p2, clampf(t, 0.0f, 1.0f));
+}
+
+static glm::vec3 interpolateNormal(const glm::vec3 &normal0, const glm::vec3 &normal1, float val0, float val1)
+{
+    if (std::fabs(isoLevel - val0) < 0.00001f)
+        return normal0;
+    if (std::fabs(isoLevel - val1) < 0.00001f)
+        return normal1;
+    if (std::fabs(val0 - val1) < 0.00001f)
+        return normal0;
+
+    float t = (isoLevel - val0) / (val1 - val0);
+    glm::vec3 n = mixv(normal0, normal1, t);
+
+    float length = lengthv(n);
+    if (length < 0.0001f)
+        return normal0;
+    return n / length;
+}
+
+// PACKED_POSITION_SCALE / PACKED_POSITION_OFFSET in meshCommon.glsl
+static const float PACKED_POSITION_SCALE = 512.0f;
+static const float PACKED_POSITION_OFFSET = 1.0f;
+
+static float signNotZero(float v)
+{
+    return v >= 0.0f ? 1.0f : -1.0f;
+}
+
+PackedVertex packVertex(const VertexNormal &vertex)
+{
+    PackedVertex packed;
+    for (int c = 0; c < 3; ++c)
+    {
+        float q = std::round((vertex.position[c] + PACKED_POSITION_OFFSET) * PACKED_POSITION_SCALE);
+        packed.position[c] = (uint16_t)clampf(q, 0.0f, 65535.0f);
+    }
+    packed.spare = 0;
+
+    // octahedralEncode, then packSnorm2x16
+    glm::vec3 n = vertex.normal;
+    n = n / std::max(std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z), 1e-6f);
+    float ex = n.x;
+    float ey = n.y;
+    if (n.z < 0.0f)
+    {
+        ex = (1.0f - std::fabs(n.y)) * signNotZero(n.x);
+        ey = (1.0f - std::fabs(n.x)) * signNotZero(n.y);
+    }
+    packed.normal[0] = (int16_t)std::round(clampf(ex, -1.0f, 1.0f) * 32767.0f);
+    packed.normal[1] = (int16_t)std::round(clampf(ey, -1.0f, 1.0f) * 32767.0f);
+    return packed;
+}
+
+VertexNormal unpackVertex(const PackedVertex &packed)
+{
+    VertexNormal vertex;
+    vertex.position = glm::vec4(packed.position[0] / PACKED_POSITION_SCALE - PACKED_POSITION_OFFSET,
+                                packed.position[1] / PACKED_POSITION_SCALE - PACKED_POSITION_OFFSET,
+                                packed.position[2] / PACKED_POSITION_SCALE - PACKED_POSITION_OFFSET, 1.0f);
+
+    float ex = std::max(packed.normal[0] / 32767.0f, -1.0f);
+    float ey = std::max(packed.normal[1] / 32767.0f, -1.0f);
+    glm::vec3 n(ex, ey, 1.0f - std::fabs(ex) - std::fabs(ey));
+    if (n.z < 0.0f)
+    {
+        n.x = (1.0f - std::fabs(ey)) * signNotZero(ex);
+        n.y = (1.0f - std::fabs(ex)) * signNotZero(ey);
+    }
+    vertex.normal = n / lengthv(n);
+    vertex.pad = 0.0f;
+    return vertex;
+}
+
+CpuMesher::CpuMesher(int densitySize) : densitySize(densitySize)
+{
+}
+
+float CpuMesher::sample(const std::vector<float> &density, int x, int y, int z) const
+{
+    x = std::min(std::max(x, 0), densitySize - 1);
+    y = std::min(std::max(y, 0), densitySize - 1);
+    z = std::min(std::max(z, 0), densitySize - 1);
+    return density[x + (size_t)y * densitySize + (size_t)z * densitySize * densitySize];
+}
+
+glm::vec3 CpuMesher::centralDifference(const std::vector<float> &density, int x, int y, int z) const
+{
+    glm::vec3 n(sample(density, x - 1, y, z) - sample(density, x + 1, y, z),
+                sample(density, x, y - 1, z) - sample(density, x, y + 1, z),
+                sample(density, x, y, z - 1) - sample(density, x, y, z + 1));
+
+    float length = lengthv(n);
+    if (length < 0.0001f)
+        return glm::vec3(0.0f, 1.0f, 0.0f);
+    return n / length;
+}
+
+bool CpuMesher::cellInRange(int x, int z) const
+{
+    return cellRange.y == 0 || (x >= cellRange.x && x <= cellRange.y && z >= cellRange.x && z <= cellRange.y);
+}
+
+bool CpuMesher::edgeInRange(int x, int z, int axis) const
+{
+    // along x or z the edge belongs to cell x or z alone, across them to the cells on both sides
+    int xEnd = cellRange.y + (axis == 0 ? 0 : 1);
+    int zEnd = cellRange.y + (axis == 2 ? 0 : 1);
+    return cellRange.y == 0 || (x >= cellRange.x && x <= xEnd && z >= cellRange.x && z <= zEnd);
+}
+
+bool CpuMesher::onCellRangeBorder(int x, int z) const
+{
+    return cellRange.y != 0 && (x == cellRange.x || x == cellRange.y || z == cellRange.x || z == cellRange.y);
+}
+
+void CpuMesher::computeGradients(const std::vector<float> &density, std::vector<glm::vec3> &gradients) const
+{
+    gradients.resize((size_t)densitySize * densitySize * densitySize);
+    parallelForSlabs(0, densitySize * densitySize, threadCount, [&](int rowBegin, int rowEnd, int)
+                     {
+        size_t i = (size_t)rowBegin * densitySize;
+        for (int row = rowBegin; row < rowEnd; ++row)
+        {
+            int y = row % densitySize;
+            int z = row / densitySize;
+            for (int x = 0; x < densitySize; ++x)
+                gradients[i++] = centralDifference(density, x, y, z);
+        } });
+}
+
+// concatenates the per-slab arenas in slab order: a prefix sum of their sizes gives each one's
+// offset, then every slab copies itself in parallel
+template <typename T>
+static void mergeArenas(const std::vector<std::vector<T>> &arenas, unsigned int threadCount, std::vector<T> &out, std::vector<size_t> &offsets)
+{
+    offsets.assign(arenas.size() + 1, 0);
+    for (size_t s = 0; s < arenas.size(); ++s)
+        offsets[s + 1] = offsets[s] + arenas[s].size();
+    out.resize(offsets.back());
+    parallelForSlabs(0, (int)arenas.size(), threadCount, [&](int begin, int end, int)
+                     {
+        for (int s = begin; s < end; ++s)
+            std::copy(arenas[s].begin(), arenas[s].end(), out.begin() + offsets[s]); });
+}
+
+// drops the vertices no index refers to, the rest keep their order
+static void removeUnreferenced(std::vector<VertexNormal> &vertices, std::vector<uint32_t> &indices)
+{
+    const uint32_t unused = 0xFFFFFFFFu;
+    std::vector<uint32_t> remap(vertices.size(), unused);
+    for (uint32_t index : indices)
+        remap[index] = 0;
+    uint32_t kept = 0;
+    for (size_t i = 0; i < vertices.size(); ++i)
+    {
+        if (remap[i] == unused)
+            continue;
+        remap[i] = kept;
+        vertices[kept++] = vertices[i];
+    }
+    if (kept == vertices.size())
+        return;
+    vertices.resize(kept);
+    for (uint32_t &index : indices)
+        index = remap[index];
+}
+
+void CpuMesher::mesh(const std::vector<float> &density, const std::vector<glm::vec3> *gradients, std::vector<VertexNormal> &vertices) const
+{
+    // every worker appends its slab of x rows to its own arena; merged in order, the result is the same as one thread's
+    std::vector<uint64_t> signs;
+    classifySigns(density, signs);
+    std::vector<std::vector<VertexNormal>> arenas(resolveThreadCount(threadCount));
+    parallelForSlabs(0, (densitySize - 1) * (densitySize - 1), threadCount, [&](int rowBegin, int rowEnd, int slab)
+                     { meshSlab(density, gradients, signs, rowBegin, rowEnd, arenas[slab]); });
+
+    std::vector<size_t> offsets;
+    mergeArenas(arenas, threadCount, vertices, offsets);
+}
+
+void CpuMesher::classifySigns(const std::vector<float> &density, std::vector<uint64_t> &signs) const
+{
+    signs.resize((size_t)densitySize * densitySize * CubeClassify::rowWords(densitySize));
+    parallelForSlabs(0, densitySize * densitySize, threadCount, [&](int rowBegin, int rowEnd, int)
+                     { CubeClassify::signRows(density.data(), densitySize, isoLevel, rowBegin, rowEnd, signs.data()); });
+}
+
+void CpuMesher::meshSlab(const std::vector<float> &density, const std::vector<glm::vec3> *gradients, const std::vector<uint64_t> &signs, int rowBegin, int rowEnd, std::vector<VertexNormal> &vertices) const
+{
+    const size_t plane = (size_t)densitySize * densitySize;
+    std::vector<uint8_t> cubeIndices(densitySize - 1);
+
+    for (int row = rowBegin; row < rowEnd; ++row)
+    {
+        int y = row % (densitySize - 1);
+        int z = row / (densitySize - 1);
+        if (!CubeClassify::cubeRow(signs.data(), densitySize, y, z, cubeIndices.data()))
+            continue;
+
+        for (int x = 0; x < densitySize - 1; ++x)
+        {
+            int cubeIndex = cubeIndices[x];
+            const EdgeList &edges = edgelists[cubeIndex];
+            if (edges.count == 0 || !cellInRange(x, z))
+                continue;
+
+            size_t corner[8];
+            float d[8];
+            for (int c = 0; c < 8; ++c)
+            {
+                corner[c] = (x + cornerOffsets[c][0]) + (y + cornerOffsets[c][1]) * (size_t)densitySize + (z + cornerOffsets[c][2]) * plane;
+                d[c] = density[corner[c]];
+            }
+
+            glm::vec3 basePos((float)x - 1.0f, (float)y - 1.0f, (float)z - 1.0f);
+            glm::vec3 n[8];
+            for (int c = 0; c < 8; ++c)
+            {
+                if (gradients)
+                    n[c] = (*gradients)[corner[c]];
+                else
+                    n[c] = centralDifference(density, x + cornerOffsets[c][0], y + cornerOffsets[c][1], z + cornerOffsets[c][2]);
+            }
+
+            glm::vec3 edgeVerts[12];
+            glm::vec3 edgeNormals[12];
+            for (int i = 0; i < edges.count; ++i)
+            {
+                int e = edges.edges[i];
+                int a = edgeCorners[e][0];
+                int b = edgeCorners[e][1];
+                glm::vec3 pa = basePos + glm::vec3((float)cornerOffsets[a][0], (float)cornerOffsets[a][1], (float)cornerOffsets[a][2]);
+                glm::vec3 pb = basePos + glm::vec3((float)cornerOffsets[b][0], (float)cornerOffsets[b][1], (float)cornerOffsets[b][2]);
+                edgeVerts[e] = interpolateVertex(pa, pb, d[a], d[b]);
+                edgeNormals[e] = interpolateNormal(n[a], n[b], d[a], d[b]);
+            }
+
+            const int8_t *tris = tritable[cubeIndex];
+            for (int i = 0; i < tricounts[cubeIndex] * 3; ++i)
+            {
+                VertexNormal vertex;
+                vertex.position = glm::vec4(edgeVerts[tris[i]], 1.0f);
+                vertex.normal = edgeNormals[tris[i]];
+                vertex.pad = 0.0f;
+                vertices.push_back(vertex);
+            }
+        }
+    }
+}
+
+glm::vec3 CpuMesher::borderNormal(const std::vector<float> &density, int x, int y, int z, int cellX, int cellZ) const
+{
+    glm::vec3 n(sample(density, x - 1, y, z) - sample(density, x + 1, y, z),
+                sample(density, x, y - 1, z) - sample(density, x, y + 1, z),
+                sample(density, x, y, z - 1) - sample(density, x, y, z + 1));
+    // across the border only the cell's own two samples, doubled to the scale of a central difference
+    if (cellX >= 0)
+        n.x = 2.0f * (sample(density, cellX, y, z) - sample(density, cellX + 1, y, z));
+    if (cellZ >= 0)
+        n.z = 2.0f * (sample(density, x, y, cellZ) - sample(density, x, y, cellZ + 1));
+
+    float length = lengthv(n);
+    if (length < 0.0001f)
+        return glm::vec3(0.0f, 1.0f, 0.0f);
+    return n / length;
+}
+
+glm::vec3 CpuMesher::cornerNormal(const std::vector<float> &density, const std::vector<glm::vec3> *gradients, int x, int y, int z) const
+{
+    if (gradients)
+        return (*gradients)[x + (size_t)y * densitySize + (size_t)z * densitySize * densitySize];
+    return centralDifference(density, x, y, z);
+}
+
+void CpuMesher::meshIndexed(const std::vector<float> &density, const std::vector<glm::vec3> *gradients, std::vector<VertexNormal> &vertices, std::vector<uint32_t> &indices) const
+{
+    const size_t plane = (size_t)densitySize * densitySize;
+    std::vector<uint32_t> edgeVertices(plane * densitySize * 3);
+    std::vector<std::vector<VertexNormal>> vertexArenas(resolveThreadCount(threadCount));
+    std::vector<std::vector<uint32_t>> indexArenas(vertexArenas.size());
+
+    // pass 1: the vertex on each crossing edge a cell in the range uses, interpolated from the owning
+    // sample towards +axis. each slab numbers its vertices from 0 and fixes up its edge map once the slab
+    // offsets are known
+    parallelForSlabs(0, densitySize * densitySize, threadCount, [&](int rowBegin, int rowEnd, int slab)
+                     {
+        std::vector<VertexNormal> &arena = vertexArenas[slab];
+        for (int row = rowBegin; row < rowEnd; ++row)
+        {
+            int y = row % densitySize;
+            int z = row / densitySize;
+            for (int x = 0; x < densitySize; ++x)
+            {
+                size_t sample = x + (size_t)y * densitySize + (size_t)z * plane;
+                float d0 = density[sample];
+                glm::vec3 p0((float)x - 1.0f, (float)y - 1.0f, (float)z - 1.0f);
+
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    int other[3] = {x, y, z};
+                    other[axis] += 1;
+                    if (other[axis] >= densitySize || !edgeInRange(x, z, axis))
+                        continue;
+
+                    float d1 = density[other[0] + (size_t)other[1] * densitySize + (size_t)other[2] * plane];
+                    if ((d0 < isoLevel) == (d1 < isoLevel))
+                        continue;
+
+                    glm::vec3 p1((float)other[0] - 1.0f, (float)other[1] - 1.0f, (float)other[2] - 1.0f);
+                    VertexNormal vertex;
+                    vertex.position = glm::vec4(interpolateVertex(p0, p1, d0, d1), 1.0f);
+                    vertex.normal = interpolateNormal(cornerNormal(density, gradients, x, y, z),
+                                                      cornerNormal(density, gradients, other[0], other[1], other[2]), d0, d1);
+                    vertex.pad = 0.0f;
+                    edgeVertices[sample * 3 + axis] = (uint32_t)arena.size();
+                    arena.push_back(vertex);
+                }
+            }
+        } });
+
+    std::vector<size_t> offsets;
+    mergeArenas(vertexArenas, threadCount, vertices, offsets);
+    // same slabs as above; entries of edges without a vertex are never read, so they can be shifted too
+    parallelForSlabs(0, densitySize * densitySize, threadCount, [&](int rowBegin, int rowEnd, int slab)
+                     {
+        uint32_t offset = (uint32_t)offsets[slab];
+        for (size_t i = (size_t)rowBegin * densitySize * 3; i < (size_t)rowEnd * densitySize * 3; ++i)
+            edgeVertices[i] += offset; });
+
+    // pass 2: each cell's triangles as references to the edges it shares with its neighbours
+    std::vector<uint64_t> signs;
+    classifySigns(density, signs);
+    parallelForSlabs(0, (densitySize - 1) * (densitySize - 1), threadCount, [&](int rowBegin, int rowEnd, int slab)
+                     {
+        std::vector<uint32_t> &arena = indexArenas[slab];
+        std::vector<uint8_t> cubeIndices(densitySize - 1);
+        for (int row = rowBegin; row < rowEnd; ++row)
+        {
+            int y = row % (densitySize - 1);
+            int z = row / (densitySize - 1);
+            if (!CubeClassify::cubeRow(signs.data(), densitySize, y, z, cubeIndices.data()))
+                continue;
+
+            for (int x = 0; x < densitySize - 1; ++x)
+            {
+                if (!cellInRange(x, z))
+                    continue;
+                const int8_t *tris = tritable[cubeIndices[x]];
+                for (int i = 0; i < tricounts[cubeIndices[x]] * 3; ++i)
+                {
+                    const int *owner = edgeOwners[tris[i]];
+                    size_t sample = (x + owner[0]) + (y + owner[1]) * (size_t)densitySize + (z + owner[2]) * plane;
+                    arena.push_back(edgeVertices[sample * 3 + owner[3]]);
+                }
+            }
+        } });
+
+    mergeArenas(indexArenas, threadCount, indices, offsets);
+}
+
+// regularisation towards the mass point, as QEF_BIAS in surfaceNetsVertices.comp.glsl. keeps flat and
+// edge-only cells, whose QEF is rank 1 or 2, from sliding along the surface
+static const float QEF_BIAS = 0.05f;
+
+// minimises sum (n_i . (x - p_i))^2 + QEF_BIAS * |x - massPoint|^2 relative to the mass point, by
+// Cramer's rule on the 3x3 normal equations; the bias keeps the determinant away from zero
+static glm::vec3 solveQef(const float ata[6], const glm::vec3 &atb, const glm::vec3 &massPoint)
+{
+    float a00 = ata[0] + QEF_BIAS, a01 = ata[1], a02 = ata[2];
+    float a11 = ata[3] + QEF_BIAS, a12 = ata[4], a22 = ata[5] + QEF_BIAS;
+    float c0 = a11 * a22 - a12 * a12;
+    float c1 = a02 * a12 - a01 * a22;
+    float c2 = a01 * a12 - a02 * a11;
+    float det = a00 * c0 + a01 * c1 + a02 * c2;
+    if (std::fabs(det) < 1e-12f)
+        return massPoint;
+    glm::vec3 delta((c0 * atb.x + c1 * atb.y + c2 * atb.z) / det,
+                    (c1 * atb.x + (a00 * a22 - a02 * a02) * atb.y + (a02 * a01 - a00 * a12) * atb.z) / det,
+                    (c2 * atb.x + (a01 * a02 - a00 * a12) * atb.y + (a00 * a11 - a01 * a01) * atb.z) / det);
+    return massPoint + delta;
+}
+
+VertexNormal CpuMesher::dualVertex(const std::vector<float> &density, const std::vector<glm::vec3> *gradients, int x, int y, int z, int cubeIndex, bool dualContouring) const
+{
+    const size_t plane = (size_t)densitySize * densitySize;
+    glm::vec3 basePos((float)x - 1.0f, (float)y - 1.0f, (float)z - 1.0f);
+    // a border cell is made by both chunks, and one of them has its corner on the first sample, where
+    // the gradient is one-sided. across the border both take the difference inside the cell instead,
+    // so the two copies of the vertex get the same normal
+    int borderX = cellRange.y != 0 && (x == cellRange.x || x == cellRange.y) ? x : -1;
+    int borderZ = cellRange.y != 0 && (z == cellRange.x || z == cellRange.y) ? z : -1;
+    float d[8];
+    glm::vec3 n[8];
+    for (int c = 0; c < 8; ++c)
+    {
+        int cx = x + cornerOffsets[c][0];
+        int cy = y + cornerOffsets[c][1];
+        int cz = z + cornerOffsets[c][2];
+        d[c] = density[cx + cy * (size_t)densitySize + cz * plane];
+        if (borderX >= 0 || borderZ >= 0)
+            n[c] = borderNormal(density, cx, cy, cz, borderX, borderZ);
+        else
+            n[c] = cornerNormal(density, gradients, cx, cy, cz);
+    }
+
+    // the same crossing points and normals marching cubes would put on the cell's edges
+    const EdgeList &edges = edgelists[cubeIndex];
+    glm::vec3 points[12];
+    glm::vec3 normals[12];
+    glm::vec3 massPoint(0.0f);
+    glm::vec3 normalSum(0.0f);
+    for (int i = 0; i < edges.count; ++i)
+    {
+        int a = edgeCorners[edges.edges[i]][0];
+        int b = edgeCorners[edges.edges[i]][1];
+        glm::vec3 pa = basePos + glm::vec3((float)cornerOffsets[a][0], (float)cornerOffsets[a][1], (float)cornerOffsets[a][2]);
+        glm::vec3 pb = basePos + glm::vec3((float)cornerOffsets[b][0], (float)cornerOffsets[b][1], (float)cornerOffsets[b][2]);
+        points[i] = interpolateVertex(pa, pb, d[a], d[b]);
+        normals[i] = interpolateNormal(n[a], n[b], d[a], d[b]);
+        massPoint += points[i];
+        normalSum += normals[i];
+    }
+    massPoint /= (float)edges.count;
+
+    VertexNormal vertex;
+    glm::vec3 position = massPoint;
+    if (dualContouring)
+    {
+        // upper triangle of A^T A and A^T b for the planes through each crossing, relative to the mass point
+        float ata[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+        glm::vec3 atb(0.0f);
+        for (int i = 0; i < edges.count; ++i)
+        {
+            const glm::vec3 &m = normals[i];
+            float b = m.x * (points[i].x - massPoint.x) + m.y * (points[i].y - massPoint.y) + m.z * (points[i].z - massPoint.z);
+            ata[0] += m.x * m.x;
+            ata[1] += m.x * m.y;
+            ata[2] += m.x * m.z;
+            ata[3] += m.y * m.y;
+            ata[4] += m.y * m.z;
+            ata[5] += m.z * m.z;
+            atb += m * b;
+        }
+        position = solveQef(ata, atb, massPoint);
+        for (int c = 0; c < 3; ++c)
+            position[c] = clampf(position[c], basePos[c], basePos[c] + 1.0f);
+    }
+    vertex.position = glm::vec4(position, 1.0f);
+    float length = lengthv(normalSum);
+    vertex.normal = length < 0.0001f ? normals[0] : normalSum / length;
+    vertex.pad = 0.0f;
+    return vertex;
+}
+
+void CpuMesher::meshSurfaceNets(const std::vector<float> &density, const std::vector<glm::vec3> *gradients, bool dualContouring, std::vector<VertexNormal> &vertices, std::vector<uint32_t> &indices) const
+{
+    const int cells = densitySize - 1;
+    const size_t plane = (size_t)densitySize * densitySize;
+    std::vector<uint32_t> cellVertices((size_t)cells * cells * cells);
+    std::vector<std::vector<VertexNormal>> vertexArenas(resolveThreadCount(threadCount));
+    std::vector<std::vector<uint32_t>> indexArenas(vertexArenas.size());
+    std::vector<uint64_t> signs;
+    classifySigns(density, signs);
+
+    // pass 1: one vertex per cell in the range that crosses the surface, numbered per slab and fixed up
+    // below. the range includes the border cells the quads on its edge reach into
+    parallelForSlabs(0, cells * cells, threadCount, [&](int rowBegin, int rowEnd, int slab)
+                     {
+        std::vector<VertexNormal> &arena = vertexArenas[slab];
+        std::vector<uint8_t> cubeIndices(cells);
+        for (int row = rowBegin; row < rowEnd; ++row)
+        {
+            int y = row % cells;
+            int z = row / cells;
+            if (!CubeClassify::cubeRow(signs.data(), densitySize, y, z, cubeIndices.data()))
+                continue;
+
+            for (int x = 0; x < cells; ++x)
+            {
+                if (edgelists[cubeIndices[x]].count == 0 || !cellInRange(x, z))
+                    continue;
+                // mass point on the range border, as surfaceNetsVertices.comp.glsl
+                cellVertices[x + (size_t)row * cells] = (uint32_t)arena.size();
+                arena.push_back(dualVertex(density, gradients, x, y, z, cubeIndices[x], dualContouring && !onCellRangeBorder(x, z)));
+            }
+        } });
+
+    std::vector<size_t> offsets;
+    mergeArenas(vertexArenas, threadCount, vertices, offsets);
+    parallelForSlabs(0, cells * cells, threadCount, [&](int rowBegin, int rowEnd, int slab)
+                     {
+        uint32_t offset = (uint32_t)offsets[slab];
+        for (size_t i = (size_t)rowBegin * cells; i < (size_t)rowEnd * cells; ++i)
+            cellVertices[i] += offset; });
+
+    // pass 2: a quad around every crossing edge the four cells sharing it all exist for, as two triangles
+    parallelForSlabs(0, densitySize * densitySize, threadCount, [&](int rowBegin, int rowEnd, int slab)
+                     {
+        std::vector<uint32_t> &arena = indexArenas[slab];
+        for (int row = rowBegin; row < rowEnd; ++row)
+        {
+            int y = row % densitySize;
+            int z = row / densitySize;
+            for (int x = 0; x < densitySize; ++x)
+            {
+                // with a cell range only samples in (x, y] own edges, as in surfaceNetsQuads.comp.glsl
+                if (cellRange.y != 0 && (x <= cellRange.x || x > cellRange.y || z <= cellRange.x || z > cellRange.y))
+                    continue;
+                int p[3] = {x, y, z};
+                bool inside = density[x + (size_t)row * densitySize] < isoLevel;
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    // u and v span the plane across the edge, so (axis, u, v) is right-handed
+                    int u = (axis + 1) % 3;
+                    int v = (axis + 2) % 3;
+                    if (p[axis] >= cells || p[u] < 1 || p[u] >= cells || p[v] < 1 || p[v] >= cells)
+                        continue;
+                    int q[3] = {x, y, z};
+                    q[axis] += 1;
+                    if ((density[q[0] + q[1] * (size_t)densitySize + q[2] * plane] < isoLevel) == inside)
+                        continue;
+
+                    int c[3] = {x, y, z};
+                    uint32_t quad[4];
+                    for (int corner = 0; corner < 4; ++corner)
+                    {
+                        // (0,0), (1,0), (1,1), (0,1) in (u, v), stepping back from the edge's owner
+                        c[u] = p[u] - ((corner == 0 || corner == 3) ? 1 : 0);
+                        c[v] = p[v] - ((corner == 0 || corner == 1) ? 1 : 0);
+                        quad[corner] = cellVertices[c[0] + (c[1] + (size_t)c[2] * cells) * cells];
+                    }
+                    // wound like the marching cubes triangles: by which end of the edge is inside
+                    if (inside)
+                        std::swap(quad[1], quad[3]);
+                    uint32_t tris[6] = {quad[0], quad[1], quad[2], quad[0], quad[2], quad[3]};
+                    arena.insert(arena.end(), tris, tris + 6);
+                }
+            }
+        } });
+
+    mergeArenas(indexArenas, threadCount, indices, offsets);
+    // a border cell whose crossing edges all belong to the neighbouring range gets no quad. without a
+    // range every crossing cell keeps its vertex, one per cell as surfaceNetsVertices.comp.glsl has it
+    if (cellRange.y != 0)
+        removeUnreferenced(vertices, indices);
+}
@@ -0,0 +1,93 @@
+#include "include/cubeclassify.h"
+#include <atomic>
+
+namespace CubeClassify
+{
+    static std::atomic<int> levelCap{(int)SimdLevel::AVX512};
+
+    SimdLevel activeLevel()
+    {
+        int detected = (int)detectSimdLevel();
+        int cap = levelCap.load(std::memory_order_relaxed);
+        return (SimdLevel)(detected < cap ? detected : cap);
+    }
+
+    void forceLevel(SimdLevel level)
+    {
+        levelCap.store((int)level, std::memory_order_relaxed);
+    }
+
+    void signRows(const float *density, int densitySize, float isoLevel, int rowBegin, int rowEnd, uint64_t *signs)
+    {
+        // a level whose translation unit was built without that ISA does 0 samples, so fall through
+        SimdLevel level = activeLevel();
+        int words = rowWords(densitySize);
+        for (int r = rowBegin; r < rowEnd; ++r)
+        {
+            const float *row = density + (size_t)r * densitySize;
+            uint64_t *bits = signs + (size_t)r * words;
+            for (int w = 0; w < words; ++w)
+                bits[w] = 0;
+
+            int x = 0;
+            if (level >= SimdLevel::AVX512)
+                x = signRowAVX512(row, densitySize, isoLevel, bits);
+            if (x == 0 && level >= SimdLevel::AVX2)
+                x = signRowAVX2(row, densitySize, isoLevel, bits);
+            for (; x < densitySize; ++x)
+            {
+                if (row[x] < isoLevel)
+                    bits[x >> 6] |= 1ull << (x & 63);
+            }
+        }
+    }
+
+    bool cubeRow(const uint64_t *signs, int densitySize, int y, int z, uint8_t *cubeIndices)
+    {
+        int words = rowWords(densitySize);
+        const uint64_t *rows[4] = {
+            signs + (size_t)(y + z * densitySize) * words,
+            signs + (size_t)(y + 1 + z * densitySize) * words,
+            signs + (size_t)(y + (z + 1) * densitySize) * words,
+            signs + (size_t)(y + 1 + (z + 1) * densitySize) * words};
+
+        // all four rows entirely outside or entirely inside: every cell is 0 or 255
+        bool anyInside = false;
+        bool anyOutside = false;
+        for (int w = 0; w < words; ++w)
+        {
+            int valid = densitySize - w * 64;
+            if (valid <= 0)
+                break;
+            uint64_t mask = valid >= 64 ? ~0ull : (1ull << valid) - 1;
+            for (int r = 0; r < 4; ++r)
+            {
+                anyInside |= (rows[r][w] & mask) != 0;
+                anyOutside |= (~rows[r][w] & mask) != 0;
+            }
+        }
+        if (!anyInside || !anyOutside)
+            return false;
+
+        int cells = densitySize - 1;
+        SimdLevel level = activeLevel();
+        int x = 0;
+        if (level >= SimdLevel::AVX512)
+            x = cubeRowAVX512(rows, cells, cubeIndices);
+        if (x == 0 && level >= SimdLevel::AVX2)
+            x = cubeRowAVX2(rows, cells, cubeIndices);
+        for (; x < cells; ++x)
+        {
+            int x1 = x + 1;
+            cubeIndices[x] = (uint8_t)(((rows[0][x >> 6] >> (x & 63)) & 1) |
+                                       ((rows[0][x1 >> 6] >> (x1 & 63)) & 1) << 1 |
+                                       ((rows[1][x1 >> 6] >> (x1 & 63)) & 1) << 2 |
+                                       ((rows[1][x >> 6] >> (x & 63)) & 1) << 3 |
+                                       ((rows[2][x >> 6] >> (x & 63)) & 1) << 4 |
+                                       ((rows[2][x1 >> 6] >> (x1 & 63)) & 1) << 5 |
+                                       ((rows[3][x1 >> 6] >> (x1 & 63)) & 1) << 6 |
+                                       ((rows[3][x >> 6] >> (x & 63)) & 1) << 7);
+        }
+        return true;
+    }
+}
@@ -0,0 +1,59 @@
+// built with -mavx2 (see CMakeLists.txt)
+#include "include/cubeclassify.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+// one byte per bit of a 32-bit mask, 0xff where the bit is set: broadcast, give every byte the mask
+// byte holding its bit, keep only that bit and compare
+static inline __m256i expandBits(uint32_t mask)
+{
+    const __m256i byteOfBit = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+                                               2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+    const __m256i bitOfByte = _mm256_set1_epi64x((long long)0x8040201008040201ull);
+    __m256i bytes = _mm256_shuffle_epi8(_mm256_set1_epi32((int)mask), byteOfBit);
+    return _mm256_cmpeq_epi8(_mm256_and_si256(bytes, bitOfByte), bitOfByte);
+}
+
+int CubeClassify::signRowAVX2(const float *row, int count, float isoLevel, uint64_t *bits)
+{
+    const __m256 iso = _mm256_set1_ps(isoLevel);
+    int x = 0;
+    for (; x + 8 <= count; x += 8)
+    {
+        // ordered compare, so NaN is outside like the scalar <
+        int mask = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(row + x), iso, _CMP_LT_OQ));
+        bits[x >> 6] |= (uint64_t)mask << (x & 63);
+    }
+    return x;
+}
+
+int CubeClassify::cubeRowAVX2(const uint64_t *const rows[4], int cells, uint8_t *cubeIndices)
+{
+    int x = 0;
+    for (; x + 32 <= cells; x += 32)
+    {
+        // corner c of cell x is bit x or x + 1 of one of the rows, as cornerOffsets in cpumesher.cpp
+        __m256i index = _mm256_and_si256(expandBits(rowBits(rows[0], x)), _mm256_set1_epi8(1));
+        index = _mm256_or_si256(index, _mm256_and_si256(expandBits(rowBits(rows[0], x + 1)), _mm256_set1_epi8(2)));
+        index = _mm256_or_si256(index, _mm256_and_si256(expandBits(rowBits(rows[1], x + 1)), _mm256_set1_epi8(4)));
+        index = _mm256_or_si256(index, _mm256_and_si256(expandBits(rowBits(rows[1], x)), _mm256_set1_epi8(8)));
+        index = _mm256_or_si256(index, _mm256_and_si256(expandBits(rowBits(rows[2], x)), _mm256_set1_epi8(16)));
+        index = _mm256_or_si256(index, _mm256_and_si256(expandBits(rowBits(rows[2], x + 1)), _mm256_set1_epi8(32)));
+        index = _mm256_or_si256(index, _mm256_and_si256(expandBits(rowBits(rows[3], x + 1)), _mm256_set1_epi8(64)));
+        index = _mm256_or_si256(index, _mm256_and_si256(expandBits(rowBits(rows[3], x)), _mm256_set1_epi8((char)128)));
+        _mm256_storeu_si256((__m256i *)(cubeIndices + x), index);
+    }
+    return x;
+}
+#else
+int CubeClassify::signRowAVX2(const float *, int, float, uint64_t *)
+{
+    return 0;
+}
+
+int CubeClassify::cubeRowAVX2(const uint64_t *const[4], int, uint8_t *)
+{
+    return 0;
+}
+#endif
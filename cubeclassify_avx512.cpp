@@ -0,0 +1,48 @@
+// built with -mavx512f (see CMakeLists.txt)
+#include "include/cubeclassify.h"
+
+#if defined(__AVX512F__)
+#include <immintrin.h>
+
+int CubeClassify::signRowAVX512(const float *row, int count, float isoLevel, uint64_t *bits)
+{
+    const __m512 iso = _mm512_set1_ps(isoLevel);
+    for (int x = 0; x < count; x += 16)
+    {
+        // the tail is a masked load and compare, so the whole row is done here
+        __mmask16 lanes = count - x >= 16 ? (__mmask16)0xffff : (__mmask16)((1u << (count - x)) - 1);
+        __mmask16 mask = _mm512_mask_cmp_ps_mask(lanes, _mm512_maskz_loadu_ps(lanes, row + x), iso, _CMP_LT_OQ);
+        bits[x >> 6] |= (uint64_t)mask << (x & 63);
+    }
+    return count;
+}
+
+int CubeClassify::cubeRowAVX512(const uint64_t *const rows[4], int cells, uint8_t *cubeIndices)
+{
+    int x = 0;
+    for (; x + 16 <= cells; x += 16)
+    {
+        // a 16-bit sign mask selects the corner's bit into each dword lane directly; no byte shuffles needed
+        __m512i index = _mm512_maskz_mov_epi32((__mmask16)rowBits(rows[0], x), _mm512_set1_epi32(1));
+        index = _mm512_mask_or_epi32(index, (__mmask16)rowBits(rows[0], x + 1), index, _mm512_set1_epi32(2));
+        index = _mm512_mask_or_epi32(index, (__mmask16)rowBits(rows[1], x + 1), index, _mm512_set1_epi32(4));
+        index = _mm512_mask_or_epi32(index, (__mmask16)rowBits(rows[1], x), index, _mm512_set1_epi32(8));
+        index = _mm512_mask_or_epi32(index, (__mmask16)rowBits(rows[2], x), index, _mm512_set1_epi32(16));
+        index = _mm512_mask_or_epi32(index, (__mmask16)rowBits(rows[2], x + 1), index, _mm512_set1_epi32(32));
+        index = _mm512_mask_or_epi32(index, (__mmask16)rowBits(rows[3], x + 1), index, _mm512_set1_epi32(64));
+        index = _mm512_mask_or_epi32(index, (__mmask16)rowBits(rows[3], x), index, _mm512_set1_epi32(128));
+        _mm_storeu_si128((__m128i *)(cubeIndices + x), _mm512_cvtepi32_epi8(index));
+    }
+    return x;
+}
+#else
+int CubeClassify::signRowAVX512(const float *, int, float, uint64_t *)
+{
+    return 0;
+}
+
+int CubeClassify::cubeRowAVX512(const uint64_t *const[4], int, uint8_t *)
+{
+    return 0;
+}
+#endif
@@ -0,0 +1,528 @@
+#include "include/densitygenerator.h"
+#include "include/parallel.h"
+#include "include/glslmath.h"
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+// latticeCell() from coarseLattice.glsl along one axis, for every voxel coordinate
+struct LatticeAxis
+{
+    std::vector<int> cell;
+    std::vector<float> t;
+
+    LatticeAxis(int densitySize, int stride, int n) : cell(densitySize), t(densitySize)
+    {
+        for (int i = 0; i < densitySize; ++i)
+        {
+            float g = (float)i / (float)stride;
+            cell[i] = std::min((int)std::floor(g), n - 2);
+            t[i] = g - (float)cell[i];
+        }
+    }
+};
+
+// the y/z half of the trilinear reconstruction for a whole x row, component c of a field with
+// `components` floats per lattice point. the x half is mixf(line[cx], line[cx + 1], tx), as in the shader
+static void latticeLine(const float *field, int n, int components, int c, int cy, float ty, int cz, float tz, float *line)
+{
+    for (int i = 0; i < n; ++i)
+    {
+        auto at = [&](int dy, int dz)
+        {
+            return field[(i + (cy + dy) * n + (cz + dz) * n * n) * components + c];
+        };
+        line[i] = mixf(mixf(at(0, 0), at(1, 0), ty), mixf(at(0, 1), at(1, 1), ty), tz);
+    }
+}
+
+int DensityGenerator::latticeSize(int densitySize, int stride)
+{
+    return (densitySize - 1 + stride - 1) / stride + 1;
+}
+
+DensityGenerator::DensityGenerator(int densitySize) : densitySize(densitySize)
+{
+}
+
+DensityGenerator::NoiseSet DensityGenerator::createNoiseSet(int seed, const std::vector<Cave> &caves) const
+{
+    // mirrors the fnl_state setup in density.comp.glsl
+    NoiseSet noises;
+
+    noises.warpNoise.SetSeed(seed);
+    noises.warpNoise.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2);
+    noises.warpNoise.SetDomainWarpType(FastNoiseLite::DomainWarpType_OpenSimplex2);
+    noises.warpNoise.SetFrequency(0.005f);
+    noises.warpNoise.SetDomainWarpAmp(5.0f);
+
+    noises.terrainNoise.SetSeed(seed);
+    noises.terrainNoise.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2);
+    noises.terrainNoise.SetFractalType(FastNoiseLite::FractalType_FBm);
+    noises.terrainNoise.SetFrequency(0.01f);
+    noises.terrainNoise.SetFractalOctaves(4);
+
+    for (int i = 0; i < (int)caves.size(); ++i)
+    {
+        FastNoiseLite caveNoise(seed + i * 431);
+        caveNoise.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2);
+        caveNoise.SetFractalType(FastNoiseLite::FractalType_Ridged);
+        caveNoise.SetFrequency(caves[i].frequency);
+        caveNoise.SetFractalOctaves(2);
+        noises.caveNoise.push_back(caveNoise);
+
+        // low-frequency zone noise to cluster caves
+        FastNoiseLite zoneNoise(seed + 9999 + i * 131);
+        zoneNoise.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2);
+        zoneNoise.SetFractalType(FastNoiseLite::FractalType_FBm);
+        zoneNoise.SetFrequency(caves[i].zoneFrequency);
+        zoneNoise.SetFractalOctaves(2);
+        noises.zoneNoise.push_back(zoneNoise);
+    }
+
+    return noises;
+}
+
+void DensityGenerator::generate(int seed, const std::vector<Cave> &caves, float caveCeiling, const glm::vec3 &offset, std::vector<float> &density, CaveSkipStats *stats) const
+{
+    density.resize((size_t)densitySize * densitySize * densitySize);
+
+    std::vector<float> heightmap;
+    if (terrainMode == TERRAIN_HEIGHTMAP)
+    {
+        generateHeightmap(seed, offset, heightmap);
+    }
+
+    NoiseSet noises = createNoiseSet(seed, caves);
+    const float *columns = heightmap.empty() ? nullptr : heightmap.data();
+
+    CoarseFields coarse;
+    generateCoarseFields(noises, caves, offset, coarse);
+    float *out = density.data();
+    std::vector<CaveSkipStats> slabStats(resolveThreadCount(threadCount));
+
+    // each worker owns a contiguous range of z slices, so writes never overlap
+    parallelForSlabs(0, densitySize, threadCount, [&](int zBegin, int zEnd, int slab)
+                     { generateSlab(noises, caves, caveCeiling, offset, columns, coarse, zBegin, zEnd, out, slabStats[slab]); });
+
+    if (stats)
+    {
+        *stats = CaveSkipStats();
+        stats->evaluations = density.size() * caves.size();
+        for (const CaveSkipStats &slab : slabStats)
+        {
+            stats->caveNoiseSkipped += slab.caveNoiseSkipped;
+            stats->zoneNoiseSkipped += slab.zoneNoiseSkipped;
+        }
+    }
+}
+
+void DensityGenerator::generateCoarseFields(const NoiseSet &noises, const std::vector<Cave> &caves, const glm::vec3 &offset, CoarseFields &coarse) const
+{
+    // mirrors coarseFields.comp.glsl
+    int numCaves = (int)caves.size();
+    coarse.warpLattice = warpStride > 1 ? latticeSize(densitySize, warpStride) : 0;
+    coarse.zoneLattice = zoneStride > 1 && numCaves > 0 ? latticeSize(densitySize, zoneStride) : 0;
+    coarse.warp.resize((size_t)coarse.warpLattice * coarse.warpLattice * coarse.warpLattice * 3);
+    coarse.zone.resize((size_t)coarse.zoneLattice * coarse.zoneLattice * coarse.zoneLattice * numCaves);
+
+    // the warped positions of one lattice row, then either the displacement or the zone noise at them
+    auto warpRow = [&](int n, int stride, int j, int k, std::vector<float> &wx, std::vector<float> &wy, std::vector<float> &wz)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            wx[i] = ((float)(i * stride) + offset.x) - 1.0f;
+            wy[i] = ((float)(j * stride) + offset.y) - 1.0f;
+            wz[i] = ((float)(k * stride) + offset.z) - 1.0f;
+        }
+        noises.warpNoise.DomainWarpBatch(wx.data(), wy.data(), wz.data(), n);
+    };
+
+    if (coarse.warpLattice > 0)
+    {
+        int n = coarse.warpLattice;
+        parallelForSlabs(0, n, threadCount, [&](int kBegin, int kEnd, int)
+                         {
+            std::vector<float> wx(n), wy(n), wz(n);
+            for (int k = kBegin; k < kEnd; ++k)
+            {
+                for (int j = 0; j < n; ++j)
+                {
+                    warpRow(n, warpStride, j, k, wx, wy, wz);
+                    for (int i = 0; i < n; ++i)
+                    {
+                        size_t index = ((size_t)i + (size_t)j * n + (size_t)k * n * n) * 3;
+                        coarse.warp[index + 0] = wx[i] - (((float)(i * warpStride) + offset.x) - 1.0f);
+                        coarse.warp[index + 1] = wy[i] - (((float)(j * warpStride) + offset.y) - 1.0f);
+                        coarse.warp[index + 2] = wz[i] - (((float)(k * warpStride) + offset.z) - 1.0f);
+                    }
+                }
+            } });
+    }
+
+    if (coarse.zoneLattice > 0)
+    {
+        int n = coarse.zoneLattice;
+        size_t latticePoints = (size_t)n * n * n;
+        parallelForSlabs(0, n, threadCount, [&](int kBegin, int kEnd, int)
+                         {
+            std::vector<float> wx(n), wy(n), wz(n), px(n), py(n), pz(n);
+            for (int k = kBegin; k < kEnd; ++k)
+            {
+                for (int j = 0; j < n; ++j)
+                {
+                    // zone noise is sampled at the full-rate warped position of the lattice point
+                    warpRow(n, zoneStride, j, k, wx, wy, wz);
+                    for (int c = 0; c < numCaves; ++c)
+                    {
+                        for (int i = 0; i < n; ++i)
+                        {
+                            px[i] = wx[i] + caves[c].offset.x;
+                            py[i] = wy[i] + caves[c].offset.y;
+                            pz[i] = wz[i] + caves[c].offset.z;
+                        }
+                        float *out = coarse.zone.data() + c * latticePoints + (size_t)j * n + (size_t)k * n * n;
+                        noises.zoneNoise[c].GetNoiseBatch(px.data(), py.data(), pz.data(), out, n);
+                    }
+                }
+            } });
+    }
+}
+
+void DensityGenerator::generateHeightmap(int seed, const glm::vec3 &offset, std::vector<float> &heightmap) const
+{
+    // mirrors heightmap.comp.glsl
+    heightmap.resize((size_t)densitySize * densitySize);
+
+    NoiseSet noises = createNoiseSet(seed, std::vector<Cave>());
+    float *out = heightmap.data();
+
+    parallelForSlabs(0, densitySize, threadCount, [&](int zBegin, int zEnd, int)
+                     { generateHeightmapSlab(noises, offset, zBegin, zEnd, out); });
+}
+
+void DensityGenerator::generateHeightmapSlab(const NoiseSet &noises, const glm::vec3 &offset, int zBegin, int zEnd, float *heightmap) const
+{
+    size_t rowSize = (size_t)densitySize;
+    std::vector<float> warpX(rowSize), warpY(rowSize), warpZ(rowSize), zeros(rowSize, 0.0f), terrain(rowSize);
+
+    for (int z = zBegin; z < zEnd; ++z)
+    {
+        // warp on the y = 0 plane and keep only the xz displacement
+        for (size_t x = 0; x < rowSize; ++x)
+        {
+            warpX[x] = ((float)x + offset.x) - 1.0f;
+            warpY[x] = 0.0f;
+            warpZ[x] = ((float)z + offset.z) - 1.0f;
+        }
+        noises.warpNoise.DomainWarpBatch(warpX.data(), warpY.data(), warpZ.data(), rowSize);
+        noises.terrainNoise.GetNoiseBatch(warpX.data(), zeros.data(), warpZ.data(), terrain.data(), rowSize);
+
+        for (size_t x = 0; x < rowSize; ++x)
+        {
+            heightmap[x + (size_t)z * rowSize] = terrain[x] * 40.0f + 20.0f;
+        }
+    }
+}
+
+void DensityGenerator::generateSlab(const NoiseSet &noises, const std::vector<Cave> &caves, float caveCeiling, const glm::vec3 &offset, const float *heightmap, const CoarseFields &coarse, int zBegin, int zEnd, float *density, CaveSkipStats &stats) const
+{
+    const float caveThreshold = 0.67f;
+    int numCaves = (int)caves.size();
+    size_t rowSize = (size_t)densitySize;
+
+    // one x row at a time so every noise call is a single GetNoiseBatch / DomainWarpBatch
+    std::vector<float> worldX(rowSize), warpX(rowSize), warpY(rowSize), warpZ(rowSize);
+    std::vector<float> zeros(rowSize, 0.0f), terrain(rowSize), row(rowSize);
+    std::vector<float> px(rowSize), py(rowSize), pz(rowSize), zoneVal(rowSize), zoneMask(rowSize), caveSDF(rowSize);
+    std::vector<float> cx(rowSize), cy(rowSize), cz(rowSize), caveVal(rowSize);
+    std::vector<size_t> activeX(rowSize);
+
+    // lattice cells per voxel coordinate and a scratch line for the coarse fields
+    std::unique_ptr<LatticeAxis> warpAxis, zoneAxis;
+    if (coarse.warpLattice > 0)
+        warpAxis.reset(new LatticeAxis(densitySize, warpStride, coarse.warpLattice));
+    if (coarse.zoneLattice > 0)
+        zoneAxis.reset(new LatticeAxis(densitySize, zoneStride, coarse.zoneLattice));
+    std::vector<float> line(3 * (size_t)std::max(coarse.warpLattice, coarse.zoneLattice));
+
+    for (int x = 0; x < densitySize; ++x)
+    {
+        worldX[x] = ((float)x + offset.x) - 1.0f;
+    }
+
+    for (int z = zBegin; z < zEnd; ++z)
+    {
+        float worldZ = ((float)z + offset.z) - 1.0f;
+
+        for (int y = 0; y < densitySize; ++y)
+        {
+            float worldY = ((float)y + offset.y) - 1.0f;
+
+            // bedrock rows and the z walls are overwritten below, nothing to evaluate
+            if (y < 3 || (walls && (z == 0 || z == densitySize - 1)))
+            {
+                stats.caveNoiseSkipped += rowSize * numCaves;
+                stats.zoneNoiseSkipped += rowSize * numCaves;
+                for (int x = 0; x < densitySize; ++x)
+                {
+                    bool wall = (walls && (x == 0 || x == densitySize - 1 || z == 0 || z == densitySize - 1)) || y == 0;
+                    density[x + (size_t)y * densitySize + (size_t)z * densitySize * densitySize] = wall ? -10.0f : 100.0f;
+                }
+                continue;
+            }
+
+            // the two wall columns of this row
+            if (walls)
+            {
+                stats.caveNoiseSkipped += 2 * numCaves;
+                stats.zoneNoiseSkipped += 2 * numCaves;
+            }
+
+            if (coarse.warpLattice > 0)
+            {
+                int n = coarse.warpLattice;
+                const LatticeAxis &axis = *warpAxis;
+                for (int c = 0; c < 3; ++c)
+                {
+                    latticeLine(coarse.warp.data(), n, 3, c, axis.cell[y], axis.t[y], axis.cell[z], axis.t[z], line.data() + c * n);
+                }
+                for (int x = 0; x < densitySize; ++x)
+                {
+                    int cx = axis.cell[x];
+                    warpX[x] = worldX[x] + mixf(line[cx], line[cx + 1], axis.t[x]);
+                    warpY[x] = worldY + mixf(line[n + cx], line[n + cx + 1], axis.t[x]);
+                    warpZ[x] = worldZ + mixf(line[2 * n + cx], line[2 * n + cx + 1], axis.t[x]);
+                }
+            }
+            else
+            {
+                std::copy(worldX.begin(), worldX.end(), warpX.begin());
+                std::fill(warpY.begin(), warpY.end(), worldY);
+                std::fill(warpZ.begin(), warpZ.end(), worldZ);
+                noises.warpNoise.DomainWarpBatch(warpX.data(), warpY.data(), warpZ.data(), rowSize);
+            }
+
+            if (heightmap)
+            {
+                const float *columns = heightmap + (size_t)z * rowSize;
+                for (size_t x = 0; x < rowSize; ++x)
+                {
+                    row[x] = columns[x] - worldY;
+                }
+            }
+            else
+            {
+                noises.terrainNoise.GetNoiseBatch(warpX.data(), zeros.data(), warpZ.data(), terrain.data(), rowSize);
+                for (size_t x = 0; x < rowSize; ++x)
+                {
+                    float terrainHeight = terrain[x] * 40.0f + 20.0f;
+                    row[x] = terrainHeight - worldY;
+                }
+            }
+
+            float heightMask = clampf((caveCeiling - worldY) * 0.15f, 0.0f, 1.0f);
+
+            // masks first: a zero mask makes mixf(100, caveSDF, finalMask) exactly 100, so the noise behind it
+            // is skipped and only the smin against 100 is kept. x = 0 and x = densitySize - 1 are walls,
+            // unless there are none
+            size_t first = walls ? 1 : 0;
+            size_t interior = walls ? rowSize - 2 : rowSize;
+            size_t last = first + interior - 1;
+            for (int i = 0; i < numCaves; ++i)
+            {
+                const Cave &cave = caves[i];
+                std::fill(caveSDF.begin(), caveSDF.end(), 100.0f);
+
+                if (heightMask == 0.0f)
+                {
+                    stats.caveNoiseSkipped += interior;
+                    stats.zoneNoiseSkipped += interior;
+                }
+                else
+                {
+                    for (size_t x = first; x <= last; ++x)
+                    {
+                        px[x] = warpX[x] + cave.offset.x;
+                        py[x] = warpY[x] + cave.offset.y;
+                        pz[x] = warpZ[x] + cave.offset.z;
+                    }
+                    if (coarse.zoneLattice > 0)
+                    {
+                        int n = coarse.zoneLattice;
+                        const LatticeAxis &axis = *zoneAxis;
+                        const float *field = coarse.zone.data() + (size_t)i * n * n * n;
+                        latticeLine(field, n, 1, 0, axis.cell[y], axis.t[y], axis.cell[z], axis.t[z], line.data());
+                        for (size_t x = first; x <= last; ++x)
+                        {
+                            int cx = axis.cell[x];
+                            zoneVal[x] = mixf(line[cx], line[cx + 1], axis.t[x]);
+                        }
+                    }
+                    else
+                    {
+                        noises.zoneNoise[i].GetNoiseBatch(px.data() + first, py.data() + first, pz.data() + first, zoneVal.data() + first, interior);
+                    }
+
+                    // compact the columns inside a cave zone so the ridged noise runs as one dense batch
+                    size_t active = 0;
+                    for (size_t x = first; x <= last; ++x)
+                    {
+                        zoneMask[x] = smoothstepf(cave.zoneThreshold - 0.05f, cave.zoneThreshold + 0.05f, zoneVal[x] * 0.5f + 0.5f);
+                        if (zoneMask[x] != 0.0f)
+                        {
+                            activeX[active] = x;
+                            cx[active] = px[x];
+                            cy[active] = py[x];
+                            cz[active] = pz[x];
+                            active++;
+                        }
+                    }
+                    stats.caveNoiseSkipped += interior - active;
+
+                    noises.caveNoise[i].GetNoiseBatch(cx.data(), cy.data(), cz.data(), caveVal.data(), active);
+                    for (size_t a = 0; a < active; ++a)
+                    {
+                        size_t x = activeX[a];
+                        float sdf = (caveThreshold - caveVal[a]) * cave.gain * 2.0f * (float)numCaves * (float)numCaves;
+
+                        float finalMask = zoneMask[x] * heightMask;
+                        caveSDF[x] = mixf(100.0f, sdf, finalMask);
+                    }
+                }
+
+                for (size_t x = first; x <= last; ++x)
+                {
+                    row[x] = smin(row[x], caveSDF[x], 4.0f);
+                }
+            }
+
+            for (int x = 0; x < densitySize; ++x)
+            {
+                float currentDensity = row[x];
+
+                if (y < 3)
+                {
+                    currentDensity = 100.0f; // bedrock
+                }
+
+                // walls and floor around surface
+                if ((walls && (x == 0 || x == densitySize - 1 ||
+                               z == 0 || z == densitySize - 1)) ||
+                    y == 0)
+                {
+                    currentDensity = -10.0f;
+                }
+
+                density[x + (size_t)y * densitySize + (size_t)z * densitySize * densitySize] = currentDensity;
+            }
+        }
+    }
+}
+
+// gradient of smin(a, b, k): the terms through h cancel, leaving the same blend
+static glm::vec3 sminGradient(float a, float b, float k, const glm::vec3 &gradientA, const glm::vec3 &gradientB)
+{
+    float h = clampf(0.5f + 0.5f * (b - a) / k, 0.0f, 1.0f);
+    return gradientB * (1.0f - h) + gradientA * h;
+}
+
+// same chain as evaluateDensity in density.comp.glsl with u_AnalyticGradients set
+glm::vec3 DensityGenerator::densityGradient(const NoiseSet &noises, const std::vector<Cave> &caves, float caveCeiling, const glm::vec3 &worldPos) const
+{
+    const float caveThreshold = 0.67f;
+    int numCaves = (int)caves.size();
+
+    float wx = worldPos.x;
+    float wy = worldPos.y;
+    float wz = worldPos.z;
+    float jacobian[9];
+    noises.warpNoise.DomainWarpDerivative(wx, wy, wz, jacobian);
+
+    // gradient of noise sampled at the warped position, with respect to worldPos
+    auto throughWarp = [&](float gx, float gy, float gz)
+    {
+        return glm::vec3(gx * jacobian[0] + gy * jacobian[3] + gz * jacobian[6],
+                         gx * jacobian[1] + gy * jacobian[4] + gz * jacobian[7],
+                         gx * jacobian[2] + gy * jacobian[5] + gz * jacobian[8]);
+    };
+
+    float dx, dy, dz;
+    float terrainHeight = noises.terrainNoise.GetNoiseDerivative(wx, 0.0f, wz, dx, dy, dz) * 40.0f + 20.0f;
+    float currentDensity = terrainHeight - worldPos.y;
+    glm::vec3 gradient = throughWarp(dx * 40.0f, 0.0f, dz * 40.0f) - glm::vec3(0.0f, 1.0f, 0.0f);
+
+    float heightMask = clampf((caveCeiling - worldPos.y) * 0.15f, 0.0f, 1.0f);
+    glm::vec3 heightMaskGradient = heightMask > 0.0f && heightMask < 1.0f ? glm::vec3(0.0f, -0.15f, 0.0f) : glm::vec3(0.0f);
+
+    for (int i = 0; i < numCaves; ++i)
+    {
+        const Cave &cave = caves[i];
+        float caveSDF = 100.0f;
+        glm::vec3 caveGradient(0.0f);
+
+        if (heightMask != 0.0f)
+        {
+            float px = wx + cave.offset.x;
+            float py = wy + cave.offset.y;
+            float pz = wz + cave.offset.z;
+
+            float zx, zy, zz;
+            float zoneVal = noises.zoneNoise[i].GetNoiseDerivative(px, py, pz, zx, zy, zz);
+            float zoneMask = smoothstepf(cave.zoneThreshold - 0.05f, cave.zoneThreshold + 0.05f, zoneVal * 0.5f + 0.5f);
+
+            if (zoneMask != 0.0f)
+            {
+                float cx, cy, cz;
+                float caveVal = noises.caveNoise[i].GetNoiseDerivative(px, py, pz, cx, cy, cz);
+                float sdf = (caveThreshold - caveVal) * cave.gain * 2.0f * (float)numCaves * (float)numCaves;
+                float caveGain = cave.gain * 2.0f * (float)numCaves * (float)numCaves;
+                float finalMask = zoneMask * heightMask;
+
+                // smoothstep' = 6t(1 - t) / (edge1 - edge0), on zoneVal * 0.5 + 0.5
+                float t = clampf((zoneVal * 0.5f + 0.5f - (cave.zoneThreshold - 0.05f)) / 0.1f, 0.0f, 1.0f);
+                glm::vec3 zoneMaskGradient = throughWarp(zx, zy, zz) * (6.0f * t * (1.0f - t) / 0.1f * 0.5f);
+                glm::vec3 finalMaskGradient = zoneMaskGradient * heightMask + heightMaskGradient * zoneMask;
+                caveGradient = throughWarp(cx, cy, cz) * (-caveGain * finalMask) + finalMaskGradient * (sdf - 100.0f);
+                caveSDF = mixf(100.0f, sdf, finalMask);
+            }
+        }
+
+        gradient = sminGradient(currentDensity, caveSDF, 4.0f, gradient, caveGradient);
+        currentDensity = smin(currentDensity, caveSDF, 4.0f);
+    }
+
+    return gradient;
+}
+
+void DensityGenerator::generateNormals(int seed, const std::vector<Cave> &caves, float caveCeiling, const glm::vec3 &offset, std::vector<glm::vec3> &normals) const
+{
+    normals.resize((size_t)densitySize * densitySize * densitySize);
+    NoiseSet noises = createNoiseSet(seed, caves);
+
+    parallelForSlabs(0, densitySize, threadCount, [&](int zBegin, int zEnd, int)
+                     {
+        for (int z = zBegin; z < zEnd; ++z)
+        {
+            for (int y = 0; y < densitySize; ++y)
+            {
+                for (int x = 0; x < densitySize; ++x)
+                {
+                    // bedrock and walls are constants, so they get the outward face their neighbours would see
+                    glm::vec3 gradient;
+                    if (walls && (x == 0 || x == densitySize - 1))
+                        gradient = glm::vec3(x == 0 ? 1.0f : -1.0f, 0.0f, 0.0f);
+                    else if (walls && (z == 0 || z == densitySize - 1))
+                        gradient = glm::vec3(0.0f, 0.0f, z == 0 ? 1.0f : -1.0f);
+                    else if (y < 3)
+                        gradient = glm::vec3(0.0f, y < 2 ? 1.0f : -1.0f, 0.0f);
+                    else
+                        gradient = densityGradient(noises, caves, caveCeiling, glm::vec3(((float)x + offset.x) - 1.0f, ((float)y + offset.y) - 1.0f, ((float)z + offset.z) - 1.0f));
+
+                    float length = std::sqrt(gradient.x * gradient.x + gradient.y * gradient.y + gradient.z * gradient.z);
+                    normals[x + (size_t)y * densitySize + (size_t)z * densitySize * densitySize] =
+                        length < 0.0001f ? glm::vec3(0.0f, 1.0f, 0.0f) : -gradient / length;
+                }
+            }
+        } });
+}
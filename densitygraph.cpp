@@ -0,0 +1,625 @@
+#include "include/densitygraph.h"
+#include "include/parallel.h"
+#include "include/glslmath.h"
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <tuple>
+
+bool DensityGraph::NoiseDesc::operator==(const NoiseDesc &other) const
+{
+    return seedOffset == other.seedOffset && frequency == other.frequency && noiseType == other.noiseType &&
+           fractalType == other.fractalType && octaves == other.octaves && lacunarity == other.lacunarity &&
+           gain == other.gain && weightedStrength == other.weightedStrength && pingPongStrength == other.pingPongStrength &&
+           warpType == other.warpType && warpAmp == other.warpAmp;
+}
+
+int DensityGraph::push(const Node &node)
+{
+    nodes.push_back(node);
+    return (int)nodes.size() - 1;
+}
+
+int DensityGraph::addNoise(const NoiseDesc &desc)
+{
+    for (int i = 0; i < (int)noises.size(); ++i)
+    {
+        if (noises[i] == desc)
+            return i;
+    }
+    noises.push_back(desc);
+    return (int)noises.size() - 1;
+}
+
+int DensityGraph::constant(float value)
+{
+    Node node;
+    node.op = Const;
+    node.value = value;
+    return push(node);
+}
+
+int DensityGraph::position()
+{
+    Node node;
+    node.op = Position;
+    return push(node);
+}
+
+int DensityGraph::vec3(int x, int y, int z)
+{
+    Node node;
+    node.op = Vec3;
+    node.a = x;
+    node.b = y;
+    node.c = z;
+    return push(node);
+}
+
+int DensityGraph::component(int v, int axis)
+{
+    Node node;
+    node.op = Component;
+    node.a = v;
+    node.axis = axis;
+    return push(node);
+}
+
+int DensityGraph::offset(int v, const glm::vec3 &vector)
+{
+    Node node;
+    node.op = Offset;
+    node.a = v;
+    node.vector = vector;
+    return push(node);
+}
+
+int DensityGraph::warp(const NoiseDesc &desc, int v)
+{
+    Node node;
+    node.op = Warp;
+    node.a = v;
+    node.noise = addNoise(desc);
+    return push(node);
+}
+
+int DensityGraph::noise(const NoiseDesc &desc, int v)
+{
+    Node node;
+    node.op = Noise;
+    node.a = v;
+    node.noise = addNoise(desc);
+    return push(node);
+}
+
+static DensityGraph::Node binary(DensityGraph::Op op, int a, int b, int c = -1)
+{
+    DensityGraph::Node node;
+    node.op = op;
+    node.a = a;
+    node.b = b;
+    node.c = c;
+    return node;
+}
+
+int DensityGraph::add(int a, int b) { return push(binary(Add, a, b)); }
+int DensityGraph::sub(int a, int b) { return push(binary(Sub, a, b)); }
+int DensityGraph::mul(int a, int b) { return push(binary(Mul, a, b)); }
+int DensityGraph::min(int a, int b) { return push(binary(Min, a, b)); }
+int DensityGraph::max(int a, int b) { return push(binary(Max, a, b)); }
+int DensityGraph::mix(int a, int b, int t) { return push(binary(Mix, a, b, t)); }
+int DensityGraph::smin(int a, int b, int k) { return push(binary(Smin, a, b, k)); }
+int DensityGraph::clamp(int x, int lo, int hi) { return push(binary(Clamp, x, lo, hi)); }
+int DensityGraph::smoothstep(int edge0, int edge1, int x) { return push(binary(Smoothstep, edge0, edge1, x)); }
+
+// scalar semantics shared by constant folding and the native evaluator
+static float applyScalar(DensityGraph::Op op, float a, float b, float c)
+{
+    switch (op)
+    {
+    case DensityGraph::Add:
+        return a + b;
+    case DensityGraph::Sub:
+        return a - b;
+    case DensityGraph::Mul:
+        return a * b;
+    case DensityGraph::Min:
+        return std::min(a, b);
+    case DensityGraph::Max:
+        return std::max(a, b);
+    case DensityGraph::Mix:
+        return mixf(a, b, c);
+    case DensityGraph::Smin:
+        return smin(a, b, c);
+    case DensityGraph::Clamp:
+        return clampf(a, b, c);
+    case DensityGraph::Smoothstep:
+        return smoothstepf(a, b, c);
+    default:
+        return 0.0f;
+    }
+}
+
+static unsigned int floatBits(float f)
+{
+    unsigned int bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+DensityGraph DensityGraph::compile() const
+{
+    DensityGraph folded;
+    std::vector<int> remap(nodes.size(), -1);
+
+    typedef std::tuple<int, int, int, int, unsigned int, unsigned int, unsigned int, unsigned int, int, int> NodeKey;
+    std::map<NodeKey, int> existing;
+
+    auto isConst = [&](int id, float value)
+    {
+        return id >= 0 && folded.nodes[id].op == Const && folded.nodes[id].value == value;
+    };
+
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        Node node = nodes[i];
+        if (node.a >= 0)
+            node.a = remap[node.a];
+        if (node.b >= 0)
+            node.b = remap[node.b];
+        if (node.c >= 0)
+            node.c = remap[node.c];
+        if (node.op == Warp || node.op == Noise)
+            node.noise = folded.addNoise(noises[node.noise]);
+
+        // identities first, they forward an existing node
+        int forward = -1;
+        switch (node.op)
+        {
+        case Component:
+            if (folded.nodes[node.a].op == Vec3)
+            {
+                const Node &v = folded.nodes[node.a];
+                forward = node.axis == 0 ? v.a : node.axis == 1 ? v.b : v.c;
+            }
+            break;
+        case Offset:
+            if (node.vector == glm::vec3(0.0f))
+                forward = node.a;
+            break;
+        case Add:
+            forward = isConst(node.b, 0.0f) ? node.a : isConst(node.a, 0.0f) ? node.b : -1;
+            break;
+        case Sub:
+            forward = isConst(node.b, 0.0f) ? node.a : -1;
+            break;
+        case Mul:
+            forward = isConst(node.b, 1.0f) ? node.a : isConst(node.a, 1.0f) ? node.b : -1;
+            break;
+        case Mix:
+            forward = isConst(node.c, 0.0f) ? node.a : isConst(node.c, 1.0f) ? node.b : -1;
+            break;
+        default:
+            break;
+        }
+        if (forward >= 0)
+        {
+            remap[i] = forward;
+            continue;
+        }
+
+        // arithmetic on constants only
+        if (node.op >= Add)
+        {
+            bool allConst = folded.nodes[node.a].op == Const && folded.nodes[node.b].op == Const &&
+                            (node.c < 0 || folded.nodes[node.c].op == Const);
+            if (allConst)
+            {
+                float c = node.c >= 0 ? folded.nodes[node.c].value : 0.0f;
+                float value = applyScalar(node.op, folded.nodes[node.a].value, folded.nodes[node.b].value, c);
+                node = Node();
+                node.op = Const;
+                node.value = value;
+            }
+        }
+
+        // merge identical nodes, e.g. the warp and height mask every cave shares
+        NodeKey key(node.op, node.a, node.b, node.c, floatBits(node.value), floatBits(node.vector.x),
+                    floatBits(node.vector.y), floatBits(node.vector.z), node.axis, node.noise);
+        auto found = existing.find(key);
+        if (found != existing.end())
+        {
+            remap[i] = found->second;
+            continue;
+        }
+        remap[i] = folded.push(node);
+        existing[key] = remap[i];
+    }
+
+    // keep only what the output depends on
+    int foldedOutput = output >= 0 ? remap[output] : -1;
+    std::vector<bool> live(folded.nodes.size(), false);
+    if (foldedOutput >= 0)
+        live[foldedOutput] = true;
+    for (int i = (int)folded.nodes.size() - 1; i >= 0; --i)
+    {
+        if (!live[i])
+            continue;
+        const Node &node = folded.nodes[i];
+        for (int input : {node.a, node.b, node.c})
+        {
+            if (input >= 0)
+                live[input] = true;
+        }
+    }
+
+    DensityGraph result;
+    result.sourceNodes = sourceNodes > 0 ? sourceNodes : (int)nodes.size();
+    std::vector<int> compact(folded.nodes.size(), -1);
+    for (size_t i = 0; i < folded.nodes.size(); ++i)
+    {
+        if (!live[i])
+            continue;
+        Node node = folded.nodes[i];
+        if (node.a >= 0)
+            node.a = compact[node.a];
+        if (node.b >= 0)
+            node.b = compact[node.b];
+        if (node.c >= 0)
+            node.c = compact[node.c];
+        if (node.op == Warp || node.op == Noise)
+            node.noise = result.addNoise(folded.noises[node.noise]);
+        compact[i] = result.push(node);
+    }
+    result.output = foldedOutput >= 0 ? compact[foldedOutput] : -1;
+    return result;
+}
+
+// shortest text that reads back as the same float, always a valid GLSL float literal
+static std::string glslFloat(float value)
+{
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+    std::string text = buffer;
+    if (text.find_first_of(".e") == std::string::npos)
+        text += ".0";
+    if (value < 0.0f)
+        text = "(" + text + ")";
+    return text;
+}
+
+std::string DensityGraph::emitGlsl() const
+{
+    std::ostringstream src;
+    static const char axisName[] = {'x', 'y', 'z'};
+
+    auto ref = [&](int id) -> std::string
+    {
+        const Node &node = nodes[id];
+        if (node.op == Const)
+            return glslFloat(node.value);
+        if (node.op == Position)
+            return "worldPos";
+        return "n" + std::to_string(id);
+    };
+
+    src << "#version 460 core\n"
+        << "// generated by DensityGraph: " << nodes.size() << " nodes (" << sourceNodes << " before compile), "
+        << noises.size() << " noise states\n"
+        << "layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;\n\n"
+        << "// DensityBuffer (binding 0), densitySize and storeDensity come from densityStorage.glsl\n"
+        << "uniform int u_Seed;\n"
+        << "uniform vec3 u_Offset;\n"
+        << "uniform int u_Walls; // 0 for chunks, see density.comp.glsl\n\n"
+        << "float smin(float a, float b, float k) {\n"
+        << "    float h = clamp(0.5 + 0.5 * (b - a) / k, 0.0, 1.0);\n"
+        << "    return mix(b, a, h) - k * h * (1.0 - h);\n"
+        << "}\n\n"
+        << "float densityGraph(vec3 worldPos) {\n";
+
+    // every state is built once up front with constant fields; only the seed comes from a uniform
+    for (size_t i = 0; i < noises.size(); ++i)
+    {
+        const NoiseDesc &n = noises[i];
+        src << "    fnl_state noise" << i << " = fnl_state(u_Seed + " << n.seedOffset << ", " << glslFloat(n.frequency) << ", "
+            << (int)n.noiseType << ", FNL_ROTATION_NONE, " << (int)n.fractalType << ", " << n.octaves << ", "
+            << glslFloat(n.lacunarity) << ", " << glslFloat(n.gain) << ", " << glslFloat(n.weightedStrength) << ", "
+            << glslFloat(n.pingPongStrength) << ", FNL_CELLULAR_DISTANCE_EUCLIDEANSQ, FNL_CELLULAR_RETURN_TYPE_DISTANCE, 1.0, "
+            << (int)n.warpType << ", " << glslFloat(n.warpAmp) << ");\n";
+    }
+    src << "\n";
+
+    static const char *binaryOp[] = {nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, " + ", " - ", " * "};
+    static const char *callName[] = {nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+                                     "min", "max", "mix", "smin", "clamp", "smoothstep"};
+
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        const Node &node = nodes[i];
+        std::string name = "n" + std::to_string(i);
+        switch (node.op)
+        {
+        case Const:
+        case Position:
+            break;
+        case Vec3:
+            src << "    vec3 " << name << " = vec3(" << ref(node.a) << ", " << ref(node.b) << ", " << ref(node.c) << ");\n";
+            break;
+        case Component:
+            src << "    float " << name << " = " << ref(node.a) << "." << axisName[node.axis] << ";\n";
+            break;
+        case Offset:
+            src << "    vec3 " << name << " = " << ref(node.a) << " + vec3(" << glslFloat(node.vector.x) << ", "
+                << glslFloat(node.vector.y) << ", " << glslFloat(node.vector.z) << ");\n";
+            break;
+        case Warp:
+            src << "    vec3 " << name << " = " << ref(node.a) << ";\n"
+                << "    fnlDomainWarp3D(noise" << node.noise << ", " << name << ".x, " << name << ".y, " << name << ".z);\n";
+            break;
+        case Noise:
+        {
+            std::string in = ref(node.a);
+            src << "    float " << name << " = fnlGetNoise3D(noise" << node.noise << ", " << in << ".x, " << in << ".y, " << in << ".z);\n";
+        }
+        break;
+        case Add:
+        case Sub:
+        case Mul:
+            src << "    float " << name << " = " << ref(node.a) << binaryOp[node.op] << ref(node.b) << ";\n";
+            break;
+        default:
+            src << "    float " << name << " = " << callName[node.op] << "(" << ref(node.a) << ", " << ref(node.b);
+            if (node.c >= 0)
+                src << ", " << ref(node.c);
+            src << ");\n";
+            break;
+        }
+    }
+
+    src << "    return " << (output >= 0 ? ref(output) : std::string("0.0")) << ";\n"
+        << "}\n\n"
+        << "void main() {\n"
+        << "    // no early return: storeDensity has a barrier for the 16-bit formats\n"
+        << "    uvec3 id = gl_GlobalInvocationID.xyz;\n"
+        << "    bool inBounds = id.x < densitySize && id.y < densitySize && id.z < densitySize;\n\n"
+        << "    float currentDensity = 0.0;\n"
+        << "    if (inBounds) {\n"
+        << "        vec3 worldPos = vec3(id) + u_Offset - vec3(1.0);\n"
+        << "        currentDensity = densityGraph(worldPos);\n\n"
+        << "        if (id.y < 3) {\n"
+        << "            currentDensity = 100.0; // bedrock\n"
+        << "        }\n\n"
+        << "        // walls and floor around surface\n"
+        << "        if ((u_Walls == 1 && (id.x == 0 || id.x == densitySize - 1 ||\n"
+        << "                              id.z == 0 || id.z == densitySize - 1)) ||\n"
+        << "            id.y == 0)\n"
+        << "        {\n"
+        << "            currentDensity = -10.0;\n"
+        << "        }\n"
+        << "    }\n\n"
+        << "    storeDensity(ivec3(id), currentDensity, inBounds);\n"
+        << "}\n";
+
+    return src.str();
+}
+
+void DensityGraph::evaluate(int seed, const glm::vec3 &offset, int densitySize, unsigned int threadCount, std::vector<float> &density, bool walls) const
+{
+    density.resize((size_t)densitySize * densitySize * densitySize);
+
+    // noise state set up once per run, not per sample
+    std::vector<FastNoiseLite> states;
+    for (const NoiseDesc &n : noises)
+    {
+        FastNoiseLite state(seed + n.seedOffset);
+        state.SetFrequency(n.frequency);
+        state.SetNoiseType(n.noiseType);
+        state.SetFractalType(n.fractalType);
+        state.SetFractalOctaves(n.octaves);
+        state.SetFractalLacunarity(n.lacunarity);
+        state.SetFractalGain(n.gain);
+        state.SetFractalWeightedStrength(n.weightedStrength);
+        state.SetFractalPingPongStrength(n.pingPongStrength);
+        state.SetDomainWarpType(n.warpType);
+        state.SetDomainWarpAmp(n.warpAmp);
+        states.push_back(state);
+    }
+
+    float *out = density.data();
+    parallelForSlabs(0, densitySize, threadCount, [&](int zBegin, int zEnd, int)
+                     { evaluateSlab(states, offset, densitySize, zBegin, zEnd, walls, out); });
+}
+
+void DensityGraph::evaluateSlab(const std::vector<FastNoiseLite> &states, const glm::vec3 &offset, int densitySize, int zBegin, int zEnd, bool walls, float *density) const
+{
+    // one register per node holding a whole x row (three rows for vectors), executed in program order
+    size_t rowSize = (size_t)densitySize;
+    std::vector<std::vector<float>> regs(nodes.size());
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        const Node &node = nodes[i];
+        regs[i].assign(isVector(node.op) ? rowSize * 3 : rowSize, node.op == Const ? node.value : 0.0f);
+        if (node.op == Position)
+        {
+            for (size_t x = 0; x < rowSize; ++x)
+                regs[i][x] = ((float)x + offset.x) - 1.0f;
+        }
+    }
+
+    for (int z = zBegin; z < zEnd; ++z)
+    {
+        float worldZ = ((float)z + offset.z) - 1.0f;
+
+        for (int y = 0; y < densitySize; ++y)
+        {
+            float worldY = ((float)y + offset.y) - 1.0f;
+
+            // bedrock rows and the z walls are overwritten below, nothing to evaluate
+            bool overwritten = y < 3 || (walls && (z == 0 || z == densitySize - 1));
+
+            for (size_t i = 0; i < nodes.size() && !overwritten; ++i)
+            {
+                const Node &node = nodes[i];
+                float *r = regs[i].data();
+                const float *a = node.a >= 0 ? regs[node.a].data() : nullptr;
+                const float *b = node.b >= 0 ? regs[node.b].data() : nullptr;
+                const float *c = node.c >= 0 ? regs[node.c].data() : nullptr;
+
+                switch (node.op)
+                {
+                case Const:
+                    break;
+                case Position:
+                    std::fill(r + rowSize, r + 2 * rowSize, worldY);
+                    std::fill(r + 2 * rowSize, r + 3 * rowSize, worldZ);
+                    break;
+                case Vec3:
+                    std::copy(a, a + rowSize, r);
+                    std::copy(b, b + rowSize, r + rowSize);
+                    std::copy(c, c + rowSize, r + 2 * rowSize);
+                    break;
+                case Component:
+                    std::copy(a + node.axis * rowSize, a + (node.axis + 1) * rowSize, r);
+                    break;
+                case Offset:
+                    for (size_t x = 0; x < rowSize; ++x)
+                    {
+                        r[x] = a[x] + node.vector.x;
+                        r[rowSize + x] = a[rowSize + x] + node.vector.y;
+                        r[2 * rowSize + x] = a[2 * rowSize + x] + node.vector.z;
+                    }
+                    break;
+                case Warp:
+                    std::copy(a, a + 3 * rowSize, r);
+                    states[node.noise].DomainWarpBatch(r, r + rowSize, r + 2 * rowSize, rowSize);
+                    break;
+                case Noise:
+                    states[node.noise].GetNoiseBatch(a, a + rowSize, a + 2 * rowSize, r, rowSize);
+                    break;
+                case Add:
+                    for (size_t x = 0; x < rowSize; ++x)
+                        r[x] = a[x] + b[x];
+                    break;
+                case Sub:
+                    for (size_t x = 0; x < rowSize; ++x)
+                        r[x] = a[x] - b[x];
+                    break;
+                case Mul:
+                    for (size_t x = 0; x < rowSize; ++x)
+                        r[x] = a[x] * b[x];
+                    break;
+                case Min:
+                    for (size_t x = 0; x < rowSize; ++x)
+                        r[x] = std::min(a[x], b[x]);
+                    break;
+                case Max:
+                    for (size_t x = 0; x < rowSize; ++x)
+                        r[x] = std::max(a[x], b[x]);
+                    break;
+                case Mix:
+                    for (size_t x = 0; x < rowSize; ++x)
+                        r[x] = mixf(a[x], b[x], c[x]);
+                    break;
+                case Smin:
+                    for (size_t x = 0; x < rowSize; ++x)
+                        r[x] = ::smin(a[x], b[x], c[x]);
+                    break;
+                case Clamp:
+                    for (size_t x = 0; x < rowSize; ++x)
+                        r[x] = clampf(a[x], b[x], c[x]);
+                    break;
+                case Smoothstep:
+                    for (size_t x = 0; x < rowSize; ++x)
+                        r[x] = smoothstepf(a[x], b[x], c[x]);
+                    break;
+                }
+            }
+
+            const float *result = output >= 0 && !overwritten ? regs[output].data() : nullptr;
+            for (int x = 0; x < densitySize; ++x)
+            {
+                float currentDensity = result ? result[x] : 0.0f;
+
+                if (y < 3)
+                {
+                    currentDensity = 100.0f; // bedrock
+                }
+
+                // walls and floor around surface
+                if ((walls && (x == 0 || x == densitySize - 1 ||
+                               z == 0 || z == densitySize - 1)) ||
+                    y == 0)
+                {
+                    currentDensity = -10.0f;
+                }
+
+                density[x + (size_t)y * densitySize + (size_t)z * densitySize * densitySize] = currentDensity;
+            }
+        }
+    }
+}
+
+DensityGraph buildTerrainGraph(const std::vector<Cave> &caves, float caveCeiling)
+{
+    DensityGraph g;
+
+    DensityGraph::NoiseDesc warpNoise;
+    warpNoise.frequency = 0.005f;
+    warpNoise.warpAmp = 5.0f;
+
+    DensityGraph::NoiseDesc terrainNoise;
+    terrainNoise.fractalType = FastNoiseLite::FractalType_FBm;
+    terrainNoise.frequency = 0.01f;
+    terrainNoise.octaves = 4;
+
+    int worldPos = g.position();
+    int warpedPos = g.warp(warpNoise, worldPos);
+
+    int terrainPos = g.vec3(g.component(warpedPos, 0), g.constant(0.0f), g.component(warpedPos, 2));
+    int terrainHeight = g.add(g.mul(g.noise(terrainNoise, terrainPos), g.constant(40.0f)), g.constant(20.0f));
+    int density = g.sub(terrainHeight, g.component(worldPos, 1));
+
+    float numCaves = (float)caves.size();
+    for (int i = 0; i < (int)caves.size(); ++i)
+    {
+        const Cave &cave = caves[i];
+
+        DensityGraph::NoiseDesc caveNoise;
+        caveNoise.seedOffset = i * 431;
+        caveNoise.fractalType = FastNoiseLite::FractalType_Ridged;
+        caveNoise.frequency = cave.frequency;
+        caveNoise.octaves = 2;
+
+        // low-frequency zone noise to cluster caves
+        DensityGraph::NoiseDesc zoneNoise;
+        zoneNoise.seedOffset = 9999 + i * 131;
+        zoneNoise.fractalType = FastNoiseLite::FractalType_FBm;
+        zoneNoise.frequency = cave.zoneFrequency;
+        zoneNoise.octaves = 2;
+
+        int p = g.offset(warpedPos, cave.offset);
+        int caveVal = g.noise(caveNoise, p);
+
+        int caveSDF = g.sub(g.constant(0.67f), caveVal);
+        caveSDF = g.mul(caveSDF, g.constant(cave.gain));
+        caveSDF = g.mul(caveSDF, g.constant(2.0f));
+        caveSDF = g.mul(caveSDF, g.constant(numCaves));
+        caveSDF = g.mul(caveSDF, g.constant(numCaves));
+
+        int heightMask = g.clamp(g.mul(g.sub(g.constant(caveCeiling), g.component(worldPos, 1)), g.constant(0.15f)),
+                                 g.constant(0.0f), g.constant(1.0f));
+
+        int zoneVal = g.noise(zoneNoise, p);
+        int zoneMask = g.smoothstep(g.sub(g.constant(cave.zoneThreshold), g.constant(0.05f)),
+                                    g.add(g.constant(cave.zoneThreshold), g.constant(0.05f)),
+                                    g.add(g.mul(zoneVal, g.constant(0.5f)), g.constant(0.5f)));
+        int finalMask = g.mul(zoneMask, heightMask);
+        caveSDF = g.mix(g.constant(100.0f), caveSDF, finalMask);
+
+        density = g.smin(density, caveSDF, g.constant(4.0f));
+    }
+
+    g.setOutput(density);
+    return g;
+}
@@ -0,0 +1,176 @@
+#include "include/densitystorage.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// smallest normal fp16 magnitude. negative samples are pushed at least this far from zero so
+// they cannot round to -0.0 (which is not < isoLevel) or be flushed as a denormal on the GPU
+static const float HALF_MIN_NORMAL = 6.2e-5f;
+
+size_t DensityStorage::wordCount(int densitySize) const
+{
+    size_t plane = (size_t)densitySize * densitySize;
+    if (format == DENSITY_FLOAT32)
+        return plane * densitySize;
+    return (size_t)((densitySize + 1) / 2) * plane;
+}
+
+uint16_t DensityStorage::floatToHalf(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    uint32_t sign = (bits >> 16) & 0x8000u;
+    uint32_t exponent = (bits >> 23) & 0xffu;
+    uint32_t mantissa = bits & 0x7fffffu;
+
+    if (exponent == 0xffu)
+        return (uint16_t)(sign | 0x7c00u | (mantissa ? 0x200u : 0u));
+
+    int halfExponent = (int)exponent - 127 + 15;
+    if (halfExponent >= 0x1f)
+        return (uint16_t)(sign | 0x7c00u);
+
+    if (halfExponent <= 0)
+    {
+        // denormal or zero
+        if (halfExponent < -10)
+            return (uint16_t)sign;
+        mantissa |= 0x800000u;
+        int shift = 14 - halfExponent;
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1u);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1u)))
+            half++;
+        return (uint16_t)(sign | half);
+    }
+
+    // round to nearest even; a mantissa carry correctly bumps the exponent
+    uint32_t half = ((uint32_t)halfExponent << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1fffu;
+    if (rest > 0x1000u || (rest == 0x1000u && (half & 1u)))
+        half++;
+    return (uint16_t)(sign | half);
+}
+
+float DensityStorage::halfToFloat(uint16_t half)
+{
+    uint32_t sign = (uint32_t)(half & 0x8000u) << 16;
+    uint32_t exponent = (half >> 10) & 0x1fu;
+    uint32_t mantissa = half & 0x3ffu;
+    uint32_t bits;
+
+    if (exponent == 0)
+    {
+        if (mantissa == 0)
+        {
+            bits = sign;
+        }
+        else
+        {
+            // normalise the denormal
+            int e = -1;
+            do
+            {
+                e++;
+                mantissa <<= 1;
+            } while ((mantissa & 0x400u) == 0);
+            bits = sign | ((uint32_t)(127 - 15 - e) << 23) | ((mantissa & 0x3ffu) << 13);
+        }
+    }
+    else if (exponent == 0x1f)
+    {
+        bits = sign | 0x7f800000u | (mantissa << 13);
+    }
+    else
+    {
+        bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    }
+
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// same steps as encodeDensityHalf / loadDensity in densityStorage.glsl
+uint16_t DensityStorage::encodeHalfWord(float value) const
+{
+    if (format == DENSITY_FP16)
+    {
+        value = std::max(-65504.0f, std::min(value, 65504.0f));
+        if (value < 0.0f)
+            value = std::min(value, -HALF_MIN_NORMAL);
+        return floatToHalf(value);
+    }
+
+    float q = std::max(-32767.0f, std::min(std::round(value * scale()), 32767.0f));
+    if (value < 0.0f)
+        q = std::min(q, -1.0f);
+    return (uint16_t)(int16_t)q;
+}
+
+float DensityStorage::decodeHalfWord(uint16_t bits) const
+{
+    if (format == DENSITY_FP16)
+        return halfToFloat(bits);
+    return (float)(int16_t)bits / scale();
+}
+
+float DensityStorage::quantize(float value) const
+{
+    if (format == DENSITY_FLOAT32)
+        return value;
+    return decodeHalfWord(encodeHalfWord(value));
+}
+
+void DensityStorage::encode(const std::vector<float> &density, int densitySize, std::vector<uint32_t> &words) const
+{
+    words.assign(wordCount(densitySize), 0u);
+    if (format == DENSITY_FLOAT32)
+    {
+        std::memcpy(words.data(), density.data(), words.size() * sizeof(uint32_t));
+        return;
+    }
+
+    int rowWords = (densitySize + 1) / 2;
+    for (int z = 0; z < densitySize; ++z)
+    {
+        for (int y = 0; y < densitySize; ++y)
+        {
+            const float *row = density.data() + (size_t)y * densitySize + (size_t)z * densitySize * densitySize;
+            uint32_t *out = words.data() + (size_t)rowWords * (y + (size_t)z * densitySize);
+            for (int x = 0; x < densitySize; x += 2)
+            {
+                uint32_t low = encodeHalfWord(row[x]);
+                uint32_t high = x + 1 < densitySize ? encodeHalfWord(row[x + 1]) : 0u;
+                out[x >> 1] = low | (high << 16);
+            }
+        }
+    }
+}
+
+void DensityStorage::decode(const std::vector<uint32_t> &words, int densitySize, std::vector<float> &density) const
+{
+    density.resize((size_t)densitySize * densitySize * densitySize);
+    if (format == DENSITY_FLOAT32)
+    {
+        std::memcpy(density.data(), words.data(), density.size() * sizeof(float));
+        return;
+    }
+
+    int rowWords = (densitySize + 1) / 2;
+    for (int z = 0; z < densitySize; ++z)
+    {
+        for (int y = 0; y < densitySize; ++y)
+        {
+            float *row = density.data() + (size_t)y * densitySize + (size_t)z * densitySize * densitySize;
+            const uint32_t *in = words.data() + (size_t)rowWords * (y + (size_t)z * densitySize);
+            for (int x = 0; x < densitySize; ++x)
+            {
+                uint32_t word = in[x >> 1];
+                row[x] = decodeHalfWord((uint16_t)((x & 1) ? word >> 16 : word & 0xffffu));
+            }
+        }
+    }
+}
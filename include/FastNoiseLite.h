@@ -51,6 +51,8 @@
 #define FASTNOISELITE_H
 
 #include <cmath>
+#include <cstddef>
+#include "noisebatch.h"
 
 class FastNoiseLite
 {
@@ -388,6 +390,165 @@ public:
         }
     }
 
+    /// <summary>
+    /// 3D noise for n positions using current settings, vectorised for OpenSimplex2
+    /// </summary>
+    /// <remarks>
+    /// Uses the widest of SSE4.1/AVX2/AVX-512 the CPU supports, falling back to GetNoise per point.
+    /// Output matches GetNoise(x, y, z) for every point
+    /// </remarks>
+    void GetNoiseBatch(const float *xs, const float *ys, const float *zs, float *out, size_t n) const
+    {
+        if (mNoiseType == NoiseType_OpenSimplex2)
+        {
+            NoiseBatch::NoiseParams params;
+            params.seed = mSeed;
+            params.frequency = mFrequency;
+            params.transform = (NoiseBatch::Transform3D)mTransformType3D;
+            params.fractal = mFractalType <= FractalType_PingPong ? (NoiseBatch::Fractal)mFractalType : NoiseBatch::Fractal_None;
+            params.octaves = mOctaves;
+            params.lacunarity = mLacunarity;
+            params.gain = mGain;
+            params.weightedStrength = mWeightedStrength;
+            params.pingPongStrength = mPingPongStrength;
+            params.fractalBounding = mFractalBounding;
+            params.gradients3D = Lookup<float>::Gradients3D;
+
+            if (NoiseBatch::getNoise(params, xs, ys, zs, out, n))
+                return;
+        }
+
+        for (size_t i = 0; i < n; i++)
+            out[i] = GetNoise(xs[i], ys[i], zs[i]);
+    }
+
+    /// <summary>
+    /// 3D warps n positions in place using current domain warp settings, vectorised for OpenSimplex2(Reduced)
+    /// </summary>
+    /// <remarks>
+    /// Output matches DomainWarp(x, y, z) for every point
+    /// </remarks>
+    void DomainWarpBatch(float *xs, float *ys, float *zs, size_t n) const
+    {
+        if (mDomainWarpType == DomainWarpType_OpenSimplex2 || mDomainWarpType == DomainWarpType_OpenSimplex2Reduced)
+        {
+            NoiseBatch::WarpParams params;
+            params.seed = mSeed;
+            params.frequency = mFrequency;
+            params.transform = (NoiseBatch::Transform3D)mWarpTransformType3D;
+            params.fractal = mFractalType >= FractalType_DomainWarpProgressive ? (NoiseBatch::Fractal)mFractalType : NoiseBatch::Fractal_None;
+            params.octaves = mOctaves;
+            params.lacunarity = mLacunarity;
+            params.gain = mGain;
+            params.amp = mDomainWarpAmp * mFractalBounding;
+            params.reduced = mDomainWarpType == DomainWarpType_OpenSimplex2Reduced;
+            params.gradients3D = Lookup<float>::Gradients3D;
+            params.randVecs3D = Lookup<float>::RandVecs3D;
+
+            if (NoiseBatch::domainWarp(params, xs, ys, zs, n))
+                return;
+        }
+
+        for (size_t i = 0; i < n; i++)
+            DomainWarp(xs[i], ys[i], zs[i]);
+    }
+
+    /// <summary>
+    /// 3D noise at the given position and its gradient with respect to (x, y, z)
+    /// </summary>
+    /// <remarks>
+    /// Analytic for OpenSimplex2 with no fractal, FBm or Ridged, central differences otherwise.
+    /// The returned value matches GetNoise(x, y, z)
+    /// </remarks>
+    template <typename FNfloat>
+    float GetNoiseDerivative(FNfloat x, FNfloat y, FNfloat z, float &dx, float &dy, float &dz) const
+    {
+        Arguments_must_be_floating_point_values<FNfloat>();
+
+        if (mNoiseType != NoiseType_OpenSimplex2 || mFractalType > FractalType_Ridged)
+        {
+            FNfloat h = (FNfloat)(0.001f / mFrequency);
+            dx = (float)((GetNoise(x + h, y, z) - GetNoise(x - h, y, z)) / (2 * h));
+            dy = (float)((GetNoise(x, y + h, z) - GetNoise(x, y - h, z)) / (2 * h));
+            dz = (float)((GetNoise(x, y, z + h) - GetNoise(x, y, z - h)) / (2 * h));
+            return GetNoise(x, y, z);
+        }
+
+        TransformNoiseCoordinate(x, y, z);
+
+        float value;
+        switch (mFractalType)
+        {
+        default:
+            value = SingleOpenSimplex2Derivative(mSeed, x, y, z, dx, dy, dz);
+            break;
+        case FractalType_FBm:
+            value = GenFractalFBmDerivative(x, y, z, dx, dy, dz);
+            break;
+        case FractalType_Ridged:
+            value = GenFractalRidgedDerivative(x, y, z, dx, dy, dz);
+            break;
+        }
+
+        // back through the rotation and frequency scale of TransformNoiseCoordinate
+        TransformGradient(mTransformType3D, dx, dy, dz);
+        dx *= mFrequency;
+        dy *= mFrequency;
+        dz *= mFrequency;
+        return value;
+    }
+
+    /// <summary>
+    /// 3D warps the input position like DomainWarp(x, y, z) and returns the Jacobian of the warp
+    /// </summary>
+    /// <remarks>
+    /// jacobian[row * 3 + column] = d warped[row] / d input[column]. Analytic for single (non fractal)
+    /// OpenSimplex2 and OpenSimplex2Reduced warps, central differences otherwise
+    /// </remarks>
+    template <typename FNfloat>
+    void DomainWarpDerivative(FNfloat &x, FNfloat &y, FNfloat &z, float *jacobian) const
+    {
+        Arguments_must_be_floating_point_values<FNfloat>();
+
+        bool simplexWarp = mDomainWarpType == DomainWarpType_OpenSimplex2 || mDomainWarpType == DomainWarpType_OpenSimplex2Reduced;
+        if (!simplexWarp || mFractalType == FractalType_DomainWarpProgressive || mFractalType == FractalType_DomainWarpIndependent)
+        {
+            FNfloat h = (FNfloat)(0.001f / mFrequency);
+            for (int column = 0; column < 3; column++)
+            {
+                FNfloat plus[3] = {x, y, z};
+                FNfloat minus[3] = {x, y, z};
+                plus[column] += h;
+                minus[column] -= h;
+                DomainWarp(plus[0], plus[1], plus[2]);
+                DomainWarp(minus[0], minus[1], minus[2]);
+                for (int row = 0; row < 3; row++)
+                    jacobian[row * 3 + column] = (float)((plus[row] - minus[row]) / (2 * h));
+            }
+            DomainWarp(x, y, z);
+            return;
+        }
+
+        float amp = mDomainWarpAmp * mFractalBounding;
+        bool reduced = mDomainWarpType == DomainWarpType_OpenSimplex2Reduced;
+
+        FNfloat xs = x;
+        FNfloat ys = y;
+        FNfloat zs = z;
+        TransformDomainWarpCoordinate(xs, ys, zs);
+
+        // displacement derivatives in rotated, frequency scaled space, then back to input space
+        float displacement[9];
+        SingleDomainWarpOpenSimplex2GradientDerivative(mSeed, amp * (reduced ? 7.71604938271605f : 32.69428253173828125f), mFrequency,
+                                                       xs, ys, zs, x, y, z, reduced, displacement);
+        for (int row = 0; row < 3; row++)
+        {
+            TransformGradient(mWarpTransformType3D, displacement[row * 3], displacement[row * 3 + 1], displacement[row * 3 + 2]);
+            for (int column = 0; column < 3; column++)
+                jacobian[row * 3 + column] = (row == column ? 1.0f : 0.0f) + displacement[row * 3 + column] * mFrequency;
+        }
+    }
+
 private:
     template <typename T>
     struct Arguments_must_be_floating_point_values;
@@ -2402,6 +2563,403 @@ private:
         yr += vy * warpAmp;
         zr += vz * warpAmp;
     }
+    // Analytic derivatives
+
+    // gradient taken in rotated space back to the space before TransformNoiseCoordinate /
+    // TransformDomainWarpCoordinate (frequency aside): the transposed rotation
+    static void TransformGradient(TransformType3D type, float &dx, float &dy, float &dz)
+    {
+        switch (type)
+        {
+        case TransformType3D_ImproveXYPlanes:
+        {
+            float s2 = (dx + dy) * -0.211324865405187f;
+            float zk = dz * 0.577350269189626f;
+            float xy = (dx + dy) * 0.577350269189626f;
+            dx += s2 + zk;
+            dy += s2 + zk;
+            dz = zk - xy;
+        }
+        break;
+        case TransformType3D_ImproveXZPlanes:
+        {
+            float s2 = (dx + dz) * -0.211324865405187f;
+            float yk = dy * 0.577350269189626f;
+            float xz = (dx + dz) * 0.577350269189626f;
+            dx += s2 + yk;
+            dz += s2 + yk;
+            dy = yk - xz;
+        }
+        break;
+        case TransformType3D_DefaultOpenSimplex2:
+        {
+            float r = (dx + dy + dz) * (2.0f / 3.0f);
+            dx = r - dx;
+            dy = r - dy;
+            dz = r - dz;
+        }
+        break;
+        default:
+            break;
+        }
+    }
+
+    void GradVector(int seed, int xPrimed, int yPrimed, int zPrimed, float &xg, float &yg, float &zg) const
+    {
+        int hash = Hash(seed, xPrimed, yPrimed, zPrimed);
+        hash ^= hash >> 15;
+        hash &= 63 << 2;
+
+        xg = Lookup<float>::Gradients3D[hash];
+        yg = Lookup<float>::Gradients3D[hash | 1];
+        zg = Lookup<float>::Gradients3D[hash | 2];
+    }
+
+    // the two vectors GradCoordDual combines: the gradient and the output direction
+    void GradVectorDual(int seed, int xPrimed, int yPrimed, int zPrimed, float &xg, float &yg, float &zg, float &xo, float &yo, float &zo) const
+    {
+        int hash = Hash(seed, xPrimed, yPrimed, zPrimed);
+        int index1 = hash & (63 << 2);
+        int index2 = (hash >> 6) & (255 << 2);
+
+        xg = Lookup<float>::Gradients3D[index1];
+        yg = Lookup<float>::Gradients3D[index1 | 1];
+        zg = Lookup<float>::Gradients3D[index1 | 2];
+
+        xo = Lookup<float>::RandVecs3D[index2];
+        yo = Lookup<float>::RandVecs3D[index2 | 1];
+        zo = Lookup<float>::RandVecs3D[index2 | 2];
+    }
+
+    // SingleOpenSimplex2 plus the gradient of each (0.6 - |d|^2)^4 * dot(g, d) term:
+    // -8 * t^3 * dot(g, d) * d + t^4 * g
+    template <typename FNfloat>
+    float SingleOpenSimplex2Derivative(int seed, FNfloat x, FNfloat y, FNfloat z, float &dx, float &dy, float &dz) const
+    {
+        int i = FastRound(x);
+        int j = FastRound(y);
+        int k = FastRound(z);
+        float x0 = (float)(x - i);
+        float y0 = (float)(y - j);
+        float z0 = (float)(z - k);
+
+        int xNSign = (int)(-1.0f - x0) | 1;
+        int yNSign = (int)(-1.0f - y0) | 1;
+        int zNSign = (int)(-1.0f - z0) | 1;
+
+        float ax0 = xNSign * -x0;
+        float ay0 = yNSign * -y0;
+        float az0 = zNSign * -z0;
+
+        i *= PrimeX;
+        j *= PrimeY;
+        k *= PrimeZ;
+
+        float value = 0;
+        dx = dy = dz = 0;
+        float a = (0.6f - x0 * x0) - (y0 * y0 + z0 * z0);
+
+        auto contribute = [&](float t, int ip, int jp, int kp, float xd, float yd, float zd)
+        {
+            float xg, yg, zg;
+            GradVector(seed, ip, jp, kp, xg, yg, zg);
+            float dot = xd * xg + yd * yg + zd * zg;
+            float tt = t * t;
+            value += tt * tt * dot;
+            float falloff = -8 * tt * t * dot;
+            dx += falloff * xd + tt * tt * xg;
+            dy += falloff * yd + tt * tt * yg;
+            dz += falloff * zd + tt * tt * zg;
+        };
+
+        for (int l = 0;; l++)
+        {
+            if (a > 0)
+                contribute(a, i, j, k, x0, y0, z0);
+
+            float b = a + 1;
+            int i1 = i;
+            int j1 = j;
+            int k1 = k;
+            float x1 = x0;
+            float y1 = y0;
+            float z1 = z0;
+
+            if (ax0 >= ay0 && ax0 >= az0)
+            {
+                x1 += xNSign;
+                b -= xNSign * 2 * x1;
+                i1 -= xNSign * PrimeX;
+            }
+            else if (ay0 > ax0 && ay0 >= az0)
+            {
+                y1 += yNSign;
+                b -= yNSign * 2 * y1;
+                j1 -= yNSign * PrimeY;
+            }
+            else
+            {
+                z1 += zNSign;
+                b -= zNSign * 2 * z1;
+                k1 -= zNSign * PrimeZ;
+            }
+
+            if (b > 0)
+                contribute(b, i1, j1, k1, x1, y1, z1);
+
+            if (l == 1)
+                break;
+
+            ax0 = 0.5f - ax0;
+            ay0 = 0.5f - ay0;
+            az0 = 0.5f - az0;
+
+            x0 = xNSign * ax0;
+            y0 = yNSign * ay0;
+            z0 = zNSign * az0;
+
+            a += (0.75f - ax0) - (ay0 + az0);
+
+            i += (xNSign >> 1) & PrimeX;
+            j += (yNSign >> 1) & PrimeY;
+            k += (zNSign >> 1) & PrimeZ;
+
+            xNSign = -xNSign;
+            yNSign = -yNSign;
+            zNSign = -zNSign;
+
+            seed = ~seed;
+        }
+
+        dx *= 32.69428253173828125f;
+        dy *= 32.69428253173828125f;
+        dz *= 32.69428253173828125f;
+        return value * 32.69428253173828125f;
+    }
+
+    // GenFractalFBm with the product rule through the weighted-strength amplitude
+    template <typename FNfloat>
+    float GenFractalFBmDerivative(FNfloat x, FNfloat y, FNfloat z, float &dx, float &dy, float &dz) const
+    {
+        int seed = mSeed;
+        float sum = 0;
+        float amp = mFractalBounding;
+        float ampDx = 0, ampDy = 0, ampDz = 0;
+        float scale = 1;
+        dx = dy = dz = 0;
+
+        for (int i = 0; i < mOctaves; i++)
+        {
+            float ndx, ndy, ndz;
+            float noise = SingleOpenSimplex2Derivative(seed++, x, y, z, ndx, ndy, ndz);
+            ndx *= scale;
+            ndy *= scale;
+            ndz *= scale;
+
+            sum += noise * amp;
+            dx += ndx * amp + noise * ampDx;
+            dy += ndy * amp + noise * ampDy;
+            dz += ndz * amp + noise * ampDz;
+
+            float weight = Lerp(1.0f, (noise + 1) * 0.5f, mWeightedStrength);
+            float weightSlope = mWeightedStrength * 0.5f;
+            ampDx = ampDx * weight + amp * weightSlope * ndx;
+            ampDy = ampDy * weight + amp * weightSlope * ndy;
+            ampDz = ampDz * weight + amp * weightSlope * ndz;
+            amp *= weight;
+
+            x *= mLacunarity;
+            y *= mLacunarity;
+            z *= mLacunarity;
+            scale *= mLacunarity;
+            amp *= mGain;
+            ampDx *= mGain;
+            ampDy *= mGain;
+            ampDz *= mGain;
+        }
+
+        return sum;
+    }
+
+    // GenFractalRidged; d|n| = sign(n) * dn
+    template <typename FNfloat>
+    float GenFractalRidgedDerivative(FNfloat x, FNfloat y, FNfloat z, float &dx, float &dy, float &dz) const
+    {
+        int seed = mSeed;
+        float sum = 0;
+        float amp = mFractalBounding;
+        float ampDx = 0, ampDy = 0, ampDz = 0;
+        float scale = 1;
+        dx = dy = dz = 0;
+
+        for (int i = 0; i < mOctaves; i++)
+        {
+            float ndx, ndy, ndz;
+            float signed_ = SingleOpenSimplex2Derivative(seed++, x, y, z, ndx, ndy, ndz);
+            float noise = FastAbs(signed_);
+            float sign = signed_ < 0 ? -scale : scale;
+            ndx *= sign;
+            ndy *= sign;
+            ndz *= sign;
+
+            sum += (noise * -2 + 1) * amp;
+            dx += ndx * -2 * amp + (noise * -2 + 1) * ampDx;
+            dy += ndy * -2 * amp + (noise * -2 + 1) * ampDy;
+            dz += ndz * -2 * amp + (noise * -2 + 1) * ampDz;
+
+            float weight = Lerp(1.0f, 1 - noise, mWeightedStrength);
+            ampDx = ampDx * weight - amp * mWeightedStrength * ndx;
+            ampDy = ampDy * weight - amp * mWeightedStrength * ndy;
+            ampDz = ampDz * weight - amp * mWeightedStrength * ndz;
+            amp *= weight;
+
+            x *= mLacunarity;
+            y *= mLacunarity;
+            z *= mLacunarity;
+            scale *= mLacunarity;
+            amp *= mGain;
+            ampDx *= mGain;
+            ampDy *= mGain;
+            ampDz *= mGain;
+        }
+
+        return sum;
+    }
+
+    // SingleDomainWarpOpenSimplex2Gradient plus d(displacement)/d(x, y, z) in its frequency scaled input space,
+    // derivative[row * 3 + column]. same falloff terms as SingleOpenSimplex2Derivative, times the output direction
+    template <typename FNfloat>
+    void SingleDomainWarpOpenSimplex2GradientDerivative(int seed, float warpAmp, float frequency, FNfloat x, FNfloat y, FNfloat z,
+                                                        FNfloat &xr, FNfloat &yr, FNfloat &zr, bool outGradOnly, float *derivative) const
+    {
+        x *= frequency;
+        y *= frequency;
+        z *= frequency;
+
+        int i = FastRound(x);
+        int j = FastRound(y);
+        int k = FastRound(z);
+        float x0 = (float)x - i;
+        float y0 = (float)y - j;
+        float z0 = (float)z - k;
+
+        int xNSign = (int)(-x0 - 1.0f) | 1;
+        int yNSign = (int)(-y0 - 1.0f) | 1;
+        int zNSign = (int)(-z0 - 1.0f) | 1;
+
+        float ax0 = xNSign * -x0;
+        float ay0 = yNSign * -y0;
+        float az0 = zNSign * -z0;
+
+        i *= PrimeX;
+        j *= PrimeY;
+        k *= PrimeZ;
+
+        float vx, vy, vz;
+        vx = vy = vz = 0;
+        for (int d = 0; d < 9; d++)
+            derivative[d] = 0;
+
+        auto contribute = [&](float t, int ip, int jp, int kp, float xd, float yd, float zd)
+        {
+            float tt = t * t;
+            float tttt = tt * tt;
+            float xg, yg, zg, xo, yo, zo;
+            float dot, slope[3];
+            if (outGradOnly)
+            {
+                GradCoordOut(seed, ip, jp, kp, xo, yo, zo);
+                dot = 1;
+                slope[0] = slope[1] = slope[2] = 0;
+            }
+            else
+            {
+                GradVectorDual(seed, ip, jp, kp, xg, yg, zg, xo, yo, zo);
+                dot = xd * xg + yd * yg + zd * zg;
+                slope[0] = tttt * xg;
+                slope[1] = tttt * yg;
+                slope[2] = tttt * zg;
+            }
+            vx += tttt * (dot * xo);
+            vy += tttt * (dot * yo);
+            vz += tttt * (dot * zo);
+
+            float falloff = -8 * tt * t * dot;
+            float d[3] = {falloff * xd + slope[0], falloff * yd + slope[1], falloff * zd + slope[2]};
+            float out[3] = {xo, yo, zo};
+            for (int row = 0; row < 3; row++)
+            {
+                for (int column = 0; column < 3; column++)
+                    derivative[row * 3 + column] += out[row] * d[column];
+            }
+        };
+
+        float a = (0.6f - x0 * x0) - (y0 * y0 + z0 * z0);
+        for (int l = 0; l < 2; l++)
+        {
+            if (a > 0)
+                contribute(a, i, j, k, x0, y0, z0);
+
+            float b = a + 1;
+            int i1 = i;
+            int j1 = j;
+            int k1 = k;
+            float x1 = x0;
+            float y1 = y0;
+            float z1 = z0;
+
+            if (ax0 >= ay0 && ax0 >= az0)
+            {
+                x1 += xNSign;
+                b -= xNSign * 2 * x1;
+                i1 -= xNSign * PrimeX;
+            }
+            else if (ay0 > ax0 && ay0 >= az0)
+            {
+                y1 += yNSign;
+                b -= yNSign * 2 * y1;
+                j1 -= yNSign * PrimeY;
+            }
+            else
+            {
+                z1 += zNSign;
+                b -= zNSign * 2 * z1;
+                k1 -= zNSign * PrimeZ;
+            }
+
+            if (b > 0)
+                contribute(b, i1, j1, k1, x1, y1, z1);
+
+            if (l == 1)
+                break;
+
+            ax0 = 0.5f - ax0;
+            ay0 = 0.5f - ay0;
+            az0 = 0.5f - az0;
+
+            x0 = xNSign * ax0;
+            y0 = yNSign * ay0;
+            z0 = zNSign * az0;
+
+            a += (0.75f - ax0) - (ay0 + az0);
+
+            i += (xNSign >> 1) & PrimeX;
+            j += (yNSign >> 1) & PrimeY;
+            k += (zNSign >> 1) & PrimeZ;
+
+            xNSign = -xNSign;
+            yNSign = -yNSign;
+            zNSign = -zNSign;
+
+            seed += 1293373;
+        }
+
+        xr += vx * warpAmp;
+        yr += vy * warpAmp;
+        zr += vz * warpAmp;
+        for (int d = 0; d < 9; d++)
+            derivative[d] *= warpAmp;
+    }
 };
 
 template <>
@@ -0,0 +1,101 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+#include "include/chunkmanager.h"
+#include "include/cpumesher.h"
+
+// a chunk as built with one set of settings at one level of detail
+struct ChunkKey
+{
+    uint64_t paramHash = 0;
+    glm::ivec2 coord = glm::ivec2(0);
+    int lod = 0; // 0 = full resolution, the only level chunks are built at so far
+
+    bool operator==(const ChunkKey &other) const { return paramHash == other.paramHash && coord == other.coord && lod == other.lod; }
+};
+
+struct ChunkKeyHash
+{
+    size_t operator()(const ChunkKey &key) const
+    {
+        uint64_t h = key.paramHash ^ ((uint64_t)ChunkManager::key(key.coord) * 0x9E3779B97F4A7C15ull) ^ ((uint64_t)key.lod << 59);
+        return (size_t)(h ^ (h >> 29));
+    }
+};
+
+// CPU copy of a built chunk: the mesh as uploaded and the density it came from, in the storage format
+struct ChunkData
+{
+    bool packedVertices = false;
+    std::vector<VertexNormal> vertices;
+    std::vector<PackedVertex> packed; // instead of vertices when packedVertices
+    std::vector<uint32_t> indices;    // empty for a triangle soup
+    std::vector<uint32_t> densityWords;
+
+    size_t meshBytes() const { return vertices.size() * sizeof(VertexNormal) + packed.size() * sizeof(PackedVertex) + indices.size() * sizeof(uint32_t); }
+    size_t bytes() const { return meshBytes() + densityWords.size() * sizeof(uint32_t); }
+};
+
+// chunks that left the view, kept so flying back does not rebuild them. two tiers, each least recently
+// used first out: GPU buffers of retired chunks, drawn again as they are, and CPU copies of built
+// chunks, uploaded again without regenerating. sizes are the bytes handed to glBufferData and held in
+// the vectors, not driver or allocator overhead. each budget covers the tier and what the caller holds
+// besides it, which the caller takes off as the limit it passes in.
+// the cache makes no GL calls: evicted GPU chunks are handed back for the caller to release
+class ChunkCache
+{
+public:
+    struct Stats
+    {
+        unsigned long long gpuHits = 0;
+        unsigned long long gpuMisses = 0;
+        unsigned long long gpuEvictions = 0;
+        unsigned long long cpuHits = 0;
+        unsigned long long cpuMisses = 0;
+        unsigned long long cpuEvictions = 0;
+        unsigned long long cpuRejected = 0; // bigger than the limit on its own
+        size_t gpuBytes = 0;
+        size_t cpuBytes = 0;
+        int gpuEntries = 0;
+        int cpuEntries = 0;
+    };
+
+    // hit: moves the chunk out of the cache into chunk
+    bool takeGpu(const ChunkKey &key, Chunk &chunk);
+    // caches a retired chunk and evicts until the tier fits in limit bytes; the chunk itself is evicted
+    // straight away if it does not fit on its own
+    void putGpu(const ChunkKey &key, const Chunk &chunk, size_t limit, std::vector<Chunk> &evicted);
+    void trimGpu(size_t limit, std::vector<Chunk> &evicted);
+    void clearGpu(std::vector<Chunk> &evicted);
+
+    // hit: marks the entry most recently used; valid until the next putCpu
+    const ChunkData *findCpu(const ChunkKey &key);
+    // caches a built chunk and evicts until the tier fits in limit bytes; false if the data alone does not
+    bool putCpu(const ChunkKey &key, ChunkData &&data, size_t limit);
+    void trimCpu(size_t limit);
+    void clearCpu();
+
+    const Stats &stats() const { return counters; }
+    void resetCounters();
+
+    size_t gpuBudget = 256u << 20; // for the resident chunks and this tier together, the caller's limits
+    size_t cpuBudget = 256u << 20; // for this tier and the chunk data waiting elsewhere, the caller's limit
+
+private:
+    template <typename Value>
+    struct Lru
+    {
+        std::list<std::pair<ChunkKey, Value>> order; // most recently used first
+        std::unordered_map<ChunkKey, typename std::list<std::pair<ChunkKey, Value>>::iterator, ChunkKeyHash> entries;
+    };
+    static size_t gpuBytes(const Chunk &chunk) { return chunk.densityBytes + chunk.meshBytes; }
+
+    Lru<Chunk> gpu;
+    Lru<ChunkData> cpu;
+    Stats counters;
+};
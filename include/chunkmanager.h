@@ -0,0 +1,76 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include "include/jobsystem.h"
+
+// GPU resources of one resident chunk. mesh positions are chunk-local, as the single volume's, and
+// drawn translated by the chunk's origin
+struct Chunk
+{
+    glm::ivec2 coord = glm::ivec2(0); // chunk units along x and z
+    GLuint densityBuffer = 0;
+    GLuint vertexBuffer = 0;
+    GLuint indexBuffer = 0; // 0 for a triangle soup
+    GLuint VAO = 0;
+    GLsizei vertexCount = 0;
+    GLsizei indexCount = 0;
+    bool packedVertices = false;
+    uint64_t paramHash = 0; // MarchingCubes::meshParamHash it was built with
+    size_t densityBytes = 0;
+    size_t meshBytes = 0;
+};
+
+// which chunks should be resident around the camera. the world is a plane of columns chunkSize wide
+// in x and z (the terrain fits one chunk in y), keyed by integer chunk coordinates. chunks within
+// radius of the camera's chunk are loaded nearest first; a resident chunk is only retired once it is
+// more than radius + 1 away, so flying along a chunk border does not load and retire the same row
+// every frame. chunks built on the job pool are tracked with their cancellation token from submission
+// until the result is uploaded. GL resources are created and released by MarchingCubes, this only
+// keeps the books
+class ChunkManager
+{
+public:
+    explicit ChunkManager(int chunkSize);
+
+    // shifted unsigned, a negative x shifted as int64_t would be undefined
+    static int64_t key(const glm::ivec2 &coord) { return (int64_t)((uint64_t)(uint32_t)coord.x << 32 | (uint32_t)coord.y); }
+    static glm::ivec2 keyCoord(int64_t key);
+    // JobSystem tag of a chunk's build, never 0 (that would need x = INT_MIN)
+    static uint64_t jobTag(const glm::ivec2 &coord) { return (uint64_t)key(coord) ^ (1ull << 63); }
+    static glm::ivec2 tagCoord(uint64_t tag);
+    glm::ivec2 chunkAt(const glm::vec3 &position) const;
+    glm::vec3 origin(const glm::ivec2 &coord) const;
+
+    // coordinates within radius of centre that are neither resident nor being built, nearest first
+    void missing(const glm::ivec2 &centre, std::vector<glm::ivec2> &coords) const;
+    // resident coordinates within radius of centre built with another paramHash and not being rebuilt,
+    // nearest first
+    void stale(const glm::ivec2 &centre, uint64_t paramHash, std::vector<glm::ivec2> &coords) const;
+    // resident coordinates past radius + 1 of centre
+    void outOfRange(const glm::ivec2 &centre, std::vector<glm::ivec2> &coords) const;
+
+    void markBuilding(const glm::ivec2 &coord, const CancellationToken &token);
+    // false if the build was cancelled since, in which case its result is stale
+    bool finishBuilding(const glm::ivec2 &coord, const CancellationToken &token);
+    // cancels builds past radius + 1 of centre and returns how many
+    int cancelOutOfRange(const glm::ivec2 &centre);
+    void cancelAll();
+    int buildingCount() const { return (int)building.size(); }
+
+    Chunk *find(const glm::ivec2 &coord);
+    Chunk &insert(const Chunk &chunk);
+    void erase(const glm::ivec2 &coord);
+    std::unordered_map<int64_t, Chunk> &resident() { return chunks; }
+    const std::unordered_map<int64_t, Chunk> &resident() const { return chunks; }
+
+    int chunkSize;
+    int radius = 4;
+
+private:
+    std::unordered_map<int64_t, Chunk> chunks;
+    std::unordered_map<int64_t, CancellationToken> building;
+};
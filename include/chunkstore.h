@@ -0,0 +1,142 @@
+#pragma once
+#include <cstddef>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "include/chunkcache.h"
+
+// a built chunk as it lies in the pack file. the pointers point into the mapping, which stays alive
+// as long as this does, so uploading straight from them copies nothing on the CPU side
+struct StoredChunk
+{
+    std::shared_ptr<const void> mapping;
+    bool packedVertices = false;
+    const void *vertices = nullptr; // VertexNormal, or PackedVertex when packedVertices
+    size_t vertexCount = 0;
+    const uint32_t *indices = nullptr; // none for a triangle soup
+    size_t indexCount = 0;
+    const uint32_t *densityWords = nullptr; // in the storage format it was built with
+    size_t densityWordCount = 0;
+};
+
+// built chunks kept on disk between runs, so the same seed and settings are not generated twice.
+// two files in one directory, both append-only: chunks.pack holds the records, chunks.idx one small
+// checksummed entry per record. a record is synced to disk before its index entry is written, so an
+// entry never points at data that is not there; a crash mid-write leaves at most a torn entry or an
+// unindexed record at the end, and open() cuts both off. reads go through a read-only mapping of the
+// pack. writes go through a queue to one writer thread, so nothing that builds or draws chunks waits
+// on the disk; everything is safe from any thread.
+// past the budget the writer compacts: the most recently used records are copied into new files,
+// which replace the old ones by rename, and the rest, records of old settings first, are dropped
+class ChunkStore
+{
+public:
+    struct Stats
+    {
+        int records = 0;
+        size_t packBytes = 0;
+        unsigned long long hits = 0;
+        unsigned long long misses = 0;
+        unsigned long long writes = 0;
+        unsigned long long writeFailures = 0;
+        unsigned long long droppedWrites = 0; // not queued, the queue was full
+        int queuedWrites = 0;                 // now, including the one being written
+        size_t queuedBytes = 0;               // now, the records in the queue
+        unsigned long long droppedOnOpen = 0; // torn or unreadable entries cut off by open
+        double writeMs = 0.0;                 // total, including the syncs
+        unsigned long long compactions = 0;
+        unsigned long long compactedRecords = 0; // dropped by the compactions
+        double compactMs = 0.0;
+    };
+
+    ChunkStore() = default;
+    ~ChunkStore();
+    ChunkStore(const ChunkStore &) = delete;
+    ChunkStore &operator=(const ChunkStore &) = delete;
+
+    // creates the directory and files if needed; files written by another version start over. false
+    // and closed if the files can not be opened
+    bool open(const std::string &directory);
+    // writes what is still queued, then closes the files
+    void close();
+    bool isOpen() const { return opened; }
+
+    bool find(const ChunkKey &key, StoredChunk &chunk);
+    bool contains(const ChunkKey &key) const;
+    // copies the chunk into the write queue and returns; false if it is stored or queued already, or
+    // the queue holds maxQueuedBytes
+    bool enqueue(const ChunkKey &key, const ChunkData &data);
+    // drops every record, and the queued ones
+    void clear();
+    // bytes the pack may grow to before it is compacted to three quarters of it; 0 for no limit
+    void setBudget(uint64_t bytes);
+
+    size_t maxQueuedBytes = 64u << 20;
+
+    Stats stats() const;
+    void resetCounters();
+
+private:
+    struct Entry
+    {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        uint64_t lastUse = 0; // useClock when last found or written
+    };
+
+    struct PendingRecord
+    {
+        ChunkKey key;
+        std::vector<char> record;
+    };
+
+    bool mapPack(uint64_t size);
+    bool loadIndex();
+    bool append(const ChunkKey &key, const std::vector<char> &record);
+    // copies the most recently used records that fit in target bytes into new files, which then
+    // replace the old ones; writeMutex held
+    bool rewrite(uint64_t target, size_t &dropped);
+    void writeQueued();
+
+    std::string directoryPath;
+    std::string packPath;
+    std::string indexPath;
+    int packFile = -1;
+    int indexFile = -1;
+    std::atomic<bool> opened{false}; // for isOpen from other threads, the files are behind writeMutex
+
+    // appends, one at a time
+    std::mutex writeMutex;
+    uint64_t packEnd = 0;
+    uint64_t indexEnd = 0;
+
+    // index, mapping and counters; never held across a disk write
+    mutable std::mutex indexMutex;
+    std::unordered_map<ChunkKey, Entry, ChunkKeyHash> entries;
+    std::shared_ptr<const void> mapping;
+    uint64_t mappedBytes = 0;
+    uint64_t indexedBytes = 0; // end of the last indexed record, all a read may touch
+    uint64_t useClock = 0;
+    Stats counters;
+
+    // the writer thread's queue
+    mutable std::mutex queueMutex;
+    std::condition_variable queueReady;
+    std::condition_variable queueIdle;
+    std::deque<PendingRecord> queue;
+    std::unordered_set<ChunkKey, ChunkKeyHash> queuedKeys;
+    size_t queuedBytes = 0;
+    bool writing = false;
+    bool stopping = false;
+    bool budgetChanged = false;
+    std::atomic<uint64_t> budget{0};
+    std::thread writer;
+};
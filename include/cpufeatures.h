@@ -0,0 +1,13 @@
+#pragma once
+
+// widest x86 vector instruction set usable on this machine, checked once via CPUID/XGETBV
+enum class SimdLevel
+{
+    Scalar,
+    SSE41,
+    AVX2,
+    AVX512
+};
+
+SimdLevel detectSimdLevel();
+const char *simdLevelName(SimdLevel level);
@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// vertex layout written by marchingCube.comp.glsl (binding 1)
+struct VertexNormal
+{
+    glm::vec4 position;
+    glm::vec3 normal;
+    float pad;
+};
+
+// 12-byte vertex written by storeVertex in shaders/meshCommon.glsl when vertices are packed:
+// chunk-local fixed-point position (1/512 voxel from -1), 2 spare bytes and an octahedral normal
+struct PackedVertex
+{
+    uint16_t position[3];
+    uint16_t spare;
+    int16_t normal[2];
+};
+static_assert(sizeof(PackedVertex) == 12, "PackedVertex must match the 12-byte GPU layout");
+
+// same rounding as the shader, and its inverse as vertex.glsl decodes it
+PackedVertex packVertex(const VertexNormal &vertex);
+VertexNormal unpackVertex(const PackedVertex &vertex);
+
+// CPU port of shaders/marchingCube.comp.glsl over a densitySize^3 field in DensityGenerator's
+// layout. cells are visited x fastest, so the output order is deterministic; the GPU appends
+// triangles in whatever order its atomics hand out (or in this order with prefix sums).
+// work is split into contiguous ranges of x rows (z-major, so an even share even when there are more
+// threads than z slices), each appending to its own arena; the arenas are concatenated in row order,
+// so the output does not depend on threadCount. cube indices come a row at a time from CubeClassify
+class CpuMesher
+{
+public:
+    explicit CpuMesher(int densitySize);
+
+    // normalised gradient per sample, same as shaders/gradient.comp.glsl
+    void computeGradients(const std::vector<float> &density, std::vector<glm::vec3> &gradients) const;
+
+    // gradients from computeGradients, or nullptr to take central differences at every cube corner
+    void mesh(const std::vector<float> &density, const std::vector<glm::vec3> *gradients, std::vector<VertexNormal> &vertices) const;
+
+    // indexed variant, as meshVertices.comp.glsl + meshIndices.comp.glsl: every sample owns the vertices on
+    // its +x, +y and +z edges and cells reference them. vertices come out sample by sample, x fastest,
+    // and indices cell by cell, so the result is deterministic
+    void meshIndexed(const std::vector<float> &density, const std::vector<glm::vec3> *gradients, std::vector<VertexNormal> &vertices, std::vector<uint32_t> &indices) const;
+
+    // dual mesh, as surfaceNetsVertices.comp.glsl + surfaceNetsQuads.comp.glsl: one vertex per cell that
+    // crosses the surface (the mean of its edge crossings, or with dualContouring the QEF minimiser of
+    // the planes through them, kept inside the cell) and a quad of the four cells around each crossing
+    // edge. vertices come out cell by cell and quads sample by sample, so the result is deterministic
+    void meshSurfaceNets(const std::vector<float> &density, const std::vector<glm::vec3> *gradients, bool dualContouring, std::vector<VertexNormal> &vertices, std::vector<uint32_t> &indices) const;
+
+    int densitySize;
+    unsigned int threadCount = 0; // 0 = one worker per hardware thread
+    // x and z cells [x, y] to mesh, u_CellRange in meshCommon.glsl; (0, 0) = all of them
+    glm::ivec2 cellRange = glm::ivec2(0);
+
+private:
+    bool cellInRange(int x, int z) const;
+    // whether a cell in the range uses the edge from sample (x, z) towards +axis
+    bool edgeInRange(int x, int z, int axis) const;
+    bool onCellRangeBorder(int x, int z) const;
+    // sign rows for CubeClassify::cubeRow
+    void classifySigns(const std::vector<float> &density, std::vector<uint64_t> &signs) const;
+    void meshSlab(const std::vector<float> &density, const std::vector<glm::vec3> *gradients, const std::vector<uint64_t> &signs, int rowBegin, int rowEnd, std::vector<VertexNormal> &vertices) const;
+    VertexNormal dualVertex(const std::vector<float> &density, const std::vector<glm::vec3> *gradients, int x, int y, int z, int cubeIndex, bool dualContouring) const;
+    float sample(const std::vector<float> &density, int x, int y, int z) const;
+    glm::vec3 centralDifference(const std::vector<float> &density, int x, int y, int z) const;
+    glm::vec3 cornerNormal(const std::vector<float> &density, const std::vector<glm::vec3> *gradients, int x, int y, int z) const;
+    // central difference at a corner of border cell (cellX, cellZ), -1 where the cell is not on that border
+    glm::vec3 borderNormal(const std::vector<float> &density, int x, int y, int z, int cellX, int cellZ) const;
+};
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "cpufeatures.h"
+
+// cube indices for CpuMesher without eight scalar compares per cell. every sample row (y, z) becomes a
+// row of sign bits (bit x set where density < isoLevel) with whole-row vector compares and movemask,
+// then the four sign rows around a cell row are shifted against each other and spread into one
+// 8-bit cube index per cell, 16 or 32 cells at a time. cell rows whose four sign rows are all
+// outside or all inside have no triangles and are skipped before any of that.
+// the vector paths give the same bits as the scalar one, so the choice never changes the mesh.
+namespace CubeClassify
+{
+    // uint64_t words per sign row: enough for densitySize bits plus the word rowBits may read past them
+    inline int rowWords(int densitySize) { return densitySize / 64 + 2; }
+
+    // sign rows for sample rows [rowBegin, rowEnd), row = y + z * densitySize, into signs + row * rowWords
+    void signRows(const float *density, int densitySize, float isoLevel, int rowBegin, int rowEnd, uint64_t *signs);
+
+    // cube indices of the densitySize - 1 cells of cell row (y, z), corner order as cornerOffsets in
+    // cpumesher.cpp. returns false, writing nothing, when every cell in the row is 0 or 255
+    bool cubeRow(const uint64_t *signs, int densitySize, int y, int z, uint8_t *cubeIndices);
+
+    SimdLevel activeLevel();
+    // caps the dispatch level (clamped to what the CPU supports); used to compare against the scalar path
+    void forceLevel(SimdLevel level);
+
+    // 32 sign bits starting at bit x. static so every ISA translation unit keeps its own copy
+    static inline uint32_t rowBits(const uint64_t *row, int x)
+    {
+        int shift = x & 63;
+        uint64_t low = row[x >> 6] >> shift;
+        uint64_t high = shift > 32 ? row[(x >> 6) + 1] << (64 - shift) : 0;
+        return (uint32_t)(low | high);
+    }
+
+    // per-ISA kernels, defined in cubeclassify_<isa>.cpp. each handles a whole number of vectors from
+    // the start of the row and returns how many samples / cells it did, 0 if compiled without that ISA;
+    // the caller finishes the tail in scalar code. rows are the sign rows at (y, z), (y + 1, z),
+    // (y, z + 1) and (y + 1, z + 1)
+    int signRowAVX2(const float *row, int count, float isoLevel, uint64_t *bits);
+    int signRowAVX512(const float *row, int count, float isoLevel, uint64_t *bits);
+    int cubeRowAVX2(const uint64_t *const rows[4], int cells, uint8_t *cubeIndices);
+    int cubeRowAVX512(const uint64_t *const rows[4], int cells, uint8_t *cubeIndices);
+}
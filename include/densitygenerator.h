@@ -0,0 +1,75 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "FastNoiseLite.h"
+#include "include/cave.h"
+
+// matches u_TerrainMode in density.comp.glsl
+enum TerrainMode
+{
+    TERRAIN_VOLUMETRIC = 0, // height FBm per voxel at the 3D-warped position
+    TERRAIN_HEIGHTMAP = 1   // xz-only warp, height FBm once per column (heightmap.comp.glsl)
+};
+
+// noise evaluations the cave masks made unnecessary. evaluations is voxels * caves,
+// i.e. how many of each noise a run without any skipping would do
+struct CaveSkipStats
+{
+    unsigned long long caveNoiseSkipped = 0;
+    unsigned long long zoneNoiseSkipped = 0;
+    unsigned long long evaluations = 0;
+    unsigned long long tilesSkipped = 0; // GPU only: 8^3 workgroups that skipped every cave
+};
+
+// CPU port of shaders/density.comp.glsl. produces the same densitySize^3 layout
+// (x fastest, then y, then z) so the result can be uploaded or meshed directly.
+class DensityGenerator
+{
+public:
+    explicit DensityGenerator(int densitySize);
+
+    void generate(int seed, const std::vector<Cave> &caves, float caveCeiling, const glm::vec3 &offset, std::vector<float> &density, CaveSkipStats *stats = nullptr) const;
+    // densitySize^2 column heights, x fastest then z. same layout as the GPU heightmap buffer
+    void generateHeightmap(int seed, const glm::vec3 &offset, std::vector<float> &heightmap) const;
+
+    // per-sample normals from the analytic noise derivatives: normalised -gradient, the convention of
+    // CpuMesher::computeGradients. always the full-rate volumetric field, like density.comp.glsl with
+    // u_AnalyticGradients, so terrainMode and the strides are ignored
+    void generateNormals(int seed, const std::vector<Cave> &caves, float caveCeiling, const glm::vec3 &offset, std::vector<glm::vec3> &normals) const;
+
+    // points per axis of a field sampled every `stride` voxels (shaders/coarseLattice.glsl)
+    static int latticeSize(int densitySize, int stride);
+
+    int densitySize;
+    unsigned int threadCount = 0; // 0 = one worker per hardware thread
+    TerrainMode terrainMode = TERRAIN_VOLUMETRIC;
+    // sample the warp / cave zone noise every N voxels and interpolate trilinearly. 1 = per voxel
+    int warpStride = 1;
+    int zoneStride = 1;
+    // air on the x and z faces that closes the single volume, u_Walls in density.comp.glsl; off for chunks
+    bool walls = true;
+
+private:
+    struct NoiseSet
+    {
+        FastNoiseLite warpNoise;
+        FastNoiseLite terrainNoise;
+        std::vector<FastNoiseLite> caveNoise;
+        std::vector<FastNoiseLite> zoneNoise;
+    };
+
+    // coarse lattices, same layout as the GPU WarpFieldBuffer / ZoneFieldBuffer
+    struct CoarseFields
+    {
+        int warpLattice = 0; // 0 = not used
+        std::vector<float> warp; // xyz displacement per lattice point
+        int zoneLattice = 0;
+        std::vector<float> zone; // one lattice per cave
+    };
+
+    NoiseSet createNoiseSet(int seed, const std::vector<Cave> &caves) const;
+    void generateCoarseFields(const NoiseSet &noises, const std::vector<Cave> &caves, const glm::vec3 &offset, CoarseFields &coarse) const;
+    void generateHeightmapSlab(const NoiseSet &noises, const glm::vec3 &offset, int zBegin, int zEnd, float *heightmap) const;
+    glm::vec3 densityGradient(const NoiseSet &noises, const std::vector<Cave> &caves, float caveCeiling, const glm::vec3 &worldPos) const;
+    void generateSlab(const NoiseSet &noises, const std::vector<Cave> &caves, float caveCeiling, const glm::vec3 &offset, const float *heightmap, const CoarseFields &coarse, int zBegin, int zEnd, float *density, CaveSkipStats &stats) const;
+};
@@ -0,0 +1,107 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "FastNoiseLite.h"
+#include "include/cave.h"
+
+// small expression graph for terrain density. nodes are added bottom-up through the builder
+// methods, which return node ids, so inputs always come before the nodes that use them.
+// compile() turns the graph into a straight-line program that can be emitted as a GLSL compute
+// kernel or evaluated natively over FastNoiseLite, giving one specialised kernel per variant.
+class DensityGraph
+{
+public:
+    enum Op
+    {
+        Const,      // value
+        Position,   // vec3 world position of the sample
+        Vec3,       // vec3(a, b, c)
+        Component,  // a[axis]
+        Offset,     // vec3 a + vector
+        Warp,       // noise domain warp of vec3 a
+        Noise,      // noise at vec3 a
+        Add,
+        Sub,
+        Mul,
+        Min,
+        Max,
+        Mix,        // mix(a, b, c)
+        Smin,       // polynomial smooth min(a, b, k = c)
+        Clamp,      // clamp(a, b, c)
+        Smoothstep  // smoothstep(a, b, c)
+    };
+
+    // fnl_state / FastNoiseLite settings. the seed is u_Seed + seedOffset so a new seed never recompiles
+    struct NoiseDesc
+    {
+        int seedOffset = 0;
+        float frequency = 0.01f;
+        FastNoiseLite::NoiseType noiseType = FastNoiseLite::NoiseType_OpenSimplex2;
+        FastNoiseLite::FractalType fractalType = FastNoiseLite::FractalType_None;
+        int octaves = 3;
+        float lacunarity = 2.0f;
+        float gain = 0.5f;
+        float weightedStrength = 0.0f;
+        float pingPongStrength = 2.0f;
+        FastNoiseLite::DomainWarpType warpType = FastNoiseLite::DomainWarpType_OpenSimplex2;
+        float warpAmp = 1.0f;
+
+        bool operator==(const NoiseDesc &other) const;
+    };
+
+    struct Node
+    {
+        Op op = Const;
+        int a = -1, b = -1, c = -1;
+        float value = 0.0f;
+        glm::vec3 vector = glm::vec3(0.0f);
+        int axis = 0;
+        int noise = -1; // index into noises for Warp / Noise
+    };
+
+    int constant(float value);
+    int position();
+    int vec3(int x, int y, int z);
+    int component(int v, int axis);
+    int offset(int v, const glm::vec3 &vector);
+    int warp(const NoiseDesc &desc, int v);
+    int noise(const NoiseDesc &desc, int v);
+    int add(int a, int b);
+    int sub(int a, int b);
+    int mul(int a, int b);
+    int min(int a, int b);
+    int max(int a, int b);
+    int mix(int a, int b, int t);
+    int smin(int a, int b, int k);
+    int clamp(int x, int lo, int hi);
+    int smoothstep(int edge0, int edge1, int x);
+    void setOutput(int node) { output = node; }
+
+    static bool isVector(Op op) { return op == Position || op == Vec3 || op == Offset || op == Warp; }
+
+    // constant folding, dead node removal and merging of identical nodes. the result is in
+    // dependency order with only live nodes, and one noise state per distinct NoiseDesc
+    DensityGraph compile() const;
+
+    // compute shader for Shader::fromComputeSource with FastNoiseLite.glsl and densityStorage.glsl
+    // as includes. bindings and uniforms match density.comp.glsl (densitySize, u_Seed, u_Offset)
+    std::string emitGlsl() const;
+
+    // native evaluation of a compiled graph, densitySize^3 samples laid out like DensityGenerator.
+    // walls as DensityGenerator::walls
+    void evaluate(int seed, const glm::vec3 &offset, int densitySize, unsigned int threadCount, std::vector<float> &density, bool walls = true) const;
+
+    std::vector<Node> nodes;
+    std::vector<NoiseDesc> noises;
+    int output = -1;
+    int sourceNodes = 0; // node count before compile()
+
+private:
+    int push(const Node &node);
+    int addNoise(const NoiseDesc &desc);
+    void evaluateSlab(const std::vector<FastNoiseLite> &states, const glm::vec3 &offset, int densitySize, int zBegin, int zEnd, bool walls, float *density) const;
+};
+
+// density.comp.glsl's volumetric terrain (warp, FBm height, ridged caves with zone and height masks) as a graph
+DensityGraph buildTerrainGraph(const std::vector<Cave> &caves, float caveCeiling);
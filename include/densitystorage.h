@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// matches u_DensityFormat in shaders/densityStorage.glsl
+enum DensityFormat
+{
+    DENSITY_FLOAT32 = 0, // one float per sample
+    DENSITY_FP16 = 1,    // packHalf2x16, two samples per uint
+    DENSITY_INT16 = 2    // signed 16-bit, value * scale(), two samples per uint
+};
+
+// how a density field is laid out in the density buffer. float32 keeps the DensityGenerator layout
+// (x fastest, then y, then z). the 16-bit formats pack an x pair into one uint, low half first,
+// with every row padded to an even length so a workgroup always owns whole words.
+// only the sign and values near zero matter for meshing: the sign is kept exactly, so the
+// mesh topology never changes, and int16 clamps everything outside +-range (bedrock and walls).
+struct DensityStorage
+{
+    DensityFormat format = DENSITY_FLOAT32;
+    float range = 16.0f; // int16 only, per chunk. one step is range / 32767
+
+    float scale() const { return 32767.0f / range; }
+    size_t wordCount(int densitySize) const;
+    size_t byteSize(int densitySize) const { return wordCount(densitySize) * sizeof(uint32_t); }
+
+    void encode(const std::vector<float> &density, int densitySize, std::vector<uint32_t> &words) const;
+    void decode(const std::vector<uint32_t> &words, int densitySize, std::vector<float> &density) const;
+
+    // what a sample reads back as after a round trip through this format
+    float quantize(float value) const;
+
+    static uint16_t floatToHalf(float value);
+    static float halfToFloat(uint16_t half);
+
+private:
+    uint16_t encodeHalfWord(float value) const;
+    float decodeHalfWord(uint16_t bits) const;
+};
@@ -0,0 +1,25 @@
+#pragma once
+#include <algorithm>
+
+// GLSL built-ins, written out so the arithmetic matches the shaders operation for operation
+inline float clampf(float x, float lo, float hi)
+{
+    return std::min(std::max(x, lo), hi);
+}
+
+inline float mixf(float a, float b, float t)
+{
+    return a * (1.0f - t) + b * t;
+}
+
+inline float smoothstepf(float edge0, float edge1, float x)
+{
+    float t = clampf((x - edge0) / (edge1 - edge0), 0.0f, 1.0f);
+    return t * t * (3.0f - 2.0f * t);
+}
+
+inline float smin(float a, float b, float k)
+{
+    float h = clampf(0.5f + 0.5f * (b - a) / k, 0.0f, 1.0f);
+    return mixf(b, a, h) - k * h * (1.0f - h);
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// shared flag a job checks before it starts and between its stages. cancelling only asks: a stage
+// already running finishes, its result is dropped by whoever checks the token next
+class CancellationToken
+{
+public:
+    CancellationToken() : flag(std::make_shared<std::atomic<bool>>(false)) {}
+    void cancel() const { flag->store(true, std::memory_order_relaxed); }
+    bool cancelled() const { return flag->load(std::memory_order_relaxed); }
+
+private:
+    std::shared_ptr<std::atomic<bool>> flag;
+};
+
+// work-stealing pool for the CPU side of generation. every worker owns a deque kept in priority order
+// (highest first) and takes from its front; an idle worker steals the front of another worker's deque.
+// the front rather than the back, as in a classic work-stealing deque, because here the order is the
+// point (nearest chunks first) and jobs are milliseconds long, so one mutex per deque never contends.
+// jobs submitted from a worker go onto its own deque, others are dealt round-robin. no GL in jobs:
+// results go back to the main thread, which uploads them
+class JobSystem
+{
+public:
+    struct Stats
+    {
+        std::vector<int> queueDepths; // per worker, now
+        int queued = 0;               // sum of queueDepths
+        int running = 0;
+        uint64_t submitted = 0;
+        uint64_t completed = 0;
+        uint64_t cancelled = 0; // dropped before they started
+        uint64_t steals = 0;
+        double meanWaitMs = 0.0; // submit to start
+        double meanRunMs = 0.0;
+        double maxLatencyMs = 0.0; // submit to finish
+    };
+
+    // 0 = one worker per hardware thread but one, which is left to the render thread
+    explicit JobSystem(unsigned int threadCount = 0);
+    ~JobSystem();
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    // higher priority runs first. tag identifies the job for reprioritize, 0 = none
+    void submit(std::function<void()> fn, float priority = 0.0f, CancellationToken token = CancellationToken(), uint64_t tag = 0);
+    // new priority for every queued job with a tag, e.g. after the camera turned
+    void reprioritize(const std::function<float(uint64_t tag, float priority)> &priority);
+    // blocks until every queue is empty and no job is running. not from inside a job
+    void waitIdle();
+
+    Stats stats() const;
+    void resetStats();
+    unsigned int workerCount() const { return (unsigned int)workers.size(); }
+
+private:
+    struct Job
+    {
+        std::function<void()> fn;
+        float priority = 0.0f;
+        CancellationToken token;
+        uint64_t tag = 0;
+        std::chrono::steady_clock::time_point submitted;
+    };
+    struct Worker
+    {
+        mutable std::mutex mutex;
+        std::deque<Job> jobs;
+        std::thread thread;
+    };
+
+    void run(unsigned int index);
+    bool pop(unsigned int index, Job &job);
+    void insert(Worker &worker, Job &&job);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<unsigned int> nextWorker{0};
+    std::atomic<bool> stopping{false};
+
+    // sleeping workers and waitIdle
+    mutable std::mutex wakeMutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    int queued = 0;
+    int pending = 0; // queued + running
+
+    mutable std::mutex statsMutex;
+    Stats totals;
+    double waitMsSum = 0.0;
+    double runMsSum = 0.0;
+};
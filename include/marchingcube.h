@@ -1,43 +1,224 @@
 #pragma once
 #include <glad/glad.h>
 #include <vector>
-#include "FastNoiseLite.h"
 #include <glm/glm.hpp>
 #include "include/camera.h"
+#include "include/cave.h"
+#include "include/densitygenerator.h"
+#include "include/densitygraph.h"
+#include "include/densitystorage.h"
+#include "include/cpumesher.h"
+#include "include/cpufeatures.h"
+#include "include/meshsimplifier.h"
+#include "include/meshoptimizer.h"
+#include "include/chunkmanager.h"
+#include "include/chunkcache.h"
+#include "include/chunkstore.h"
+#include "include/jobsystem.h"
+#include "include/paramhash.h"
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+// how the triangle soup is extracted; the indexed mesh has its own passes
+enum MeshExtraction
+{
+    EXTRACTION_ATOMIC = 0,      // marchingCube.comp.glsl, counter atomics or prefix sums
+    EXTRACTION_HISTOPYRAMID = 1 // histoPyramidReduce/Emit.comp.glsl, one thread per vertex
+};
+
+// which surface the mesh passes extract
+enum MeshMethod
+{
+    MESH_MARCHING_CUBES = 0,  // triangles per cell from the case tables, soup or indexed
+    MESH_SURFACE_NETS = 1,    // surfaceNetsVertices/Quads.comp.glsl, one vertex per crossing cell, always indexed
+    MESH_DUAL_CONTOURING = 2  // the same with the vertex at the QEF minimiser instead of the mean
+};
 
 class MarchingCubes
 {
-private:
+public:
     static const int GRID_SIZE = 64;
     static const int DENSITY_SIZE = GRID_SIZE + 3;
 
+private:
     GLuint densitySSBO;
     GLuint vertexSSBO;
     GLuint edgeTableSSBO;
     GLuint triTableSSBO;
     GLuint counterBuffer;
+    GLuint caveStatsBuffer;
     GLuint computeShader;
     GLuint renderShader;
     GLuint densityComputeShader;
+    GLuint heightmapComputeShader;
+    GLuint heightmapSSBO;
+    GLuint coarseFieldsComputeShader;
+    GLuint warpFieldSSBO;
+    GLuint zoneFieldSSBO;
     GLuint normalSSBO;
+    GLuint graphComputeShader;
+    GLuint gradientComputeShader;
+    GLuint gradientSSBO;
+    GLuint meshVerticesComputeShader;
+    GLuint meshIndicesComputeShader;
+    GLuint edgeVertexSSBO;
+    GLuint indexSSBO;
+    GLuint meshCountComputeShader;
+    GLuint prefixScanComputeShader;
+    GLuint scanSSBO;
+    GLuint classifyComputeShader;
+    GLuint activeCellSSBO;
+    GLuint histoPyramidReduceComputeShader;
+    GLuint histoPyramidEmitComputeShader;
+    GLuint surfaceNetsVerticesComputeShader;
+    GLuint surfaceNetsQuadsComputeShader;
     GLuint VAO;
 
-    FastNoiseLite noise;
+    DensityGenerator densityGenerator;
+    CpuMesher cpuMesher;
+
+    // decimated copies of the mesh for distant views: meshed and simplified as a job on the pool from a
+    // density readback, uploaded on the render thread once the job is done
+    struct LodMesh
+    {
+        float targetError = 0.0f;
+        GLuint VAO = 0;
+        GLuint vertexBuffer = 0;
+        GLuint indexBuffer = 0;
+        GLsizei indexCount = 0;
+    };
+    struct LodBuild
+    {
+        std::vector<std::vector<VertexNormal>> vertices;
+        std::vector<std::vector<uint32_t>> indices;
+        std::vector<MeshSimplifier::Stats> stats;
+        std::vector<float> measuredErrors;
+        size_t sourceTriangles = 0;
+        uint64_t densityHash = 0; // of the density it was built from
+        glm::vec3 boundsMin = glm::vec3(0.0f);
+        glm::vec3 boundsMax = glm::vec3(0.0f);
+    };
+    // what the density and mesh passes generate: the single volume at the origin with walls, or one
+    // chunk of the streamed world (generateChunk sets these and puts them back)
+    glm::vec3 densityOffset = glm::vec3(0.0f);
+    bool densityWalls = true;
+    glm::ivec2 cellRange = glm::ivec2(0); // u_CellRange in meshCommon.glsl, (0, 0) = the whole grid
+    void setCellRangeUniform(GLuint program);
+    void dispatchHeightmap();
+    void setRenderUniforms(Camera &camera);
+
+    ChunkManager chunkManager;
+    glm::ivec2 chunkCellRange() const;
+    void updateChunks(const Camera &camera);
+    // false, with nothing left allocated, if the chunk does not fit in the GPU budget
+    bool generateChunk(Chunk &chunk);
+    void releaseChunk(Chunk &chunk);
+    void releaseChunks(std::vector<Chunk> &chunks);
+    void replaceChunk(const Chunk &chunk);
 
-    struct Cave
+    // chunks out of view, and what counts against the GPU budget besides them
+    ChunkCache chunkCache;
+    size_t residentChunkBytes();
+    // evicts cached chunks until one of bytes fits with the resident ones; false if it never would
+    bool makeRoomForChunk(size_t bytes);
+    void retireChunk(const Chunk &chunk);
+    // what the CPU budget leaves for the cache tier after the finished builds not uploaded yet, waiting
+    // ones included, and the records queued for the disk store. builds still running are not counted,
+    // at most one chunk per worker
+    size_t cpuCacheLimit(size_t waiting);
+    // shared with the jobs, which write to it
+    std::shared_ptr<ChunkStore> chunkStore = std::make_shared<ChunkStore>();
+    // from either tier of the cache or the disk store; true if nothing is left to build, counting an
+    // upload that did not fit, which is deferred
+    bool restoreChunk(const glm::ivec2 &coord, uint64_t paramHash, int &overBudget);
+    // chunks that did not fit, by ChunkManager::key. not looked up again until the budget, the settings
+    // or the resident chunks change and there may be room
+    std::unordered_set<int64_t> deferredChunks;
+    size_t deferredBudget = 0;
+    uint64_t deferredParamHash = 0;
+    size_t deferredResident = 0;
+    void renderChunks(Camera &camera);
+
+    // a chunk generated and meshed on the job pool, waiting for the render thread to upload it
+    struct ChunkBuild
+    {
+        glm::ivec2 coord = glm::ivec2(0);
+        CancellationToken token;
+        uint64_t paramHash = 0;
+        ChunkData data;
+    };
+    struct ChunkBuildQueue
     {
-        glm::vec3 offset;
-        float gain;
-        float frequency;
-        float zoneFrequency;
-        float zoneThreshold = 0.5f;
-        Cave(const glm::vec3 &o = glm::vec3(0.0f, -40.0f, 0.0f), float g = 2.0f, float f = 0.01f, float zf = 0.002f) : offset(o), gain(g), frequency(f), zoneFrequency(zf) {}
+        std::mutex mutex;
+        std::vector<ChunkBuild> done;
+        size_t doneBytes = 0; // their data, counted against the CPU budget
     };
+    // shared with the jobs, which may finish after a clear
+    std::shared_ptr<ChunkBuildQueue> finishedChunks = std::make_shared<ChunkBuildQueue>();
+    float chunkPriority(const glm::ivec2 &coord, const Camera &camera) const;
+    void submitChunkBuild(const glm::ivec2 &coord, float priority);
+    void uploadChunk(const ChunkData &data, Chunk &chunk);
+    void uploadChunk(const StoredChunk &stored, Chunk &chunk);
+    void uploadChunkMesh(bool packedVertices, const void *vertices, size_t vertexCount, const uint32_t *indices, size_t indexCount, Chunk &chunk);
+    JobSystem jobs;
+
+    // what the density and mesh buffers hold, so render only reruns the passes whose inputs changed
+    bool densityCached = false;
+    bool meshCached = false;
+    uint64_t cachedDensityHash = 0;
+    uint64_t cachedMeshHash = 0;
+    unsigned int cachedVertexCount = 0;
+    unsigned int cachedIndexCount = 0;
+
+    std::vector<LodMesh> lodMeshes;
+    std::future<LodBuild> lodBuild;
+    glm::vec3 lodBoundsMin = glm::vec3(0.0f);
+    glm::vec3 lodBoundsMax = glm::vec3(0.0f);
+    void uploadLods(LodBuild &build);
+    void deleteLods();
+    int lodLevelFor(const glm::vec3 &viewPos) const;
 
     void createDensitySSBO();
+    void setDensityStorageUniforms(GLuint program);
+    void createHeightmapSSBO();
+    void createCoarseFieldSSBOs();
+    void createGradientSSBO();
+    void createMeshBuffers();
+    void setupVertexAttributes();
+    size_t vertexStride() const;
+    void readVertices(unsigned int count, std::vector<VertexNormal> &vertices);
+    void createScanSSBO();
+    void createActiveCellSSBO();
+    void dispatchCoarseFields();
     void uploadMarchingCubesTables();
     void setupShaders();
     void setupBuffers();
+    void dispatchDensity(int densitySize = DENSITY_SIZE);
+    void dispatchDensityGraph();
+    void dispatchGradients();
+    void dispatchMeshCounts(int densitySize, GLuint cellBase, bool countSamples);
+    void dispatchPrefixScan(GLuint offset, GLuint count, int totalCounter);
+    void dispatchActiveCells();
+    void dispatchMeshPass(GLuint program, int densitySize, int gridExtent);
+    void dispatchMarchingCubes(bool useGradients, int densitySize = DENSITY_SIZE);
+    void dispatchHistoPyramid(bool useGradients, int densitySize);
+    void dispatchIndexedMesh(bool useGradients);
+    void dispatchSurfaceNets(bool useGradients);
+    // drawn with glDrawElements from vertexSSBO + indexSSBO
+    bool indexedOutput() const { return useIndexedMesh || meshMethod != MESH_MARCHING_CUBES; }
+    DensityGraph compiledTerrainGraph() const;
+    // the current terrain settings on the CPU at any size, for the CPU-only benchmarks
+    void generateCpuDensity(int densitySize, std::vector<float> &density) const;
+
+    std::string graphShaderSource; // source of graphComputeShader, rebuilt when the graph changes
+    DensityFormat allocatedDensityFormat = DENSITY_FLOAT32; // format densitySSBO is currently sized for
+    bool allocatedIndexedMesh = false; // mode vertexSSBO / indexSSBO are currently sized for
+    MeshMethod allocatedMeshMethod = MESH_MARCHING_CUBES;
+    bool allocatedPackedVertices = false; // vertex format vertexSSBO and the VAO are set up for
+    GLuint vertexCapacity = 0;         // vertices vertexSSBO holds
 
 public:
     MarchingCubes();
@@ -46,10 +227,342 @@ public:
     void render(Camera camera);
     void debugComputeShaderOutput();
     void resetVertexCounter();
+    void resetCaveStats();
+    void readCaveStats(int numCaves);
+    bool compareCpuDensity(float tolerance = 1e-3f);
+    void measureCoarseSamplingError();
+
+    struct DensityComparison
+    {
+        bool ran = false;
+        bool passed = false;
+        float maxError = 0.0f;
+        float meanError = 0.0f;
+        int mismatches = 0;
+        double cpuMilliseconds = 0.0;
+    };
+    DensityComparison lastDensityComparison;
+
+    // cells that cross the surface, from the classification pass when useActiveCells is on
+    struct ActiveCellStats
+    {
+        unsigned int activeCells = 0;
+        unsigned int totalCells = 0;
+        float ratio() const { return totalCells > 0 ? (float)activeCells / totalCells : 0.0f; }
+    };
+    ActiveCellStats lastActiveCellStats;
+    CaveSkipStats lastCaveStats; // from the last GPU density pass
+
+    // coarse-lattice density against full-rate evaluation, both on the CPU
+    struct CoarseSamplingReport
+    {
+        bool ran = false;
+        int warpStride = 1;
+        int zoneStride = 1;
+        float maxError = 0.0f;
+        float meanError = 0.0f;
+        int signFlips = 0; // samples that changed side of the surface
+        double fullMilliseconds = 0.0;
+        double coarseMilliseconds = 0.0;
+    };
+    CoarseSamplingReport lastCoarseReport;
+
+    // mesh vertex positions from quantized density against float32, both on the CPU
+    struct QuantizationReport
+    {
+        bool ran = false;
+        DensityFormat format = DENSITY_FLOAT32;
+        size_t floatBytes = 0;
+        size_t storedBytes = 0;
+        float maxDensityError = 0.0f;  // over samples with |density| < 1, where the surface is
+        int crossingEdges = 0;         // edges with a vertex in the float32 mesh
+        int changedCubes = 0;          // cells whose cube index differs, should stay 0
+        float maxVertexError = 0.0f;   // in voxels, along the edge
+        float meanVertexError = 0.0f;
+    };
+    QuantizationReport lastQuantizationReport;
+    void measureDensityQuantization();
+
+    // meshing stage with central differences per cube corner against the gradient pass, GPU and CPU
+    struct MeshingBenchmark
+    {
+        bool ran = false;
+        int iterations = 0;
+        double gpuCentralMs = 0.0;
+        double gpuGradientPassMs = 0.0;
+        double gpuGradientMeshMs = 0.0;
+        double cpuCentralMs = 0.0;
+        double cpuGradientPassMs = 0.0;
+        double cpuGradientMeshMs = 0.0;
+        int cpuVertices = 0;
+        bool cpuMatches = false;
+    };
+    MeshingBenchmark lastMeshingBenchmark;
+    void benchmarkMeshing(int iterations = 20);
+
+    // CpuMesher::mesh at 1, 2, 4 ... hardware threads on a 2 * GRID_SIZE grid, where the work outweighs spawning
+    struct CpuMesherScaling
+    {
+        unsigned int threads = 0;
+        double milliseconds = 0.0;
+        double speedup = 0.0;  // single-threaded time / this one
+        bool identical = false; // byte-identical to the single-threaded mesh
+    };
+    std::vector<CpuMesherScaling> lastCpuMesherScaling;
+    void measureCpuMesherScaling(int iterations = 5);
+
+    // CubeClassify over the same grid at each SIMD level the CPU has, against the scalar path
+    struct CubeClassifyTiming
+    {
+        SimdLevel level = SimdLevel::Scalar;
+        double milliseconds = 0.0; // sign rows + cube indices for every cell row
+        int skippedRows = 0;       // cell rows that were all outside or all inside
+        int totalRows = 0;
+        bool identical = false;    // same cube indices as scalar
+    };
+    std::vector<CubeClassifyTiming> lastCubeClassifyTimings;
+    void benchmarkCubeClassification(int iterations = 20);
+
+    // analytic normals from the density pass against central differences, and what each costs
+    struct NormalComparison
+    {
+        bool ran = false;
+        int samples = 0;         // samples with |density| < 2, around the surface
+        float maxAngle = 0.0f;   // degrees between the analytic and central-difference normal
+        float meanAngle = 0.0f;
+        double gpuDensityMs = 0.0;          // density pass alone
+        double gpuGradientPassMs = 0.0;     // + gradient.comp.glsl
+        double gpuAnalyticDensityMs = 0.0;  // density pass writing exact gradients
+        double cpuCentralMs = 0.0;
+        double cpuAnalyticMs = 0.0;
+    };
+    NormalComparison lastNormalComparison;
+    void compareAnalyticNormals(int iterations = 10);
+    bool analyticNormalsActive() const;
+
+    // GPU indexed mesh against CpuMesher::meshIndexed on the density read back from the GPU
+    struct IndexedMeshReport
+    {
+        bool ran = false;
+        bool passed = false;
+        unsigned int vertices = 0;
+        unsigned int indices = 0;
+        unsigned int cpuVertices = 0;
+        unsigned int cpuIndices = 0;
+        float maxPositionError = 0.0f;
+        float maxNormalError = 0.0f;
+        size_t indexedBytes = 0; // vertex + index bytes actually used
+        size_t soupBytes = 0;    // the same triangles as three VertexNormals each
+    };
+    IndexedMeshReport lastIndexedReport;
+    bool verifyIndexedMesh();
+
+    // GPU Surface Nets / dual contouring against CpuMesher::meshSurfaceNets, and the size of the result
+    // next to the marching cubes mesh of the same density
+    struct SurfaceNetsReport
+    {
+        bool ran = false;
+        bool passed = false;
+        bool dualContouring = false;
+        unsigned int vertices = 0;
+        unsigned int indices = 0;
+        unsigned int cpuVertices = 0;
+        unsigned int cpuIndices = 0;
+        float maxPositionError = 0.0f;
+        float maxNormalError = 0.0f;
+        unsigned int marchingCubesVertices = 0; // indexed: one per crossing edge
+        unsigned int marchingCubesIndices = 0;  // also the vertex count of the soup
+        int slivers = 0;                        // triangles with area < 5% of their longest edge squared
+        int marchingCubesSlivers = 0;
+    };
+    SurfaceNetsReport lastSurfaceNetsReport;
+    bool verifySurfaceNets(bool dualContouring);
+
+    // error bound of each LOD level, in voxels; level i is drawn from lodDistance * 2^i on
+    static constexpr float LOD_ERRORS[3] = {0.5f, 1.0f, 2.0f};
+    // reads the density back and starts meshing + decimating it on a worker thread
+    void requestLods();
+    bool lodsPending() const { return lodBuild.valid(); }
+    bool lodsReady() const { return !lodMeshes.empty(); }
+    int lastLodLevel = -1; // level drawn last frame, -1 = full resolution
+
+    struct LodLevelReport
+    {
+        float targetError = 0.0f;
+        MeshSimplifier::Stats stats;
+        float measuredError = 0.0f; // farthest original vertex from the decimated surface
+        MeshOptimizer::CacheStats cache;
+    };
+    struct LodReport
+    {
+        bool ran = false;
+        size_t sourceTriangles = 0;
+        std::vector<LodLevelReport> levels;
+    };
+    LodReport lastLodReport;
+
+    // MeshSimplifier on the CPU mesh of the current terrain, by error bound and by triangle budget:
+    // the measured distance must stay under the bound, and triangles removed per ms is the throughput
+    struct DecimationResult
+    {
+        float targetError = 0.0f;
+        size_t targetTriangles = 0;
+        MeshSimplifier::Stats stats;
+        float measuredError = 0.0f;
+        bool withinBound = false; // measured distance <= max accepted collapse error
+    };
+    std::vector<DecimationResult> lastDecimationResults;
+    bool measureDecimation();
+
+    // MeshOptimizer stages on the indexed mesh the last frame drew (the GPU's scheduling order), or on
+    // the CPU mesh when the last frame drew a soup
+    struct MeshOptimizationStage
+    {
+        const char *name = "";
+        MeshOptimizer::CacheStats cache;
+        double milliseconds = 0.0;
+    };
+    struct MeshOptimizationReport
+    {
+        bool ran = false;
+        bool fromGpu = false;
+        unsigned int vertices = 0;
+        unsigned int triangles = 0;
+        std::vector<MeshOptimizationStage> stages;
+    };
+    MeshOptimizationReport lastMeshOptimizationReport;
+    void measureMeshOptimization();
+
+    // soup extraction with the counter atomics, prefix sums and the HistoPyramid, at GRID_SIZE and larger
+    struct SoupMeshingGrid
+    {
+        int gridSize = 0;
+        unsigned int vertices = 0;
+        double atomicMs = 0.0;
+        double prefixSumMs = 0.0;   // count, scan and emit together
+        double histoPyramidMs = 0.0; // count, reduce and emit together
+        bool atomicRepeatable = false; // two runs gave byte-identical vertex buffers
+        bool prefixSumRepeatable = false;
+        bool histoPyramidRepeatable = false;
+        bool prefixSumMatchesCpu = false; // output in CpuMesher::mesh order
+        bool histoPyramidMatchesCpu = false;
+    };
+    struct SoupMeshingBenchmark
+    {
+        bool ran = false;
+        int iterations = 0;
+        std::vector<SoupMeshingGrid> grids;
+    };
+    SoupMeshingBenchmark lastSoupMeshingBenchmark;
+    void benchmarkSoupMeshing(int iterations = 10);
 
     static const int MAX_CAVES = 8;
 
     int seed;
     std::vector<Cave> caves;
     float caveCeiling = 20.0f;
+    TerrainMode terrainMode = TERRAIN_VOLUMETRIC;
+    // coarse lattice strides for the low-frequency fields, 1 = per voxel
+    int warpStride = 1;
+    int zoneStride = 1;
+    // generate density with a kernel emitted from the compiled terrain graph (volumetric only)
+    bool useDensityGraph = false;
+    // density buffer format, shared by the density passes and the mesher
+    DensityStorage densityStorage;
+    // normals from a per-sample gradient pass instead of central differences at every cube corner
+    bool useGradientPass = true;
+    // exact normals chained through the noise derivatives in the density pass, so meshing reads no
+    // neighbours at all. volumetric, non-graph, full-rate only; otherwise the above applies
+    bool useAnalyticNormals = false;
+    // vertex-shared output drawn with glDrawElements instead of three vertices per triangle
+    bool useIndexedMesh = false;
+    // output offsets from a count pass and a prefix scan instead of atomics: same mesh, same order every run
+    bool usePrefixSums = false;
+    // classify cells first and run the mesh emit passes indirectly over the active ones only
+    bool useActiveCells = false;
+    MeshExtraction meshExtraction = EXTRACTION_ATOMIC;
+    MeshMethod meshMethod = MESH_MARCHING_CUBES;
+    // stream chunks around the camera instead of meshing the single volume. a chunk built with other
+    // settings than the current ones is rebuilt, nearest first, and drawn as it was until then
+    bool useChunks = false;
+    int chunkRadius = 4;    // in chunks
+    int chunksPerFrame = 2; // most chunks generated in one frame, nearest first (GPU only)
+    // generate and mesh chunks on the job pool with the CPU generator and mesher, nearest and most in
+    // view first, and only upload them here; off generates them on the GPU inside render
+    bool useChunkJobs = true;
+    // chunks that leave the view are cached, GPU buffers and CPU copies each up to a budget. the GPU
+    // budget covers the resident chunks as well, so it bounds all chunk buffer memory; chunks that
+    // would not fit are left out. the shared generation buffers are not included. the CPU budget covers
+    // finished builds waiting for upload and records queued for the disk store as well, not the builds
+    // still running on the pool
+    int chunkGpuBudgetMB = 256;
+    int chunkCpuBudgetMB = 256;
+    void clearChunks();
+    const ChunkCache::Stats &chunkCacheStats() const { return chunkCache.stats(); }
+    void resetChunkCacheStats() { chunkCache.resetCounters(); }
+    // chunks built on the job pool are also kept on disk under chunkStorePath and read back, mapped,
+    // before anything is generated, in this run or a later one. off by default; opened on first use,
+    // turned off again if the files can not be opened. past the budget the least recently used records
+    // are dropped
+    bool useChunkStore = false;
+    std::string chunkStorePath = "chunkstore";
+    int chunkStoreBudgetMB = 1024;
+    ChunkStore::Stats chunkStoreStats() const { return chunkStore->stats(); }
+    void resetChunkStoreStats() { chunkStore->resetCounters(); }
+    void clearChunkStore() { chunkStore->clear(); }
+    JobSystem::Stats jobStats() const { return jobs.stats(); }
+    void resetJobStats() { jobs.resetStats(); }
+    struct ChunkStats
+    {
+        glm::ivec2 cameraChunk = glm::ivec2(0);
+        int resident = 0;
+        int generated = 0;  // this frame
+        int retired = 0;    // this frame
+        int cancelled = 0;  // builds dropped this frame, out of range before they finished
+        int pending = 0;    // in range but not generated yet, or being built on the pool
+        int stale = 0;      // resident but built with other settings, waiting to be rebuilt
+        int overBudget = 0; // chunks left out or dropped this frame to stay within the GPU budget
+        int deferred = 0;   // in range, left out until there may be room for them
+        double generateMs = 0.0; // render thread time this frame: GPU generation and readback, or uploads
+        size_t densityBytes = 0;
+        size_t meshBytes = 0;
+        size_t triangles = 0; // drawn this frame
+    };
+    ChunkStats lastChunkStats;
+
+    // hashes of everything the density passes and the mesh passes read (the latter includes the former).
+    // render reruns only the passes whose hash changed since they last ran; chunks keep the mesh hash
+    // they were built with, so any setting a chunk's mesh depends on belongs in it
+    uint64_t densityParamHash() const;
+    uint64_t meshParamHash() const;
+    // for anything that overwrites the shared density or mesh buffers outside render
+    void invalidateGeneration();
+    struct RegenerationStats
+    {
+        unsigned long long frames = 0;
+        unsigned long long skippedFrames = 0; // neither pass ran, the cached mesh was drawn
+        unsigned long long densityRuns = 0;
+        unsigned long long meshRuns = 0;
+    };
+    RegenerationStats regenerationStats;
+
+    // draw a decimated LOD instead of the full mesh once the camera is lodDistance from the terrain.
+    // single volume only: chunks are drawn at full resolution
+    bool useDistanceLod = false;
+    float lodDistance = 100.0f;
+    // reorder LOD meshes for the vertex cache and fetch locality, and optionally sort clusters outside-in
+    bool useMeshOptimization = true;
+    bool useOverdrawClustering = false;
+    // 12-byte PackedVertex instead of the 32-byte VertexNormal, decoded in vertex.glsl
+    bool usePackedVertices = false;
+    size_t vertexBufferBytes() const { return (size_t)vertexCapacity * vertexStride(); }
+
+    struct GraphStats
+    {
+        int sourceNodes = 0;
+        int compiledNodes = 0;
+        int noiseStates = 0;
+        int shaderBuilds = 0;
+    };
+    GraphStats lastGraphStats;
 };
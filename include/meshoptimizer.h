@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "cpumesher.h"
+
+// post-process for indexed meshes, whose triangles come out of the mesh passes in cell or scheduling
+// order. triangles are reordered for the post-transform vertex cache with Tipsify (Sander, Nehab &
+// Barczak 2007), optionally grouped into the clusters Tipsify leaves behind and sorted outside-in to
+// cut overdraw, and vertices are renumbered in first-use order so fetches walk the buffer forwards.
+// none of this changes the triangles themselves, only their order and the vertex numbering
+namespace MeshOptimizer
+{
+    // FIFO cache of this many vertices, a common hardware size and the one the metrics below assume
+    const int CACHE_SIZE = 16;
+
+    struct CacheStats
+    {
+        float acmr = 0.0f;      // cache misses per triangle: 0.5 is ideal on a large grid-like mesh, 3 is no reuse
+        float atvr = 0.0f;      // cache misses per vertex: 1 means every vertex is transformed exactly once
+        float overfetch = 0.0f; // vertex bytes fetched through a small cache of 64-byte lines / bytes used
+    };
+
+    CacheStats analyze(const std::vector<uint32_t> &indices, size_t vertexCount, size_t vertexSize = sizeof(VertexNormal));
+
+    // reorders the triangles of indices in place. clusterStarts, if given, gets the first triangle of every
+    // run Tipsify produced without leaving the cache, for optimizeOverdraw
+    void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount, std::vector<uint32_t> *clusterStarts = nullptr);
+
+    // sorts the clusters by how far they face away from the mesh centre, so front-most surfaces tend to
+    // be drawn first; the triangle order inside each cluster is kept
+    void optimizeOverdraw(std::vector<uint32_t> &indices, const std::vector<VertexNormal> &vertices, const std::vector<uint32_t> &clusterStarts);
+
+    // renumbers vertices in the order the indices first use them and drops unused ones
+    void optimizeVertexFetch(std::vector<VertexNormal> &vertices, std::vector<uint32_t> &indices);
+
+    // all of the above, in that order
+    void optimize(std::vector<VertexNormal> &vertices, std::vector<uint32_t> &indices, bool reduceOverdraw);
+}
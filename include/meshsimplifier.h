@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "cpumesher.h"
+
+// quadric error metric decimation (Garland & Heckbert) of an indexed VertexNormal mesh, as
+// CpuMesher::meshIndexed / meshSurfaceNets produce. edges are collapsed cheapest first onto one of
+// their two vertices, so the output is a subset of the input vertices with their normals unchanged.
+// vertices on an open or non-manifold edge are locked, and so are those outside a box (Options), so
+// the rims where neighbouring chunks meet stay exactly where the full-resolution mesh has them.
+// the quadrics are unweighted plane sums, so the square root of a collapse's cost bounds its
+// distance to every plane merged into the kept vertex, in voxels
+namespace MeshSimplifier
+{
+    struct Options
+    {
+        float targetError = 0.5f;  // stop before a collapse whose error exceeds this, in voxels
+        size_t targetTriangles = 0; // or once this few are left; 0 = error only
+        // vertices outside this box are locked as well: a chunk's walls close its mesh, so the seam to
+        // the neighbour runs through vertices that are not on any open edge
+        glm::vec3 lockOutsideMin = glm::vec3(-std::numeric_limits<float>::max());
+        glm::vec3 lockOutsideMax = glm::vec3(std::numeric_limits<float>::max());
+    };
+
+    struct Stats
+    {
+        size_t inputTriangles = 0;
+        size_t outputTriangles = 0;
+        size_t lockedVertices = 0;
+        size_t collapses = 0;
+        size_t rejectedFlips = 0; // collapses skipped because a triangle would have turned over
+        float maxError = 0.0f;    // largest accepted collapse error
+        double milliseconds = 0.0;
+        double trianglesRemovedPerMs() const
+        {
+            return milliseconds > 0.0 ? (inputTriangles - outputTriangles) / milliseconds : 0.0;
+        }
+    };
+
+    Stats simplify(const std::vector<VertexNormal> &vertices, const std::vector<uint32_t> &indices, const Options &options,
+                   std::vector<VertexNormal> &outVertices, std::vector<uint32_t> &outIndices);
+
+    // largest distance from a vertex of the original mesh to the simplified surface, searched up to
+    // maxDistance (returned when nothing is closer)
+    float maxSurfaceDistance(const std::vector<VertexNormal> &original, const std::vector<VertexNormal> &vertices,
+                             const std::vector<uint32_t> &indices, float maxDistance);
+}
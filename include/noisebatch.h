@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include "cpufeatures.h"
+
+// batched OpenSimplex2 kernels behind FastNoiseLite::GetNoiseBatch / DomainWarpBatch.
+// the parameter blocks are flattened FastNoiseLite state so the per-ISA translation units
+// never have to include FastNoiseLite.h (and so never emit ISA-specific copies of its inline code).
+namespace NoiseBatch
+{
+    enum Transform3D
+    {
+        Transform_None,
+        Transform_ImproveXYPlanes,
+        Transform_ImproveXZPlanes,
+        Transform_DefaultOpenSimplex2
+    };
+
+    enum Fractal
+    {
+        Fractal_None,
+        Fractal_FBm,
+        Fractal_Ridged,
+        Fractal_PingPong,
+        Fractal_DomainWarpProgressive,
+        Fractal_DomainWarpIndependent
+    };
+
+    struct NoiseParams
+    {
+        int seed;
+        float frequency;
+        Transform3D transform;
+        Fractal fractal;
+        int octaves;
+        float lacunarity;
+        float gain;
+        float weightedStrength;
+        float pingPongStrength;
+        float fractalBounding;
+        const float *gradients3D;
+    };
+
+    struct WarpParams
+    {
+        int seed;
+        float frequency;
+        Transform3D transform;
+        Fractal fractal;
+        int octaves;
+        float lacunarity;
+        float gain;
+        float amp;       // domain warp amp * fractal bounding
+        bool reduced;    // OpenSimplex2Reduced: gradient-only output vectors
+        const float *gradients3D;
+        const float *randVecs3D;
+    };
+
+    // both return false when no vector path is available, leaving the caller to run scalar code
+    bool getNoise(const NoiseParams &params, const float *xs, const float *ys, const float *zs, float *out, size_t n);
+    bool domainWarp(const WarpParams &params, float *xs, float *ys, float *zs, size_t n);
+
+    SimdLevel activeLevel();
+    // caps the dispatch level (clamped to what the CPU supports); used to compare vector widths
+    void forceLevel(SimdLevel level);
+
+    // per-ISA entry points, defined in noisebatch_<isa>.cpp. return false if compiled without that ISA
+    bool getNoiseSSE41(const NoiseParams &params, const float *xs, const float *ys, const float *zs, float *out, size_t n);
+    bool getNoiseAVX2(const NoiseParams &params, const float *xs, const float *ys, const float *zs, float *out, size_t n);
+    bool getNoiseAVX512(const NoiseParams &params, const float *xs, const float *ys, const float *zs, float *out, size_t n);
+    bool domainWarpSSE41(const WarpParams &params, float *xs, float *ys, float *zs, size_t n);
+    bool domainWarpAVX2(const WarpParams &params, float *xs, float *ys, float *zs, size_t n);
+    bool domainWarpAVX512(const WarpParams &params, float *xs, float *ys, float *zs, size_t n);
+}
@@ -0,0 +1,478 @@
+#pragma once
+#include <cstddef>
+#include "noisebatch.h"
+
+// vector transcription of FastNoiseLite's OpenSimplex2 3D noise, fractals and domain warp.
+// S is a per-ISA ops struct (see noisebatch_sse41.cpp etc.) exposing Width, the F/I/M vector,
+// integer and mask types, and the handful of operations used below.
+//
+// every expression keeps the operand order of the scalar code in FastNoiseLite.h, and the ISA
+// translation units are built with -ffp-contract=off, so results match the scalar path bit for bit
+// apart from the sign of exact zeros. branches become masked selects: lanes that would skip a
+// contribution add zero instead.
+//
+// only the noisebatch_<isa>.cpp files include this, and everything lives in an anonymous namespace,
+// so ISA-specific instantiations can never be merged into code that runs on older CPUs.
+namespace
+{
+    template <typename S>
+    struct NoiseBatchKernel
+    {
+        typedef typename S::F F;
+        typedef typename S::I I;
+        typedef typename S::M M;
+
+        static const int PrimeX = 501125321;
+        static const int PrimeY = 1136930381;
+        static const int PrimeZ = 1720413743;
+
+        static inline I fastRound(F f)
+        {
+            F half = S::select(S::ge(f, S::set(0.0f)), S::set(0.5f), S::set(-0.5f));
+            return S::truncate(S::add(f, half));
+        }
+
+        static inline F lerp(F a, F b, F t)
+        {
+            return S::add(a, S::mul(t, S::sub(b, a)));
+        }
+
+        static inline I hash(int seed, I xPrimed, I yPrimed, I zPrimed)
+        {
+            I h = S::ixor(S::ixor(S::ixor(S::seti(seed), xPrimed), yPrimed), zPrimed);
+            return S::imul(h, S::seti(0x27d4eb2d));
+        }
+
+        static inline F gradCoord(int seed, I xPrimed, I yPrimed, I zPrimed, F xd, F yd, F zd, const float *gradients)
+        {
+            I h = hash(seed, xPrimed, yPrimed, zPrimed);
+            h = S::ixor(h, S::template srai<15>(h));
+            h = S::iand(h, S::seti(63 << 2));
+
+            F xg = S::gather(gradients, h);
+            F yg = S::gather(gradients, S::ior(h, S::seti(1)));
+            F zg = S::gather(gradients, S::ior(h, S::seti(2)));
+
+            return S::add(S::add(S::mul(xd, xg), S::mul(yd, yg)), S::mul(zd, zg));
+        }
+
+        static inline void gradCoordOut(int seed, I xPrimed, I yPrimed, I zPrimed, F &xo, F &yo, F &zo, const float *randVecs)
+        {
+            I h = S::iand(hash(seed, xPrimed, yPrimed, zPrimed), S::seti(255 << 2));
+
+            xo = S::gather(randVecs, h);
+            yo = S::gather(randVecs, S::ior(h, S::seti(1)));
+            zo = S::gather(randVecs, S::ior(h, S::seti(2)));
+        }
+
+        static inline void gradCoordDual(int seed, I xPrimed, I yPrimed, I zPrimed, F xd, F yd, F zd, F &xo, F &yo, F &zo,
+                                         const float *gradients, const float *randVecs)
+        {
+            I h = hash(seed, xPrimed, yPrimed, zPrimed);
+            I index1 = S::iand(h, S::seti(63 << 2));
+            I index2 = S::iand(S::template srai<6>(h), S::seti(255 << 2));
+
+            F xg = S::gather(gradients, index1);
+            F yg = S::gather(gradients, S::ior(index1, S::seti(1)));
+            F zg = S::gather(gradients, S::ior(index1, S::seti(2)));
+            F value = S::add(S::add(S::mul(xd, xg), S::mul(yd, yg)), S::mul(zd, zg));
+
+            xo = S::mul(value, S::gather(randVecs, index2));
+            yo = S::mul(value, S::gather(randVecs, S::ior(index2, S::seti(1))));
+            zo = S::mul(value, S::gather(randVecs, S::ior(index2, S::seti(2))));
+        }
+
+        // the neighbour step shared by noise and warp: moves the second lattice point one unit along
+        // the dominant axis, updating its offset, falloff and primed coordinate
+        static inline void stepDominantAxis(F ax0, F ay0, F az0, I xNSign, I yNSign, I zNSign,
+                                            F &x1, F &y1, F &z1, F &b, I &i1, I &j1, I &k1)
+        {
+            M cx = S::mand(S::ge(ax0, ay0), S::ge(ax0, az0));
+            M cy = S::mandnot(cx, S::mand(S::gt(ay0, ax0), S::ge(ay0, az0)));
+
+            F xStep = S::add(x1, S::tofloat(xNSign));
+            F yStep = S::add(y1, S::tofloat(yNSign));
+            F zStep = S::add(z1, S::tofloat(zNSign));
+
+            F bx = S::sub(b, S::mul(S::tofloat(S::iadd(xNSign, xNSign)), xStep));
+            F by = S::sub(b, S::mul(S::tofloat(S::iadd(yNSign, yNSign)), yStep));
+            F bz = S::sub(b, S::mul(S::tofloat(S::iadd(zNSign, zNSign)), zStep));
+
+            I iStep = S::isub(i1, S::imul(xNSign, S::seti(PrimeX)));
+            I jStep = S::isub(j1, S::imul(yNSign, S::seti(PrimeY)));
+            I kStep = S::isub(k1, S::imul(zNSign, S::seti(PrimeZ)));
+
+            b = S::select(cx, bx, S::select(cy, by, bz));
+            z1 = S::select(cx, z1, S::select(cy, z1, zStep));
+            k1 = S::selecti(cx, k1, S::selecti(cy, k1, kStep));
+            x1 = S::select(cx, xStep, x1);
+            i1 = S::selecti(cx, iStep, i1);
+            y1 = S::select(cy, yStep, y1);
+            j1 = S::selecti(cy, jStep, j1);
+        }
+
+        static inline F singleOpenSimplex2(int seed, F x, F y, F z, const float *gradients)
+        {
+            const F zero = S::set(0.0f);
+
+            I i = fastRound(x);
+            I j = fastRound(y);
+            I k = fastRound(z);
+            F x0 = S::sub(x, S::tofloat(i));
+            F y0 = S::sub(y, S::tofloat(j));
+            F z0 = S::sub(z, S::tofloat(k));
+
+            I xNSign = S::ior(S::truncate(S::sub(S::set(-1.0f), x0)), S::seti(1));
+            I yNSign = S::ior(S::truncate(S::sub(S::set(-1.0f), y0)), S::seti(1));
+            I zNSign = S::ior(S::truncate(S::sub(S::set(-1.0f), z0)), S::seti(1));
+
+            F ax0 = S::mul(S::tofloat(xNSign), S::neg(x0));
+            F ay0 = S::mul(S::tofloat(yNSign), S::neg(y0));
+            F az0 = S::mul(S::tofloat(zNSign), S::neg(z0));
+
+            i = S::imul(i, S::seti(PrimeX));
+            j = S::imul(j, S::seti(PrimeY));
+            k = S::imul(k, S::seti(PrimeZ));
+
+            F value = zero;
+            F a = S::sub(S::sub(S::set(0.6f), S::mul(x0, x0)), S::add(S::mul(y0, y0), S::mul(z0, z0)));
+
+            for (int l = 0;; l++)
+            {
+                F aa = S::mul(a, a);
+                F contribution = S::mul(S::mul(aa, aa), gradCoord(seed, i, j, k, x0, y0, z0, gradients));
+                value = S::add(value, S::select(S::gt(a, zero), contribution, zero));
+
+                F b = S::add(a, S::set(1.0f));
+                I i1 = i, j1 = j, k1 = k;
+                F x1 = x0, y1 = y0, z1 = z0;
+                stepDominantAxis(ax0, ay0, az0, xNSign, yNSign, zNSign, x1, y1, z1, b, i1, j1, k1);
+
+                F bb = S::mul(b, b);
+                contribution = S::mul(S::mul(bb, bb), gradCoord(seed, i1, j1, k1, x1, y1, z1, gradients));
+                value = S::add(value, S::select(S::gt(b, zero), contribution, zero));
+
+                if (l == 1)
+                    break;
+
+                ax0 = S::sub(S::set(0.5f), ax0);
+                ay0 = S::sub(S::set(0.5f), ay0);
+                az0 = S::sub(S::set(0.5f), az0);
+
+                x0 = S::mul(S::tofloat(xNSign), ax0);
+                y0 = S::mul(S::tofloat(yNSign), ay0);
+                z0 = S::mul(S::tofloat(zNSign), az0);
+
+                a = S::add(a, S::sub(S::sub(S::set(0.75f), ax0), S::add(ay0, az0)));
+
+                i = S::iadd(i, S::iand(S::template srai<1>(xNSign), S::seti(PrimeX)));
+                j = S::iadd(j, S::iand(S::template srai<1>(yNSign), S::seti(PrimeY)));
+                k = S::iadd(k, S::iand(S::template srai<1>(zNSign), S::seti(PrimeZ)));
+
+                xNSign = S::isub(S::seti(0), xNSign);
+                yNSign = S::isub(S::seti(0), yNSign);
+                zNSign = S::isub(S::seti(0), zNSign);
+
+                seed = ~seed;
+            }
+
+            return S::mul(value, S::set(32.69428253173828125f));
+        }
+
+        static inline void transform(NoiseBatch::Transform3D type, F &x, F &y, F &z)
+        {
+            switch (type)
+            {
+            case NoiseBatch::Transform_ImproveXYPlanes:
+            {
+                F xy = S::add(x, y);
+                F s2 = S::mul(xy, S::set(-(float)0.211324865405187));
+                z = S::mul(z, S::set((float)0.577350269189626));
+                x = S::add(x, S::sub(s2, z));
+                y = S::sub(S::add(y, s2), z);
+                z = S::add(z, S::mul(xy, S::set((float)0.577350269189626)));
+            }
+            break;
+            case NoiseBatch::Transform_ImproveXZPlanes:
+            {
+                F xz = S::add(x, z);
+                F s2 = S::mul(xz, S::set(-(float)0.211324865405187));
+                y = S::mul(y, S::set((float)0.577350269189626));
+                x = S::add(x, S::sub(s2, y));
+                z = S::add(z, S::sub(s2, y));
+                y = S::add(y, S::mul(xz, S::set((float)0.577350269189626)));
+            }
+            break;
+            case NoiseBatch::Transform_DefaultOpenSimplex2:
+            {
+                F r = S::mul(S::add(S::add(x, y), z), S::set((float)(2.0 / 3.0)));
+                x = S::sub(r, x);
+                y = S::sub(r, y);
+                z = S::sub(r, z);
+            }
+            break;
+            default:
+                break;
+            }
+        }
+
+        static inline F pingPong(F t)
+        {
+            I whole = S::truncate(S::mul(t, S::set(0.5f)));
+            t = S::sub(t, S::tofloat(S::iadd(whole, whole)));
+            return S::select(S::lt(t, S::set(1.0f)), t, S::sub(S::set(2.0f), t));
+        }
+
+        static inline F getNoise(const NoiseBatch::NoiseParams &p, F x, F y, F z)
+        {
+            F frequency = S::set(p.frequency);
+            x = S::mul(x, frequency);
+            y = S::mul(y, frequency);
+            z = S::mul(z, frequency);
+            transform(p.transform, x, y, z);
+
+            if (p.fractal == NoiseBatch::Fractal_None)
+                return singleOpenSimplex2(p.seed, x, y, z, p.gradients3D);
+
+            const F one = S::set(1.0f);
+            const F lacunarity = S::set(p.lacunarity);
+            const F gain = S::set(p.gain);
+            const F weightedStrength = S::set(p.weightedStrength);
+
+            int seed = p.seed;
+            F sum = S::set(0.0f);
+            F amp = S::set(p.fractalBounding);
+
+            for (int i = 0; i < p.octaves; i++)
+            {
+                F noise = singleOpenSimplex2(seed++, x, y, z, p.gradients3D);
+
+                switch (p.fractal)
+                {
+                case NoiseBatch::Fractal_Ridged:
+                    noise = S::abs(noise);
+                    sum = S::add(sum, S::mul(S::add(S::mul(noise, S::set(-2.0f)), one), amp));
+                    amp = S::mul(amp, lerp(one, S::sub(one, noise), weightedStrength));
+                    break;
+                case NoiseBatch::Fractal_PingPong:
+                    noise = pingPong(S::mul(S::add(noise, one), S::set(p.pingPongStrength)));
+                    sum = S::add(sum, S::mul(S::mul(S::sub(noise, S::set(0.5f)), S::set(2.0f)), amp));
+                    amp = S::mul(amp, lerp(one, noise, weightedStrength));
+                    break;
+                default:
+                    sum = S::add(sum, S::mul(noise, amp));
+                    amp = S::mul(amp, lerp(one, S::mul(S::add(noise, one), S::set(0.5f)), weightedStrength));
+                    break;
+                }
+
+                x = S::mul(x, lacunarity);
+                y = S::mul(y, lacunarity);
+                z = S::mul(z, lacunarity);
+                amp = S::mul(amp, gain);
+            }
+
+            return sum;
+        }
+
+        static inline void singleWarpOpenSimplex2(const NoiseBatch::WarpParams &p, int seed, float warpAmp, float frequency,
+                                                  F x, F y, F z, F &xr, F &yr, F &zr)
+        {
+            const F zero = S::set(0.0f);
+
+            x = S::mul(x, S::set(frequency));
+            y = S::mul(y, S::set(frequency));
+            z = S::mul(z, S::set(frequency));
+
+            I i = fastRound(x);
+            I j = fastRound(y);
+            I k = fastRound(z);
+            F x0 = S::sub(x, S::tofloat(i));
+            F y0 = S::sub(y, S::tofloat(j));
+            F z0 = S::sub(z, S::tofloat(k));
+
+            I xNSign = S::ior(S::truncate(S::sub(S::neg(x0), S::set(1.0f))), S::seti(1));
+            I yNSign = S::ior(S::truncate(S::sub(S::neg(y0), S::set(1.0f))), S::seti(1));
+            I zNSign = S::ior(S::truncate(S::sub(S::neg(z0), S::set(1.0f))), S::seti(1));
+
+            F ax0 = S::mul(S::tofloat(xNSign), S::neg(x0));
+            F ay0 = S::mul(S::tofloat(yNSign), S::neg(y0));
+            F az0 = S::mul(S::tofloat(zNSign), S::neg(z0));
+
+            i = S::imul(i, S::seti(PrimeX));
+            j = S::imul(j, S::seti(PrimeY));
+            k = S::imul(k, S::seti(PrimeZ));
+
+            F vx = zero, vy = zero, vz = zero;
+            F a = S::sub(S::sub(S::set(0.6f), S::mul(x0, x0)), S::add(S::mul(y0, y0), S::mul(z0, z0)));
+
+            for (int l = 0; l < 2; l++)
+            {
+                F xo, yo, zo;
+                M aPositive = S::gt(a, zero);
+                F aa = S::mul(a, a);
+                F aaaa = S::mul(aa, aa);
+                if (p.reduced)
+                    gradCoordOut(seed, i, j, k, xo, yo, zo, p.randVecs3D);
+                else
+                    gradCoordDual(seed, i, j, k, x0, y0, z0, xo, yo, zo, p.gradients3D, p.randVecs3D);
+                vx = S::add(vx, S::select(aPositive, S::mul(aaaa, xo), zero));
+                vy = S::add(vy, S::select(aPositive, S::mul(aaaa, yo), zero));
+                vz = S::add(vz, S::select(aPositive, S::mul(aaaa, zo), zero));
+
+                F b = S::add(a, S::set(1.0f));
+                I i1 = i, j1 = j, k1 = k;
+                F x1 = x0, y1 = y0, z1 = z0;
+                stepDominantAxis(ax0, ay0, az0, xNSign, yNSign, zNSign, x1, y1, z1, b, i1, j1, k1);
+
+                M bPositive = S::gt(b, zero);
+                F bb = S::mul(b, b);
+                F bbbb = S::mul(bb, bb);
+                if (p.reduced)
+                    gradCoordOut(seed, i1, j1, k1, xo, yo, zo, p.randVecs3D);
+                else
+                    gradCoordDual(seed, i1, j1, k1, x1, y1, z1, xo, yo, zo, p.gradients3D, p.randVecs3D);
+                vx = S::add(vx, S::select(bPositive, S::mul(bbbb, xo), zero));
+                vy = S::add(vy, S::select(bPositive, S::mul(bbbb, yo), zero));
+                vz = S::add(vz, S::select(bPositive, S::mul(bbbb, zo), zero));
+
+                if (l == 1)
+                    break;
+
+                ax0 = S::sub(S::set(0.5f), ax0);
+                ay0 = S::sub(S::set(0.5f), ay0);
+                az0 = S::sub(S::set(0.5f), az0);
+
+                x0 = S::mul(S::tofloat(xNSign), ax0);
+                y0 = S::mul(S::tofloat(yNSign), ay0);
+                z0 = S::mul(S::tofloat(zNSign), az0);
+
+                a = S::add(a, S::sub(S::sub(S::set(0.75f), ax0), S::add(ay0, az0)));
+
+                i = S::iadd(i, S::iand(S::template srai<1>(xNSign), S::seti(PrimeX)));
+                j = S::iadd(j, S::iand(S::template srai<1>(yNSign), S::seti(PrimeY)));
+                k = S::iadd(k, S::iand(S::template srai<1>(zNSign), S::seti(PrimeZ)));
+
+                xNSign = S::isub(S::seti(0), xNSign);
+                yNSign = S::isub(S::seti(0), yNSign);
+                zNSign = S::isub(S::seti(0), zNSign);
+
+                seed += 1293373;
+            }
+
+            F amp = S::set(warpAmp);
+            xr = S::add(xr, S::mul(vx, amp));
+            yr = S::add(yr, S::mul(vy, amp));
+            zr = S::add(zr, S::mul(vz, amp));
+        }
+
+        static inline void doSingleWarp(const NoiseBatch::WarpParams &p, int seed, float amp, float frequency,
+                                        F xs, F ys, F zs, F &x, F &y, F &z)
+        {
+            float warpAmp = p.reduced ? amp * 7.71604938271605f : amp * 32.69428253173828125f;
+            singleWarpOpenSimplex2(p, seed, warpAmp, frequency, xs, ys, zs, x, y, z);
+        }
+
+        static inline void domainWarp(const NoiseBatch::WarpParams &p, F &x, F &y, F &z)
+        {
+            int seed = p.seed;
+            float amp = p.amp;
+            float frequency = p.frequency;
+
+            switch (p.fractal)
+            {
+            case NoiseBatch::Fractal_DomainWarpProgressive:
+                for (int i = 0; i < p.octaves; i++)
+                {
+                    F xs = x, ys = y, zs = z;
+                    transform(p.transform, xs, ys, zs);
+                    doSingleWarp(p, seed, amp, frequency, xs, ys, zs, x, y, z);
+
+                    seed++;
+                    amp *= p.gain;
+                    frequency *= p.lacunarity;
+                }
+                break;
+            case NoiseBatch::Fractal_DomainWarpIndependent:
+            {
+                F xs = x, ys = y, zs = z;
+                transform(p.transform, xs, ys, zs);
+                for (int i = 0; i < p.octaves; i++)
+                {
+                    doSingleWarp(p, seed, amp, frequency, xs, ys, zs, x, y, z);
+
+                    seed++;
+                    amp *= p.gain;
+                    frequency *= p.lacunarity;
+                }
+            }
+            break;
+            default:
+            {
+                F xs = x, ys = y, zs = z;
+                transform(p.transform, xs, ys, zs);
+                doSingleWarp(p, seed, amp, frequency, xs, ys, zs, x, y, z);
+            }
+            break;
+            }
+        }
+
+        // full vectors straight from the arrays, then one zero-padded vector for the tail
+        static void getNoiseBatch(const NoiseBatch::NoiseParams &p, const float *xs, const float *ys, const float *zs, float *out, size_t n)
+        {
+            size_t i = 0;
+            for (; i + S::Width <= n; i += S::Width)
+            {
+                S::store(out + i, getNoise(p, S::load(xs + i), S::load(ys + i), S::load(zs + i)));
+            }
+            if (i < n)
+            {
+                float tx[S::Width] = {}, ty[S::Width] = {}, tz[S::Width] = {}, to[S::Width];
+                size_t rest = n - i;
+                for (size_t l = 0; l < rest; ++l)
+                {
+                    tx[l] = xs[i + l];
+                    ty[l] = ys[i + l];
+                    tz[l] = zs[i + l];
+                }
+                S::store(to, getNoise(p, S::load(tx), S::load(ty), S::load(tz)));
+                for (size_t l = 0; l < rest; ++l)
+                    out[i + l] = to[l];
+            }
+        }
+
+        static void domainWarpBatch(const NoiseBatch::WarpParams &p, float *xs, float *ys, float *zs, size_t n)
+        {
+            size_t i = 0;
+            for (; i + S::Width <= n; i += S::Width)
+            {
+                F x = S::load(xs + i), y = S::load(ys + i), z = S::load(zs + i);
+                domainWarp(p, x, y, z);
+                S::store(xs + i, x);
+                S::store(ys + i, y);
+                S::store(zs + i, z);
+            }
+            if (i < n)
+            {
+                float tx[S::Width] = {}, ty[S::Width] = {}, tz[S::Width] = {};
+                size_t rest = n - i;
+                for (size_t l = 0; l < rest; ++l)
+                {
+                    tx[l] = xs[i + l];
+                    ty[l] = ys[i + l];
+                    tz[l] = zs[i + l];
+                }
+                F x = S::load(tx), y = S::load(ty), z = S::load(tz);
+                domainWarp(p, x, y, z);
+                S::store(tx, x);
+                S::store(ty, y);
+                S::store(tz, z);
+                for (size_t l = 0; l < rest; ++l)
+                {
+                    xs[i + l] = tx[l];
+                    ys[i + l] = ty[l];
+                    zs[i + l] = tz[l];
+                }
+            }
+        }
+    };
+}
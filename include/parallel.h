@@ -0,0 +1,42 @@
+#pragma once
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+inline unsigned int resolveThreadCount(unsigned int requested)
+{
+    if (requested != 0)
+        return requested;
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// splits [begin, end) into contiguous slabs, one per worker, and calls fn(slabBegin, slabEnd, slabIndex).
+// slab 0 runs on the calling thread so a single-threaded run spawns nothing.
+template <typename Fn>
+void parallelForSlabs(int begin, int end, unsigned int threadCount, Fn &&fn)
+{
+    int count = end - begin;
+    if (count <= 0)
+        return;
+
+    int slabs = (int)std::min<unsigned int>(resolveThreadCount(threadCount), (unsigned int)count);
+    int base = count / slabs;
+    int remainder = count % slabs;
+
+    std::vector<std::thread> workers;
+    workers.reserve(slabs - 1);
+
+    int slabBegin = begin + base + (remainder > 0 ? 1 : 0);
+    for (int s = 1; s < slabs; ++s)
+    {
+        int slabEnd = slabBegin + base + (s < remainder ? 1 : 0);
+        workers.emplace_back([&fn, slabBegin, slabEnd, s]()
+                             { fn(slabBegin, slabEnd, s); });
+        slabBegin = slabEnd;
+    }
+
+    fn(begin, begin + base + (remainder > 0 ? 1 : 0), 0);
+
+    for (auto &worker : workers)
+        worker.join();
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// FNV-1a over plain values, to tell whether the inputs of a generation step changed since it last ran.
+// structs are added field by field, never as a whole, so their padding never gets in
+class ParamHash
+{
+public:
+    template <typename T>
+    ParamHash &add(const T &value)
+    {
+        static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value, "add plain values one field at a time");
+        const unsigned char *bytes = reinterpret_cast<const unsigned char *>(&value);
+        for (size_t i = 0; i < sizeof(T); ++i)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return *this;
+    }
+
+    uint64_t value() const { return hash; }
+
+private:
+    uint64_t hash = 14695981039346656037ull;
+};
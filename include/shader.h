@@ -65,32 +65,15 @@ public:
 
     Shader(const char *computePath, const std::vector<std::string> &includePaths = {})
     {
-        std::string computeCode = readFile(computePath);
-
-        std::string fullSource = "#version 460 core\n";
-
-        for (const auto &path : includePaths)
-        {
-            std::string includeCode = readFile(path.c_str());
-            fullSource += removeVersionTag(includeCode) + "\n";
-        }
-
-        fullSource += removeVersionTag(computeCode);
-
-        const char *cShaderCode = fullSource.c_str();
-
-        unsigned int compute;
-        compute = glCreateShader(GL_COMPUTE_SHADER);
-        glShaderSource(compute, 1, &cShaderCode, NULL);
-        glCompileShader(compute);
-        checkCompileErrors(compute, "COMPUTE");
-
-        ID = glCreateProgram();
-        glAttachShader(ID, compute);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
+        buildCompute(readFile(computePath), includePaths);
+    }
 
-        glDeleteShader(compute);
+    // compute shader from generated source (e.g. DensityGraph), include files are prepended the same way
+    static Shader fromComputeSource(const std::string &computeCode, const std::vector<std::string> &includePaths = {})
+    {
+        Shader shader;
+        shader.buildCompute(computeCode, includePaths);
+        return shader;
     }
 
     void use() const
@@ -120,6 +103,36 @@ public:
     }
 
 private:
+    Shader() : ID(0) {}
+
+    void buildCompute(const std::string &computeCode, const std::vector<std::string> &includePaths)
+    {
+        std::string fullSource = "#version 460 core\n";
+
+        for (const auto &path : includePaths)
+        {
+            std::string includeCode = readFile(path.c_str());
+            fullSource += removeVersionTag(includeCode) + "\n";
+        }
+
+        fullSource += removeVersionTag(computeCode);
+
+        const char *cShaderCode = fullSource.c_str();
+
+        unsigned int compute;
+        compute = glCreateShader(GL_COMPUTE_SHADER);
+        glShaderSource(compute, 1, &cShaderCode, NULL);
+        glCompileShader(compute);
+        checkCompileErrors(compute, "COMPUTE");
+
+        ID = glCreateProgram();
+        glAttachShader(ID, compute);
+        glLinkProgram(ID);
+        checkCompileErrors(ID, "PROGRAM");
+
+        glDeleteShader(compute);
+    }
+
     std::string readFile(const char *path)
     {
         std::string code;
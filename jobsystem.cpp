@@ -0,0 +1,188 @@
+#include "include/jobsystem.h"
+#include "include/parallel.h"
+#include <algorithm>
+
+// the pool and worker the current thread belongs to, so a job's own submissions stay on its deque
+static thread_local const JobSystem *currentPool = nullptr;
+static thread_local unsigned int currentWorker = 0;
+
+JobSystem::JobSystem(unsigned int threadCount)
+{
+    unsigned int count = threadCount != 0 ? threadCount : std::max(1u, resolveThreadCount(0) - 1);
+    for (unsigned int i = 0; i < count; ++i)
+        workers.emplace_back(new Worker());
+    totals.queueDepths.assign(count, 0);
+    for (unsigned int i = 0; i < count; ++i)
+        workers[i]->thread = std::thread([this, i]()
+                                         { run(i); });
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto &worker : workers)
+        worker->thread.join();
+}
+
+void JobSystem::insert(Worker &worker, Job &&job)
+{
+    // after every job of the same or higher priority, so equal priorities run in submission order
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    auto it = std::find_if(worker.jobs.begin(), worker.jobs.end(), [&](const Job &queued)
+                           { return queued.priority < job.priority; });
+    worker.jobs.insert(it, std::move(job));
+}
+
+void JobSystem::submit(std::function<void()> fn, float priority, CancellationToken token, uint64_t tag)
+{
+    Job job;
+    job.fn = std::move(fn);
+    job.priority = priority;
+    job.token = token;
+    job.tag = tag;
+    job.submitted = std::chrono::steady_clock::now();
+
+    // counted before it is visible, so a worker can not finish it and take pending to 0 first
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        queued++;
+        pending++;
+    }
+    unsigned int index = currentPool == this ? currentWorker : nextWorker++ % (unsigned int)workers.size();
+    insert(*workers[index], std::move(job));
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        totals.submitted++;
+    }
+    wake.notify_one();
+}
+
+void JobSystem::reprioritize(const std::function<float(uint64_t tag, float priority)> &priority)
+{
+    for (auto &worker : workers)
+    {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        for (Job &job : worker->jobs)
+        {
+            if (job.tag != 0)
+                job.priority = priority(job.tag, job.priority);
+        }
+        std::stable_sort(worker->jobs.begin(), worker->jobs.end(), [](const Job &a, const Job &b)
+                         { return a.priority > b.priority; });
+    }
+}
+
+bool JobSystem::pop(unsigned int index, Job &job)
+{
+    // own deque first, then the others starting with the next one along
+    unsigned int count = (unsigned int)workers.size();
+    for (unsigned int k = 0; k < count; ++k)
+    {
+        Worker &worker = *workers[(index + k) % count];
+        std::unique_lock<std::mutex> lock(worker.mutex);
+        if (worker.jobs.empty())
+            continue;
+        job = std::move(worker.jobs.front());
+        worker.jobs.pop_front();
+        lock.unlock();
+
+        if (k != 0)
+        {
+            std::lock_guard<std::mutex> statsLock(statsMutex);
+            totals.steals++;
+        }
+        std::lock_guard<std::mutex> wakeLock(wakeMutex);
+        queued--;
+        return true;
+    }
+    return false;
+}
+
+void JobSystem::run(unsigned int index)
+{
+    currentPool = this;
+    currentWorker = index;
+    while (true)
+    {
+        Job job;
+        if (!pop(index, job))
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wake.wait(lock, [&]()
+                      { return stopping || queued > 0; });
+            if (stopping)
+                return;
+            continue;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        bool cancelled = job.token.cancelled();
+        if (!cancelled)
+            job.fn();
+        auto end = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> lock(statsMutex);
+            if (cancelled)
+            {
+                totals.cancelled++;
+            }
+            else
+            {
+                totals.completed++;
+                waitMsSum += std::chrono::duration<double, std::milli>(start - job.submitted).count();
+                runMsSum += std::chrono::duration<double, std::milli>(end - start).count();
+                totals.maxLatencyMs = std::max(totals.maxLatencyMs, std::chrono::duration<double, std::milli>(end - job.submitted).count());
+            }
+        }
+        // the job's captures go before anyone waiting on idle is woken
+        job = Job();
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        if (--pending == 0)
+            idle.notify_all();
+    }
+}
+
+void JobSystem::waitIdle()
+{
+    std::unique_lock<std::mutex> lock(wakeMutex);
+    idle.wait(lock, [&]()
+              { return pending == 0; });
+}
+
+JobSystem::Stats JobSystem::stats() const
+{
+    Stats stats;
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        stats = totals;
+        if (totals.completed > 0)
+        {
+            stats.meanWaitMs = waitMsSum / totals.completed;
+            stats.meanRunMs = runMsSum / totals.completed;
+        }
+    }
+    stats.queued = 0;
+    for (size_t i = 0; i < workers.size(); ++i)
+    {
+        std::lock_guard<std::mutex> lock(workers[i]->mutex);
+        stats.queueDepths[i] = (int)workers[i]->jobs.size();
+        stats.queued += stats.queueDepths[i];
+    }
+    std::lock_guard<std::mutex> lock(wakeMutex);
+    stats.running = pending - queued;
+    return stats;
+}
+
+void JobSystem::resetStats()
+{
+    std::lock_guard<std::mutex> lock(statsMutex);
+    std::vector<int> depths = totals.queueDepths;
+    totals = Stats();
+    totals.queueDepths = depths;
+    waitMsSum = 0.0;
+    runMsSum = 0.0;
+}
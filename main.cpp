@@ -11,6 +11,7 @@
 #include <iostream>
 #include <random>
 #include <chrono>
+#include <cstring>
 
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
@@ -90,8 +91,13 @@ void framebuffer_size_callback(GLFWwindow *window, int width, int height)
     glViewport(0, 0, width, height);
 }
 
-int main()
+int main(int argc, char **argv)
 {
+    // --verify-indexed: compare the indexed GPU mesh with the CPU mesher on a hidden window and exit,
+    // e.g. LIBGL_ALWAYS_SOFTWARE=1 xvfb-run ./marchingcubes --verify-indexed
+    bool verifyIndexed = argc > 1 && std::strcmp(argv[1], "--verify-indexed") == 0;
+    // --verify-surface-nets: the same for the surface nets and dual contouring meshes
+    bool verifySurfaceNets = argc > 1 && std::strcmp(argv[1], "--verify-surface-nets") == 0;
     std::mt19937 rng(std::chrono::steady_clock::now().time_since_epoch().count());
 
     if (!glfwInit())
@@ -103,6 +109,8 @@ int main()
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    if (verifyIndexed || verifySurfaceNets)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
     GLFWwindow *window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Marching Cubes", NULL, NULL);
     if (!window)
@@ -127,6 +135,19 @@ int main()
 
     MarchingCubes marchingCubes;
     marchingCubes.initialize();
+    if (verifyIndexed)
+    {
+        bool passed = marchingCubes.verifyIndexedMesh();
+        glfwTerminate();
+        return passed ? 0 : 1;
+    }
+    if (verifySurfaceNets)
+    {
+        bool passed = marchingCubes.verifySurfaceNets(false);
+        passed = marchingCubes.verifySurfaceNets(true) && passed;
+        glfwTerminate();
+        return passed ? 0 : 1;
+    }
 
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
@@ -214,6 +235,30 @@ int main()
             {
                 marchingCubes.seed = std::uniform_int_distribution<int>(0, 100000)(rng);
             }
+            ImGui::Text("Terrain Mode");
+            ImGui::SameLine();
+            ImGui::RadioButton("Volumetric", (int *)&marchingCubes.terrainMode, TERRAIN_VOLUMETRIC);
+            ImGui::SameLine();
+            ImGui::RadioButton("Heightmap", (int *)&marchingCubes.terrainMode, TERRAIN_HEIGHTMAP);
+            ImGui::Text("Warp Stride");
+            ImGui::SameLine();
+            ImGui::SliderInt("##warpstride", &marchingCubes.warpStride, 1, 8);
+            ImGui::Text("Zone Stride");
+            ImGui::SameLine();
+            ImGui::SliderInt("##zonestride", &marchingCubes.zoneStride, 1, 8);
+            ImGui::Text("Density Storage");
+            ImGui::SameLine();
+            ImGui::RadioButton("Float32", (int *)&marchingCubes.densityStorage.format, DENSITY_FLOAT32);
+            ImGui::SameLine();
+            ImGui::RadioButton("FP16", (int *)&marchingCubes.densityStorage.format, DENSITY_FP16);
+            ImGui::SameLine();
+            ImGui::RadioButton("Int16", (int *)&marchingCubes.densityStorage.format, DENSITY_INT16);
+            if (marchingCubes.densityStorage.format == DENSITY_INT16)
+            {
+                ImGui::Text("Int16 Range");
+                ImGui::SameLine();
+                ImGui::SliderFloat("##densityrange", &marchingCubes.densityStorage.range, 1.0f, 128.0f);
+            }
             ImGui::Text("Cave Ceiling");
             ImGui::SameLine();
             ImGui::SliderFloat("##ceiling", &marchingCubes.caveCeiling, 0.0f, 60.0f);
@@ -253,6 +298,264 @@ int main()
             {
                 marchingCubes.caves.emplace_back();
             }
+            if (marchingCubes.lastCaveStats.evaluations > 0)
+            {
+                const auto &stats = marchingCubes.lastCaveStats;
+                ImGui::Text("Cave noise skipped: %.1f%%, zone noise skipped: %.1f%%, %llu tiles above ceiling",
+                            100.0 * stats.caveNoiseSkipped / stats.evaluations,
+                            100.0 * stats.zoneNoiseSkipped / stats.evaluations, stats.tilesSkipped);
+            }
+            ImGui::Checkbox("Use Density Graph Kernel", &marchingCubes.useDensityGraph);
+            if (marchingCubes.useDensityGraph && marchingCubes.lastGraphStats.shaderBuilds > 0)
+            {
+                const auto &graph = marchingCubes.lastGraphStats;
+                ImGui::Text("Graph: %d -> %d nodes, %d noise states, %d kernel builds",
+                            graph.sourceNodes, graph.compiledNodes, graph.noiseStates, graph.shaderBuilds);
+            }
+            ImGui::Separator();
+            if (ImGui::Button("Compare CPU Density"))
+            {
+                marchingCubes.compareCpuDensity();
+            }
+            if (marchingCubes.lastDensityComparison.ran)
+            {
+                const auto &cmp = marchingCubes.lastDensityComparison;
+                ImGui::Text("%s: max err %.2e, %d over tolerance, CPU %.1f ms",
+                            cmp.passed ? "Match" : "Mismatch", cmp.maxError, cmp.mismatches, cmp.cpuMilliseconds);
+            }
+            if (ImGui::Button("Measure Coarse Sampling Error"))
+            {
+                marchingCubes.measureCoarseSamplingError();
+            }
+            if (marchingCubes.lastCoarseReport.ran)
+            {
+                const auto &report = marchingCubes.lastCoarseReport;
+                ImGui::Text("Strides %d/%d: max err %.3f, mean %.2e, %d sign flips, %.1f ms vs %.1f ms",
+                            report.warpStride, report.zoneStride, report.maxError, report.meanError, report.signFlips,
+                            report.coarseMilliseconds, report.fullMilliseconds);
+            }
+            ImGui::Checkbox("Use Gradient Pass", &marchingCubes.useGradientPass);
+            if (ImGui::Button("Benchmark Meshing"))
+            {
+                marchingCubes.benchmarkMeshing();
+            }
+            if (marchingCubes.lastMeshingBenchmark.ran)
+            {
+                const auto &bench = marchingCubes.lastMeshingBenchmark;
+                ImGui::Text("GPU mesh %.3f ms vs gradients %.3f + %.3f ms", bench.gpuCentralMs,
+                            bench.gpuGradientPassMs, bench.gpuGradientMeshMs);
+                ImGui::Text("CPU mesh %.1f ms vs gradients %.1f + %.1f ms, %s", bench.cpuCentralMs,
+                            bench.cpuGradientPassMs, bench.cpuGradientMeshMs, bench.cpuMatches ? "identical" : "differ");
+            }
+            if (ImGui::Button("Measure CPU Mesher Scaling"))
+            {
+                marchingCubes.measureCpuMesherScaling();
+            }
+            for (const auto &result : marchingCubes.lastCpuMesherScaling)
+            {
+                ImGui::Text("%u threads: %.1f ms, %.2fx%s", result.threads, result.milliseconds, result.speedup,
+                            result.identical ? "" : " (MISMATCH)");
+            }
+            if (ImGui::Button("Benchmark Cube Classification"))
+            {
+                marchingCubes.benchmarkCubeClassification();
+            }
+            for (const auto &timing : marchingCubes.lastCubeClassifyTimings)
+            {
+                ImGui::Text("%s: %.2f ms, %d / %d rows skipped%s", simdLevelName(timing.level), timing.milliseconds,
+                            timing.skippedRows, timing.totalRows, timing.identical ? "" : " (MISMATCH)");
+            }
+            ImGui::Checkbox("Use Analytic Normals", &marchingCubes.useAnalyticNormals);
+            if (marchingCubes.useAnalyticNormals && !marchingCubes.analyticNormalsActive())
+            {
+                ImGui::TextDisabled("Needs volumetric terrain, strides 1 and no graph kernel");
+            }
+            if (ImGui::Button("Compare Analytic Normals"))
+            {
+                marchingCubes.compareAnalyticNormals();
+            }
+            if (marchingCubes.lastNormalComparison.ran)
+            {
+                const auto &cmp = marchingCubes.lastNormalComparison;
+                ImGui::Text("vs central: max %.1f mean %.2f deg over %d samples", cmp.maxAngle, cmp.meanAngle, cmp.samples);
+                ImGui::Text("GPU %.3f + %.3f ms vs %.3f ms analytic", cmp.gpuDensityMs, cmp.gpuGradientPassMs,
+                            cmp.gpuAnalyticDensityMs);
+            }
+            ImGui::Checkbox("Use Indexed Mesh", &marchingCubes.useIndexedMesh);
+            if (ImGui::Button("Verify Indexed Mesh"))
+            {
+                marchingCubes.verifyIndexedMesh();
+            }
+            if (marchingCubes.lastIndexedReport.ran)
+            {
+                const auto &report = marchingCubes.lastIndexedReport;
+                ImGui::Text("%s: %u vertices / %u indices, %zu vs %zu soup bytes", report.passed ? "matches CPU" : "MISMATCH",
+                            report.vertices, report.indices, report.indexedBytes, report.soupBytes);
+            }
+            ImGui::Text("Mesh");
+            ImGui::SameLine();
+            ImGui::RadioButton("Marching Cubes", (int *)&marchingCubes.meshMethod, MESH_MARCHING_CUBES);
+            ImGui::SameLine();
+            ImGui::RadioButton("Surface Nets", (int *)&marchingCubes.meshMethod, MESH_SURFACE_NETS);
+            ImGui::SameLine();
+            ImGui::RadioButton("Dual Contouring", (int *)&marchingCubes.meshMethod, MESH_DUAL_CONTOURING);
+            if (ImGui::Button("Verify Surface Nets"))
+            {
+                marchingCubes.verifySurfaceNets(marchingCubes.meshMethod == MESH_DUAL_CONTOURING);
+            }
+            if (marchingCubes.lastSurfaceNetsReport.ran)
+            {
+                const auto &report = marchingCubes.lastSurfaceNetsReport;
+                ImGui::Text("%s %s: %u vertices / %u triangles, %d slivers", report.dualContouring ? "DC" : "SN",
+                            report.passed ? "matches CPU" : "MISMATCH", report.vertices, report.indices / 3, report.slivers);
+                ImGui::Text("MC: %u indexed / %u soup vertices, %u triangles, %d slivers", report.marchingCubesVertices,
+                            report.marchingCubesIndices, report.marchingCubesIndices / 3, report.marchingCubesSlivers);
+            }
+            ImGui::Text("%llu frames: density %llu, mesh %llu runs, %llu skipped", marchingCubes.regenerationStats.frames,
+                        marchingCubes.regenerationStats.densityRuns, marchingCubes.regenerationStats.meshRuns,
+                        marchingCubes.regenerationStats.skippedFrames);
+            ImGui::Checkbox("Chunked World", &marchingCubes.useChunks);
+            if (marchingCubes.useChunks)
+            {
+                ImGui::SliderInt("Chunk Radius", &marchingCubes.chunkRadius, 1, 12);
+                ImGui::Checkbox("Build On Job Pool", &marchingCubes.useChunkJobs);
+                if (!marchingCubes.useChunkJobs)
+                    ImGui::SliderInt("Chunks Per Frame", &marchingCubes.chunksPerFrame, 1, 8);
+                ImGui::SliderFloat("Camera Speed", &camera.MovementSpeed, 2.5f, 200.0f);
+                const auto &stats = marchingCubes.lastChunkStats;
+                ImGui::Text("chunk (%d, %d): %d resident, %d pending, %d stale, %zu triangles", stats.cameraChunk.x,
+                            stats.cameraChunk.y, stats.resident, stats.pending, stats.stale, stats.triangles);
+                ImGui::Text("+%d / -%d / %d cancelled this frame, %.2f ms; %.1f MB density, %.1f MB mesh", stats.generated,
+                            stats.retired, stats.cancelled, stats.generateMs, stats.densityBytes / (1024.0 * 1024.0),
+                            stats.meshBytes / (1024.0 * 1024.0));
+                JobSystem::Stats jobs = marchingCubes.jobStats();
+                ImGui::Text("jobs: %d queued on %zu workers, %d running, %llu steals", jobs.queued, jobs.queueDepths.size(),
+                            jobs.running, (unsigned long long)jobs.steals);
+                ImGui::Text("%llu done, %llu cancelled; wait %.1f ms, run %.1f ms, max latency %.1f ms",
+                            (unsigned long long)jobs.completed, (unsigned long long)jobs.cancelled, jobs.meanWaitMs,
+                            jobs.meanRunMs, jobs.maxLatencyMs);
+                if (ImGui::Button("Reset Job Stats"))
+                {
+                    marchingCubes.resetJobStats();
+                }
+                ImGui::SliderInt("GPU Budget MB", &marchingCubes.chunkGpuBudgetMB, 0, 2048);
+                ImGui::SliderInt("CPU Cache MB", &marchingCubes.chunkCpuBudgetMB, 0, 2048);
+                const ChunkCache::Stats &cache = marchingCubes.chunkCacheStats();
+                ImGui::Text("GPU cache: %d chunks, %.1f MB; %llu hits, %llu misses, %llu evicted; %d over budget, %d deferred",
+                            cache.gpuEntries, cache.gpuBytes / (1024.0 * 1024.0), cache.gpuHits, cache.gpuMisses,
+                            cache.gpuEvictions, stats.overBudget, stats.deferred);
+                ImGui::Text("CPU cache: %d chunks, %.1f MB; %llu hits, %llu misses, %llu evicted, %llu too big",
+                            cache.cpuEntries, cache.cpuBytes / (1024.0 * 1024.0), cache.cpuHits, cache.cpuMisses,
+                            cache.cpuEvictions, cache.cpuRejected);
+                if (ImGui::Button("Reset Cache Stats"))
+                {
+                    marchingCubes.resetChunkCacheStats();
+                    marchingCubes.resetChunkStoreStats();
+                }
+                ImGui::Checkbox("Disk Chunk Store", &marchingCubes.useChunkStore);
+                ImGui::SameLine();
+                if (ImGui::Button("Clear Disk Store"))
+                {
+                    marchingCubes.clearChunkStore();
+                }
+                ImGui::SliderInt("Disk Budget MB", &marchingCubes.chunkStoreBudgetMB, 64, 8192);
+                ChunkStore::Stats store = marchingCubes.chunkStoreStats();
+                ImGui::Text("disk: %d chunks, %.1f MB; %llu hits, %llu misses", store.records,
+                            store.packBytes / (1024.0 * 1024.0), store.hits, store.misses);
+                ImGui::Text("%llu written in %.1f ms, %d queued, %llu dropped, %llu failed, %llu dropped on open",
+                            store.writes, store.writeMs, store.queuedWrites, store.droppedWrites, store.writeFailures,
+                            store.droppedOnOpen);
+                ImGui::Text("%llu compactions, %llu chunks dropped, %.1f ms", store.compactions,
+                            store.compactedRecords, store.compactMs);
+            }
+            // the LODs are built from the single volume; chunks are always drawn at full resolution
+            if (marchingCubes.useChunks)
+            {
+                ImGui::Text("Distance LOD: single volume only, chunks draw at full resolution");
+            }
+            else
+            {
+                ImGui::Checkbox("Distance LOD", &marchingCubes.useDistanceLod);
+                ImGui::SameLine();
+                if (marchingCubes.lodsPending())
+                    ImGui::Text("building");
+                else
+                    ImGui::Text("level %d", marchingCubes.lastLodLevel);
+                ImGui::SliderFloat("LOD Distance", &marchingCubes.lodDistance, 25.0f, 400.0f);
+            }
+            ImGui::Checkbox("Optimize LOD Order", &marchingCubes.useMeshOptimization);
+            ImGui::SameLine();
+            ImGui::Checkbox("Overdraw Clusters", &marchingCubes.useOverdrawClustering);
+            if (!marchingCubes.useChunks)
+            {
+                if (ImGui::Button("Rebuild LODs"))
+                {
+                    marchingCubes.requestLods();
+                }
+                for (const auto &level : marchingCubes.lastLodReport.levels)
+                {
+                    ImGui::Text("error %.2f: %zu -> %zu triangles, measured %.3f, %.1f ms, ACMR %.2f", level.targetError,
+                                level.stats.inputTriangles, level.stats.outputTriangles, level.measuredError, level.stats.milliseconds,
+                                level.cache.acmr);
+                }
+            }
+            if (ImGui::Button("Measure Mesh Optimization"))
+            {
+                marchingCubes.measureMeshOptimization();
+            }
+            for (const auto &stage : marchingCubes.lastMeshOptimizationReport.stages)
+            {
+                ImGui::Text("%s: ACMR %.2f, ATVR %.2f, overfetch %.2f, %.2f ms", stage.name, stage.cache.acmr, stage.cache.atvr,
+                            stage.cache.overfetch, stage.milliseconds);
+            }
+            if (ImGui::Button("Measure Decimation"))
+            {
+                marchingCubes.measureDecimation();
+            }
+            for (const auto &result : marchingCubes.lastDecimationResults)
+            {
+                ImGui::Text("%zu -> %zu triangles, error %.3f (measured %.3f%s), %.0f tri/ms", result.stats.inputTriangles,
+                            result.stats.outputTriangles, result.stats.maxError, result.measuredError,
+                            result.withinBound ? "" : " OVER", result.stats.trianglesRemovedPerMs());
+            }
+            ImGui::Checkbox("Packed Vertices", &marchingCubes.usePackedVertices);
+            ImGui::SameLine();
+            ImGui::Text("%.1f MB vertex buffer", marchingCubes.vertexBufferBytes() / (1024.0 * 1024.0));
+            ImGui::Checkbox("Deterministic Mesh Order", &marchingCubes.usePrefixSums);
+            ImGui::Checkbox("Compact Active Cells", &marchingCubes.useActiveCells);
+            if (marchingCubes.useActiveCells)
+            {
+                const auto &stats = marchingCubes.lastActiveCellStats;
+                ImGui::Text("Active cells: %u / %u (%.2f%%)", stats.activeCells, stats.totalCells, stats.ratio() * 100.0f);
+            }
+            ImGui::Text("Soup Extraction");
+            ImGui::SameLine();
+            ImGui::RadioButton("Atomic", (int *)&marchingCubes.meshExtraction, EXTRACTION_ATOMIC);
+            ImGui::SameLine();
+            ImGui::RadioButton("HistoPyramid", (int *)&marchingCubes.meshExtraction, EXTRACTION_HISTOPYRAMID);
+            if (ImGui::Button("Benchmark Soup Meshing"))
+            {
+                marchingCubes.benchmarkSoupMeshing();
+            }
+            for (const auto &grid : marchingCubes.lastSoupMeshingBenchmark.grids)
+            {
+                ImGui::Text("%d^3: atomics %.3f ms%s, scan %.3f ms%s, pyramid %.3f ms%s", grid.gridSize, grid.atomicMs,
+                            grid.atomicRepeatable ? "" : " (order varies)", grid.prefixSumMs,
+                            grid.prefixSumRepeatable && grid.prefixSumMatchesCpu ? "" : " (MISMATCH)", grid.histoPyramidMs,
+                            grid.histoPyramidRepeatable && grid.histoPyramidMatchesCpu ? "" : " (MISMATCH)");
+            }
+            if (ImGui::Button("Measure Density Quantization"))
+            {
+                marchingCubes.measureDensityQuantization();
+            }
+            if (marchingCubes.lastQuantizationReport.ran)
+            {
+                const auto &report = marchingCubes.lastQuantizationReport;
+                ImGui::Text("%zu / %zu bytes: vertex err max %.2e mean %.2e voxels, %d cubes changed",
+                            report.storedBytes, report.floatBytes, report.maxVertexError, report.meanVertexError,
+                            report.changedCubes);
+            }
+            ImGui::Text("CPU noise SIMD: %s", simdLevelName(NoiseBatch::activeLevel()));
             ImGui::Separator();
             ImGui::TextDisabled("Press M to toggle this window");
             ImGui::TextDisabled("Press ENTER to toggle wireframe mode");
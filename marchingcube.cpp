@@ -3,24 +3,33 @@
 #include "include/edgetable.h"
 #include "include/shader.h"
 #include "include/camera.h"
+#include "include/cpumesher.h"
+#include "include/parallel.h"
+#include "include/cubeclassify.h"
+#include "include/meshsimplifier.h"
+#include "include/meshoptimizer.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstring>
 
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 
-struct VertexNormal
-{
-    glm::vec4 position;
-    glm::vec3 normal;
-    float pad;
-};
-
 MarchingCubes::MarchingCubes()
     : densitySSBO(0), vertexSSBO(0), edgeTableSSBO(0), triTableSSBO(0), normalSSBO(0),
-      counterBuffer(0), densityComputeShader(0),
-      computeShader(0), renderShader(0), VAO(0), seed(999)
+      counterBuffer(0), caveStatsBuffer(0), densityComputeShader(0), heightmapComputeShader(0), heightmapSSBO(0),
+      coarseFieldsComputeShader(0), warpFieldSSBO(0), zoneFieldSSBO(0), graphComputeShader(0),
+      gradientComputeShader(0), gradientSSBO(0), meshVerticesComputeShader(0), meshIndicesComputeShader(0),
+      edgeVertexSSBO(0), indexSSBO(0), meshCountComputeShader(0), prefixScanComputeShader(0), scanSSBO(0),
+      classifyComputeShader(0), activeCellSSBO(0), histoPyramidReduceComputeShader(0), histoPyramidEmitComputeShader(0),
+      surfaceNetsVerticesComputeShader(0), surfaceNetsQuadsComputeShader(0),
+      computeShader(0), renderShader(0), VAO(0), densityGenerator(DENSITY_SIZE), cpuMesher(DENSITY_SIZE), chunkManager(GRID_SIZE), seed(999)
 {
 }
 
@@ -32,10 +41,32 @@ MarchingCubes::~MarchingCubes()
     glDeleteBuffers(1, &edgeTableSSBO);
     glDeleteBuffers(1, &triTableSSBO);
     glDeleteBuffers(1, &counterBuffer);
+    glDeleteBuffers(1, &caveStatsBuffer);
+    glDeleteBuffers(1, &heightmapSSBO);
+    glDeleteBuffers(1, &warpFieldSSBO);
+    glDeleteBuffers(1, &zoneFieldSSBO);
+    glDeleteBuffers(1, &gradientSSBO);
+    glDeleteBuffers(1, &edgeVertexSSBO);
+    glDeleteBuffers(1, &indexSSBO);
+    glDeleteBuffers(1, &scanSSBO);
+    glDeleteBuffers(1, &activeCellSSBO);
     glDeleteProgram(computeShader);
     glDeleteProgram(renderShader);
     glDeleteProgram(densityComputeShader);
+    glDeleteProgram(heightmapComputeShader);
+    glDeleteProgram(coarseFieldsComputeShader);
+    glDeleteProgram(graphComputeShader);
+    glDeleteProgram(gradientComputeShader);
+    glDeleteProgram(meshVerticesComputeShader);
+    glDeleteProgram(meshIndicesComputeShader);
+    glDeleteProgram(meshCountComputeShader);
+    glDeleteProgram(prefixScanComputeShader);
+    glDeleteProgram(classifyComputeShader);
+    glDeleteProgram(histoPyramidReduceComputeShader);
+    glDeleteProgram(histoPyramidEmitComputeShader);
     glDeleteVertexArrays(1, &VAO);
+    deleteLods();
+    clearChunks();
 }
 
 void MarchingCubes::createDensitySSBO()
@@ -54,34 +85,248 @@ void MarchingCubes::createDensitySSBO()
     // }
     // glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, densitySSBO);
     // glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
-    int totalElements = DENSITY_SIZE * DENSITY_SIZE * DENSITY_SIZE;
-
-    glGenBuffers(1, &densitySSBO);
+    // also called again when the storage format changes; the 16-bit formats need half the bytes
+    if (densitySSBO == 0)
+        glGenBuffers(1, &densitySSBO);
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, densitySSBO);
 
-    glBufferData(GL_SHADER_STORAGE_BUFFER, totalElements * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, densityStorage.byteSize(DENSITY_SIZE), nullptr, GL_DYNAMIC_DRAW);
+    allocatedDensityFormat = densityStorage.format;
+    invalidateGeneration();
 
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, densitySSBO);
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 }
 
+void MarchingCubes::setDensityStorageUniforms(GLuint program)
+{
+    glUniform1i(glGetUniformLocation(program, "u_DensityFormat"), (int)densityStorage.format);
+    glUniform1f(glGetUniformLocation(program, "u_DensityScale"), densityStorage.scale());
+}
+
+void MarchingCubes::createHeightmapSSBO()
+{
+    // one terrain height per (x, z) column for TERRAIN_HEIGHTMAP
+    glGenBuffers(1, &heightmapSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, heightmapSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, DENSITY_SIZE * DENSITY_SIZE * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, heightmapSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void MarchingCubes::createGradientSSBO()
+{
+    // normalised gradient per density sample, 3 floats each
+    int totalElements = DENSITY_SIZE * DENSITY_SIZE * DENSITY_SIZE;
+    glGenBuffers(1, &gradientSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, gradientSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, totalElements * 3 * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, gradientSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void MarchingCubes::createMeshBuffers()
+{
+    // also called again when the output mode changes. a triangle soup needs up to 15 vertices per cell;
+    // the indexed mesh at most one vertex per edge, 15 indices per cell and an edge -> vertex map;
+    // the dual meshes one vertex per cell, a quad per edge and a cell -> vertex map
+    meshCached = false;
+    bool indexed = indexedOutput();
+    bool dual = meshMethod != MESH_MARCHING_CUBES;
+    int samples = DENSITY_SIZE * DENSITY_SIZE * DENSITY_SIZE;
+    int cells = (DENSITY_SIZE - 1) * (DENSITY_SIZE - 1) * (DENSITY_SIZE - 1);
+    if (dual)
+        vertexCapacity = cells;
+    else if (indexed)
+        vertexCapacity = 3 * samples;
+    else
+        vertexCapacity = GRID_SIZE * GRID_SIZE * GRID_SIZE * 15;
+
+    if (vertexSSBO == 0)
+    {
+        glGenBuffers(1, &vertexSSBO);
+        glGenBuffers(1, &indexSSBO);
+        glGenBuffers(1, &edgeVertexSSBO);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, vertexSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)vertexBufferBytes(), nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, vertexSSBO);
+
+    // unused by the soup, kept at a token size
+    size_t indexBytes = sizeof(GLuint);
+    size_t edgeBytes = sizeof(GLuint);
+    if (dual)
+    {
+        indexBytes = (size_t)samples * 3 * 6 * sizeof(GLuint);
+        edgeBytes = (size_t)cells * sizeof(GLuint);
+    }
+    else if (indexed)
+    {
+        indexBytes = (size_t)cells * 15 * sizeof(GLuint);
+        edgeBytes = (size_t)samples * 3 * sizeof(GLuint);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, indexSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, indexBytes, nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 11, indexSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, edgeVertexSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, edgeBytes, nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10, edgeVertexSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    allocatedIndexedMesh = indexed;
+    allocatedMeshMethod = meshMethod;
+    allocatedPackedVertices = usePackedVertices;
+    if (VAO != 0)
+        setupVertexAttributes();
+}
+
+size_t MarchingCubes::vertexStride() const
+{
+    return usePackedVertices ? sizeof(PackedVertex) : sizeof(VertexNormal);
+}
+
+// attribute layout of the buffer bound to GL_ARRAY_BUFFER, into the bound VAO
+static void setVertexLayout(bool packed)
+{
+    if (packed)
+    {
+        // x, y, z, spare as plain numbers, vertex.glsl scales them; the normal as two snorm16
+        glVertexAttribPointer(0, 4, GL_UNSIGNED_SHORT, GL_FALSE, sizeof(PackedVertex), (void *)0);
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void *)8);
+    }
+    else
+    {
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(VertexNormal), (void *)0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(VertexNormal), (void *)16);
+    }
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+}
+
+void MarchingCubes::setupVertexAttributes()
+{
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexSSBO);
+    setVertexLayout(usePackedVertices);
+    // only read by glDrawElements in indexed mode
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexSSBO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+void MarchingCubes::readVertices(unsigned int count, std::vector<VertexNormal> &vertices)
+{
+    // unpacked on the CPU when the buffer holds PackedVertex, so callers always see VertexNormal
+    vertices.resize(count);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, vertexSSBO);
+    if (usePackedVertices)
+    {
+        std::vector<PackedVertex> packed(count);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, count * sizeof(PackedVertex), packed.data());
+        for (unsigned int i = 0; i < count; ++i)
+            vertices[i] = unpackVertex(packed[i]);
+    }
+    else
+    {
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, count * sizeof(VertexNormal), vertices.data());
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+// prefixScan.comp.glsl works in blocks of this many values
+static const GLuint SCAN_BLOCK_SIZE = 512;
+
+// a scan of count values plus the block totals of every level above it
+static GLuint scanRegionSize(GLuint count)
+{
+    GLuint size = count;
+    do
+    {
+        count = (count + SCAN_BLOCK_SIZE - 1) / SCAN_BLOCK_SIZE;
+        size += count;
+    } while (count > 1);
+    return size;
+}
+
+// the HistoPyramid's 4-uint header, the per-cell counts and every level of sums of 8 above them
+static GLuint histoPyramidSize(GLuint count)
+{
+    GLuint size = 4 + count;
+    do
+    {
+        count = (count + 7) / 8;
+        size += count;
+    } while (count > 1);
+    return size;
+}
+
+static GLuint cellCount(int densitySize)
+{
+    return (GLuint)(densitySize - 1) * (densitySize - 1) * (densitySize - 1);
+}
+
+// the prefix-sum regions or the HistoPyramid, whichever the soup or indexed mesher is using
+static GLuint scanBufferSize(int densitySize)
+{
+    GLuint samples = (GLuint)densitySize * densitySize * densitySize;
+    GLuint cells = cellCount(densitySize);
+    return std::max(scanRegionSize(cells) + scanRegionSize(samples), histoPyramidSize(cells));
+}
+
+void MarchingCubes::createScanSSBO()
+{
+    // prefix sums: per-cell counts (soup vertices, or indices) first, then per-sample vertex counts for
+    // the indexed mesh. the HistoPyramid reuses the same buffer
+    GLuint size = scanBufferSize(DENSITY_SIZE);
+    glGenBuffers(1, &scanSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, scanSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)size * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 12, scanSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void MarchingCubes::createActiveCellSSBO()
+{
+    // indirect dispatch arguments and the active cell count, then one entry per cell at most
+    GLsizeiptr size = 4 * sizeof(GLuint) + (GLsizeiptr)cellCount(DENSITY_SIZE) * sizeof(GLuint);
+    glGenBuffers(1, &activeCellSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, activeCellSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 13, activeCellSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void MarchingCubes::createCoarseFieldSSBOs()
+{
+    // sized for the finest coarse lattice (stride 2)
+    int n = DensityGenerator::latticeSize(DENSITY_SIZE, 2);
+    int latticePoints = n * n * n;
+
+    glGenBuffers(1, &warpFieldSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, warpFieldSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, latticePoints * 3 * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, warpFieldSSBO);
+
+    glGenBuffers(1, &zoneFieldSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, zoneFieldSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, latticePoints * MAX_CAVES * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, zoneFieldSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
 void MarchingCubes::uploadMarchingCubesTables()
 {
+    // the constexpr tables as they are; meshCommon.glsl unpacks the 16-bit masks and 8-bit edges
     glGenBuffers(1, &edgeTableSSBO);
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, edgeTableSSBO);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, edgetable.size() * sizeof(int), edgetable.data(), GL_STATIC_DRAW);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(edgetable), edgetable, GL_STATIC_DRAW);
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, edgeTableSSBO);
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
-    std::vector<int> flattenedTriTable;
-    for (const auto &row : tritable)
-    {
-        flattenedTriTable.insert(flattenedTriTable.end(), row.begin(), row.end());
-    }
-
     glGenBuffers(1, &triTableSSBO);
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, triTableSSBO);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, flattenedTriTable.size() * sizeof(int), flattenedTriTable.data(), GL_STATIC_DRAW);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(tritable), tritable, GL_STATIC_DRAW);
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, triTableSSBO);
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 }
@@ -91,41 +336,72 @@ void MarchingCubes::initialize()
     setupShaders();
     setupBuffers();
     createDensitySSBO();
+    createHeightmapSSBO();
+    createCoarseFieldSSBOs();
+    createGradientSSBO();
+    createScanSSBO();
+    createActiveCellSSBO();
     uploadMarchingCubesTables();
 }
 
 void MarchingCubes::setupBuffers()
 {
-    int maxVertices = GRID_SIZE * GRID_SIZE * GRID_SIZE * 15;
-
-    glGenBuffers(1, &vertexSSBO);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, vertexSSBO);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, maxVertices * sizeof(VertexNormal), nullptr, GL_DYNAMIC_DRAW);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, vertexSSBO);
+    createMeshBuffers();
 
+    // vertexCounter, indexCounter
     glGenBuffers(1, &counterBuffer);
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
-    unsigned int zero = 0;
-    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int), &zero, GL_DYNAMIC_DRAW);
+    unsigned int counters[2] = {0, 0};
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(counters), counters, GL_DYNAMIC_DRAW);
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, counterBuffer);
 
-    glGenVertexArrays(1, &VAO);
-    glBindVertexArray(VAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, vertexSSBO);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(VertexNormal), (void *)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(VertexNormal), (void *)16);
-    glEnableVertexAttribArray(1);
+    // caveNoiseSkipped, zoneNoiseSkipped, tilesSkipped
+    glGenBuffers(1, &caveStatsBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, caveStatsBuffer);
+    unsigned int zeros[3] = {0, 0, 0};
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(zeros), zeros, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, caveStatsBuffer);
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    glGenVertexArrays(1, &VAO);
+    setupVertexAttributes();
 }
 void MarchingCubes::setupShaders()
 {
     {
-        Shader computeShaderObj("shaders/marchingCube.comp.glsl");
+        std::vector<std::string> densityIncludes = {"shaders/densityStorage.glsl"};
+        std::vector<std::string> meshIncludes = {"shaders/densityStorage.glsl", "shaders/meshCommon.glsl"};
+        Shader computeShaderObj("shaders/marchingCube.comp.glsl", meshIncludes);
         computeShader = computeShaderObj.ID;
+
+        Shader meshVerticesShaderObj("shaders/meshVertices.comp.glsl", meshIncludes);
+        meshVerticesComputeShader = meshVerticesShaderObj.ID;
+
+        Shader meshIndicesShaderObj("shaders/meshIndices.comp.glsl", meshIncludes);
+        meshIndicesComputeShader = meshIndicesShaderObj.ID;
+
+        Shader meshCountShaderObj("shaders/meshCount.comp.glsl", meshIncludes);
+        meshCountComputeShader = meshCountShaderObj.ID;
+
+        Shader classifyShaderObj("shaders/classifyCells.comp.glsl", meshIncludes);
+        classifyComputeShader = classifyShaderObj.ID;
+
+        Shader histoPyramidReduceShaderObj("shaders/histoPyramidReduce.comp.glsl");
+        histoPyramidReduceComputeShader = histoPyramidReduceShaderObj.ID;
+
+        Shader histoPyramidEmitShaderObj("shaders/histoPyramidEmit.comp.glsl", meshIncludes);
+        histoPyramidEmitComputeShader = histoPyramidEmitShaderObj.ID;
+
+        Shader surfaceNetsVerticesShaderObj("shaders/surfaceNetsVertices.comp.glsl", meshIncludes);
+        surfaceNetsVerticesComputeShader = surfaceNetsVerticesShaderObj.ID;
+
+        Shader surfaceNetsQuadsShaderObj("shaders/surfaceNetsQuads.comp.glsl", meshIncludes);
+        surfaceNetsQuadsComputeShader = surfaceNetsQuadsShaderObj.ID;
+
+        Shader prefixScanShaderObj("shaders/prefixScan.comp.glsl");
+        prefixScanComputeShader = prefixScanShaderObj.ID;
+
+        Shader gradientShaderObj("shaders/gradient.comp.glsl", densityIncludes);
+        gradientComputeShader = gradientShaderObj.ID;
     }
 
     {
@@ -136,20 +412,114 @@ void MarchingCubes::setupShaders()
     {
         std::vector<std::string> includes = {"shaders/FastNoiseLite.glsl"};
 
-        Shader densityShaderObj("shaders/density.comp.glsl", includes);
+        std::vector<std::string> latticeIncludes = {"shaders/FastNoiseLite.glsl", "shaders/coarseLattice.glsl"};
+        std::vector<std::string> densityIncludes = {"shaders/FastNoiseLite.glsl", "shaders/coarseLattice.glsl", "shaders/densityStorage.glsl"};
+
+        Shader densityShaderObj("shaders/density.comp.glsl", densityIncludes);
         densityComputeShader = densityShaderObj.ID;
+
+        Shader heightmapShaderObj("shaders/heightmap.comp.glsl", includes);
+        heightmapComputeShader = heightmapShaderObj.ID;
+
+        Shader coarseFieldsShaderObj("shaders/coarseFields.comp.glsl", latticeIncludes);
+        coarseFieldsComputeShader = coarseFieldsShaderObj.ID;
     }
 }
 
-void MarchingCubes::render(Camera camera)
+void MarchingCubes::dispatchCoarseFields()
+{
+    int numCaves = (int)std::min((size_t)MAX_CAVES, caves.size());
+
+    glUseProgram(coarseFieldsComputeShader);
+    glUniform1i(glGetUniformLocation(coarseFieldsComputeShader, "densitySize"), DENSITY_SIZE);
+    glUniform1i(glGetUniformLocation(coarseFieldsComputeShader, "u_Seed"), seed);
+    glUniform3fv(glGetUniformLocation(coarseFieldsComputeShader, "u_Offset"), 1, glm::value_ptr(densityOffset));
+    glUniform1i(glGetUniformLocation(coarseFieldsComputeShader, "u_WarpStride"), warpStride);
+    glUniform1i(glGetUniformLocation(coarseFieldsComputeShader, "u_ZoneStride"), zoneStride);
+    glUniform1i(glGetUniformLocation(coarseFieldsComputeShader, "u_NumCaves"), numCaves);
+
+    if (numCaves > 0)
+    {
+        std::vector<glm::vec3> offsets;
+        std::vector<float> zoneFreqs;
+        for (int i = 0; i < numCaves; ++i)
+        {
+            offsets.push_back(caves[i].offset);
+            zoneFreqs.push_back(caves[i].zoneFrequency);
+        }
+        glUniform3fv(glGetUniformLocation(coarseFieldsComputeShader, "u_CaveOffsets"), numCaves, (const float *)offsets.data());
+        glUniform1fv(glGetUniformLocation(coarseFieldsComputeShader, "u_CaveZoneFrequencies"), numCaves, zoneFreqs.data());
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, warpFieldSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, zoneFieldSSBO);
+
+    // one invocation per point of the finer lattice
+    int finestStride = warpStride > 1 && zoneStride > 1 ? std::min(warpStride, zoneStride) : std::max(warpStride, zoneStride);
+    int n = DensityGenerator::latticeSize(DENSITY_SIZE, finestStride);
+    glDispatchCompute((n + 3) / 4, (n + 3) / 4, (n + 3) / 4);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+DensityGraph MarchingCubes::compiledTerrainGraph() const
+{
+    int numCaves = (int)std::min((size_t)MAX_CAVES, caves.size());
+    std::vector<Cave> activeCaves(caves.begin(), caves.begin() + numCaves);
+    return buildTerrainGraph(activeCaves, caveCeiling).compile();
+}
+
+void MarchingCubes::dispatchDensityGraph()
 {
+    // cave parameters are baked into the kernel, so it is only rebuilt when they change
+    DensityGraph graph = compiledTerrainGraph();
+    std::string source = graph.emitGlsl();
+    if (source != graphShaderSource || graphComputeShader == 0)
+    {
+        Shader graphShaderObj = Shader::fromComputeSource(source, {"shaders/FastNoiseLite.glsl", "shaders/densityStorage.glsl"});
+        glDeleteProgram(graphComputeShader);
+        graphComputeShader = graphShaderObj.ID;
+        graphShaderSource = source;
+        lastGraphStats.shaderBuilds++;
+    }
+    lastGraphStats.sourceNodes = graph.sourceNodes;
+    lastGraphStats.compiledNodes = (int)graph.nodes.size();
+    lastGraphStats.noiseStates = (int)graph.noises.size();
+
+    glUseProgram(graphComputeShader);
+    glUniform1i(glGetUniformLocation(graphComputeShader, "densitySize"), DENSITY_SIZE);
+    glUniform1i(glGetUniformLocation(graphComputeShader, "u_Seed"), seed);
+    glUniform3fv(glGetUniformLocation(graphComputeShader, "u_Offset"), 1, glm::value_ptr(densityOffset));
+    glUniform1i(glGetUniformLocation(graphComputeShader, "u_Walls"), densityWalls ? 1 : 0);
+    setDensityStorageUniforms(graphComputeShader);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, densitySSBO);
+    glDispatchCompute((DENSITY_SIZE + 7) / 8, (DENSITY_SIZE + 7) / 8, (DENSITY_SIZE + 7) / 8);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void MarchingCubes::dispatchDensity(int densitySize)
+{
+    // the coarse buffers are sized for stride 2 and up
+    warpStride = std::max(1, warpStride);
+    zoneStride = std::max(1, zoneStride);
+    if (warpStride > 1 || zoneStride > 1)
+    {
+        dispatchCoarseFields();
+    }
+
     // generate terrain noise
     glUseProgram(densityComputeShader);
-    glUniform1i(glGetUniformLocation(densityComputeShader, "gridSize"), GRID_SIZE);
-    glUniform1i(glGetUniformLocation(densityComputeShader, "densitySize"), DENSITY_SIZE);
+    glUniform1i(glGetUniformLocation(densityComputeShader, "gridSize"), densitySize - 3);
+    glUniform1i(glGetUniformLocation(densityComputeShader, "densitySize"), densitySize);
     glUniform1i(glGetUniformLocation(densityComputeShader, "u_Seed"), seed);
-    glUniform3f(glGetUniformLocation(densityComputeShader, "u_Offset"), 0.0f, 0.0f, 0.0f);
+    glUniform3fv(glGetUniformLocation(densityComputeShader, "u_Offset"), 1, glm::value_ptr(densityOffset));
+    glUniform1i(glGetUniformLocation(densityComputeShader, "u_Walls"), densityWalls ? 1 : 0);
     glUniform1f(glGetUniformLocation(densityComputeShader, "u_CaveCeiling"), caveCeiling);
+    glUniform1i(glGetUniformLocation(densityComputeShader, "u_TerrainMode"), (int)terrainMode);
+    glUniform1i(glGetUniformLocation(densityComputeShader, "u_WarpStride"), warpStride);
+    glUniform1i(glGetUniformLocation(densityComputeShader, "u_ZoneStride"), zoneStride);
+    glUniform1i(glGetUniformLocation(densityComputeShader, "u_AnalyticGradients"), analyticNormalsActive() ? 1 : 0);
+    setDensityStorageUniforms(densityComputeShader);
 
     // upload cave uniforms
     int numCaves = (int)std::min((size_t)MAX_CAVES, caves.size());
@@ -180,41 +550,270 @@ void MarchingCubes::render(Camera camera)
     }
 
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, densitySSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, gradientSSBO);
+    resetCaveStats();
 
     // glDispatchCompute(GRID_SIZE / 8, GRID_SIZE / 8, GRID_SIZE / 8);
-    glDispatchCompute((DENSITY_SIZE + 7) / 8, (DENSITY_SIZE + 7) / 8, (DENSITY_SIZE + 7) / 8);
+    glDispatchCompute((densitySize + 7) / 8, (densitySize + 7) / 8, (densitySize + 7) / 8);
 
     // wait for density generation to finish before meshing
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    readCaveStats(numCaves);
+}
 
-    resetVertexCounter();
+void MarchingCubes::dispatchGradients()
+{
+    glUseProgram(gradientComputeShader);
+    glUniform1i(glGetUniformLocation(gradientComputeShader, "densitySize"), DENSITY_SIZE);
+    setDensityStorageUniforms(gradientComputeShader);
 
-    glUseProgram(computeShader);
-    glUniform1i(glGetUniformLocation(computeShader, "gridSize"), GRID_SIZE);
-    glUniform1i(glGetUniformLocation(computeShader, "densitySize"), DENSITY_SIZE);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, gradientSSBO);
+    glDispatchCompute((DENSITY_SIZE + 7) / 8, (DENSITY_SIZE + 7) / 8, (DENSITY_SIZE + 7) / 8);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
 
-    int dispatchSize = DENSITY_SIZE - 1;
-    glDispatchCompute((dispatchSize + 7) / 8, (dispatchSize + 7) / 8, (dispatchSize + 7) / 8);
+void MarchingCubes::dispatchMeshCounts(int densitySize, GLuint cellBase, bool countSamples)
+{
+    glUseProgram(meshCountComputeShader);
+    glUniform1i(glGetUniformLocation(meshCountComputeShader, "densitySize"), densitySize);
+    glUniform1ui(glGetUniformLocation(meshCountComputeShader, "u_CellScanBase"), cellBase);
+    glUniform1ui(glGetUniformLocation(meshCountComputeShader, "u_SampleScanBase"), scanRegionSize(cellCount(densitySize)));
+    glUniform1i(glGetUniformLocation(meshCountComputeShader, "u_CountSamples"), countSamples ? 1 : 0);
+    setDensityStorageUniforms(meshCountComputeShader);
+    setCellRangeUniform(meshCountComputeShader);
+    glDispatchCompute((densitySize + 7) / 8, (densitySize + 7) / 8, (densitySize + 7) / 8);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void MarchingCubes::dispatchPrefixScan(GLuint offset, GLuint count, int totalCounter)
+{
+    // each level's block totals are stored right after it and scanned the same way, down to one block
+    GLuint blocks = (count + SCAN_BLOCK_SIZE - 1) / SCAN_BLOCK_SIZE;
+    GLuint sums = offset + count;
 
+    glUseProgram(prefixScanComputeShader);
+    glUniform1ui(glGetUniformLocation(prefixScanComputeShader, "u_DataOffset"), offset);
+    glUniform1ui(glGetUniformLocation(prefixScanComputeShader, "u_SumsOffset"), sums);
+    glUniform1ui(glGetUniformLocation(prefixScanComputeShader, "u_Count"), count);
+    glUniform1i(glGetUniformLocation(prefixScanComputeShader, "u_Pass"), 0);
+    glUniform1i(glGetUniformLocation(prefixScanComputeShader, "u_TotalCounter"), totalCounter);
+    glDispatchCompute(blocks, 1, 1);
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    if (blocks == 1)
+        return;
 
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
-    unsigned int vertexCount = 0;
-    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(unsigned int), &vertexCount);
+    dispatchPrefixScan(sums, blocks, totalCounter);
+
+    glUseProgram(prefixScanComputeShader);
+    glUniform1ui(glGetUniformLocation(prefixScanComputeShader, "u_DataOffset"), offset);
+    glUniform1ui(glGetUniformLocation(prefixScanComputeShader, "u_SumsOffset"), sums);
+    glUniform1ui(glGetUniformLocation(prefixScanComputeShader, "u_Count"), count);
+    glUniform1i(glGetUniformLocation(prefixScanComputeShader, "u_Pass"), 1);
+    glDispatchCompute(blocks, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void MarchingCubes::dispatchActiveCells()
+{
+    // no groups and no cells yet; classifyCells.comp.glsl adds a group per 512 cells it appends
+    GLuint header[4] = {0, 1, 1, 0};
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, activeCellSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(header), header);
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
-    if (vertexCount == 0)
+    glUseProgram(classifyComputeShader);
+    glUniform1i(glGetUniformLocation(classifyComputeShader, "densitySize"), DENSITY_SIZE);
+    setDensityStorageUniforms(classifyComputeShader);
+    setCellRangeUniform(classifyComputeShader);
+    int dispatchSize = DENSITY_SIZE - 1;
+    glDispatchCompute((dispatchSize + 7) / 8, (dispatchSize + 7) / 8, (dispatchSize + 7) / 8);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+}
+
+void MarchingCubes::dispatchMeshPass(GLuint program, int densitySize, int gridExtent)
+{
+    // the active cell list is sized for DENSITY_SIZE, larger benchmark grids always run over the whole grid
+    bool activeCells = useActiveCells && densitySize == DENSITY_SIZE;
+    glUniform1i(glGetUniformLocation(program, "u_UseActiveCells"), activeCells ? 1 : 0);
+    if (activeCells)
     {
-        std::cout << "No vertices generated. Skipping rendering." << std::endl;
+        glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, activeCellSSBO);
+        glDispatchComputeIndirect(0);
+        glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+    }
+    else
+    {
+        glDispatchCompute((gridExtent + 7) / 8, (gridExtent + 7) / 8, (gridExtent + 7) / 8);
+    }
+}
+
+void MarchingCubes::dispatchMarchingCubes(bool useGradients, int densitySize)
+{
+    if (meshExtraction == EXTRACTION_HISTOPYRAMID)
+    {
+        dispatchHistoPyramid(useGradients, densitySize);
         return;
     }
+    resetVertexCounter();
 
-    glm::mat4 model = glm::mat4(1.0f);
+    // the scan also leaves the vertex total in vertexCounter
+    if (usePrefixSums)
+    {
+        dispatchMeshCounts(densitySize, 0, false);
+        dispatchPrefixScan(0, cellCount(densitySize), 0);
+    }
+    if (useActiveCells && densitySize == DENSITY_SIZE)
+        dispatchActiveCells();
+
+    glUseProgram(computeShader);
+    glUniform1i(glGetUniformLocation(computeShader, "gridSize"), densitySize - 3);
+    glUniform1i(glGetUniformLocation(computeShader, "densitySize"), densitySize);
+    glUniform1i(glGetUniformLocation(computeShader, "u_UseGradients"), useGradients ? 1 : 0);
+    glUniform1i(glGetUniformLocation(computeShader, "u_PackedVertices"), usePackedVertices ? 1 : 0);
+    glUniform1ui(glGetUniformLocation(computeShader, "u_VertexCapacity"), vertexCapacity);
+    glUniform1i(glGetUniformLocation(computeShader, "u_UsePrefixSums"), usePrefixSums ? 1 : 0);
+    glUniform1ui(glGetUniformLocation(computeShader, "u_ScanBase"), 0);
+    setDensityStorageUniforms(computeShader);
+    setCellRangeUniform(computeShader);
+
+    dispatchMeshPass(computeShader, densitySize, densitySize - 1);
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void MarchingCubes::dispatchHistoPyramid(bool useGradients, int densitySize)
+{
+    resetVertexCounter();
+
+    // base level: vertices per cell, after the header the top level fills in
+    const int MAX_LEVELS = 16;
+    GLuint levelOffsets[MAX_LEVELS] = {4};
+    GLuint count = cellCount(densitySize);
+    dispatchMeshCounts(densitySize, levelOffsets[0], false);
+
+    glUseProgram(histoPyramidReduceComputeShader);
+    int levels = 0;
+    do
+    {
+        GLuint parents = (count + 7) / 8;
+        levelOffsets[levels + 1] = levelOffsets[levels] + count;
+        glUniform1ui(glGetUniformLocation(histoPyramidReduceComputeShader, "u_InputOffset"), levelOffsets[levels]);
+        glUniform1ui(glGetUniformLocation(histoPyramidReduceComputeShader, "u_InputCount"), count);
+        glUniform1ui(glGetUniformLocation(histoPyramidReduceComputeShader, "u_OutputOffset"), levelOffsets[levels + 1]);
+        glUniform1ui(glGetUniformLocation(histoPyramidReduceComputeShader, "u_OutputCount"), parents);
+        glDispatchCompute((parents + 255) / 256, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        levels++;
+        count = parents;
+    } while (count > 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+
+    // one thread per vertex, as many as the top of the pyramid says
+    glUseProgram(histoPyramidEmitComputeShader);
+    glUniform1i(glGetUniformLocation(histoPyramidEmitComputeShader, "densitySize"), densitySize);
+    glUniform1i(glGetUniformLocation(histoPyramidEmitComputeShader, "u_UseGradients"), useGradients ? 1 : 0);
+    glUniform1i(glGetUniformLocation(histoPyramidEmitComputeShader, "u_PackedVertices"), usePackedVertices ? 1 : 0);
+    glUniform1ui(glGetUniformLocation(histoPyramidEmitComputeShader, "u_VertexCapacity"), vertexCapacity);
+    glUniform1i(glGetUniformLocation(histoPyramidEmitComputeShader, "u_Levels"), levels);
+    glUniform1uiv(glGetUniformLocation(histoPyramidEmitComputeShader, "u_LevelOffsets"), levels + 1, levelOffsets);
+    setDensityStorageUniforms(histoPyramidEmitComputeShader);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, scanSSBO);
+    glDispatchComputeIndirect(0);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void MarchingCubes::dispatchIndexedMesh(bool useGradients)
+{
+    resetVertexCounter();
+
+    // indices per cell, vertices per sample; the scans leave both totals in the counters
+    GLuint sampleScanBase = scanRegionSize(cellCount(DENSITY_SIZE));
+    if (usePrefixSums)
+    {
+        dispatchMeshCounts(DENSITY_SIZE, 0, true);
+        dispatchPrefixScan(0, cellCount(DENSITY_SIZE), 1);
+        dispatchPrefixScan(sampleScanBase, (GLuint)DENSITY_SIZE * DENSITY_SIZE * DENSITY_SIZE, 0);
+    }
+    if (useActiveCells)
+        dispatchActiveCells();
+
+    // vertices on every sample's +x/+y/+z edges, then indices per cell into them
+    glUseProgram(meshVerticesComputeShader);
+    glUniform1i(glGetUniformLocation(meshVerticesComputeShader, "densitySize"), DENSITY_SIZE);
+    glUniform1i(glGetUniformLocation(meshVerticesComputeShader, "u_UseGradients"), useGradients ? 1 : 0);
+    glUniform1i(glGetUniformLocation(meshVerticesComputeShader, "u_PackedVertices"), usePackedVertices ? 1 : 0);
+    glUniform1i(glGetUniformLocation(meshVerticesComputeShader, "u_UsePrefixSums"), usePrefixSums ? 1 : 0);
+    glUniform1ui(glGetUniformLocation(meshVerticesComputeShader, "u_ScanBase"), sampleScanBase);
+    setDensityStorageUniforms(meshVerticesComputeShader);
+    glDispatchCompute((DENSITY_SIZE + 7) / 8, (DENSITY_SIZE + 7) / 8, (DENSITY_SIZE + 7) / 8);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    glUseProgram(meshIndicesComputeShader);
+    glUniform1i(glGetUniformLocation(meshIndicesComputeShader, "densitySize"), DENSITY_SIZE);
+    glUniform1i(glGetUniformLocation(meshIndicesComputeShader, "u_UsePrefixSums"), usePrefixSums ? 1 : 0);
+    glUniform1ui(glGetUniformLocation(meshIndicesComputeShader, "u_ScanBase"), 0);
+    setDensityStorageUniforms(meshIndicesComputeShader);
+    setCellRangeUniform(meshIndicesComputeShader);
+    dispatchMeshPass(meshIndicesComputeShader, DENSITY_SIZE, DENSITY_SIZE - 1);
+
+    // the index buffer is read as GL_ELEMENT_ARRAY_BUFFER next
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+}
+
+void MarchingCubes::dispatchSurfaceNets(bool useGradients)
+{
+    // atomics only: the vertex and quad order varies from run to run, the mesh does not
+    resetVertexCounter();
+    if (useActiveCells)
+        dispatchActiveCells();
+
+    // a vertex in every crossing cell, then a quad around every crossing edge
+    glUseProgram(surfaceNetsVerticesComputeShader);
+    glUniform1i(glGetUniformLocation(surfaceNetsVerticesComputeShader, "densitySize"), DENSITY_SIZE);
+    glUniform1i(glGetUniformLocation(surfaceNetsVerticesComputeShader, "u_UseGradients"), useGradients ? 1 : 0);
+    glUniform1i(glGetUniformLocation(surfaceNetsVerticesComputeShader, "u_PackedVertices"), usePackedVertices ? 1 : 0);
+    glUniform1i(glGetUniformLocation(surfaceNetsVerticesComputeShader, "u_DualContouring"), meshMethod == MESH_DUAL_CONTOURING ? 1 : 0);
+    setDensityStorageUniforms(surfaceNetsVerticesComputeShader);
+    setCellRangeUniform(surfaceNetsVerticesComputeShader);
+    dispatchMeshPass(surfaceNetsVerticesComputeShader, DENSITY_SIZE, DENSITY_SIZE - 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    glUseProgram(surfaceNetsQuadsComputeShader);
+    glUniform1i(glGetUniformLocation(surfaceNetsQuadsComputeShader, "densitySize"), DENSITY_SIZE);
+    setDensityStorageUniforms(surfaceNetsQuadsComputeShader);
+    setCellRangeUniform(surfaceNetsQuadsComputeShader);
+    glDispatchCompute((DENSITY_SIZE + 7) / 8, (DENSITY_SIZE + 7) / 8, (DENSITY_SIZE + 7) / 8);
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+}
+
+void MarchingCubes::dispatchHeightmap()
+{
+    // 2.5D mode: terrain height once per column, read by the density pass
+    glUseProgram(heightmapComputeShader);
+    glUniform1i(glGetUniformLocation(heightmapComputeShader, "densitySize"), DENSITY_SIZE);
+    glUniform1i(glGetUniformLocation(heightmapComputeShader, "u_Seed"), seed);
+    glUniform3fv(glGetUniformLocation(heightmapComputeShader, "u_Offset"), 1, glm::value_ptr(densityOffset));
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, heightmapSSBO);
+    glDispatchCompute((DENSITY_SIZE + 7) / 8, (DENSITY_SIZE + 7) / 8, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void MarchingCubes::setCellRangeUniform(GLuint program)
+{
+    glUniform2i(glGetUniformLocation(program, "u_CellRange"), cellRange.x, cellRange.y);
+}
+
+void MarchingCubes::setRenderUniforms(Camera &camera)
+{
+    // everything but the model matrix and the vertex format
     glm::mat4 view = camera.GetViewMatrix();
     glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 1000.0f);
 
     glUseProgram(renderShader);
-    glUniformMatrix4fv(glGetUniformLocation(renderShader, "model"), 1, GL_FALSE, glm::value_ptr(model));
     glUniformMatrix4fv(glGetUniformLocation(renderShader, "view"), 1, GL_FALSE, glm::value_ptr(view));
     glUniformMatrix4fv(glGetUniformLocation(renderShader, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
 
@@ -227,18 +826,972 @@ void MarchingCubes::render(Camera camera)
     glUniform3fv(glGetUniformLocation(renderShader, "viewPos"), 1, glm::value_ptr(viewPos));
     glUniform3fv(glGetUniformLocation(renderShader, "lightColor"), 1, glm::value_ptr(lightColor));
     glUniform3fv(glGetUniformLocation(renderShader, "objectColor"), 1, glm::value_ptr(objectColor));
-
-    glBindVertexArray(VAO);
-    glDrawArrays(GL_TRIANGLES, 0, vertexCount);
-    glBindVertexArray(0);
-    // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 }
 
-void MarchingCubes::debugComputeShaderOutput()
+uint64_t MarchingCubes::densityParamHash() const
 {
-    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-
-    // Read back the vertex count
+    ParamHash hash;
+    hash.add(seed).add(caveCeiling).add(terrainMode).add(warpStride).add(zoneStride);
+    hash.add(useDensityGraph && terrainMode == TERRAIN_VOLUMETRIC).add(analyticNormalsActive());
+    hash.add(densityStorage.format).add(densityStorage.range);
+    int numCaves = (int)std::min((size_t)MAX_CAVES, caves.size());
+    hash.add(numCaves);
+    for (int i = 0; i < numCaves; ++i)
+    {
+        const Cave &cave = caves[i];
+        hash.add(cave.offset.x).add(cave.offset.y).add(cave.offset.z);
+        hash.add(cave.gain).add(cave.frequency).add(cave.zoneFrequency).add(cave.zoneThreshold);
+    }
+    return hash.value();
+}
+
+uint64_t MarchingCubes::meshParamHash() const
+{
+    ParamHash hash;
+    hash.add(densityParamHash());
+    hash.add(meshMethod).add(useIndexedMesh).add(usePackedVertices).add(useGradientPass);
+    hash.add(usePrefixSums).add(useActiveCells).add(meshExtraction);
+    // chunk builds also depend on these: which mesher runs, and what the job does to its output
+    hash.add(useChunkJobs).add(useMeshOptimization).add(useOverdrawClustering);
+    return hash.value();
+}
+
+void MarchingCubes::invalidateGeneration()
+{
+    densityCached = false;
+    meshCached = false;
+}
+
+void MarchingCubes::render(Camera camera)
+{
+    if (densityStorage.format != allocatedDensityFormat)
+    {
+        createDensitySSBO();
+    }
+    if (indexedOutput() != allocatedIndexedMesh || meshMethod != allocatedMeshMethod || usePackedVertices != allocatedPackedVertices)
+    {
+        createMeshBuffers();
+    }
+
+    if (useChunks)
+    {
+        renderChunks(camera);
+        return;
+    }
+
+    // the buffers still hold the last frame's density and mesh; rerun only what the settings changed
+    regenerationStats.frames++;
+    uint64_t densityHash = densityParamHash();
+    uint64_t meshHash = meshParamHash();
+    bool densityStale = !densityCached || densityHash != cachedDensityHash;
+    bool meshStale = densityStale || !meshCached || meshHash != cachedMeshHash;
+    if (densityStale)
+    {
+        if (terrainMode == TERRAIN_HEIGHTMAP)
+            dispatchHeightmap();
+        if (useDensityGraph && terrainMode == TERRAIN_VOLUMETRIC)
+            dispatchDensityGraph();
+        else
+            dispatchDensity();
+        densityCached = true;
+        cachedDensityHash = densityHash;
+        regenerationStats.densityRuns++;
+        // LODs of the old terrain; requested again below when in use
+        deleteLods();
+    }
+
+    if (meshStale)
+    {
+        // analytic normals are already in the gradient buffer
+        bool analyticNormals = analyticNormalsActive();
+        if (useGradientPass && !analyticNormals)
+            dispatchGradients();
+        if (meshMethod != MESH_MARCHING_CUBES)
+            dispatchSurfaceNets(useGradientPass || analyticNormals);
+        else if (useIndexedMesh)
+            dispatchIndexedMesh(useGradientPass || analyticNormals);
+        else
+            dispatchMarchingCubes(useGradientPass || analyticNormals);
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+        unsigned int counters[2] = {0, 0};
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(counters), counters);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        // the soup counter keeps counting past a full buffer
+        cachedVertexCount = std::min(counters[0], vertexCapacity);
+        cachedIndexCount = counters[1];
+
+        if (useActiveCells)
+        {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, activeCellSSBO);
+            glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 3 * sizeof(GLuint), sizeof(GLuint), &lastActiveCellStats.activeCells);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+            lastActiveCellStats.totalCells = cellCount(DENSITY_SIZE);
+        }
+        meshCached = true;
+        cachedMeshHash = meshHash;
+        regenerationStats.meshRuns++;
+    }
+    else
+    {
+        regenerationStats.skippedFrames++;
+    }
+    unsigned int vertexCount = cachedVertexCount;
+    unsigned int indexCount = cachedIndexCount;
+
+    if (lodBuild.valid() && lodBuild.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+    {
+        // a build started before the terrain last changed is dropped
+        LodBuild build = lodBuild.get();
+        if (build.densityHash == cachedDensityHash)
+            uploadLods(build);
+    }
+    if (useDistanceLod && !lodsReady() && !lodsPending())
+        requestLods();
+
+    if (vertexCount == 0)
+    {
+        std::cout << "No vertices generated. Skipping rendering." << std::endl;
+        return;
+    }
+
+    setRenderUniforms(camera);
+    glm::mat4 model = glm::mat4(1.0f);
+    glUniformMatrix4fv(glGetUniformLocation(renderShader, "model"), 1, GL_FALSE, glm::value_ptr(model));
+    glUniform1i(glGetUniformLocation(renderShader, "u_PackedVertices"), usePackedVertices ? 1 : 0);
+
+    lastLodLevel = useDistanceLod ? lodLevelFor(camera.Position) : -1;
+    if (lastLodLevel >= 0)
+    {
+        // LOD buffers always hold VertexNormal
+        const LodMesh &lod = lodMeshes[lastLodLevel];
+        glUniform1i(glGetUniformLocation(renderShader, "u_PackedVertices"), 0);
+        glBindVertexArray(lod.VAO);
+        glDrawElements(GL_TRIANGLES, lod.indexCount, GL_UNSIGNED_INT, nullptr);
+    }
+    else
+    {
+        glBindVertexArray(VAO);
+        if (indexedOutput())
+            glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, nullptr);
+        else
+            glDrawArrays(GL_TRIANGLES, 0, vertexCount);
+    }
+    glBindVertexArray(0);
+    // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+}
+
+glm::ivec2 MarchingCubes::chunkCellRange() const
+{
+    // both chunks of a shared face see the same samples, so each meshes only the cells that start
+    // inside its own [0, GRID_SIZE) columns; marching cubes cell 0 spans samples -1 to 0 and belongs to
+    // the neighbour, Surface Nets needs that cell's vertex for the quads on the face and drops the
+    // quads instead (see surfaceNetsQuads.comp.glsl)
+    return meshMethod == MESH_MARCHING_CUBES ? glm::ivec2(1, DENSITY_SIZE - 3) : glm::ivec2(0, DENSITY_SIZE - 3);
+}
+
+float MarchingCubes::chunkPriority(const glm::ivec2 &coord, const Camera &camera) const
+{
+    // nearest first, and at the same distance what the camera faces before what is behind it
+    glm::vec3 centre = chunkManager.origin(coord) + glm::vec3(GRID_SIZE * 0.5f, 0.0f, GRID_SIZE * 0.5f);
+    glm::vec2 toChunk(centre.x - camera.Position.x, centre.z - camera.Position.z);
+    glm::vec2 facing(camera.Front.x, camera.Front.z);
+    float distance = glm::length(toChunk);
+    float alignment = 0.0f;
+    if (distance > 0.001f && glm::length(facing) > 0.001f)
+        alignment = glm::dot(toChunk / distance, glm::normalize(facing));
+    return -distance * (1.5f - 0.5f * alignment);
+}
+
+size_t MarchingCubes::residentChunkBytes()
+{
+    size_t bytes = 0;
+    for (const auto &entry : chunkManager.resident())
+        bytes += entry.second.densityBytes + entry.second.meshBytes;
+    return bytes;
+}
+
+bool MarchingCubes::makeRoomForChunk(size_t bytes)
+{
+    // resident chunks first, then as much of the cache as still fits alongside them
+    size_t resident = residentChunkBytes();
+    std::vector<Chunk> evicted;
+    if (resident + bytes > chunkCache.gpuBudget)
+    {
+        chunkCache.trimGpu(0, evicted);
+        releaseChunks(evicted);
+        return false;
+    }
+    chunkCache.trimGpu(chunkCache.gpuBudget - resident - bytes, evicted);
+    releaseChunks(evicted);
+    return true;
+}
+
+void MarchingCubes::retireChunk(const Chunk &chunk)
+{
+    std::vector<Chunk> evicted;
+    size_t resident = residentChunkBytes();
+    size_t limit = resident < chunkCache.gpuBudget ? chunkCache.gpuBudget - resident : 0;
+    chunkCache.putGpu({chunk.paramHash, chunk.coord, 0}, chunk, limit, evicted);
+    releaseChunks(evicted);
+}
+
+size_t MarchingCubes::cpuCacheLimit(size_t waiting)
+{
+    {
+        std::lock_guard<std::mutex> lock(finishedChunks->mutex);
+        waiting += finishedChunks->doneBytes;
+    }
+    waiting += chunkStore->stats().queuedBytes;
+    return waiting < chunkCache.cpuBudget ? chunkCache.cpuBudget - waiting : 0;
+}
+
+bool MarchingCubes::restoreChunk(const glm::ivec2 &coord, uint64_t paramHash, int &overBudget)
+{
+    ChunkKey key{paramHash, coord, 0};
+    Chunk chunk;
+    if (chunkCache.takeGpu(key, chunk))
+    {
+        replaceChunk(chunk);
+        return true;
+    }
+    chunk.coord = coord;
+    chunk.paramHash = paramHash;
+    // the CPU tier only holds what the jobs built, the GPU path never reads its meshes back
+    const ChunkData *data = useChunkJobs ? chunkCache.findCpu(key) : nullptr;
+    if (data)
+    {
+        if (!makeRoomForChunk(data->meshBytes()))
+        {
+            deferredChunks.insert(ChunkManager::key(coord));
+            overBudget++;
+            return true;
+        }
+        uploadChunk(*data, chunk);
+        replaceChunk(chunk);
+        return true;
+    }
+    // the disk store holds what the jobs built, in this run or an earlier one, with the same settings;
+    // the GPU path uses it too
+    StoredChunk stored;
+    if (!useChunkStore || !chunkStore->isOpen() || !chunkStore->find(key, stored))
+        return false;
+    size_t vertexSize = stored.packedVertices ? sizeof(PackedVertex) : sizeof(VertexNormal);
+    if (!makeRoomForChunk(stored.vertexCount * vertexSize + stored.indexCount * sizeof(uint32_t)))
+    {
+        deferredChunks.insert(ChunkManager::key(coord));
+        overBudget++;
+        return true;
+    }
+    uploadChunk(stored, chunk);
+    replaceChunk(chunk);
+    return true;
+}
+
+void MarchingCubes::releaseChunks(std::vector<Chunk> &chunks)
+{
+    for (Chunk &chunk : chunks)
+        releaseChunk(chunk);
+    chunks.clear();
+}
+
+void MarchingCubes::updateChunks(const Camera &camera)
+{
+    ChunkStats stats;
+    chunkManager.radius = chunkRadius;
+    stats.cameraChunk = chunkManager.chunkAt(camera.Position);
+    uint64_t paramHash = meshParamHash();
+    chunkCache.gpuBudget = (size_t)chunkGpuBudgetMB << 20;
+    chunkCache.cpuBudget = (size_t)chunkCpuBudgetMB << 20;
+    chunkStore->setBudget((uint64_t)chunkStoreBudgetMB << 20);
+    if (useChunkStore && !chunkStore->isOpen() && !chunkStore->open(chunkStorePath))
+    {
+        std::cerr << "Could not open the chunk store in " << chunkStorePath << ", chunks are not kept on disk" << std::endl;
+        useChunkStore = false;
+    }
+
+    // into the cache, not released, in case the camera comes back
+    std::vector<glm::ivec2> coords;
+    chunkManager.outOfRange(stats.cameraChunk, coords);
+    for (const glm::ivec2 &coord : coords)
+    {
+        Chunk chunk = *chunkManager.find(coord);
+        chunkManager.erase(coord);
+        retireChunk(chunk);
+        stats.retired++;
+    }
+
+    // a lowered budget applies at once: the cache goes first, then the farthest resident chunks
+    chunkCache.trimCpu(cpuCacheLimit(0));
+    while (!makeRoomForChunk(0))
+    {
+        glm::ivec2 farthest = stats.cameraChunk;
+        int farthestDistance = -1;
+        for (const auto &entry : chunkManager.resident())
+        {
+            glm::ivec2 d = entry.second.coord - stats.cameraChunk;
+            if (d.x * d.x + d.y * d.y > farthestDistance)
+            {
+                farthestDistance = d.x * d.x + d.y * d.y;
+                farthest = entry.second.coord;
+            }
+        }
+        releaseChunk(*chunkManager.find(farthest));
+        chunkManager.erase(farthest);
+        stats.overBudget++;
+    }
+
+    // once something was released or the budget or settings changed, deferred chunks may fit
+    if (chunkCache.gpuBudget != deferredBudget || paramHash != deferredParamHash || residentChunkBytes() < deferredResident)
+        deferredChunks.clear();
+
+    // cached chunks come back before anything is built, stale ones too after switching settings back
+    chunkManager.missing(stats.cameraChunk, coords);
+    std::vector<glm::ivec2> unbuilt;
+    for (const glm::ivec2 &coord : coords)
+    {
+        if (deferredChunks.count(ChunkManager::key(coord)) == 0 && !restoreChunk(coord, paramHash, stats.overBudget))
+            unbuilt.push_back(coord);
+    }
+    chunkManager.stale(stats.cameraChunk, paramHash, coords);
+    std::vector<glm::ivec2> stale;
+    for (const glm::ivec2 &coord : coords)
+    {
+        if (deferredChunks.count(ChunkManager::key(coord)) == 0 && !restoreChunk(coord, paramHash, stats.overBudget))
+            stale.push_back(coord);
+    }
+    stats.stale = (int)stale.size();
+
+    // nothing is built once the next chunk of about the average size would not fit, or every frame
+    // would build and throw away the same chunks
+    size_t resident = residentChunkBytes();
+    size_t averageBytes = chunkManager.resident().empty() ? 0 : resident / chunkManager.resident().size();
+    bool roomToBuild = resident + averageBytes <= chunkCache.gpuBudget;
+    if (!roomToBuild)
+    {
+        for (const glm::ivec2 &coord : unbuilt)
+            deferredChunks.insert(ChunkManager::key(coord));
+        unbuilt.clear();
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    if (useChunkJobs)
+    {
+        stats.cancelled = chunkManager.cancelOutOfRange(stats.cameraChunk);
+
+        std::vector<ChunkBuild> done;
+        size_t waiting = 0;
+        {
+            std::lock_guard<std::mutex> lock(finishedChunks->mutex);
+            done.swap(finishedChunks->done);
+            std::swap(waiting, finishedChunks->doneBytes);
+        }
+        for (ChunkBuild &build : done)
+        {
+            waiting -= build.data.bytes();
+            if (!chunkManager.finishBuilding(build.coord, build.token))
+                continue;
+            ChunkKey key{build.paramHash, build.coord, 0};
+            if (makeRoomForChunk(build.data.meshBytes()))
+            {
+                Chunk chunk;
+                chunk.coord = build.coord;
+                chunk.paramHash = build.paramHash;
+                uploadChunk(build.data, chunk);
+                replaceChunk(chunk);
+                stats.generated++;
+            }
+            else
+            {
+                stats.overBudget++;
+            }
+            chunkCache.putCpu(key, std::move(build.data), cpuCacheLimit(waiting));
+        }
+
+        // the camera may have moved or turned since the queued builds were submitted
+        jobs.reprioritize([&](uint64_t tag, float)
+                          { return chunkPriority(ChunkManager::tagCoord(tag), camera); });
+        for (const glm::ivec2 &coord : unbuilt)
+            submitChunkBuild(coord, chunkPriority(coord, camera));
+        // rebuilt after a settings change; the old mesh is drawn until the new one is uploaded
+        for (const glm::ivec2 &coord : stale)
+            submitChunkBuild(coord, chunkPriority(coord, camera));
+        stats.pending = chunkManager.buildingCount();
+    }
+    else
+    {
+        // a few per frame so crossing into a new row does not stall; the rest follow on later frames.
+        // missing chunks before stale ones, which at least have something to draw
+        unbuilt.insert(unbuilt.end(), stale.begin(), stale.end());
+        for (const glm::ivec2 &coord : unbuilt)
+        {
+            if (stats.generated == chunksPerFrame)
+                break;
+            Chunk chunk;
+            chunk.coord = coord;
+            // whatever does not fit now, the chunks after it most likely do not either
+            if (!generateChunk(chunk))
+            {
+                stats.overBudget++;
+                break;
+            }
+            stats.generated++;
+            replaceChunk(chunk);
+        }
+        stats.pending = (int)unbuilt.size() - stats.generated;
+    }
+    stats.generateMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    for (const auto &entry : chunkManager.resident())
+    {
+        stats.densityBytes += entry.second.densityBytes;
+        stats.meshBytes += entry.second.meshBytes;
+    }
+    stats.resident = (int)chunkManager.resident().size();
+    stats.deferred = (int)deferredChunks.size();
+    lastChunkStats = stats;
+    deferredBudget = chunkCache.gpuBudget;
+    deferredParamHash = paramHash;
+    deferredResident = residentChunkBytes();
+}
+
+void MarchingCubes::submitChunkBuild(const glm::ivec2 &coord, float priority)
+{
+    // the job gets copies of everything it reads, as the LOD build does. one thread per chunk: the
+    // pool already runs as many chunks as it has workers
+    int numCaves = (int)std::min((size_t)MAX_CAVES, caves.size());
+    std::vector<Cave> activeCaves(caves.begin(), caves.begin() + numCaves);
+    DensityGenerator generator = densityGenerator;
+    generator.terrainMode = terrainMode;
+    generator.warpStride = warpStride;
+    generator.zoneStride = zoneStride;
+    generator.walls = false;
+    generator.threadCount = 1;
+    std::shared_ptr<DensityGraph> graph;
+    if (useDensityGraph && terrainMode == TERRAIN_VOLUMETRIC)
+        graph = std::make_shared<DensityGraph>(compiledTerrainGraph());
+    CpuMesher mesher = cpuMesher;
+    mesher.threadCount = 1;
+    mesher.cellRange = chunkCellRange();
+    DensityStorage storage = densityStorage;
+    glm::vec3 origin = chunkManager.origin(coord);
+    int chunkSeed = seed;
+    float ceiling = caveCeiling;
+    MeshMethod method = meshMethod;
+    bool indexed = indexedOutput();
+    bool packed = usePackedVertices;
+    bool optimize = useMeshOptimization;
+    bool reduceOverdraw = useOverdrawClustering;
+    std::shared_ptr<ChunkBuildQueue> queue = finishedChunks;
+    std::shared_ptr<ChunkStore> store = useChunkStore && chunkStore->isOpen() ? chunkStore : nullptr;
+    uint64_t paramHash = meshParamHash();
+
+    CancellationToken token;
+    chunkManager.markBuilding(coord, token);
+    jobs.submit([coord, token, paramHash, activeCaves, generator, graph, mesher, storage, origin, chunkSeed, ceiling, method, indexed, packed, optimize, reduceOverdraw, queue, store]()
+                {
+        ChunkBuild build;
+        build.coord = coord;
+        build.token = token;
+        build.paramHash = paramHash;
+        ChunkData &data = build.data;
+
+        std::vector<float> density;
+        if (graph)
+            graph->evaluate(chunkSeed, origin, DENSITY_SIZE, 1, density, false);
+        else
+            generator.generate(chunkSeed, activeCaves, ceiling, origin, density);
+        // kept in the storage format, and meshed as the GPU path would mesh it
+        storage.encode(density, DENSITY_SIZE, data.densityWords);
+        if (storage.format != DENSITY_FLOAT32)
+            storage.decode(data.densityWords, DENSITY_SIZE, density);
+        if (token.cancelled())
+            return;
+
+        std::vector<glm::vec3> gradients;
+        mesher.computeGradients(density, gradients);
+        if (method != MESH_MARCHING_CUBES)
+            mesher.meshSurfaceNets(density, &gradients, method == MESH_DUAL_CONTOURING, data.vertices, data.indices);
+        else if (indexed)
+            mesher.meshIndexed(density, &gradients, data.vertices, data.indices);
+        else
+            mesher.mesh(density, &gradients, data.vertices);
+        if (token.cancelled())
+            return;
+
+        if (optimize && !data.indices.empty())
+            MeshOptimizer::optimize(data.vertices, data.indices, reduceOverdraw);
+        data.packedVertices = packed;
+        if (packed)
+        {
+            data.packed.reserve(data.vertices.size());
+            for (const VertexNormal &vertex : data.vertices)
+                data.packed.push_back(packVertex(vertex));
+            data.vertices = std::vector<VertexNormal>();
+        }
+        // copied into the store's write queue; its writer thread waits on the disk, not this job or the upload
+        if (store)
+            store->enqueue({paramHash, coord, 0}, data);
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->doneBytes += data.bytes();
+        queue->done.push_back(std::move(build)); },
+                priority, token, ChunkManager::jobTag(coord));
+}
+
+void MarchingCubes::uploadChunk(const ChunkData &data, Chunk &chunk)
+{
+    if (data.packedVertices)
+        uploadChunkMesh(true, data.packed.data(), data.packed.size(), data.indices.data(), data.indices.size(), chunk);
+    else
+        uploadChunkMesh(false, data.vertices.data(), data.vertices.size(), data.indices.data(), data.indices.size(), chunk);
+}
+
+void MarchingCubes::uploadChunk(const StoredChunk &stored, Chunk &chunk)
+{
+    // straight from the mapping, the pages are read in as glBufferData copies them
+    uploadChunkMesh(stored.packedVertices, stored.vertices, stored.vertexCount, stored.indices, stored.indexCount, chunk);
+}
+
+void MarchingCubes::uploadChunkMesh(bool packedVertices, const void *vertices, size_t vertexCount, const uint32_t *indices, size_t indexCount, Chunk &chunk)
+{
+    chunk.packedVertices = packedVertices;
+    chunk.vertexCount = (GLsizei)vertexCount;
+    chunk.indexCount = (GLsizei)indexCount;
+    if (chunk.vertexCount == 0)
+        return;
+
+    size_t vertexBytes = vertexCount * (packedVertices ? sizeof(PackedVertex) : sizeof(VertexNormal));
+    glGenVertexArrays(1, &chunk.VAO);
+    glGenBuffers(1, &chunk.vertexBuffer);
+    glBindVertexArray(chunk.VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, chunk.vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, vertexBytes, vertices, GL_STATIC_DRAW);
+    setVertexLayout(chunk.packedVertices);
+    if (chunk.indexCount > 0)
+    {
+        glGenBuffers(1, &chunk.indexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, chunk.indexBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(uint32_t), indices, GL_STATIC_DRAW);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    chunk.meshBytes = vertexBytes + indexCount * sizeof(uint32_t);
+}
+
+bool MarchingCubes::generateChunk(Chunk &chunk)
+{
+    // the chunk's density goes into its own buffer, put in densitySSBO's place for the passes. room
+    // is made before each allocation, the density's here and the mesh's once its size is known
+    size_t densityBytes = densityStorage.byteSize(DENSITY_SIZE);
+    if (chunk.densityBytes != densityBytes && !makeRoomForChunk(densityBytes))
+        return false;
+    if (chunk.densityBuffer == 0)
+        glGenBuffers(1, &chunk.densityBuffer);
+    if (chunk.densityBytes != densityBytes)
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, chunk.densityBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, densityBytes, nullptr, GL_DYNAMIC_DRAW);
+        chunk.densityBytes = densityBytes;
+    }
+    GLuint savedDensitySSBO = densitySSBO;
+    densitySSBO = chunk.densityBuffer;
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, densitySSBO);
+
+    // no walls, neighbours continue the terrain
+    densityOffset = chunkManager.origin(chunk.coord);
+    densityWalls = false;
+    cellRange = chunkCellRange();
+
+    if (terrainMode == TERRAIN_HEIGHTMAP)
+        dispatchHeightmap();
+    if (useDensityGraph && terrainMode == TERRAIN_VOLUMETRIC)
+        dispatchDensityGraph();
+    else
+        dispatchDensity();
+    bool analyticNormals = analyticNormalsActive();
+    if (useGradientPass && !analyticNormals)
+        dispatchGradients();
+    if (meshMethod != MESH_MARCHING_CUBES)
+        dispatchSurfaceNets(useGradientPass || analyticNormals);
+    else if (useIndexedMesh)
+        dispatchIndexedMesh(useGradientPass || analyticNormals);
+    else
+        dispatchMarchingCubes(useGradientPass || analyticNormals);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+    unsigned int counters[2] = {0, 0};
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(counters), counters);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    chunk.vertexCount = (GLsizei)std::min(counters[0], vertexCapacity);
+    chunk.indexCount = indexedOutput() ? (GLsizei)counters[1] : 0;
+    chunk.packedVertices = usePackedVertices;
+    chunk.paramHash = meshParamHash();
+    // the shared buffers now hold this chunk
+    invalidateGeneration();
+
+    densityOffset = glm::vec3(0.0f);
+    densityWalls = true;
+    cellRange = glm::ivec2(0);
+    densitySSBO = savedDensitySSBO;
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, densitySSBO);
+
+    // the shared mesh buffers are reused by the next chunk, so the mesh is copied out at its exact size
+    if (chunk.vertexCount == 0)
+        return true;
+    size_t vertexBytes = (size_t)chunk.vertexCount * vertexStride();
+    size_t indexBytes = (size_t)chunk.indexCount * sizeof(GLuint);
+    if (!makeRoomForChunk(chunk.densityBytes + vertexBytes + indexBytes))
+    {
+        releaseChunk(chunk);
+        return false;
+    }
+    glGenVertexArrays(1, &chunk.VAO);
+    glGenBuffers(1, &chunk.vertexBuffer);
+    glBindBuffer(GL_COPY_READ_BUFFER, vertexSSBO);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, chunk.vertexBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, vertexBytes, nullptr, GL_STATIC_DRAW);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, vertexBytes);
+    if (chunk.indexCount > 0)
+    {
+        glGenBuffers(1, &chunk.indexBuffer);
+        glBindBuffer(GL_COPY_READ_BUFFER, indexSSBO);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, chunk.indexBuffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, indexBytes, nullptr, GL_STATIC_DRAW);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, indexBytes);
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    chunk.meshBytes = vertexBytes + indexBytes;
+
+    glBindVertexArray(chunk.VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, chunk.vertexBuffer);
+    setVertexLayout(chunk.packedVertices);
+    if (chunk.indexBuffer != 0)
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, chunk.indexBuffer);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return true;
+}
+
+void MarchingCubes::replaceChunk(const Chunk &chunk)
+{
+    // the copy built with the old settings is cached, for switching back
+    Chunk *old = chunkManager.find(chunk.coord);
+    if (old)
+    {
+        Chunk previous = *old;
+        chunkManager.erase(chunk.coord);
+        chunkManager.insert(chunk);
+        retireChunk(previous);
+        return;
+    }
+    chunkManager.insert(chunk);
+}
+
+void MarchingCubes::releaseChunk(Chunk &chunk)
+{
+    glDeleteVertexArrays(1, &chunk.VAO);
+    glDeleteBuffers(1, &chunk.vertexBuffer);
+    glDeleteBuffers(1, &chunk.indexBuffer);
+    glDeleteBuffers(1, &chunk.densityBuffer);
+    chunk = Chunk{chunk.coord};
+}
+
+void MarchingCubes::clearChunks()
+{
+    // builds still on the pool finish or are skipped, and their results are dropped as cancelled
+    chunkManager.cancelAll();
+    for (auto &entry : chunkManager.resident())
+        releaseChunk(entry.second);
+    chunkManager.resident().clear();
+    std::vector<Chunk> cached;
+    chunkCache.clearGpu(cached);
+    releaseChunks(cached);
+    chunkCache.clearCpu();
+    deferredChunks.clear();
+    lastChunkStats = ChunkStats();
+}
+
+void MarchingCubes::renderChunks(Camera &camera)
+{
+    updateChunks(camera);
+
+    setRenderUniforms(camera);
+    GLint modelLocation = glGetUniformLocation(renderShader, "model");
+    GLint packedLocation = glGetUniformLocation(renderShader, "u_PackedVertices");
+    for (const auto &entry : chunkManager.resident())
+    {
+        const Chunk &chunk = entry.second;
+        if (chunk.vertexCount == 0)
+            continue;
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), chunkManager.origin(chunk.coord));
+        glUniformMatrix4fv(modelLocation, 1, GL_FALSE, glm::value_ptr(model));
+        glUniform1i(packedLocation, chunk.packedVertices ? 1 : 0);
+        glBindVertexArray(chunk.VAO);
+        if (chunk.indexCount > 0)
+        {
+            glDrawElements(GL_TRIANGLES, chunk.indexCount, GL_UNSIGNED_INT, nullptr);
+            lastChunkStats.triangles += chunk.indexCount / 3;
+        }
+        else
+        {
+            glDrawArrays(GL_TRIANGLES, 0, chunk.vertexCount);
+            lastChunkStats.triangles += chunk.vertexCount / 3;
+        }
+    }
+    glBindVertexArray(0);
+}
+
+void MarchingCubes::requestLods()
+{
+    // one build at a time; render picks the finished one up
+    if (lodBuild.valid())
+        return;
+
+    std::vector<uint32_t> words(densityStorage.wordCount(DENSITY_SIZE));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, densitySSBO);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, densityStorage.byteSize(DENSITY_SIZE), words.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // the worker gets copies of everything it reads, so the settings can change while it runs
+    DensityStorage storage = densityStorage;
+    CpuMesher mesher = cpuMesher;
+    MeshMethod method = meshMethod;
+    bool optimize = useMeshOptimization;
+    bool reduceOverdraw = useOverdrawClustering;
+    // render drops the result if the terrain changes before it is done; 0 when the buffer was overwritten
+    uint64_t densityHash = densityCached ? cachedDensityHash : 0;
+    auto task = std::make_shared<std::packaged_task<LodBuild()>>([words = std::move(words), storage, mesher, method, optimize, reduceOverdraw, densityHash]()
+                                                                 {
+        LodBuild build;
+        build.densityHash = densityHash;
+        std::vector<float> density;
+        storage.decode(words, DENSITY_SIZE, density);
+        std::vector<glm::vec3> gradients;
+        mesher.computeGradients(density, gradients);
+        std::vector<VertexNormal> vertices;
+        std::vector<uint32_t> indices;
+        if (method == MESH_MARCHING_CUBES)
+            mesher.meshIndexed(density, &gradients, vertices, indices);
+        else
+            mesher.meshSurfaceNets(density, &gradients, method == MESH_DUAL_CONTOURING, vertices, indices);
+        build.sourceTriangles = indices.size() / 3;
+
+        if (!vertices.empty())
+        {
+            build.boundsMin = build.boundsMax = glm::vec3(vertices[0].position);
+            for (const VertexNormal &vertex : vertices)
+            {
+                build.boundsMin = glm::min(build.boundsMin, glm::vec3(vertex.position));
+                build.boundsMax = glm::max(build.boundsMax, glm::vec3(vertex.position));
+            }
+        }
+
+        // the walls and floor outside the [0, GRID_SIZE] core are where a neighbouring chunk would join
+        MeshSimplifier::Options options;
+        options.lockOutsideMin = glm::vec3(0.0f);
+        options.lockOutsideMax = glm::vec3((float)GRID_SIZE);
+        for (float error : LOD_ERRORS)
+        {
+            options.targetError = error;
+            build.vertices.emplace_back();
+            build.indices.emplace_back();
+            build.stats.push_back(MeshSimplifier::simplify(vertices, indices, options, build.vertices.back(), build.indices.back()));
+            build.measuredErrors.push_back(MeshSimplifier::maxSurfaceDistance(vertices, build.vertices.back(), build.indices.back(), 2.0f * error + 1.0f));
+            if (optimize)
+                MeshOptimizer::optimize(build.vertices.back(), build.indices.back(), reduceOverdraw);
+        }
+        return build; });
+    lodBuild = task->get_future();
+    // ahead of every chunk build, whose priorities are negative distances
+    jobs.submit([task]()
+                { (*task)(); },
+                1.0f);
+}
+
+void MarchingCubes::uploadLods(LodBuild &build)
+{
+    deleteLods();
+    LodReport report;
+    report.ran = true;
+    report.sourceTriangles = build.sourceTriangles;
+    for (size_t level = 0; level < build.vertices.size(); ++level)
+    {
+        LodMesh lod;
+        lod.targetError = LOD_ERRORS[level];
+        lod.indexCount = (GLsizei)build.indices[level].size();
+        glGenVertexArrays(1, &lod.VAO);
+        glGenBuffers(1, &lod.vertexBuffer);
+        glGenBuffers(1, &lod.indexBuffer);
+        glBindVertexArray(lod.VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, lod.vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, build.vertices[level].size() * sizeof(VertexNormal), build.vertices[level].data(), GL_STATIC_DRAW);
+        setVertexLayout(false);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, lod.indexBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, build.indices[level].size() * sizeof(uint32_t), build.indices[level].data(), GL_STATIC_DRAW);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        lodMeshes.push_back(lod);
+
+        LodLevelReport levelReport;
+        levelReport.targetError = lod.targetError;
+        levelReport.stats = build.stats[level];
+        levelReport.measuredError = build.measuredErrors[level];
+        levelReport.cache = MeshOptimizer::analyze(build.indices[level], build.vertices[level].size());
+        report.levels.push_back(levelReport);
+        std::cout << "LOD " << level << " (error " << lod.targetError << "): " << build.sourceTriangles << " -> "
+                  << levelReport.stats.outputTriangles << " triangles, measured error " << levelReport.measuredError
+                  << ", " << levelReport.stats.milliseconds << " ms, ACMR " << levelReport.cache.acmr << ", ATVR "
+                  << levelReport.cache.atvr << std::endl;
+    }
+    lodBoundsMin = build.boundsMin;
+    lodBoundsMax = build.boundsMax;
+    lastLodReport = report;
+}
+
+void MarchingCubes::deleteLods()
+{
+    for (LodMesh &lod : lodMeshes)
+    {
+        glDeleteVertexArrays(1, &lod.VAO);
+        glDeleteBuffers(1, &lod.vertexBuffer);
+        glDeleteBuffers(1, &lod.indexBuffer);
+    }
+    lodMeshes.clear();
+}
+
+int MarchingCubes::lodLevelFor(const glm::vec3 &viewPos) const
+{
+    // distance to the mesh bounds, so the level only drops once the nearest part of the terrain is far
+    if (lodMeshes.empty())
+        return -1;
+    glm::vec3 nearest = glm::clamp(viewPos, lodBoundsMin, lodBoundsMax);
+    float distance = glm::length(viewPos - nearest);
+    if (distance < lodDistance)
+        return -1;
+    int level = (int)std::floor(std::log2(distance / lodDistance));
+    return std::min(level, (int)lodMeshes.size() - 1);
+}
+
+bool MarchingCubes::measureDecimation()
+{
+    std::vector<float> density;
+    generateCpuDensity(DENSITY_SIZE, density);
+    std::vector<glm::vec3> gradients;
+    std::vector<VertexNormal> vertices;
+    std::vector<uint32_t> indices;
+    cpuMesher.computeGradients(density, gradients);
+    cpuMesher.meshIndexed(density, &gradients, vertices, indices);
+    size_t triangles = indices.size() / 3;
+
+    // error bounds alone, then triangle budgets with no error limit
+    std::vector<std::pair<float, size_t>> targets = {{0.1f, 0}, {0.25f, 0}, {0.5f, 0}, {1.0f, 0}, {2.0f, 0}};
+    targets.push_back({(float)GRID_SIZE, triangles * 3 / 4});
+    targets.push_back({(float)GRID_SIZE, triangles * 2 / 3});
+
+    std::vector<DecimationResult> results;
+    bool passed = true;
+    std::vector<VertexNormal> outVertices;
+    std::vector<uint32_t> outIndices;
+    for (const auto &target : targets)
+    {
+        MeshSimplifier::Options options;
+        options.targetError = target.first;
+        options.targetTriangles = target.second;
+        options.lockOutsideMin = glm::vec3(0.0f);
+        options.lockOutsideMax = glm::vec3((float)GRID_SIZE);
+
+        DecimationResult result;
+        result.targetError = target.first;
+        result.targetTriangles = target.second;
+        result.stats = MeshSimplifier::simplify(vertices, indices, options, outVertices, outIndices);
+        result.measuredError = MeshSimplifier::maxSurfaceDistance(vertices, outVertices, outIndices, 2.0f * result.stats.maxError + 1.0f);
+        result.withinBound = result.measuredError <= result.stats.maxError + 1e-4f;
+        passed = passed && result.withinBound;
+        results.push_back(result);
+
+        std::cout << "Decimation ";
+        if (target.second > 0)
+            std::cout << "to " << target.second << " triangles";
+        else
+            std::cout << "at error " << target.first;
+        std::cout << ": " << triangles << " -> " << result.stats.outputTriangles << " triangles (" << result.stats.lockedVertices
+                  << " locked vertices), max collapse error " << result.stats.maxError << ", measured " << result.measuredError
+                  << (result.withinBound ? "" : " OVER BOUND") << ", " << result.stats.milliseconds << " ms, "
+                  << result.stats.trianglesRemovedPerMs() << " triangles/ms" << std::endl;
+    }
+    lastDecimationResults = results;
+    return passed;
+}
+
+void MarchingCubes::measureMeshOptimization()
+{
+    MeshOptimizationReport report;
+    report.ran = true;
+    std::vector<VertexNormal> vertices;
+    std::vector<uint32_t> indices;
+    if (allocatedIndexedMesh)
+    {
+        // what render drew last frame, in the order the atomics handed out
+        report.fromGpu = true;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+        unsigned int counters[2] = {0, 0};
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(counters), counters);
+        readVertices(std::min(counters[0], vertexCapacity), vertices);
+        indices.resize(counters[1]);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, indexSSBO);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, indices.size() * sizeof(uint32_t), indices.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+    else
+    {
+        std::vector<float> density;
+        std::vector<glm::vec3> gradients;
+        generateCpuDensity(DENSITY_SIZE, density);
+        cpuMesher.computeGradients(density, gradients);
+        cpuMesher.meshIndexed(density, &gradients, vertices, indices);
+    }
+    report.vertices = (unsigned int)vertices.size();
+    report.triangles = (unsigned int)(indices.size() / 3);
+
+    auto addStage = [&](const char *name, double milliseconds)
+    {
+        MeshOptimizationStage stage;
+        stage.name = name;
+        stage.cache = MeshOptimizer::analyze(indices, vertices.size());
+        stage.milliseconds = milliseconds;
+        report.stages.push_back(stage);
+    };
+    auto elapsedMs = [](std::chrono::steady_clock::time_point start)
+    { return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(); };
+
+    addStage(report.fromGpu ? "GPU order" : "CPU cell order", 0.0);
+    std::vector<uint32_t> clusterStarts;
+    auto start = std::chrono::steady_clock::now();
+    MeshOptimizer::optimizeVertexCache(indices, vertices.size(), &clusterStarts);
+    addStage("vertex cache", elapsedMs(start));
+    start = std::chrono::steady_clock::now();
+    MeshOptimizer::optimizeOverdraw(indices, vertices, clusterStarts);
+    addStage("overdraw clusters", elapsedMs(start));
+    start = std::chrono::steady_clock::now();
+    MeshOptimizer::optimizeVertexFetch(vertices, indices);
+    addStage("vertex fetch", elapsedMs(start));
+    lastMeshOptimizationReport = report;
+
+    std::cout << "Mesh optimization on " << report.vertices << " vertices / " << report.triangles << " triangles ("
+              << (report.fromGpu ? "GPU" : "CPU") << " mesh), FIFO cache of " << MeshOptimizer::CACHE_SIZE << ":" << std::endl;
+    for (const MeshOptimizationStage &stage : report.stages)
+    {
+        std::cout << "  " << stage.name << ": ACMR " << stage.cache.acmr << ", ATVR " << stage.cache.atvr << ", overfetch "
+                  << stage.cache.overfetch << ", " << stage.milliseconds << " ms" << std::endl;
+    }
+}
+
+void MarchingCubes::debugComputeShaderOutput()
+{
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // Read back the vertex count
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
     unsigned int vertexCount = 0;
     glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(unsigned int), &vertexCount);
@@ -272,8 +1825,969 @@ void MarchingCubes::debugComputeShaderOutput()
 }
 void MarchingCubes::resetVertexCounter()
 {
-    unsigned int zero = 0;
+    unsigned int zeros[2] = {0, 0};
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(zeros), zeros);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void MarchingCubes::resetCaveStats()
+{
+    unsigned int zeros[3] = {0, 0, 0};
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, caveStatsBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(zeros), zeros);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, caveStatsBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void MarchingCubes::readCaveStats(int numCaves)
+{
+    unsigned int counts[3] = {0, 0, 0};
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, caveStatsBuffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(counts), counts);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    lastCaveStats.caveNoiseSkipped = counts[0];
+    lastCaveStats.zoneNoiseSkipped = counts[1];
+    lastCaveStats.tilesSkipped = counts[2];
+    lastCaveStats.evaluations = (unsigned long long)DENSITY_SIZE * DENSITY_SIZE * DENSITY_SIZE * numCaves;
+}
+
+bool MarchingCubes::compareCpuDensity(float tolerance)
+{
+    // compares the last GPU density dispatch against the CPU generator for the same parameters
+    int totalElements = DENSITY_SIZE * DENSITY_SIZE * DENSITY_SIZE;
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    std::vector<uint32_t> gpuWords(densityStorage.wordCount(DENSITY_SIZE));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, densitySSBO);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, densityStorage.byteSize(DENSITY_SIZE), gpuWords.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    std::vector<float> gpuDensity;
+    densityStorage.decode(gpuWords, DENSITY_SIZE, gpuDensity);
+
+    int numCaves = (int)std::min((size_t)MAX_CAVES, caves.size());
+    std::vector<Cave> activeCaves(caves.begin(), caves.begin() + numCaves);
+
+    std::vector<float> cpuDensity;
+    densityGenerator.terrainMode = terrainMode;
+    densityGenerator.warpStride = warpStride;
+    densityGenerator.zoneStride = zoneStride;
+    auto start = std::chrono::steady_clock::now();
+    CaveSkipStats cpuStats;
+    bool graphKernel = useDensityGraph && terrainMode == TERRAIN_VOLUMETRIC;
+    if (graphKernel)
+        compiledTerrainGraph().evaluate(seed, glm::vec3(0.0f), DENSITY_SIZE, densityGenerator.threadCount, cpuDensity);
+    else
+        densityGenerator.generate(seed, activeCaves, caveCeiling, glm::vec3(0.0f), cpuDensity, &cpuStats);
+    auto end = std::chrono::steady_clock::now();
+
+    DensityComparison result;
+    result.ran = true;
+    result.cpuMilliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+
+    // quantized formats: compare against the CPU result stored the same way, allowing one int16 step
+    // for samples that land on different sides of a rounding boundary
+    float step = densityStorage.format == DENSITY_INT16 ? 1.0f / densityStorage.scale() : 0.0f;
+
+    double errorSum = 0.0;
+    for (int i = 0; i < totalElements; ++i)
+    {
+        float error = std::fabs(gpuDensity[i] - densityStorage.quantize(cpuDensity[i]));
+        errorSum += error;
+        result.maxError = std::max(result.maxError, error);
+        // relative for large magnitudes, absolute near the surface where it matters for meshing
+        if (error > tolerance * std::max(1.0f, std::fabs(gpuDensity[i])) + step)
+            result.mismatches++;
+    }
+    result.meanError = (float)(errorSum / totalElements);
+    result.passed = result.mismatches == 0;
+    lastDensityComparison = result;
+
+    std::cout << "CPU density " << (result.passed ? "matches" : "DIFFERS FROM") << " GPU density: "
+              << "max error " << result.maxError << ", mean error " << result.meanError
+              << ", " << result.mismatches << " samples over tolerance, CPU time "
+              << result.cpuMilliseconds << " ms" << std::endl;
+    if (!graphKernel)
+        std::cout << "CPU cave noise skipped " << cpuStats.caveNoiseSkipped << "/" << cpuStats.evaluations
+              << ", zone noise skipped " << cpuStats.zoneNoiseSkipped << "/" << cpuStats.evaluations << std::endl;
+
+    return result.passed;
+}
+
+void MarchingCubes::measureCoarseSamplingError()
+{
+    int numCaves = (int)std::min((size_t)MAX_CAVES, caves.size());
+    std::vector<Cave> activeCaves(caves.begin(), caves.begin() + numCaves);
+
+    DensityGenerator generator = densityGenerator;
+    generator.terrainMode = terrainMode;
+
+    std::vector<float> fullDensity;
+    generator.warpStride = 1;
+    generator.zoneStride = 1;
+    auto start = std::chrono::steady_clock::now();
+    generator.generate(seed, activeCaves, caveCeiling, glm::vec3(0.0f), fullDensity);
+    auto mid = std::chrono::steady_clock::now();
+
+    std::vector<float> coarseDensity;
+    generator.warpStride = warpStride;
+    generator.zoneStride = zoneStride;
+    generator.generate(seed, activeCaves, caveCeiling, glm::vec3(0.0f), coarseDensity);
+    auto end = std::chrono::steady_clock::now();
+
+    CoarseSamplingReport report;
+    report.ran = true;
+    report.warpStride = warpStride;
+    report.zoneStride = zoneStride;
+    report.fullMilliseconds = std::chrono::duration<double, std::milli>(mid - start).count();
+    report.coarseMilliseconds = std::chrono::duration<double, std::milli>(end - mid).count();
+
+    double errorSum = 0.0;
+    for (size_t i = 0; i < fullDensity.size(); ++i)
+    {
+        float error = std::fabs(coarseDensity[i] - fullDensity[i]);
+        errorSum += error;
+        report.maxError = std::max(report.maxError, error);
+        if ((coarseDensity[i] > 0.0f) != (fullDensity[i] > 0.0f))
+            report.signFlips++;
+    }
+    report.meanError = (float)(errorSum / fullDensity.size());
+    lastCoarseReport = report;
+
+    std::cout << "Coarse sampling (warp every " << warpStride << ", zone every " << zoneStride << " voxels): "
+              << "max error " << report.maxError << ", mean error " << report.meanError
+              << ", " << report.signFlips << " sign flips, " << report.coarseMilliseconds << " ms vs "
+              << report.fullMilliseconds << " ms full rate" << std::endl;
+}
+
+// vertex position along an edge, same rules as interpolateVertex in marchingCube.comp.glsl
+static float edgeCrossing(float val1, float val2)
+{
+    if (std::fabs(val1) < 0.00001f)
+        return 0.0f;
+    if (std::fabs(val2) < 0.00001f)
+        return 1.0f;
+    if (std::fabs(val1 - val2) < 0.00001f)
+        return 0.0f;
+    return std::max(0.0f, std::min(-val1 / (val2 - val1), 1.0f));
+}
+
+void MarchingCubes::measureDensityQuantization()
+{
+    int numCaves = (int)std::min((size_t)MAX_CAVES, caves.size());
+    std::vector<Cave> activeCaves(caves.begin(), caves.begin() + numCaves);
+
+    DensityGenerator generator = densityGenerator;
+    generator.terrainMode = terrainMode;
+    generator.warpStride = warpStride;
+    generator.zoneStride = zoneStride;
+
+    std::vector<float> density;
+    generator.generate(seed, activeCaves, caveCeiling, glm::vec3(0.0f), density);
+
+    std::vector<uint32_t> words;
+    std::vector<float> quantized;
+    densityStorage.encode(density, DENSITY_SIZE, words);
+    densityStorage.decode(words, DENSITY_SIZE, quantized);
+
+    QuantizationReport report;
+    report.ran = true;
+    report.format = densityStorage.format;
+    report.floatBytes = density.size() * sizeof(float);
+    report.storedBytes = words.size() * sizeof(uint32_t);
+
+    for (size_t i = 0; i < density.size(); ++i)
+    {
+        if (std::fabs(density[i]) < 1.0f)
+            report.maxDensityError = std::max(report.maxDensityError, std::fabs(quantized[i] - density[i]));
+    }
+
+    const int ds = DENSITY_SIZE;
+    auto index = [ds](int x, int y, int z)
+    { return x + y * ds + z * ds * ds; };
+
+    // every cell edge the mesher can place a vertex on: each sample's +x, +y and +z edge
+    double errorSum = 0.0;
+    for (int z = 0; z < ds; ++z)
+    {
+        for (int y = 0; y < ds; ++y)
+        {
+            for (int x = 0; x < ds; ++x)
+            {
+                int i = index(x, y, z);
+                int neighbours[3] = {x + 1 < ds ? index(x + 1, y, z) : -1,
+                                     y + 1 < ds ? index(x, y + 1, z) : -1,
+                                     z + 1 < ds ? index(x, y, z + 1) : -1};
+                for (int j : neighbours)
+                {
+                    if (j < 0 || (density[i] < 0.0f) == (density[j] < 0.0f))
+                        continue;
+                    float error = std::fabs(edgeCrossing(quantized[i], quantized[j]) - edgeCrossing(density[i], density[j]));
+                    errorSum += error;
+                    report.maxVertexError = std::max(report.maxVertexError, error);
+                    report.crossingEdges++;
+                }
+
+                if (x + 1 < ds && y + 1 < ds && z + 1 < ds)
+                {
+                    int corners[8] = {i, index(x + 1, y, z), index(x + 1, y + 1, z), index(x, y + 1, z),
+                                      index(x, y, z + 1), index(x + 1, y, z + 1), index(x + 1, y + 1, z + 1), index(x, y + 1, z + 1)};
+                    int cubeFloat = 0;
+                    int cubeQuantized = 0;
+                    for (int c = 0; c < 8; ++c)
+                    {
+                        cubeFloat |= density[corners[c]] < 0.0f ? 1 << c : 0;
+                        cubeQuantized |= quantized[corners[c]] < 0.0f ? 1 << c : 0;
+                    }
+                    if (cubeFloat != cubeQuantized)
+                        report.changedCubes++;
+                }
+            }
+        }
+    }
+    report.meanVertexError = report.crossingEdges > 0 ? (float)(errorSum / report.crossingEdges) : 0.0f;
+    lastQuantizationReport = report;
+
+    static const char *formatNames[] = {"float32", "fp16", "int16"};
+    std::cout << "Density storage " << formatNames[report.format] << ": " << report.storedBytes << " bytes vs "
+              << report.floatBytes << " float32, surface density error " << report.maxDensityError
+              << ", vertex error max " << report.maxVertexError << " mean " << report.meanVertexError
+              << " voxels over " << report.crossingEdges << " edges, " << report.changedCubes
+              << " cube indices changed" << std::endl;
+}
+
+void MarchingCubes::benchmarkMeshing(int iterations)
+{
+    invalidateGeneration();
+    // the last density dispatch is meshed repeatedly, so run this after a frame has rendered
+    MeshingBenchmark result;
+    result.ran = true;
+    result.iterations = iterations;
+
+    GLuint queries[3];
+    glGenQueries(3, queries);
+    GLuint64 centralNs = 0;
+    GLuint64 gradientPassNs = 0;
+    GLuint64 gradientMeshNs = 0;
+    for (int i = 0; i < iterations; ++i)
+    {
+        glBeginQuery(GL_TIME_ELAPSED, queries[0]);
+        dispatchMarchingCubes(false);
+        glEndQuery(GL_TIME_ELAPSED);
+
+        glBeginQuery(GL_TIME_ELAPSED, queries[1]);
+        dispatchGradients();
+        glEndQuery(GL_TIME_ELAPSED);
+
+        glBeginQuery(GL_TIME_ELAPSED, queries[2]);
+        dispatchMarchingCubes(true);
+        glEndQuery(GL_TIME_ELAPSED);
+
+        GLuint64 elapsed[3] = {0, 0, 0};
+        for (int q = 0; q < 3; ++q)
+            glGetQueryObjectui64v(queries[q], GL_QUERY_RESULT, &elapsed[q]);
+        centralNs += elapsed[0];
+        gradientPassNs += elapsed[1];
+        gradientMeshNs += elapsed[2];
+    }
+    glDeleteQueries(3, queries);
+    result.gpuCentralMs = centralNs / 1e6 / iterations;
+    result.gpuGradientPassMs = gradientPassNs / 1e6 / iterations;
+    result.gpuGradientMeshMs = gradientMeshNs / 1e6 / iterations;
+
+    // same comparison for the CPU mesher on the CPU density field
+    int numCaves = (int)std::min((size_t)MAX_CAVES, caves.size());
+    std::vector<Cave> activeCaves(caves.begin(), caves.begin() + numCaves);
+    DensityGenerator generator = densityGenerator;
+    generator.terrainMode = terrainMode;
+    generator.warpStride = warpStride;
+    generator.zoneStride = zoneStride;
+    std::vector<float> density;
+    generator.generate(seed, activeCaves, caveCeiling, glm::vec3(0.0f), density);
+
+    std::vector<VertexNormal> centralVertices;
+    std::vector<VertexNormal> gradientVertices;
+    std::vector<glm::vec3> gradients;
+    double centralMs = 0.0;
+    double gradientPassMs = 0.0;
+    double gradientMeshMs = 0.0;
+    for (int i = 0; i < iterations; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        cpuMesher.mesh(density, nullptr, centralVertices);
+        auto mid = std::chrono::steady_clock::now();
+        cpuMesher.computeGradients(density, gradients);
+        auto meshStart = std::chrono::steady_clock::now();
+        cpuMesher.mesh(density, &gradients, gradientVertices);
+        auto end = std::chrono::steady_clock::now();
+
+        centralMs += std::chrono::duration<double, std::milli>(mid - start).count();
+        gradientPassMs += std::chrono::duration<double, std::milli>(meshStart - mid).count();
+        gradientMeshMs += std::chrono::duration<double, std::milli>(end - meshStart).count();
+    }
+    result.cpuCentralMs = centralMs / iterations;
+    result.cpuGradientPassMs = gradientPassMs / iterations;
+    result.cpuGradientMeshMs = gradientMeshMs / iterations;
+    result.cpuVertices = (int)centralVertices.size();
+
+    // both paths normalise the same central differences, so the meshes should be identical
+    result.cpuMatches = centralVertices.size() == gradientVertices.size();
+    for (size_t i = 0; result.cpuMatches && i < centralVertices.size(); ++i)
+    {
+        result.cpuMatches = centralVertices[i].position == gradientVertices[i].position &&
+                            centralVertices[i].normal == gradientVertices[i].normal;
+    }
+    lastMeshingBenchmark = result;
+
+    std::cout << "GPU meshing: " << result.gpuCentralMs << " ms with central differences, "
+              << result.gpuGradientPassMs << " + " << result.gpuGradientMeshMs << " ms with the gradient pass" << std::endl;
+    std::cout << "CPU meshing (" << result.cpuVertices << " vertices): " << result.cpuCentralMs << " ms with central differences, "
+              << result.cpuGradientPassMs << " + " << result.cpuGradientMeshMs << " ms with the gradient pass, meshes "
+              << (result.cpuMatches ? "identical" : "DIFFER") << std::endl;
+}
+
+void MarchingCubes::generateCpuDensity(int densitySize, std::vector<float> &density) const
+{
+    int numCaves = (int)std::min((size_t)MAX_CAVES, caves.size());
+    std::vector<Cave> activeCaves(caves.begin(), caves.begin() + numCaves);
+    DensityGenerator generator(densitySize);
+    generator.terrainMode = terrainMode;
+    generator.warpStride = warpStride;
+    generator.zoneStride = zoneStride;
+    generator.generate(seed, activeCaves, caveCeiling, glm::vec3(0.0f), density);
+}
+
+void MarchingCubes::measureCpuMesherScaling(int iterations)
+{
+    int densitySize = 2 * GRID_SIZE + 3;
+    std::vector<float> density;
+    generateCpuDensity(densitySize, density);
+
+    CpuMesher mesher(densitySize);
+    std::vector<glm::vec3> gradients;
+    mesher.computeGradients(density, gradients);
+
+    std::vector<CpuMesherScaling> results;
+    std::vector<VertexNormal> reference;
+    std::vector<VertexNormal> vertices;
+    unsigned int maxThreads = resolveThreadCount(0);
+    for (unsigned int threads = 1;; threads = std::min(threads * 2, maxThreads))
+    {
+        CpuMesherScaling result;
+        result.threads = threads;
+        mesher.threadCount = threads;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+            mesher.mesh(density, &gradients, vertices);
+        auto end = std::chrono::steady_clock::now();
+        result.milliseconds = std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+
+        if (threads == 1)
+            reference = vertices;
+        result.identical = vertices.size() == reference.size() &&
+                           std::memcmp(vertices.data(), reference.data(), vertices.size() * sizeof(VertexNormal)) == 0;
+        result.speedup = results.empty() ? 1.0 : results[0].milliseconds / result.milliseconds;
+        results.push_back(result);
+        if (threads == maxThreads)
+            break;
+    }
+    lastCpuMesherScaling = results;
+
+    for (const CpuMesherScaling &result : results)
+    {
+        std::cout << "CPU mesher " << densitySize - 3 << "^3, " << result.threads << " threads: " << result.milliseconds
+                  << " ms, " << result.speedup << "x" << (result.identical ? "" : ", DIFFERS FROM 1 THREAD") << std::endl;
+    }
+}
+
+void MarchingCubes::benchmarkCubeClassification(int iterations)
+{
+    int densitySize = 2 * GRID_SIZE + 3;
+    int cells = densitySize - 1;
+    std::vector<float> density;
+    generateCpuDensity(densitySize, density);
+
+    // single-threaded, so the timings are the kernels and not the thread pool
+    std::vector<uint64_t> signs((size_t)densitySize * densitySize * CubeClassify::rowWords(densitySize));
+    std::vector<uint8_t> reference;
+    std::vector<uint8_t> cubeIndices((size_t)cells * cells * cells);
+    std::vector<CubeClassifyTiming> results;
+    SimdLevel detected = detectSimdLevel();
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::AVX2, SimdLevel::AVX512})
+    {
+        if (level > detected)
+            break;
+        CubeClassify::forceLevel(level);
+        CubeClassifyTiming result;
+        result.level = level;
+        result.totalRows = cells * cells;
+
+        // skipped rows are never written and read as 0, which meshes the same as 255
+        std::fill(cubeIndices.begin(), cubeIndices.end(), 0);
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+        {
+            CubeClassify::signRows(density.data(), densitySize, 0.0f, 0, densitySize * densitySize, signs.data());
+            result.skippedRows = 0;
+            for (int row = 0; row < cells * cells; ++row)
+            {
+                if (!CubeClassify::cubeRow(signs.data(), densitySize, row % cells, row / cells, cubeIndices.data() + (size_t)row * cells))
+                    result.skippedRows++;
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+        result.milliseconds = std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+
+        if (level == SimdLevel::Scalar)
+            reference = cubeIndices;
+        result.identical = cubeIndices == reference;
+        results.push_back(result);
+    }
+    CubeClassify::forceLevel(SimdLevel::AVX512);
+    lastCubeClassifyTimings = results;
+
+    for (const CubeClassifyTiming &result : results)
+    {
+        std::cout << "Cube classification " << densitySize - 3 << "^3, " << simdLevelName(result.level) << ": "
+                  << result.milliseconds << " ms, " << result.skippedRows << " / " << result.totalRows
+                  << " rows skipped" << (result.identical ? "" : ", DIFFERS FROM SCALAR") << std::endl;
+    }
+}
+
+bool MarchingCubes::analyticNormalsActive() const
+{
+    // the coarse lattices and the heightmap are interpolated, not differentiated
+    return useAnalyticNormals && !useDensityGraph && terrainMode == TERRAIN_VOLUMETRIC && warpStride <= 1 && zoneStride <= 1;
+}
+
+void MarchingCubes::compareAnalyticNormals(int iterations)
+{
+    invalidateGeneration();
+    NormalComparison result;
+    result.ran = true;
+
+    // GPU: the density pass with and without exact gradients, and the gradient pass it replaces
+    bool savedAnalytic = useAnalyticNormals;
+    TerrainMode savedMode = terrainMode;
+    int savedWarpStride = warpStride;
+    int savedZoneStride = zoneStride;
+    terrainMode = TERRAIN_VOLUMETRIC;
+    warpStride = 1;
+    zoneStride = 1;
+
+    GLuint queries[3];
+    glGenQueries(3, queries);
+    GLuint64 densityNs = 0;
+    GLuint64 gradientPassNs = 0;
+    GLuint64 analyticNs = 0;
+    for (int i = 0; i < iterations; ++i)
+    {
+        useAnalyticNormals = false;
+        glBeginQuery(GL_TIME_ELAPSED, queries[0]);
+        dispatchDensity();
+        glEndQuery(GL_TIME_ELAPSED);
+
+        glBeginQuery(GL_TIME_ELAPSED, queries[1]);
+        dispatchGradients();
+        glEndQuery(GL_TIME_ELAPSED);
+
+        useAnalyticNormals = true;
+        glBeginQuery(GL_TIME_ELAPSED, queries[2]);
+        dispatchDensity();
+        glEndQuery(GL_TIME_ELAPSED);
+
+        GLuint64 elapsed[3] = {0, 0, 0};
+        for (int q = 0; q < 3; ++q)
+            glGetQueryObjectui64v(queries[q], GL_QUERY_RESULT, &elapsed[q]);
+        densityNs += elapsed[0];
+        gradientPassNs += elapsed[1];
+        analyticNs += elapsed[2];
+    }
+    glDeleteQueries(3, queries);
+    result.gpuDensityMs = densityNs / 1e6 / iterations;
+    result.gpuGradientPassMs = gradientPassNs / 1e6 / iterations;
+    result.gpuAnalyticDensityMs = analyticNs / 1e6 / iterations;
+
+    useAnalyticNormals = savedAnalytic;
+    terrainMode = savedMode;
+    warpStride = savedWarpStride;
+    zoneStride = savedZoneStride;
+
+    // CPU: the same two normal fields, compared where the surface is
+    int numCaves = (int)std::min((size_t)MAX_CAVES, caves.size());
+    std::vector<Cave> activeCaves(caves.begin(), caves.begin() + numCaves);
+    DensityGenerator generator = densityGenerator;
+    generator.terrainMode = TERRAIN_VOLUMETRIC;
+    generator.warpStride = 1;
+    generator.zoneStride = 1;
+    std::vector<float> density;
+    generator.generate(seed, activeCaves, caveCeiling, glm::vec3(0.0f), density);
+
+    std::vector<glm::vec3> central;
+    std::vector<glm::vec3> analytic;
+    auto start = std::chrono::steady_clock::now();
+    cpuMesher.computeGradients(density, central);
+    auto mid = std::chrono::steady_clock::now();
+    generator.generateNormals(seed, activeCaves, caveCeiling, glm::vec3(0.0f), analytic);
+    auto end = std::chrono::steady_clock::now();
+    result.cpuCentralMs = std::chrono::duration<double, std::milli>(mid - start).count();
+    result.cpuAnalyticMs = std::chrono::duration<double, std::milli>(end - mid).count();
+
+    double angleSum = 0.0;
+    for (size_t i = 0; i < density.size(); ++i)
+    {
+        if (std::fabs(density[i]) >= 2.0f)
+            continue;
+        const glm::vec3 &a = analytic[i];
+        const glm::vec3 &c = central[i];
+        float cosine = std::min(1.0f, std::max(-1.0f, a.x * c.x + a.y * c.y + a.z * c.z));
+        float angle = std::acos(cosine) * 57.2957795f;
+        result.maxAngle = std::max(result.maxAngle, angle);
+        angleSum += angle;
+        result.samples++;
+    }
+    result.meanAngle = result.samples > 0 ? (float)(angleSum / result.samples) : 0.0f;
+    lastNormalComparison = result;
+
+    std::cout << "Analytic normals vs central differences over " << result.samples << " surface samples: max "
+              << result.maxAngle << " mean " << result.meanAngle << " degrees" << std::endl;
+    std::cout << "GPU: density " << result.gpuDensityMs << " + gradient pass " << result.gpuGradientPassMs
+              << " ms vs analytic density " << result.gpuAnalyticDensityMs << " ms; CPU: central "
+              << result.cpuCentralMs << " ms vs analytic " << result.cpuAnalyticMs << " ms" << std::endl;
+}
+
+// triangles as vertex index triples, each rotated to start at its smallest index (winding kept) and sorted,
+// so meshes that emitted the same triangles in different orders compare equal
+static std::vector<std::array<uint32_t, 3>> canonicalTriangles(const std::vector<uint32_t> &indices)
+{
+    std::vector<std::array<uint32_t, 3>> triangles(indices.size() / 3);
+    for (size_t t = 0; t < triangles.size(); ++t)
+    {
+        const uint32_t *tri = indices.data() + t * 3;
+        int first = tri[1] < tri[0] ? (tri[2] < tri[1] ? 2 : 1) : (tri[2] < tri[0] ? 2 : 0);
+        triangles[t] = {tri[first], tri[(first + 1) % 3], tri[(first + 2) % 3]};
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+bool MarchingCubes::verifyIndexedMesh()
+{
+    invalidateGeneration();
+    // draws nothing, so it also runs on a hidden window (main.cpp --verify-indexed)
+    IndexedMeshReport report;
+    report.ran = true;
+
+    bool savedIndexed = useIndexedMesh;
+    MeshMethod savedMethod = meshMethod;
+    useIndexedMesh = true;
+    meshMethod = MESH_MARCHING_CUBES;
+    if (!allocatedIndexedMesh || allocatedMeshMethod != MESH_MARCHING_CUBES)
+        createMeshBuffers();
+    if (densityStorage.format != allocatedDensityFormat)
+        createDensitySSBO();
+
+    if (useDensityGraph && terrainMode == TERRAIN_VOLUMETRIC)
+        dispatchDensityGraph();
+    else
+        dispatchDensity();
+    dispatchGradients();
+    dispatchIndexedMesh(true);
+
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
-    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(unsigned int), &zero);
+    unsigned int counters[2] = {0, 0};
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(counters), counters);
+    report.vertices = counters[0];
+    report.indices = counters[1];
+
+    const size_t samples = (size_t)DENSITY_SIZE * DENSITY_SIZE * DENSITY_SIZE;
+    std::vector<VertexNormal> gpuVertices;
+    readVertices(report.vertices, gpuVertices);
+    std::vector<uint32_t> gpuIndices(report.indices);
+    std::vector<uint32_t> gpuEdgeVertices(samples * 3);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, indexSSBO);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, gpuIndices.size() * sizeof(uint32_t), gpuIndices.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, edgeVertexSSBO);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, gpuEdgeVertices.size() * sizeof(uint32_t), gpuEdgeVertices.data());
+
+    // mesh the density the GPU actually produced, so only the meshing is under test
+    std::vector<uint32_t> words(densityStorage.wordCount(DENSITY_SIZE));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, densitySSBO);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, densityStorage.byteSize(DENSITY_SIZE), words.data());
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    std::vector<float> density;
+    densityStorage.decode(words, DENSITY_SIZE, density);
+
+    std::vector<glm::vec3> gradients;
+    std::vector<VertexNormal> cpuVertices;
+    std::vector<uint32_t> cpuIndices;
+    cpuMesher.computeGradients(density, gradients);
+    cpuMesher.meshIndexed(density, &gradients, cpuVertices, cpuIndices);
+    report.cpuVertices = (unsigned int)cpuVertices.size();
+    report.cpuIndices = (unsigned int)cpuIndices.size();
+
+    // the CPU emits one vertex per crossing edge in sample order, so walking the crossing edges in that
+    // order pairs each CPU vertex with the GPU vertex the edge map names, whatever order the atomics gave
+    bool valid = report.vertices == report.cpuVertices && report.indices == report.cpuIndices;
+    std::vector<uint32_t> gpuToCpu(report.vertices, UINT32_MAX);
+    uint32_t cpuVertex = 0;
+    for (size_t sample = 0; valid && sample < samples; ++sample)
+    {
+        int x = (int)(sample % DENSITY_SIZE);
+        int y = (int)(sample / DENSITY_SIZE % DENSITY_SIZE);
+        int z = (int)(sample / ((size_t)DENSITY_SIZE * DENSITY_SIZE));
+        int position[3] = {x, y, z};
+        size_t stride[3] = {1, (size_t)DENSITY_SIZE, (size_t)DENSITY_SIZE * DENSITY_SIZE};
+        for (int axis = 0; valid && axis < 3; ++axis)
+        {
+            if (position[axis] + 1 >= DENSITY_SIZE || (density[sample] < 0.0f) == (density[sample + stride[axis]] < 0.0f))
+                continue;
+
+            uint32_t gpuVertex = gpuEdgeVertices[sample * 3 + axis];
+            valid = gpuVertex < report.vertices && gpuToCpu[gpuVertex] == UINT32_MAX;
+            if (!valid)
+                break;
+            gpuToCpu[gpuVertex] = cpuVertex;
+
+            const VertexNormal &a = gpuVertices[gpuVertex];
+            const VertexNormal &b = cpuVertices[cpuVertex];
+            for (int c = 0; c < 3; ++c)
+            {
+                report.maxPositionError = std::max(report.maxPositionError, std::fabs(a.position[c] - b.position[c]));
+                report.maxNormalError = std::max(report.maxNormalError, std::fabs(a.normal[c] - b.normal[c]));
+            }
+            cpuVertex++;
+        }
+    }
+
+    // then the triangles must be the same index triples once the GPU indices are renumbered
+    if (valid)
+    {
+        std::vector<uint32_t> renumbered(gpuIndices.size());
+        for (size_t i = 0; valid && i < gpuIndices.size(); ++i)
+        {
+            valid = gpuIndices[i] < report.vertices;
+            renumbered[i] = valid ? gpuToCpu[gpuIndices[i]] : 0;
+        }
+        valid = valid && canonicalTriangles(renumbered) == canonicalTriangles(cpuIndices);
+    }
+    // packed positions are rounded to 1/512 voxel
+    float positionTolerance = usePackedVertices ? 2e-3f : 1e-3f;
+    report.passed = valid && report.maxPositionError < positionTolerance && report.maxNormalError < 1e-2f;
+
+    report.indexedBytes = (size_t)report.vertices * vertexStride() + (size_t)report.indices * sizeof(uint32_t);
+    report.soupBytes = (size_t)report.indices * vertexStride();
+    lastIndexedReport = report;
+
+    useIndexedMesh = savedIndexed;
+    meshMethod = savedMethod;
+
+    std::cout << "Indexed mesh " << (report.passed ? "PASSED" : "FAILED") << ": GPU " << report.vertices << " vertices / "
+              << report.indices << " indices, CPU " << report.cpuVertices << " / " << report.cpuIndices
+              << ", max position error " << report.maxPositionError << ", normal error " << report.maxNormalError << std::endl;
+    std::cout << "Indexed mesh uses " << report.indexedBytes << " bytes vs " << report.soupBytes << " as a triangle soup ("
+              << (report.vertices > 0 ? (double)report.indices / report.vertices : 0.0) << " indices per vertex)" << std::endl;
+    return report.passed;
+}
+
+// triangles with less area than 5% of their longest edge squared
+static int countSlivers(const std::vector<VertexNormal> &vertices, const std::vector<uint32_t> &indices)
+{
+    int slivers = 0;
+    for (size_t t = 0; t + 2 < indices.size(); t += 3)
+    {
+        glm::vec3 a(vertices[indices[t]].position);
+        glm::vec3 b(vertices[indices[t + 1]].position);
+        glm::vec3 c(vertices[indices[t + 2]].position);
+        float longest = std::max(glm::dot(b - a, b - a), std::max(glm::dot(c - b, c - b), glm::dot(a - c, a - c)));
+        float area = 0.5f * glm::length(glm::cross(b - a, c - a));
+        if (area < 0.05f * longest)
+            slivers++;
+    }
+    return slivers;
+}
+
+bool MarchingCubes::verifySurfaceNets(bool dualContouring)
+{
+    invalidateGeneration();
+    // draws nothing, so it also runs on a hidden window (main.cpp --verify-surface-nets)
+    SurfaceNetsReport report;
+    report.ran = true;
+    report.dualContouring = dualContouring;
+
+    MeshMethod savedMethod = meshMethod;
+    meshMethod = dualContouring ? MESH_DUAL_CONTOURING : MESH_SURFACE_NETS;
+    if (allocatedMeshMethod == MESH_MARCHING_CUBES)
+        createMeshBuffers();
+    if (densityStorage.format != allocatedDensityFormat)
+        createDensitySSBO();
+
+    if (useDensityGraph && terrainMode == TERRAIN_VOLUMETRIC)
+        dispatchDensityGraph();
+    else
+        dispatchDensity();
+    dispatchGradients();
+    dispatchSurfaceNets(true);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+    unsigned int counters[2] = {0, 0};
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(counters), counters);
+    report.vertices = counters[0];
+    report.indices = counters[1];
+
+    const int cells = DENSITY_SIZE - 1;
+    const size_t cellTotal = (size_t)cells * cells * cells;
+    std::vector<VertexNormal> gpuVertices;
+    readVertices(report.vertices, gpuVertices);
+    std::vector<uint32_t> gpuIndices(report.indices);
+    std::vector<uint32_t> gpuCellVertices(cellTotal);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, indexSSBO);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, gpuIndices.size() * sizeof(uint32_t), gpuIndices.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, edgeVertexSSBO);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, gpuCellVertices.size() * sizeof(uint32_t), gpuCellVertices.data());
+
+    std::vector<uint32_t> words(densityStorage.wordCount(DENSITY_SIZE));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, densitySSBO);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, densityStorage.byteSize(DENSITY_SIZE), words.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    std::vector<float> density;
+    densityStorage.decode(words, DENSITY_SIZE, density);
+
+    std::vector<glm::vec3> gradients;
+    std::vector<VertexNormal> cpuVertices;
+    std::vector<uint32_t> cpuIndices;
+    cpuMesher.computeGradients(density, gradients);
+    cpuMesher.meshSurfaceNets(density, &gradients, dualContouring, cpuVertices, cpuIndices);
+    report.cpuVertices = (unsigned int)cpuVertices.size();
+    report.cpuIndices = (unsigned int)cpuIndices.size();
+
+    // the CPU emits one vertex per crossing cell in cell order, so walking those cells pairs each CPU
+    // vertex with the GPU vertex of the cell map
+    bool valid = report.vertices == report.cpuVertices && report.indices == report.cpuIndices;
+    std::vector<uint32_t> gpuToCpu(report.vertices, UINT32_MAX);
+    uint32_t cpuVertex = 0;
+    for (size_t cell = 0; valid && cell < cellTotal; ++cell)
+    {
+        int x = (int)(cell % cells);
+        int y = (int)(cell / cells % cells);
+        int z = (int)(cell / ((size_t)cells * cells));
+        bool anyInside = false;
+        bool anyOutside = false;
+        for (int c = 0; c < 8; ++c)
+        {
+            bool inside = density[(x + (c & 1)) + (y + ((c >> 1) & 1)) * DENSITY_SIZE + (z + (c >> 2)) * DENSITY_SIZE * DENSITY_SIZE] < 0.0f;
+            anyInside |= inside;
+            anyOutside |= !inside;
+        }
+        if (!anyInside || !anyOutside)
+            continue;
+
+        uint32_t gpuVertex = gpuCellVertices[cell];
+        valid = gpuVertex < report.vertices && gpuToCpu[gpuVertex] == UINT32_MAX;
+        if (!valid)
+            break;
+        gpuToCpu[gpuVertex] = cpuVertex;
+
+        const VertexNormal &a = gpuVertices[gpuVertex];
+        const VertexNormal &b = cpuVertices[cpuVertex];
+        for (int c = 0; c < 3; ++c)
+        {
+            report.maxPositionError = std::max(report.maxPositionError, std::fabs(a.position[c] - b.position[c]));
+            report.maxNormalError = std::max(report.maxNormalError, std::fabs(a.normal[c] - b.normal[c]));
+        }
+        cpuVertex++;
+    }
+
+    if (valid)
+    {
+        std::vector<uint32_t> renumbered(gpuIndices.size());
+        for (size_t i = 0; valid && i < gpuIndices.size(); ++i)
+        {
+            valid = gpuIndices[i] < report.vertices;
+            renumbered[i] = valid ? gpuToCpu[gpuIndices[i]] : 0;
+        }
+        valid = valid && canonicalTriangles(renumbered) == canonicalTriangles(cpuIndices);
+    }
+    // the QEF solve is a 3x3 inverse in float on both sides, so dual contouring gets more slack
+    float positionTolerance = dualContouring ? 1e-2f : (usePackedVertices ? 2e-3f : 1e-3f);
+    report.passed = valid && report.maxPositionError < positionTolerance && report.maxNormalError < 1e-2f;
+
+    // the marching cubes mesh of the same density, for size and triangle quality
+    std::vector<VertexNormal> mcVertices;
+    std::vector<uint32_t> mcIndices;
+    cpuMesher.meshIndexed(density, &gradients, mcVertices, mcIndices);
+    report.marchingCubesVertices = (unsigned int)mcVertices.size();
+    report.marchingCubesIndices = (unsigned int)mcIndices.size();
+    report.slivers = countSlivers(cpuVertices, cpuIndices);
+    report.marchingCubesSlivers = countSlivers(mcVertices, mcIndices);
+    lastSurfaceNetsReport = report;
+
+    meshMethod = savedMethod;
+
+    const char *name = dualContouring ? "Dual contouring" : "Surface nets";
+    std::cout << name << " " << (report.passed ? "PASSED" : "FAILED") << ": GPU " << report.vertices << " vertices / "
+              << report.indices << " indices, CPU " << report.cpuVertices << " / " << report.cpuIndices
+              << ", max position error " << report.maxPositionError << ", normal error " << report.maxNormalError << std::endl;
+    std::cout << name << " mesh has " << report.cpuVertices << " vertices, " << report.cpuIndices / 3 << " triangles ("
+              << report.slivers << " slivers); marching cubes " << report.marchingCubesVertices << " indexed / "
+              << report.marchingCubesIndices << " soup vertices, " << report.marchingCubesIndices / 3 << " triangles ("
+              << report.marchingCubesSlivers << " slivers)" << std::endl;
+    return report.passed;
+}
+
+void MarchingCubes::benchmarkSoupMeshing(int iterations)
+{
+    invalidateGeneration();
+    SoupMeshingBenchmark result;
+    result.ran = true;
+    result.iterations = iterations;
+
+    // the larger grids get their own density, vertex and scan buffers, swapped in for the members, and
+    // only use the per-voxel volumetric density pass, the one pass that reads nothing sized for DENSITY_SIZE
+    // packed positions only reach 127 voxels, too few for the larger grids
+    bool savedPrefixSums = usePrefixSums;
+    bool savedPackedVertices = usePackedVertices;
+    MeshExtraction savedExtraction = meshExtraction;
+    TerrainMode savedTerrainMode = terrainMode;
+    int savedWarpStride = warpStride;
+    int savedZoneStride = zoneStride;
+    bool savedAnalyticNormals = useAnalyticNormals;
+    GLuint savedDensitySSBO = densitySSBO;
+    GLuint savedVertexSSBO = vertexSSBO;
+    GLuint savedScanSSBO = scanSSBO;
+    GLuint savedVertexCapacity = vertexCapacity;
+    terrainMode = TERRAIN_VOLUMETRIC;
+    warpStride = 1;
+    zoneStride = 1;
+    useAnalyticNormals = false;
+    usePackedVertices = false;
+
+    auto sameBytes = [](const std::vector<VertexNormal> &a, const std::vector<VertexNormal> &b)
+    {
+        return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(VertexNormal)) == 0;
+    };
+    auto matches = [](const std::vector<VertexNormal> &a, const std::vector<VertexNormal> &b)
+    {
+        bool same = a.size() == b.size();
+        for (size_t i = 0; same && i < a.size(); ++i)
+        {
+            for (int c = 0; c < 3; ++c)
+            {
+                same = same && std::fabs(a[i].position[c] - b[i].position[c]) < 1e-3f &&
+                       std::fabs(a[i].normal[c] - b[i].normal[c]) < 1e-2f;
+            }
+        }
+        return same;
+    };
+
+    GLuint query;
+    glGenQueries(1, &query);
+    for (int scale = 1; scale <= 3; ++scale)
+    {
+        SoupMeshingGrid grid;
+        grid.gridSize = GRID_SIZE * scale;
+        int densitySize = grid.gridSize + 3;
+
+        glGenBuffers(1, &densitySSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, densitySSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, densityStorage.byteSize(densitySize), nullptr, GL_DYNAMIC_DRAW);
+        glGenBuffers(1, &scanSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, scanSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)scanBufferSize(densitySize) * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 12, scanSSBO);
+        glGenBuffers(1, &vertexSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, vertexSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(VertexNormal), nullptr, GL_DYNAMIC_DRAW);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, vertexSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        dispatchDensity(densitySize);
+
+        // a first prefix-sum run with no room for vertices gives the exact size of the mesh
+        vertexCapacity = 0;
+        usePrefixSums = true;
+        meshExtraction = EXTRACTION_ATOMIC;
+        dispatchMarchingCubes(false, densitySize);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(unsigned int), &grid.vertices);
+        vertexCapacity = std::max(grid.vertices, 3u);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, vertexSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)vertexCapacity * sizeof(VertexNormal), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        // cells in x-fastest order with their triangles in triTable order, exactly what the CPU mesher does
+        std::vector<uint32_t> words(densityStorage.wordCount(densitySize));
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, densitySSBO);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, densityStorage.byteSize(densitySize), words.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        std::vector<float> density;
+        densityStorage.decode(words, densitySize, density);
+        std::vector<VertexNormal> cpuVertices;
+        CpuMesher(densitySize).mesh(density, nullptr, cpuVertices);
+
+        // 0: atomics, 1: prefix sums, 2: HistoPyramid
+        double *milliseconds[3] = {&grid.atomicMs, &grid.prefixSumMs, &grid.histoPyramidMs};
+        bool *repeatable[3] = {&grid.atomicRepeatable, &grid.prefixSumRepeatable, &grid.histoPyramidRepeatable};
+        std::vector<VertexNormal> first;
+        std::vector<VertexNormal> again;
+        for (int mode = 0; mode < 3; ++mode)
+        {
+            usePrefixSums = mode == 1;
+            meshExtraction = mode == 2 ? EXTRACTION_HISTOPYRAMID : EXTRACTION_ATOMIC;
+            GLuint64 totalNs = 0;
+            for (int i = 0; i < iterations; ++i)
+            {
+                glBeginQuery(GL_TIME_ELAPSED, query);
+                dispatchMarchingCubes(false, densitySize);
+                glEndQuery(GL_TIME_ELAPSED);
+                GLuint64 elapsed = 0;
+                glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+                totalNs += elapsed;
+            }
+            *milliseconds[mode] = totalNs / 1e6 / iterations;
+
+            // the last timed run against one more
+            readVertices(grid.vertices, first);
+            dispatchMarchingCubes(false, densitySize);
+            readVertices(grid.vertices, again);
+            *repeatable[mode] = sameBytes(first, again);
+            if (mode == 1)
+                grid.prefixSumMatchesCpu = matches(again, cpuVertices);
+            if (mode == 2)
+                grid.histoPyramidMatchesCpu = matches(again, cpuVertices);
+        }
+
+        glDeleteBuffers(1, &densitySSBO);
+        glDeleteBuffers(1, &scanSSBO);
+        glDeleteBuffers(1, &vertexSSBO);
+        result.grids.push_back(grid);
+    }
+    glDeleteQueries(1, &query);
+
+    densitySSBO = savedDensitySSBO;
+    vertexSSBO = savedVertexSSBO;
+    scanSSBO = savedScanSSBO;
+    vertexCapacity = savedVertexCapacity;
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, vertexSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 12, scanSSBO);
+    usePrefixSums = savedPrefixSums;
+    usePackedVertices = savedPackedVertices;
+    meshExtraction = savedExtraction;
+    terrainMode = savedTerrainMode;
+    warpStride = savedWarpStride;
+    zoneStride = savedZoneStride;
+    useAnalyticNormals = savedAnalyticNormals;
+    lastSoupMeshingBenchmark = result;
+
+    for (const SoupMeshingGrid &grid : result.grids)
+    {
+        std::cout << "Meshing " << grid.gridSize << "^3 (" << grid.vertices << " vertices): atomics " << grid.atomicMs
+                  << " ms" << (grid.atomicRepeatable ? "" : ", order varies") << "; count + scan + emit " << grid.prefixSumMs
+                  << " ms" << (grid.prefixSumRepeatable ? ", byte-identical" : ", NOT REPEATABLE")
+                  << (grid.prefixSumMatchesCpu ? ", matches CPU order" : ", DIFFERS FROM CPU") << "; HistoPyramid "
+                  << grid.histoPyramidMs << " ms" << (grid.histoPyramidRepeatable ? ", byte-identical" : ", NOT REPEATABLE")
+                  << (grid.histoPyramidMatchesCpu ? ", matches CPU order" : ", DIFFERS FROM CPU") << std::endl;
+    }
 }
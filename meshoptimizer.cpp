@@ -0,0 +1,233 @@
+#include "include/meshoptimizer.h"
+#include <algorithm>
+#include <numeric>
+
+namespace MeshOptimizer
+{
+    // vertex fetch model for analyze: a direct-mapped cache of 64-byte lines, 16 KB
+    static const size_t FETCH_LINE = 64;
+    static const size_t FETCH_LINES = 256;
+
+    CacheStats analyze(const std::vector<uint32_t> &indices, size_t vertexCount, size_t vertexSize)
+    {
+        CacheStats stats;
+        size_t triangles = indices.size() / 3;
+        if (triangles == 0)
+            return stats;
+
+        // FIFO: a vertex inserted by miss m is evicted by miss m + CACHE_SIZE
+        std::vector<uint32_t> insertedAt(vertexCount, 0); // miss number + 1, 0 = never
+        std::vector<size_t> lineTags(FETCH_LINES, SIZE_MAX);
+        uint32_t misses = 0;
+        size_t unique = 0;
+        size_t fetchedBytes = 0;
+        for (uint32_t v : indices)
+        {
+            if (insertedAt[v] != 0 && misses - insertedAt[v] < (uint32_t)CACHE_SIZE)
+                continue;
+            if (insertedAt[v] == 0)
+                unique++;
+            insertedAt[v] = ++misses;
+
+            size_t first = v * vertexSize / FETCH_LINE;
+            size_t last = (v * vertexSize + vertexSize - 1) / FETCH_LINE;
+            for (size_t line = first; line <= last; ++line)
+            {
+                if (lineTags[line % FETCH_LINES] != line)
+                {
+                    lineTags[line % FETCH_LINES] = line;
+                    fetchedBytes += FETCH_LINE;
+                }
+            }
+        }
+        stats.acmr = (float)misses / triangles;
+        stats.atvr = (float)misses / unique;
+        stats.overfetch = (float)fetchedBytes / (unique * vertexSize);
+        return stats;
+    }
+
+    void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount, std::vector<uint32_t> *clusterStarts)
+    {
+        size_t triangleCount = indices.size() / 3;
+        if (clusterStarts)
+            clusterStarts->clear();
+        if (triangleCount == 0)
+            return;
+
+        // triangles around each vertex, as runs of one array
+        std::vector<uint32_t> live(vertexCount, 0);
+        for (size_t i = 0; i < triangleCount * 3; ++i)
+            live[indices[i]]++;
+        std::vector<uint32_t> offsets(vertexCount + 1, 0);
+        for (size_t v = 0; v < vertexCount; ++v)
+            offsets[v + 1] = offsets[v] + live[v];
+        std::vector<uint32_t> adjacency(triangleCount * 3);
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < triangleCount * 3; ++i)
+            adjacency[fill[indices[i]]++] = (uint32_t)(i / 3);
+
+        std::vector<uint32_t> timestamps(vertexCount, 0);
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<uint32_t> deadEnd;
+        std::vector<uint32_t> candidates;
+        std::vector<uint32_t> output;
+        output.reserve(triangleCount * 3);
+        uint32_t time = CACHE_SIZE + 1;
+        size_t cursor = 0;
+        while (cursor < vertexCount && live[cursor] == 0)
+            cursor++;
+        int64_t fanning = (int64_t)cursor;
+        if (clusterStarts)
+            clusterStarts->push_back(0);
+
+        while (fanning >= 0)
+        {
+            // emit every remaining triangle around the fanning vertex
+            candidates.clear();
+            for (uint32_t k = offsets[fanning]; k < offsets[fanning + 1]; ++k)
+            {
+                uint32_t t = adjacency[k];
+                if (emitted[t])
+                    continue;
+                emitted[t] = true;
+                for (int c = 0; c < 3; ++c)
+                {
+                    uint32_t v = indices[t * 3 + c];
+                    output.push_back(v);
+                    deadEnd.push_back(v);
+                    candidates.push_back(v);
+                    live[v]--;
+                    if (time - timestamps[v] > (uint32_t)CACHE_SIZE)
+                        timestamps[v] = time++;
+                }
+            }
+
+            // next: the candidate that will still be in the cache after its remaining triangles are
+            // emitted, the oldest of those first; any candidate with triangles left otherwise
+            int64_t next = -1;
+            int64_t best = -1;
+            for (uint32_t v : candidates)
+            {
+                if (live[v] == 0)
+                    continue;
+                int64_t priority = 0;
+                if (time - timestamps[v] + 2 * live[v] <= (uint32_t)CACHE_SIZE)
+                    priority = time - timestamps[v];
+                if (priority > best)
+                {
+                    best = priority;
+                    next = v;
+                }
+            }
+
+            // dead end: a recently emitted vertex with triangles left, else the next one in input order.
+            // the cache is as good as flushed, which is where a cluster ends
+            if (next < 0)
+            {
+                while (!deadEnd.empty())
+                {
+                    uint32_t v = deadEnd.back();
+                    deadEnd.pop_back();
+                    if (live[v] > 0)
+                    {
+                        next = v;
+                        break;
+                    }
+                }
+                if (next < 0)
+                {
+                    while (cursor < vertexCount && live[cursor] == 0)
+                        cursor++;
+                    if (cursor < vertexCount)
+                        next = (int64_t)cursor;
+                }
+                if (next >= 0 && clusterStarts)
+                    clusterStarts->push_back((uint32_t)(output.size() / 3));
+            }
+            fanning = next;
+        }
+        indices.swap(output);
+    }
+
+    void optimizeOverdraw(std::vector<uint32_t> &indices, const std::vector<VertexNormal> &vertices, const std::vector<uint32_t> &clusterStarts)
+    {
+        size_t triangleCount = indices.size() / 3;
+        size_t clusterCount = clusterStarts.size();
+        if (clusterCount < 2)
+            return;
+
+        // area-weighted centroid and normal per cluster, and of the whole mesh
+        std::vector<glm::vec3> centroids(clusterCount, glm::vec3(0.0f));
+        std::vector<glm::vec3> normals(clusterCount, glm::vec3(0.0f));
+        std::vector<float> areas(clusterCount, 0.0f);
+        glm::vec3 meshCentroid(0.0f);
+        float meshArea = 0.0f;
+        for (size_t c = 0; c < clusterCount; ++c)
+        {
+            size_t end = c + 1 < clusterCount ? clusterStarts[c + 1] : triangleCount;
+            for (size_t t = clusterStarts[c]; t < end; ++t)
+            {
+                glm::vec3 a(vertices[indices[t * 3]].position);
+                glm::vec3 b(vertices[indices[t * 3 + 1]].position);
+                glm::vec3 d(vertices[indices[t * 3 + 2]].position);
+                glm::vec3 n = glm::cross(b - a, d - a);
+                float area = glm::length(n);
+                centroids[c] += (a + b + d) * (area / 3.0f);
+                normals[c] += n;
+                areas[c] += area;
+            }
+            meshCentroid += centroids[c];
+            meshArea += areas[c];
+        }
+        if (meshArea > 0.0f)
+            meshCentroid /= meshArea;
+
+        // clusters facing away from the centre are the ones that occlude the rest, so they go first
+        std::vector<float> keys(clusterCount, 0.0f);
+        for (size_t c = 0; c < clusterCount; ++c)
+        {
+            float length = glm::length(normals[c]);
+            if (areas[c] > 0.0f && length > 0.0f)
+                keys[c] = glm::dot(centroids[c] / areas[c] - meshCentroid, normals[c] / length);
+        }
+        std::vector<uint32_t> order(clusterCount);
+        std::iota(order.begin(), order.end(), 0u);
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+                         { return keys[a] > keys[b]; });
+
+        std::vector<uint32_t> output;
+        output.reserve(indices.size());
+        for (uint32_t c : order)
+        {
+            size_t end = c + 1 < clusterCount ? clusterStarts[c + 1] : triangleCount;
+            output.insert(output.end(), indices.begin() + clusterStarts[c] * 3, indices.begin() + end * 3);
+        }
+        indices.swap(output);
+    }
+
+    void optimizeVertexFetch(std::vector<VertexNormal> &vertices, std::vector<uint32_t> &indices)
+    {
+        std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+        std::vector<VertexNormal> output;
+        output.reserve(vertices.size());
+        for (uint32_t &index : indices)
+        {
+            if (remap[index] == UINT32_MAX)
+            {
+                remap[index] = (uint32_t)output.size();
+                output.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+        vertices.swap(output);
+    }
+
+    void optimize(std::vector<VertexNormal> &vertices, std::vector<uint32_t> &indices, bool reduceOverdraw)
+    {
+        std::vector<uint32_t> clusterStarts;
+        optimizeVertexCache(indices, vertices.size(), reduceOverdraw ? &clusterStarts : nullptr);
+        if (reduceOverdraw)
+            optimizeOverdraw(indices, vertices, clusterStarts);
+        optimizeVertexFetch(vertices, indices);
+    }
+}
@@ -0,0 +1,383 @@
+#include "include/meshsimplifier.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+
+namespace MeshSimplifier
+{
+    // symmetric 4x4 plane quadric: a2 ab ac ad b2 bc bd c2 cd d2
+    struct Quadric
+    {
+        double q[10] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+        void addPlane(const glm::dvec3 &n, double d)
+        {
+            q[0] += n.x * n.x;
+            q[1] += n.x * n.y;
+            q[2] += n.x * n.z;
+            q[3] += n.x * d;
+            q[4] += n.y * n.y;
+            q[5] += n.y * n.z;
+            q[6] += n.y * d;
+            q[7] += n.z * n.z;
+            q[8] += n.z * d;
+            q[9] += d * d;
+        }
+
+        void add(const Quadric &other)
+        {
+            for (int i = 0; i < 10; ++i)
+                q[i] += other.q[i];
+        }
+
+        // sum of squared distances from p to the planes
+        double error(const glm::dvec3 &p) const
+        {
+            double e = q[0] * p.x * p.x + 2 * q[1] * p.x * p.y + 2 * q[2] * p.x * p.z + 2 * q[3] * p.x +
+                       q[4] * p.y * p.y + 2 * q[5] * p.y * p.z + 2 * q[6] * p.y +
+                       q[7] * p.z * p.z + 2 * q[8] * p.z + q[9];
+            return std::max(e, 0.0);
+        }
+    };
+
+    struct Collapse
+    {
+        double cost;
+        uint32_t from; // removed
+        uint32_t to;   // kept
+        uint32_t fromVersion;
+        uint32_t toVersion;
+        bool operator>(const Collapse &other) const { return cost > other.cost; }
+    };
+
+    static glm::dvec3 position(const VertexNormal &vertex)
+    {
+        return glm::dvec3(vertex.position.x, vertex.position.y, vertex.position.z);
+    }
+
+    Stats simplify(const std::vector<VertexNormal> &vertices, const std::vector<uint32_t> &indices, const Options &options,
+                   std::vector<VertexNormal> &outVertices, std::vector<uint32_t> &outIndices)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        Stats stats;
+        size_t vertexCount = vertices.size();
+        size_t triangleCount = indices.size() / 3;
+        stats.inputTriangles = triangleCount;
+
+        std::vector<glm::dvec3> positions(vertexCount);
+        for (size_t v = 0; v < vertexCount; ++v)
+            positions[v] = position(vertices[v]);
+
+        std::vector<uint32_t> triangles(indices.begin(), indices.begin() + triangleCount * 3);
+        std::vector<bool> triangleAlive(triangleCount, true);
+        std::vector<std::vector<uint32_t>> vertexTriangles(vertexCount);
+        std::vector<Quadric> quadrics(vertexCount);
+        for (size_t t = 0; t < triangleCount; ++t)
+        {
+            const uint32_t *tri = &triangles[t * 3];
+            glm::dvec3 n = glm::cross(positions[tri[1]] - positions[tri[0]], positions[tri[2]] - positions[tri[0]]);
+            double length = glm::length(n);
+            for (int c = 0; c < 3; ++c)
+                vertexTriangles[tri[c]].push_back((uint32_t)t);
+            if (length <= 0.0)
+                continue;
+            n /= length;
+            double d = -glm::dot(n, positions[tri[0]]);
+            for (int c = 0; c < 3; ++c)
+                quadrics[tri[c]].addPlane(n, d);
+        }
+
+        // every edge once per triangle using it: one use is an open rim, more than two is non-manifold
+        std::vector<uint64_t> edges;
+        edges.reserve(triangleCount * 3);
+        for (size_t t = 0; t < triangleCount; ++t)
+        {
+            for (int c = 0; c < 3; ++c)
+            {
+                uint32_t a = triangles[t * 3 + c];
+                uint32_t b = triangles[t * 3 + (c + 1) % 3];
+                edges.push_back((uint64_t)std::min(a, b) << 32 | std::max(a, b));
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        std::vector<bool> locked(vertexCount, false);
+        for (size_t e = 0; e < edges.size();)
+        {
+            size_t run = e;
+            while (run < edges.size() && edges[run] == edges[e])
+                run++;
+            if (run - e != 2)
+            {
+                locked[edges[e] >> 32] = true;
+                locked[edges[e] & 0xffffffffu] = true;
+            }
+            e = run;
+        }
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+        for (size_t v = 0; v < vertexCount; ++v)
+        {
+            glm::vec3 p(vertices[v].position);
+            for (int c = 0; c < 3; ++c)
+            {
+                if (p[c] < options.lockOutsideMin[c] || p[c] > options.lockOutsideMax[c])
+                    locked[v] = true;
+            }
+            stats.lockedVertices += locked[v] ? 1 : 0;
+        }
+
+        std::vector<uint32_t> versions(vertexCount, 0);
+        std::vector<bool> vertexAlive(vertexCount, true);
+        std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+        const double infinity = std::numeric_limits<double>::infinity();
+        auto push = [&](uint32_t a, uint32_t b)
+        {
+            if (locked[a] && locked[b])
+                return;
+            Quadric q = quadrics[a];
+            q.add(quadrics[b]);
+            double toB = locked[a] ? infinity : q.error(positions[b]);
+            double toA = locked[b] ? infinity : q.error(positions[a]);
+            if (toB <= toA)
+                heap.push({toB, a, b, versions[a], versions[b]});
+            else
+                heap.push({toA, b, a, versions[b], versions[a]});
+        };
+        for (uint64_t edge : edges)
+            push((uint32_t)(edge >> 32), (uint32_t)(edge & 0xffffffffu));
+
+        auto neighbours = [&](uint32_t v, std::vector<uint32_t> &out)
+        {
+            out.clear();
+            for (uint32_t t : vertexTriangles[v])
+            {
+                if (!triangleAlive[t])
+                    continue;
+                for (int c = 0; c < 3; ++c)
+                {
+                    if (triangles[t * 3 + c] != v)
+                        out.push_back(triangles[t * 3 + c]);
+                }
+            }
+            std::sort(out.begin(), out.end());
+            out.erase(std::unique(out.begin(), out.end()), out.end());
+        };
+
+        double maxCost = (double)options.targetError * options.targetError;
+        size_t liveTriangles = triangleCount;
+        std::vector<uint32_t> fromNeighbours;
+        std::vector<uint32_t> toNeighbours;
+        std::vector<uint32_t> shared;
+        while (!heap.empty() && liveTriangles > options.targetTriangles)
+        {
+            Collapse collapse = heap.top();
+            heap.pop();
+            uint32_t from = collapse.from;
+            uint32_t to = collapse.to;
+            if (!vertexAlive[from] || !vertexAlive[to] || versions[from] != collapse.fromVersion || versions[to] != collapse.toVersion)
+                continue;
+            if (collapse.cost > maxCost)
+                break;
+
+            // link condition: the two vertices may only share the apexes of the triangles on their edge,
+            // otherwise the collapse pinches the surface
+            neighbours(from, fromNeighbours);
+            neighbours(to, toNeighbours);
+            shared.clear();
+            std::set_intersection(fromNeighbours.begin(), fromNeighbours.end(), toNeighbours.begin(), toNeighbours.end(),
+                                  std::back_inserter(shared));
+            int edgeTriangles = 0;
+            bool valid = true;
+            for (uint32_t t : vertexTriangles[from])
+            {
+                if (!triangleAlive[t])
+                    continue;
+                uint32_t *tri = &triangles[t * 3];
+                if (tri[0] == to || tri[1] == to || tri[2] == to)
+                {
+                    edgeTriangles++;
+                    continue;
+                }
+                // no triangle may turn over or collapse to a line
+                glm::dvec3 p[3];
+                glm::dvec3 q[3];
+                for (int c = 0; c < 3; ++c)
+                {
+                    p[c] = positions[tri[c]];
+                    q[c] = tri[c] == from ? positions[to] : p[c];
+                }
+                glm::dvec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                glm::dvec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+                if (glm::dot(before, after) <= 0.0 || glm::length(after) < 1e-12)
+                {
+                    valid = false;
+                    stats.rejectedFlips++;
+                    break;
+                }
+            }
+            if (!valid || (int)shared.size() != edgeTriangles)
+                continue;
+
+            for (uint32_t t : vertexTriangles[from])
+            {
+                if (!triangleAlive[t])
+                    continue;
+                uint32_t *tri = &triangles[t * 3];
+                if (tri[0] == to || tri[1] == to || tri[2] == to)
+                {
+                    triangleAlive[t] = false;
+                    liveTriangles--;
+                    continue;
+                }
+                for (int c = 0; c < 3; ++c)
+                {
+                    if (tri[c] == from)
+                        tri[c] = to;
+                }
+                vertexTriangles[to].push_back(t);
+            }
+            auto &kept = vertexTriangles[to];
+            kept.erase(std::remove_if(kept.begin(), kept.end(), [&](uint32_t t)
+                                      { return !triangleAlive[t]; }),
+                       kept.end());
+            vertexTriangles[from].clear();
+            vertexAlive[from] = false;
+            quadrics[to].add(quadrics[from]);
+            versions[to]++;
+            stats.collapses++;
+            stats.maxError = std::max(stats.maxError, (float)std::sqrt(collapse.cost));
+
+            // every edge at the kept vertex now has a new cost
+            neighbours(to, toNeighbours);
+            for (uint32_t n : toNeighbours)
+                push(n, to);
+        }
+
+        // surviving vertices in input order, so the output is deterministic
+        std::vector<bool> used(vertexCount, false);
+        for (size_t t = 0; t < triangleCount; ++t)
+        {
+            if (!triangleAlive[t])
+                continue;
+            for (int c = 0; c < 3; ++c)
+                used[triangles[t * 3 + c]] = true;
+        }
+        std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+        outVertices.clear();
+        outIndices.clear();
+        outIndices.reserve(liveTriangles * 3);
+        for (size_t v = 0; v < vertexCount; ++v)
+        {
+            if (!used[v])
+                continue;
+            remap[v] = (uint32_t)outVertices.size();
+            outVertices.push_back(vertices[v]);
+        }
+        for (size_t t = 0; t < triangleCount; ++t)
+        {
+            if (!triangleAlive[t])
+                continue;
+            for (int c = 0; c < 3; ++c)
+                outIndices.push_back(remap[triangles[t * 3 + c]]);
+        }
+        stats.outputTriangles = liveTriangles;
+
+        auto end = std::chrono::high_resolution_clock::now();
+        stats.milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+        return stats;
+    }
+
+    // closest point on triangle abc to p (Ericson, Real-Time Collision Detection 5.1.5)
+    static glm::vec3 closestOnTriangle(const glm::vec3 &p, const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c)
+    {
+        glm::vec3 ab = b - a;
+        glm::vec3 ac = c - a;
+        glm::vec3 ap = p - a;
+        float d1 = glm::dot(ab, ap);
+        float d2 = glm::dot(ac, ap);
+        if (d1 <= 0.0f && d2 <= 0.0f)
+            return a;
+        glm::vec3 bp = p - b;
+        float d3 = glm::dot(ab, bp);
+        float d4 = glm::dot(ac, bp);
+        if (d3 >= 0.0f && d4 <= d3)
+            return b;
+        float vc = d1 * d4 - d3 * d2;
+        if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+            return a + ab * (d1 / (d1 - d3));
+        glm::vec3 cp = p - c;
+        float d5 = glm::dot(ab, cp);
+        float d6 = glm::dot(ac, cp);
+        if (d6 >= 0.0f && d5 <= d6)
+            return c;
+        float vb = d5 * d2 - d1 * d6;
+        if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+            return a + ac * (d2 / (d2 - d6));
+        float va = d3 * d6 - d5 * d4;
+        if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+            return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+        float denom = 1.0f / (va + vb + vc);
+        return a + ab * (vb * denom) + ac * (vc * denom);
+    }
+
+    float maxSurfaceDistance(const std::vector<VertexNormal> &original, const std::vector<VertexNormal> &vertices,
+                             const std::vector<uint32_t> &indices, float maxDistance)
+    {
+        if (original.empty())
+            return 0.0f;
+        if (indices.empty())
+            return maxDistance;
+
+        // triangles bucketed on a uniform grid of maxDistance cells, so a query only looks at its 3x3x3
+        float cellSize = std::max(maxDistance, 1.0f);
+        glm::vec3 lo(std::numeric_limits<float>::max());
+        glm::vec3 hi(-std::numeric_limits<float>::max());
+        for (const VertexNormal &vertex : vertices)
+        {
+            lo = glm::min(lo, glm::vec3(vertex.position));
+            hi = glm::max(hi, glm::vec3(vertex.position));
+        }
+        glm::ivec3 dims = glm::max(glm::ivec3((hi - lo) / cellSize) + 1, glm::ivec3(1));
+        auto cellOf = [&](const glm::vec3 &p)
+        { return glm::clamp(glm::ivec3(glm::floor((p - lo) / cellSize)), glm::ivec3(0), dims - 1); };
+
+        std::vector<std::vector<uint32_t>> cells((size_t)dims.x * dims.y * dims.z);
+        for (size_t t = 0; t + 2 < indices.size(); t += 3)
+        {
+            glm::vec3 a(vertices[indices[t]].position);
+            glm::vec3 b(vertices[indices[t + 1]].position);
+            glm::vec3 c(vertices[indices[t + 2]].position);
+            glm::ivec3 first = cellOf(glm::min(a, glm::min(b, c)));
+            glm::ivec3 last = cellOf(glm::max(a, glm::max(b, c)));
+            for (int z = first.z; z <= last.z; ++z)
+                for (int y = first.y; y <= last.y; ++y)
+                    for (int x = first.x; x <= last.x; ++x)
+                        cells[x + (size_t)y * dims.x + (size_t)z * dims.x * dims.y].push_back((uint32_t)t);
+        }
+
+        float worst = 0.0f;
+        for (const VertexNormal &vertex : original)
+        {
+            glm::vec3 p(vertex.position);
+            glm::ivec3 first = cellOf(p - cellSize);
+            glm::ivec3 last = cellOf(p + cellSize);
+            float best = maxDistance * maxDistance;
+            for (int z = first.z; z <= last.z; ++z)
+                for (int y = first.y; y <= last.y; ++y)
+                    for (int x = first.x; x <= last.x; ++x)
+                    {
+                        for (uint32_t t : cells[x + (size_t)y * dims.x + (size_t)z * dims.x * dims.y])
+                        {
+                            glm::vec3 closest = closestOnTriangle(p, glm::vec3(vertices[indices[t]].position),
+                                                                  glm::vec3(vertices[indices[t + 1]].position),
+                                                                  glm::vec3(vertices[indices[t + 2]].position));
+                            best = std::min(best, glm::dot(p - closest, p - closest));
+                        }
+                    }
+            worst = std::max(worst, std::sqrt(best));
+        }
+        return worst;
+    }
+}
@@ -0,0 +1,45 @@
+#include "include/noisebatch.h"
+#include <atomic>
+
+namespace NoiseBatch
+{
+    static std::atomic<int> levelCap{(int)SimdLevel::AVX512};
+
+    SimdLevel activeLevel()
+    {
+        int detected = (int)detectSimdLevel();
+        int cap = levelCap.load(std::memory_order_relaxed);
+        return (SimdLevel)(detected < cap ? detected : cap);
+    }
+
+    void forceLevel(SimdLevel level)
+    {
+        levelCap.store((int)level, std::memory_order_relaxed);
+    }
+
+    bool getNoise(const NoiseParams &params, const float *xs, const float *ys, const float *zs, float *out, size_t n)
+    {
+        // a level whose translation unit was built without that ISA returns false, so fall through
+        SimdLevel level = activeLevel();
+        if (level >= SimdLevel::AVX512 && getNoiseAVX512(params, xs, ys, zs, out, n))
+            return true;
+        if (level >= SimdLevel::AVX2 && getNoiseAVX2(params, xs, ys, zs, out, n))
+            return true;
+        if (level >= SimdLevel::SSE41 && getNoiseSSE41(params, xs, ys, zs, out, n))
+            return true;
+        return false;
+    }
+
+    bool domainWarp(const WarpParams &params, float *xs, float *ys, float *zs, size_t n)
+    {
+        // a level whose translation unit was built without that ISA returns false, so fall through
+        SimdLevel level = activeLevel();
+        if (level >= SimdLevel::AVX512 && domainWarpAVX512(params, xs, ys, zs, n))
+            return true;
+        if (level >= SimdLevel::AVX2 && domainWarpAVX2(params, xs, ys, zs, n))
+            return true;
+        if (level >= SimdLevel::SSE41 && domainWarpSSE41(params, xs, ys, zs, n))
+            return true;
+        return false;
+    }
+}
@@ -0,0 +1,74 @@
+// built with -mavx2 -ffp-contract=off (see CMakeLists.txt)
+#include "include/noisebatch.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#include "include/noisebatch_kernel.h"
+
+namespace
+{
+    struct AVX2Ops
+    {
+        static const int Width = 8;
+        typedef __m256 F;
+        typedef __m256i I;
+        typedef __m256 M;
+
+        static inline F load(const float *p) { return _mm256_loadu_ps(p); }
+        static inline void store(float *p, F v) { _mm256_storeu_ps(p, v); }
+        static inline F set(float v) { return _mm256_set1_ps(v); }
+        static inline I seti(int v) { return _mm256_set1_epi32(v); }
+
+        static inline F add(F a, F b) { return _mm256_add_ps(a, b); }
+        static inline F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+        static inline F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+        static inline F neg(F a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f)); }
+        static inline F abs(F a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+
+        static inline I iadd(I a, I b) { return _mm256_add_epi32(a, b); }
+        static inline I isub(I a, I b) { return _mm256_sub_epi32(a, b); }
+        static inline I imul(I a, I b) { return _mm256_mullo_epi32(a, b); }
+        static inline I ixor(I a, I b) { return _mm256_xor_si256(a, b); }
+        static inline I iand(I a, I b) { return _mm256_and_si256(a, b); }
+        static inline I ior(I a, I b) { return _mm256_or_si256(a, b); }
+        template <int N>
+        static inline I srai(I a) { return _mm256_srai_epi32(a, N); }
+
+        static inline F tofloat(I a) { return _mm256_cvtepi32_ps(a); }
+        static inline I truncate(F a) { return _mm256_cvttps_epi32(a); }
+
+        static inline M gt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+        static inline M ge(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+        static inline M lt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+        static inline M mand(M a, M b) { return _mm256_and_ps(a, b); }
+        static inline M mandnot(M a, M b) { return _mm256_andnot_ps(a, b); }
+
+        static inline F select(M m, F t, F f) { return _mm256_blendv_ps(f, t, m); }
+        static inline I selecti(M m, I t, I f) { return _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(f), _mm256_castsi256_ps(t), m)); }
+
+        static inline F gather(const float *table, I index) { return _mm256_i32gather_ps(table, index, 4); }
+    };
+}
+
+bool NoiseBatch::getNoiseAVX2(const NoiseParams &params, const float *xs, const float *ys, const float *zs, float *out, size_t n)
+{
+    NoiseBatchKernel<AVX2Ops>::getNoiseBatch(params, xs, ys, zs, out, n);
+    return true;
+}
+
+bool NoiseBatch::domainWarpAVX2(const WarpParams &params, float *xs, float *ys, float *zs, size_t n)
+{
+    NoiseBatchKernel<AVX2Ops>::domainWarpBatch(params, xs, ys, zs, n);
+    return true;
+}
+#else
+bool NoiseBatch::getNoiseAVX2(const NoiseParams &, const float *, const float *, const float *, float *, size_t)
+{
+    return false;
+}
+
+bool NoiseBatch::domainWarpAVX2(const WarpParams &, float *, float *, float *, size_t)
+{
+    return false;
+}
+#endif
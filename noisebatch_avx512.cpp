@@ -0,0 +1,75 @@
+// built with -mavx512f -ffp-contract=off (see CMakeLists.txt)
+#include "include/noisebatch.h"
+
+#if defined(__AVX512F__)
+#include <immintrin.h>
+#include "include/noisebatch_kernel.h"
+
+namespace
+{
+    struct AVX512Ops
+    {
+        static const int Width = 16;
+        typedef __m512 F;
+        typedef __m512i I;
+        typedef __mmask16 M;
+
+        static inline F load(const float *p) { return _mm512_loadu_ps(p); }
+        static inline void store(float *p, F v) { _mm512_storeu_ps(p, v); }
+        static inline F set(float v) { return _mm512_set1_ps(v); }
+        static inline I seti(int v) { return _mm512_set1_epi32(v); }
+
+        static inline F add(F a, F b) { return _mm512_add_ps(a, b); }
+        static inline F sub(F a, F b) { return _mm512_sub_ps(a, b); }
+        static inline F mul(F a, F b) { return _mm512_mul_ps(a, b); }
+        // float xor needs AVX512DQ, so flip the sign bit on the integer side
+        static inline F neg(F a) { return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(a), _mm512_set1_epi32((int)0x80000000))); }
+        static inline F abs(F a) { return _mm512_abs_ps(a); }
+
+        static inline I iadd(I a, I b) { return _mm512_add_epi32(a, b); }
+        static inline I isub(I a, I b) { return _mm512_sub_epi32(a, b); }
+        static inline I imul(I a, I b) { return _mm512_mullo_epi32(a, b); }
+        static inline I ixor(I a, I b) { return _mm512_xor_si512(a, b); }
+        static inline I iand(I a, I b) { return _mm512_and_si512(a, b); }
+        static inline I ior(I a, I b) { return _mm512_or_si512(a, b); }
+        template <int N>
+        static inline I srai(I a) { return _mm512_srai_epi32(a, N); }
+
+        static inline F tofloat(I a) { return _mm512_cvtepi32_ps(a); }
+        static inline I truncate(F a) { return _mm512_cvttps_epi32(a); }
+
+        static inline M gt(F a, F b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+        static inline M ge(F a, F b) { return _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ); }
+        static inline M lt(F a, F b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+        static inline M mand(M a, M b) { return (M)(a & b); }
+        static inline M mandnot(M a, M b) { return (M)(~a & b); }
+
+        static inline F select(M m, F t, F f) { return _mm512_mask_blend_ps(m, f, t); }
+        static inline I selecti(M m, I t, I f) { return _mm512_mask_blend_epi32(m, f, t); }
+
+        static inline F gather(const float *table, I index) { return _mm512_i32gather_ps(index, table, 4); }
+    };
+}
+
+bool NoiseBatch::getNoiseAVX512(const NoiseParams &params, const float *xs, const float *ys, const float *zs, float *out, size_t n)
+{
+    NoiseBatchKernel<AVX512Ops>::getNoiseBatch(params, xs, ys, zs, out, n);
+    return true;
+}
+
+bool NoiseBatch::domainWarpAVX512(const WarpParams &params, float *xs, float *ys, float *zs, size_t n)
+{
+    NoiseBatchKernel<AVX512Ops>::domainWarpBatch(params, xs, ys, zs, n);
+    return true;
+}
+#else
+bool NoiseBatch::getNoiseAVX512(const NoiseParams &, const float *, const float *, const float *, float *, size_t)
+{
+    return false;
+}
+
+bool NoiseBatch::domainWarpAVX512(const WarpParams &, float *, float *, float *, size_t)
+{
+    return false;
+}
+#endif
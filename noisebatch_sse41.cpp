@@ -0,0 +1,79 @@
+// built with -msse4.1 -ffp-contract=off (see CMakeLists.txt)
+#include "include/noisebatch.h"
+
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#include "include/noisebatch_kernel.h"
+
+namespace
+{
+    struct SSE41Ops
+    {
+        static const int Width = 4;
+        typedef __m128 F;
+        typedef __m128i I;
+        typedef __m128 M;
+
+        static inline F load(const float *p) { return _mm_loadu_ps(p); }
+        static inline void store(float *p, F v) { _mm_storeu_ps(p, v); }
+        static inline F set(float v) { return _mm_set1_ps(v); }
+        static inline I seti(int v) { return _mm_set1_epi32(v); }
+
+        static inline F add(F a, F b) { return _mm_add_ps(a, b); }
+        static inline F sub(F a, F b) { return _mm_sub_ps(a, b); }
+        static inline F mul(F a, F b) { return _mm_mul_ps(a, b); }
+        static inline F neg(F a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+        static inline F abs(F a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+
+        static inline I iadd(I a, I b) { return _mm_add_epi32(a, b); }
+        static inline I isub(I a, I b) { return _mm_sub_epi32(a, b); }
+        static inline I imul(I a, I b) { return _mm_mullo_epi32(a, b); }
+        static inline I ixor(I a, I b) { return _mm_xor_si128(a, b); }
+        static inline I iand(I a, I b) { return _mm_and_si128(a, b); }
+        static inline I ior(I a, I b) { return _mm_or_si128(a, b); }
+        template <int N>
+        static inline I srai(I a) { return _mm_srai_epi32(a, N); }
+
+        static inline F tofloat(I a) { return _mm_cvtepi32_ps(a); }
+        static inline I truncate(F a) { return _mm_cvttps_epi32(a); }
+
+        static inline M gt(F a, F b) { return _mm_cmpgt_ps(a, b); }
+        static inline M ge(F a, F b) { return _mm_cmpge_ps(a, b); }
+        static inline M lt(F a, F b) { return _mm_cmplt_ps(a, b); }
+        static inline M mand(M a, M b) { return _mm_and_ps(a, b); }
+        static inline M mandnot(M a, M b) { return _mm_andnot_ps(a, b); }
+
+        static inline F select(M m, F t, F f) { return _mm_blendv_ps(f, t, m); }
+        static inline I selecti(M m, I t, I f) { return _mm_castps_si128(_mm_blendv_ps(_mm_castsi128_ps(f), _mm_castsi128_ps(t), m)); }
+
+        // no hardware gather before AVX2
+        static inline F gather(const float *table, I index)
+        {
+            return _mm_setr_ps(table[_mm_extract_epi32(index, 0)], table[_mm_extract_epi32(index, 1)],
+                               table[_mm_extract_epi32(index, 2)], table[_mm_extract_epi32(index, 3)]);
+        }
+    };
+}
+
+bool NoiseBatch::getNoiseSSE41(const NoiseParams &params, const float *xs, const float *ys, const float *zs, float *out, size_t n)
+{
+    NoiseBatchKernel<SSE41Ops>::getNoiseBatch(params, xs, ys, zs, out, n);
+    return true;
+}
+
+bool NoiseBatch::domainWarpSSE41(const WarpParams &params, float *xs, float *ys, float *zs, size_t n)
+{
+    NoiseBatchKernel<SSE41Ops>::domainWarpBatch(params, xs, ys, zs, n);
+    return true;
+}
+#else
+bool NoiseBatch::getNoiseSSE41(const NoiseParams &, const float *, const float *, const float *, float *, size_t)
+{
+    return false;
+}
+
+bool NoiseBatch::domainWarpSSE41(const WarpParams &, float *, float *, float *, size_t)
+{
+    return false;
+}
+#endif
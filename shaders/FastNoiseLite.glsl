@@ -2143,6 +2143,326 @@ void _fnlDomainWarpFractalIndependent3D(fnl_state state, inout FNLfloat x, inout
     }
 }
 
+// Analytic Derivatives
+// gradient taken in rotated space back to the space before the coordinate transform (frequency
+// aside): the transposed rotation. only used for OpenSimplex2 noise and warps, which rotate by default
+vec3 _fnlTransformGradient3D(fnl_state state, vec3 g)
+{
+    switch (state.rotation_type_3d)
+    {
+        case FNL_ROTATION_IMPROVE_XY_PLANES:
+        {
+            float s2 = (g.x + g.y) * -0.211324865405187;
+            float zk = g.z * 0.577350269189626;
+            return vec3(g.x + s2 + zk, g.y + s2 + zk, zk - (g.x + g.y) * 0.577350269189626);
+        }
+        case FNL_ROTATION_IMPROVE_XZ_PLANES:
+        {
+            float s2 = (g.x + g.z) * -0.211324865405187;
+            float yk = g.y * 0.577350269189626;
+            return vec3(g.x + s2 + yk, yk - (g.x + g.z) * 0.577350269189626, g.z + s2 + yk);
+        }
+        default:
+        {
+            float r = (g.x + g.y + g.z) * (2.f / 3.f);
+            return vec3(r) - g;
+        }
+    }
+}
+
+vec3 _fnlGradVector3D(int seed, int xPrimed, int yPrimed, int zPrimed)
+{
+    int hash = _fnlHash3D(seed, xPrimed, yPrimed, zPrimed);
+    hash ^= hash >> 15;
+    hash &= 63 << 2;
+    return vec3(GRADIENTS_3D[hash], GRADIENTS_3D[hash | 1], GRADIENTS_3D[hash | 2]);
+}
+
+// _fnlSingleOpenSimplex23D plus the gradient of each (0.6 - |d|^2)^4 * dot(g, d) term:
+// -8 * t^3 * dot(g, d) * d + t^4 * g
+float _fnlSingleOpenSimplex23DDerivative(int seed, FNLfloat x, FNLfloat y, FNLfloat z, out vec3 gradient)
+{
+    int i = _fnlFastRound(x);
+    int j = _fnlFastRound(y);
+    int k = _fnlFastRound(z);
+    float x0 = x - float(i);
+    float y0 = y - float(j);
+    float z0 = z - float(k);
+
+    int xNSign = int(-1.f - x0) | 1;
+    int yNSign = int(-1.f - y0) | 1;
+    int zNSign = int(-1.f - z0) | 1;
+
+    float ax0 = float(xNSign) * -x0;
+    float ay0 = float(yNSign) * -y0;
+    float az0 = float(zNSign) * -z0;
+
+    i *= PRIME_X;
+    j *= PRIME_Y;
+    k *= PRIME_Z;
+
+    float value = 0.f;
+    gradient = vec3(0.f);
+    float a = (0.6f - x0 * x0) - (y0 * y0 + z0 * z0);
+
+    for (int l = 0; ; l++)
+    {
+        if (a > 0.f)
+        {
+            vec3 g = _fnlGradVector3D(seed, i, j, k);
+            vec3 d = vec3(x0, y0, z0);
+            float dotgd = dot(g, d);
+            value += (a * a) * (a * a) * dotgd;
+            gradient += -8.f * a * a * a * dotgd * d + (a * a) * (a * a) * g;
+        }
+
+        float b = a + 1.f;
+        int i1 = i;
+        int j1 = j;
+        int k1 = k;
+        float x1 = x0;
+        float y1 = y0;
+        float z1 = z0;
+        if (ax0 >= ay0 && ax0 >= az0)
+        {
+            x1 += float(xNSign);
+            b -= float(xNSign) * 2.f * x1;
+            i1 -= xNSign * PRIME_X;
+        }
+        else if (ay0 > ax0 && ay0 >= az0)
+        {
+            y1 += float(yNSign);
+            b -= float(yNSign) * 2.f * y1;
+            j1 -= yNSign * PRIME_Y;
+        }
+        else
+        {
+            z1 += float(zNSign);
+            b -= float(zNSign) * 2.f * z1;
+            k1 -= zNSign * PRIME_Z;
+        }
+
+        if (b > 0.f)
+        {
+            vec3 g = _fnlGradVector3D(seed, i1, j1, k1);
+            vec3 d = vec3(x1, y1, z1);
+            float dotgd = dot(g, d);
+            value += (b * b) * (b * b) * dotgd;
+            gradient += -8.f * b * b * b * dotgd * d + (b * b) * (b * b) * g;
+        }
+
+        if (l == 1) break;
+
+        ax0 = 0.5f - ax0;
+        ay0 = 0.5f - ay0;
+        az0 = 0.5f - az0;
+
+        x0 = float(xNSign) * ax0;
+        y0 = float(yNSign) * ay0;
+        z0 = float(zNSign) * az0;
+
+        a += (0.75f - ax0) - (ay0 + az0);
+
+        i += (xNSign >> 1) & PRIME_X;
+        j += (yNSign >> 1) & PRIME_Y;
+        k += (zNSign >> 1) & PRIME_Z;
+
+        xNSign = -xNSign;
+        yNSign = -yNSign;
+        zNSign = -zNSign;
+
+        seed = ~seed;
+    }
+
+    gradient *= 32.69428253173828125;
+    return value * 32.69428253173828125;
+}
+
+// _fnlGenFractalFBM3D with the product rule through the weighted-strength amplitude
+float _fnlGenFractalFBM3DDerivative(fnl_state state, FNLfloat x, FNLfloat y, FNLfloat z, out vec3 gradient)
+{
+    int seed = state.seed;
+    float sum = 0.f;
+    float amp = _fnlCalculateFractalBounding(state);
+    vec3 ampGradient = vec3(0.f);
+    float scale = 1.f;
+    gradient = vec3(0.f);
+
+    for (int i = 0; i < state.octaves; i++)
+    {
+        vec3 noiseGradient;
+        float noise = _fnlSingleOpenSimplex23DDerivative(seed++, x, y, z, noiseGradient);
+        noiseGradient *= scale;
+
+        sum += noise * amp;
+        gradient += noiseGradient * amp + noise * ampGradient;
+
+        float weight = _fnlLerp(1.f, (noise + 1.f) * 0.5f, state.weighted_strength);
+        ampGradient = ampGradient * weight + amp * state.weighted_strength * 0.5f * noiseGradient;
+        amp *= weight;
+
+        x *= state.lacunarity;
+        y *= state.lacunarity;
+        z *= state.lacunarity;
+        scale *= state.lacunarity;
+        amp *= state.gain;
+        ampGradient *= state.gain;
+    }
+
+    return sum;
+}
+
+// _fnlGenFractalRidged3D; d|n| = sign(n) * dn
+float _fnlGenFractalRidged3DDerivative(fnl_state state, FNLfloat x, FNLfloat y, FNLfloat z, out vec3 gradient)
+{
+    int seed = state.seed;
+    float sum = 0.f;
+    float amp = _fnlCalculateFractalBounding(state);
+    vec3 ampGradient = vec3(0.f);
+    float scale = 1.f;
+    gradient = vec3(0.f);
+
+    for (int i = 0; i < state.octaves; i++)
+    {
+        vec3 noiseGradient;
+        float signedNoise = _fnlSingleOpenSimplex23DDerivative(seed++, x, y, z, noiseGradient);
+        float noise = _fnlFastAbs(signedNoise);
+        noiseGradient *= signedNoise < 0.f ? -scale : scale;
+
+        sum += (noise * -2.f + 1.f) * amp;
+        gradient += noiseGradient * -2.f * amp + (noise * -2.f + 1.f) * ampGradient;
+
+        float weight = _fnlLerp(1.f, 1.f - noise, state.weighted_strength);
+        ampGradient = ampGradient * weight - amp * state.weighted_strength * noiseGradient;
+        amp *= weight;
+
+        x *= state.lacunarity;
+        y *= state.lacunarity;
+        z *= state.lacunarity;
+        scale *= state.lacunarity;
+        amp *= state.gain;
+        ampGradient *= state.gain;
+    }
+
+    return sum;
+}
+
+// _fnlSingleDomainWarpOpenSimplex2Gradient plus d(displacement)/d(x, y, z) in its frequency scaled
+// input space. column i of derivative is the derivative along input axis i
+void _fnlSingleDomainWarpOpenSimplex2GradientDerivative(int seed, float warpAmp, float frequency, FNLfloat x, FNLfloat y, FNLfloat z, inout FNLfloat xr, inout FNLfloat yr, inout FNLfloat zr, bool outGradOnly, out mat3 derivative)
+{
+    x *= frequency;
+    y *= frequency;
+    z *= frequency;
+
+    int i = _fnlFastRound(x);
+    int j = _fnlFastRound(y);
+    int k = _fnlFastRound(z);
+    float x0 = x - float(i);
+    float y0 = y - float(j);
+    float z0 = z - float(k);
+
+    int xNSign = int(-x0 - 1.f) | 1;
+    int yNSign = int(-y0 - 1.f) | 1;
+    int zNSign = int(-z0 - 1.f) | 1;
+
+    float ax0 = float(xNSign) * -x0;
+    float ay0 = float(yNSign) * -y0;
+    float az0 = float(zNSign) * -z0;
+
+    i *= PRIME_X;
+    j *= PRIME_Y;
+    k *= PRIME_Z;
+
+    vec3 v = vec3(0.f);
+    derivative = mat3(0.f);
+
+    float a = (0.6f - x0 * x0) - (y0 * y0 + z0 * z0);
+    for (int l = 0; l < 2; l++)
+    {
+        for (int corner = 0; corner < 2; corner++)
+        {
+            float t = a;
+            int ic = i;
+            int jc = j;
+            int kc = k;
+            vec3 d = vec3(x0, y0, z0);
+            if (corner == 1)
+            {
+                t += 1.f;
+                if (ax0 >= ay0 && ax0 >= az0)
+                {
+                    d.x += float(xNSign);
+                    t -= float(xNSign) * 2.f * d.x;
+                    ic -= xNSign * PRIME_X;
+                }
+                else if (ay0 > ax0 && ay0 >= az0)
+                {
+                    d.y += float(yNSign);
+                    t -= float(yNSign) * 2.f * d.y;
+                    jc -= yNSign * PRIME_Y;
+                }
+                else
+                {
+                    d.z += float(zNSign);
+                    t -= float(zNSign) * 2.f * d.z;
+                    kc -= zNSign * PRIME_Z;
+                }
+            }
+            if (t <= 0.f) continue;
+
+            int hash = _fnlHash3D(seed, ic, jc, kc);
+            vec3 g = vec3(0.f);
+            vec3 o;
+            float dotgd = 1.f;
+            if (outGradOnly)
+            {
+                hash &= 255 << 2;
+                o = vec3(RAND_VECS_3D[hash], RAND_VECS_3D[hash | 1], RAND_VECS_3D[hash | 2]);
+            }
+            else
+            {
+                int index1 = hash & (63 << 2);
+                int index2 = (hash >> 6) & (255 << 2);
+                g = vec3(GRADIENTS_3D[index1], GRADIENTS_3D[index1 | 1], GRADIENTS_3D[index1 | 2]);
+                o = vec3(RAND_VECS_3D[index2], RAND_VECS_3D[index2 | 1], RAND_VECS_3D[index2 | 2]);
+                dotgd = dot(g, d);
+            }
+
+            float tt = t * t;
+            v += (tt * tt) * (dotgd * o);
+            derivative += outerProduct(o, -8.f * tt * t * dotgd * d + tt * tt * g);
+        }
+
+        if (l == 1) break;
+
+        ax0 = 0.5f - ax0;
+        ay0 = 0.5f - ay0;
+        az0 = 0.5f - az0;
+
+        x0 = float(xNSign) * ax0;
+        y0 = float(yNSign) * ay0;
+        z0 = float(zNSign) * az0;
+
+        a += (0.75f - ax0) - (ay0 + az0);
+
+        i += (xNSign >> 1) & PRIME_X;
+        j += (yNSign >> 1) & PRIME_Y;
+        k += (zNSign >> 1) & PRIME_Z;
+
+        xNSign = -xNSign;
+        yNSign = -yNSign;
+        zNSign = -zNSign;
+
+        seed += 1293373;
+    }
+
+    xr += v.x * warpAmp;
+    yr += v.y * warpAmp;
+    zr += v.z * warpAmp;
+    derivative *= warpAmp;
+}
+
 // ====================
 // Public API
 // ====================
@@ -2254,4 +2574,83 @@ void fnlDomainWarp3D(fnl_state state, inout FNLfloat x, inout FNLfloat y, inout
             _fnlDomainWarpSingle3D(state, x, y, z);
             break;
     }
-}
\ No newline at end of file
+}
+
+// 3D noise at given position and its gradient with respect to (x, y, z).
+// Analytic for OpenSimplex2 with no fractal, FBm or Ridged, central differences otherwise.
+// @returns The same value as fnlGetNoise3D.
+float fnlGetNoise3DDerivative(fnl_state state, FNLfloat x, FNLfloat y, FNLfloat z, out vec3 gradient)
+{
+    if (state.noise_type != FNL_NOISE_OPENSIMPLEX2 || state.fractal_type > FNL_FRACTAL_RIDGED)
+    {
+        FNLfloat h = 0.001f / state.frequency;
+        gradient = vec3(fnlGetNoise3D(state, x + h, y, z) - fnlGetNoise3D(state, x - h, y, z),
+                        fnlGetNoise3D(state, x, y + h, z) - fnlGetNoise3D(state, x, y - h, z),
+                        fnlGetNoise3D(state, x, y, z + h) - fnlGetNoise3D(state, x, y, z - h)) / (2.f * h);
+        return fnlGetNoise3D(state, x, y, z);
+    }
+
+    _fnlTransformNoiseCoordinate3D(state, x, y, z);
+
+    float value;
+    switch (state.fractal_type)
+    {
+        case FNL_FRACTAL_FBM:
+            value = _fnlGenFractalFBM3DDerivative(state, x, y, z, gradient);
+            break;
+        case FNL_FRACTAL_RIDGED:
+            value = _fnlGenFractalRidged3DDerivative(state, x, y, z, gradient);
+            break;
+        default:
+            value = _fnlSingleOpenSimplex23DDerivative(state.seed, x, y, z, gradient);
+            break;
+    }
+
+    gradient = _fnlTransformGradient3D(state, gradient) * state.frequency;
+    return value;
+}
+
+// 3D warps the input position like fnlDomainWarp3D and returns the Jacobian of the warp:
+// column i is the derivative of the warped position along input axis i, so the gradient of
+// noise sampled at the warped position is transpose(jacobian) * gradient there.
+// Analytic for single (non fractal) OpenSimplex2 and OpenSimplex2Reduced warps, central
+// differences otherwise.
+void fnlDomainWarp3DDerivative(fnl_state state, inout FNLfloat x, inout FNLfloat y, inout FNLfloat z, out mat3 jacobian)
+{
+    bool simplexWarp = state.domain_warp_type == FNL_DOMAIN_WARP_OPENSIMPLEX2 || state.domain_warp_type == FNL_DOMAIN_WARP_OPENSIMPLEX2_REDUCED;
+    if (!simplexWarp || state.fractal_type == FNL_FRACTAL_DOMAIN_WARP_PROGRESSIVE || state.fractal_type == FNL_FRACTAL_DOMAIN_WARP_INDEPENDENT)
+    {
+        FNLfloat h = 0.001f / state.frequency;
+        for (int column = 0; column < 3; column++)
+        {
+            vec3 offset = vec3(0.f);
+            offset[column] = h;
+            vec3 plus = vec3(x, y, z) + offset;
+            vec3 minus = vec3(x, y, z) - offset;
+            fnlDomainWarp3D(state, plus.x, plus.y, plus.z);
+            fnlDomainWarp3D(state, minus.x, minus.y, minus.z);
+            jacobian[column] = (plus - minus) / (2.f * h);
+        }
+        fnlDomainWarp3D(state, x, y, z);
+        return;
+    }
+
+    float amp = state.domain_warp_amp * _fnlCalculateFractalBounding(state);
+    bool reduced = state.domain_warp_type == FNL_DOMAIN_WARP_OPENSIMPLEX2_REDUCED;
+
+    FNLfloat xs = x;
+    FNLfloat ys = y;
+    FNLfloat zs = z;
+    _fnlTransformDomainWarpCoordinate3D(state, xs, ys, zs);
+
+    // displacement derivatives in rotated, frequency scaled space, then back to input space
+    mat3 displacement;
+    _fnlSingleDomainWarpOpenSimplex2GradientDerivative(state.seed, amp * (reduced ? 7.71604938271605 : 32.69428253173828125), state.frequency,
+                                                       xs, ys, zs, x, y, z, reduced, displacement);
+    mat3 rows = transpose(displacement);
+    for (int row = 0; row < 3; row++)
+    {
+        rows[row] = _fnlTransformGradient3D(state, rows[row]) * state.frequency;
+    }
+    jacobian = mat3(1.f) + transpose(rows);
+}
@@ -0,0 +1,30 @@
+#version 460 core
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;
+
+// compacts the cells that cross the surface into activeCells, so the emit pass runs one packed
+// invocation per active cell instead of mostly idle 8x8x8 groups over the whole grid.
+// densityStorage.glsl and meshCommon.glsl are prepended
+
+void main() {
+    ivec3 pos = ivec3(gl_GlobalInvocationID.xyz);
+    if (pos.x >= densitySize - 1 || pos.y >= densitySize - 1 || pos.z >= densitySize - 1 || !cellInRange(pos)) {
+        return;
+    }
+
+    int cubeIndex = 0;
+    if (loadDensity(pos) < isoLevel) cubeIndex |= 1;
+    if (loadDensity(pos + ivec3(1, 0, 0)) < isoLevel) cubeIndex |= 2;
+    if (loadDensity(pos + ivec3(1, 1, 0)) < isoLevel) cubeIndex |= 4;
+    if (loadDensity(pos + ivec3(0, 1, 0)) < isoLevel) cubeIndex |= 8;
+    if (loadDensity(pos + ivec3(0, 0, 1)) < isoLevel) cubeIndex |= 16;
+    if (loadDensity(pos + ivec3(1, 0, 1)) < isoLevel) cubeIndex |= 32;
+    if (loadDensity(pos + ivec3(1, 1, 1)) < isoLevel) cubeIndex |= 64;
+    if (loadDensity(pos + ivec3(0, 1, 1)) < isoLevel) cubeIndex |= 128;
+
+    if (edgeTable(cubeIndex) == 0) return;
+
+    // whoever opens a new block of 512 adds the group that will process it
+    uint slot = atomicAdd(activeCellCount, 1u);
+    if (slot % 512u == 0u) atomicAdd(activeGroupsX, 1u);
+    activeCells[slot] = (uint(cellIndex(pos)) << 8) | uint(cubeIndex);
+}
@@ -0,0 +1,79 @@
+#version 460 core
+layout(local_size_x = 4, local_size_y = 4, local_size_z = 4) in;
+
+// low-frequency fields sampled on a coarse lattice, reconstructed trilinearly by density.comp.glsl.
+// one invocation per lattice point of the finer of the two lattices
+layout(std430, binding = 7) buffer WarpFieldBuffer {
+    float warpField[]; // xyz displacement per lattice point
+};
+
+layout(std430, binding = 8) buffer ZoneFieldBuffer {
+    float zoneField[]; // MAX_CAVES lattices of zone noise
+};
+
+uniform int densitySize;
+uniform int u_Seed;
+uniform vec3 u_Offset;
+uniform int u_WarpStride;
+uniform int u_ZoneStride;
+
+const int MAX_CAVES = 8;
+uniform int u_NumCaves;
+uniform vec3 u_CaveOffsets[MAX_CAVES];
+uniform float u_CaveZoneFrequencies[MAX_CAVES];
+
+vec3 warpPosition(vec3 worldPos) {
+    fnl_state warpNoise = fnlCreateState(u_Seed);
+    warpNoise.noise_type = FNL_NOISE_OPENSIMPLEX2;
+    warpNoise.domain_warp_type = FNL_DOMAIN_WARP_OPENSIMPLEX2;
+    warpNoise.frequency = 0.005;
+    warpNoise.domain_warp_amp = 5.0;
+
+    FNLfloat wx = worldPos.x;
+    FNLfloat wy = worldPos.y;
+    FNLfloat wz = worldPos.z;
+    fnlDomainWarp3D(warpNoise, wx, wy, wz);
+    return vec3(wx, wy, wz);
+}
+
+void main() {
+    ivec3 id = ivec3(gl_GlobalInvocationID.xyz);
+
+    if (u_WarpStride > 1)
+    {
+        int n = latticeSize(densitySize, u_WarpStride);
+        if (all(lessThan(id, ivec3(n))))
+        {
+            vec3 worldPos = vec3(id * u_WarpStride) + u_Offset - vec3(1.0);
+            vec3 displacement = warpPosition(worldPos) - worldPos;
+            int index = latticeIndex(id, n) * 3;
+            warpField[index + 0] = displacement.x;
+            warpField[index + 1] = displacement.y;
+            warpField[index + 2] = displacement.z;
+        }
+    }
+
+    if (u_ZoneStride > 1)
+    {
+        int n = latticeSize(densitySize, u_ZoneStride);
+        if (all(lessThan(id, ivec3(n))))
+        {
+            // zone noise is sampled at the full-rate warped position of the lattice point
+            vec3 worldPos = vec3(id * u_ZoneStride) + u_Offset - vec3(1.0);
+            vec3 warpedPos = warpPosition(worldPos);
+            int index = latticeIndex(id, n);
+
+            for (int i = 0; i < u_NumCaves; ++i)
+            {
+                fnl_state zoneNoise = fnlCreateState(u_Seed + 9999 + i * 131);
+                zoneNoise.noise_type = FNL_NOISE_OPENSIMPLEX2;
+                zoneNoise.fractal_type = FNL_FRACTAL_FBM;
+                zoneNoise.frequency = u_CaveZoneFrequencies[i];
+                zoneNoise.octaves = 2;
+
+                vec3 p = warpedPos + u_CaveOffsets[i];
+                zoneField[i * n * n * n + index] = fnlGetNoise3D(zoneNoise, p.x, p.y, p.z);
+            }
+        }
+    }
+}
@@ -0,0 +1,18 @@
+// helpers shared by coarseFields.comp.glsl and density.comp.glsl.
+// a field sampled every `stride` voxels lives on a latticeSize(stride)^3 grid, x fastest;
+// lattice point i sits on voxel i * stride, so the last point lies at or past densitySize - 1
+
+int latticeSize(int densitySize, int stride) {
+    return (densitySize - 1 + stride - 1) / stride + 1;
+}
+
+int latticeIndex(ivec3 p, int n) {
+    return p.x + p.y * n + p.z * n * n;
+}
+
+// cell origin and fractional position of a voxel inside the lattice
+void latticeCell(uvec3 id, int stride, int n, out ivec3 cell, out vec3 t) {
+    vec3 g = vec3(id) / float(stride);
+    cell = min(ivec3(floor(g)), ivec3(n - 2));
+    t = g - vec3(cell);
+}
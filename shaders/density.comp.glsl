@@ -1,14 +1,46 @@
 #version 460 core
 layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;
 
-layout(std430, binding = 0) buffer DensityBuffer {
-    float density[];
+// DensityBuffer (binding 0), densitySize and the storage format come from densityStorage.glsl
+
+layout(std430, binding = 5) buffer HeightmapBuffer {
+    float heightmap[];
+};
+
+// cave noise evaluations avoided by the masks below, reset every frame
+layout(std430, binding = 6) buffer CaveStatsBuffer {
+    uint caveNoiseSkipped;
+    uint zoneNoiseSkipped;
+    uint tilesSkipped;
+};
+
+// coarse lattices from coarseFields.comp.glsl, used when the matching stride is > 1
+layout(std430, binding = 7) buffer WarpFieldBuffer {
+    float warpField[];
+};
+
+layout(std430, binding = 8) buffer ZoneFieldBuffer {
+    float zoneField[];
+};
+
+// per-sample normals, same layout as gradient.comp.glsl, written when u_AnalyticGradients is set
+layout(std430, binding = 9) buffer GradientBuffer {
+    float gradients[];
 };
 
+shared uint s_caveSkipped;
+shared uint s_zoneSkipped;
+
 uniform int gridSize;
-uniform int densitySize;
 uniform int u_Seed;
 uniform vec3 u_Offset;
+uniform int u_Walls;       // 1 = air on the x and z faces closes the single volume; 0 for chunks, whose
+                           // neighbours carry the terrain on
+uniform int u_TerrainMode; // 0 = volumetric, 1 = heightmap from heightmap.comp.glsl
+uniform int u_WarpStride;  // 1 = evaluate the warp per voxel
+uniform int u_ZoneStride;  // 1 = evaluate zone noise per voxel
+uniform int u_AnalyticGradients; // 1 = chain the noise derivatives into an exact gradient per sample.
+                                 // volumetric mode with both strides at 1 only
 
 const int MAX_CAVES = 8;
 uniform int u_NumCaves;
@@ -24,77 +56,284 @@ float smin(float a, float b, float k) {
     return mix(b, a, h) - k * h * (1.0 - h);
 }
 
-void main() {
-    uvec3 id = gl_GlobalInvocationID.xyz;
-    if (id.x >= densitySize || id.y >= densitySize || id.z >= densitySize) return;
+// gradient of smin(a, b, k): the terms through h cancel, leaving the same blend
+vec3 sminGradient(float a, float b, float k, vec3 gradientA, vec3 gradientB) {
+    float h = clamp(0.5 + 0.5 * (b - a) / k, 0.0, 1.0);
+    return mix(gradientB, gradientA, h);
+}
+
+bool onWall(uvec3 id) {
+    return u_Walls == 1 && (id.x == 0 || id.x == densitySize - 1 || id.z == 0 || id.z == densitySize - 1);
+}
+
+// bedrock and walls are constants, so they get the outward face their neighbours would see
+vec3 sentinelGradient(uvec3 id) {
+    if (onWall(id)) {
+        if (id.x == 0) return vec3(1.0, 0.0, 0.0);
+        if (id.x == densitySize - 1) return vec3(-1.0, 0.0, 0.0);
+        if (id.z == 0) return vec3(0.0, 0.0, 1.0);
+        return vec3(0.0, 0.0, -1.0);
+    }
+    return id.y < 2 ? vec3(0.0, 1.0, 0.0) : vec3(0.0, -1.0, 0.0);
+}
+
+vec3 fetchWarp(ivec3 p, int n) {
+    int index = latticeIndex(p, n) * 3;
+    return vec3(warpField[index], warpField[index + 1], warpField[index + 2]);
+}
+
+// y and z first, x last: the CPU path collapses a whole x row to one lattice line that way,
+// and both sides keep the same operation order
+vec3 coarseWarp(uvec3 id) {
+    int n = latticeSize(densitySize, u_WarpStride);
+    ivec3 c;
+    vec3 t;
+    latticeCell(id, u_WarpStride, n, c, t);
+
+    vec3 line0 = mix(mix(fetchWarp(c, n), fetchWarp(c + ivec3(0, 1, 0), n), t.y),
+                     mix(fetchWarp(c + ivec3(0, 0, 1), n), fetchWarp(c + ivec3(0, 1, 1), n), t.y), t.z);
+    vec3 line1 = mix(mix(fetchWarp(c + ivec3(1, 0, 0), n), fetchWarp(c + ivec3(1, 1, 0), n), t.y),
+                     mix(fetchWarp(c + ivec3(1, 0, 1), n), fetchWarp(c + ivec3(1, 1, 1), n), t.y), t.z);
+    return mix(line0, line1, t.x);
+}
+
+float fetchZone(ivec3 p, int n, int base) {
+    return zoneField[base + latticeIndex(p, n)];
+}
 
-    uint index = id.x + id.y * densitySize + id.z * densitySize * densitySize;
-    
+float coarseZone(uvec3 id, int cave) {
+    int n = latticeSize(densitySize, u_ZoneStride);
+    int base = cave * n * n * n;
+    ivec3 c;
+    vec3 t;
+    latticeCell(id, u_ZoneStride, n, c, t);
+
+    float line0 = mix(mix(fetchZone(c, n, base), fetchZone(c + ivec3(0, 1, 0), n, base), t.y),
+                      mix(fetchZone(c + ivec3(0, 0, 1), n, base), fetchZone(c + ivec3(0, 1, 1), n, base), t.y), t.z);
+    float line1 = mix(mix(fetchZone(c + ivec3(1, 0, 0), n, base), fetchZone(c + ivec3(1, 1, 0), n, base), t.y),
+                      mix(fetchZone(c + ivec3(1, 0, 1), n, base), fetchZone(c + ivec3(1, 1, 1), n, base), t.y), t.z);
+    return mix(line0, line1, t.x);
+}
+
+// gradient is d density / d worldPos, only filled in when u_AnalyticGradients is set
+float evaluateDensity(uvec3 id, bool tileAboveCeiling, inout uint caveSkipped, inout uint zoneSkipped, out vec3 gradient) {
     vec3 worldPos = vec3(id) + u_Offset - vec3(1.0);
+    bool analytic = u_AnalyticGradients == 1;
+    gradient = vec3(0.0);
+
+    // bedrock and walls overwrite everything, so nothing below is needed there
+    if (id.y < 3 || onWall(id))
+    {
+        caveSkipped += uint(u_NumCaves);
+        zoneSkipped += uint(u_NumCaves);
+        gradient = sentinelGradient(id);
+        return id.y == 0 || onWall(id) ? -10.0 : 100.0;
+    }
 
-    fnl_state warpNoise = fnlCreateState(u_Seed);
-    warpNoise.noise_type = FNL_NOISE_OPENSIMPLEX2;
-    warpNoise.domain_warp_type = FNL_DOMAIN_WARP_OPENSIMPLEX2;
-    warpNoise.frequency = 0.005;
-    warpNoise.domain_warp_amp = 5.0;
-
-    FNLfloat wx = worldPos.x;
-    FNLfloat wy = worldPos.y;
-    FNLfloat wz = worldPos.z;
-    fnlDomainWarp3D(warpNoise, wx, wy, wz);
-    vec3 warpedPos = vec3(wx, wy, wz);
-
-    fnl_state terrainNoise = fnlCreateState(u_Seed);
-    terrainNoise.noise_type = FNL_NOISE_OPENSIMPLEX2;
-    terrainNoise.fractal_type = FNL_FRACTAL_FBM;
-    terrainNoise.frequency = 0.01; 
-    terrainNoise.octaves = 4;
-
-    float terrainHeight = fnlGetNoise3D(terrainNoise, warpedPos.x, 0.0, warpedPos.z) * 40.0 + 20.0;
+    vec3 warpedPos;
+    mat3 warpJacobian = mat3(1.0); // column i = d warpedPos / d worldPos[i]
+    if (u_WarpStride > 1)
+    {
+        warpedPos = worldPos + coarseWarp(id);
+    }
+    else
+    {
+        fnl_state warpNoise = fnlCreateState(u_Seed);
+        warpNoise.noise_type = FNL_NOISE_OPENSIMPLEX2;
+        warpNoise.domain_warp_type = FNL_DOMAIN_WARP_OPENSIMPLEX2;
+        warpNoise.frequency = 0.005;
+        warpNoise.domain_warp_amp = 5.0;
+
+        FNLfloat wx = worldPos.x;
+        FNLfloat wy = worldPos.y;
+        FNLfloat wz = worldPos.z;
+        if (analytic)
+        {
+            fnlDomainWarp3DDerivative(warpNoise, wx, wy, wz, warpJacobian);
+        }
+        else
+        {
+            fnlDomainWarp3D(warpNoise, wx, wy, wz);
+        }
+        warpedPos = vec3(wx, wy, wz);
+    }
+
+    float terrainHeight;
+    if (u_TerrainMode == 1)
+    {
+        terrainHeight = heightmap[id.x + id.z * densitySize];
+    }
+    else
+    {
+        fnl_state terrainNoise = fnlCreateState(u_Seed);
+        terrainNoise.noise_type = FNL_NOISE_OPENSIMPLEX2;
+        terrainNoise.fractal_type = FNL_FRACTAL_FBM;
+        terrainNoise.frequency = 0.01; 
+        terrainNoise.octaves = 4;
+
+        if (analytic)
+        {
+            vec3 noiseGradient;
+            terrainHeight = fnlGetNoise3DDerivative(terrainNoise, warpedPos.x, 0.0, warpedPos.z, noiseGradient) * 40.0 + 20.0;
+            gradient = vec3(noiseGradient.x, 0.0, noiseGradient.z) * 40.0 * warpJacobian;
+        }
+        else
+        {
+            terrainHeight = fnlGetNoise3D(terrainNoise, warpedPos.x, 0.0, warpedPos.z) * 40.0 + 20.0;
+        }
+    }
     float currentDensity = terrainHeight - worldPos.y;
+    gradient.y -= 1.0;
 
     float caveThreshold = 0.67; 
+    float heightMask = clamp((u_CaveCeiling - worldPos.y) * 0.15, 0.0, 1.0);
+    vec3 heightMaskGradient = heightMask > 0.0 && heightMask < 1.0 ? vec3(0.0, -0.15, 0.0) : vec3(0.0);
+
+    // masks first: a zero mask makes mix(100.0, caveSDF, finalMask) exactly 100.0,
+    // so the noise behind it is skipped and only the smin against 100.0 is kept
+    if (tileAboveCeiling)
+    {
+        caveSkipped += uint(u_NumCaves);
+        zoneSkipped += uint(u_NumCaves);
+        for (int i = 0; i < u_NumCaves; ++i)
+        {
+            gradient = sminGradient(currentDensity, 100.0, 4.0, gradient, vec3(0.0));
+            currentDensity = smin(currentDensity, 100.0, 4.0);
+        }
+        return currentDensity;
+    }
 
     for (int i = 0; i < u_NumCaves; ++i)
     {
-        fnl_state caveNoise = fnlCreateState(u_Seed + i * 431);
-        caveNoise.noise_type = FNL_NOISE_OPENSIMPLEX2;
-        caveNoise.fractal_type = FNL_FRACTAL_RIDGED;
-        caveNoise.frequency = u_CaveFrequencies[i];
-        caveNoise.octaves = 2; 
-
-        // low-frequency zone noise to cluster caves
-        fnl_state zoneNoise = fnlCreateState(u_Seed + 9999 + i * 131);
-        zoneNoise.noise_type = FNL_NOISE_OPENSIMPLEX2;
-        zoneNoise.fractal_type = FNL_FRACTAL_FBM;
-        zoneNoise.frequency = u_CaveZoneFrequencies[i];
-        zoneNoise.octaves = 2;
-
-        vec3 p = warpedPos + u_CaveOffsets[i];
-        float caveVal = fnlGetNoise3D(caveNoise, p.x, p.y, p.z);
-
-        float caveSDF = (caveThreshold - caveVal) * u_CaveGains[i] * 2.0 * u_NumCaves * u_NumCaves;
-        float heightMask = clamp((u_CaveCeiling - worldPos.y) * 0.15, 0.0, 1.0);
-
-        float zoneVal = fnlGetNoise3D(zoneNoise, p.x, p.y, p.z);
-        float zoneMask = smoothstep(u_CaveZoneThreshold[i] - 0.05, u_CaveZoneThreshold[i] + 0.05, zoneVal * 0.5 + 0.5);
-        float finalMask = zoneMask * heightMask;
-        caveSDF = mix(100.0, caveSDF, finalMask);
+        float caveSDF = 100.0;
+        vec3 caveGradient = vec3(0.0);
+
+        if (heightMask == 0.0)
+        {
+            caveSkipped++;
+            zoneSkipped++;
+        }
+        else
+        {
+            vec3 p = warpedPos + u_CaveOffsets[i];
+
+            float zoneVal;
+            vec3 zoneGradient = vec3(0.0);
+            if (u_ZoneStride > 1)
+            {
+                zoneVal = coarseZone(id, i);
+            }
+            else
+            {
+                // low-frequency zone noise to cluster caves
+                fnl_state zoneNoise = fnlCreateState(u_Seed + 9999 + i * 131);
+                zoneNoise.noise_type = FNL_NOISE_OPENSIMPLEX2;
+                zoneNoise.fractal_type = FNL_FRACTAL_FBM;
+                zoneNoise.frequency = u_CaveZoneFrequencies[i];
+                zoneNoise.octaves = 2;
+
+                if (analytic)
+                {
+                    zoneVal = fnlGetNoise3DDerivative(zoneNoise, p.x, p.y, p.z, zoneGradient);
+                    zoneGradient = zoneGradient * warpJacobian;
+                }
+                else
+                {
+                    zoneVal = fnlGetNoise3D(zoneNoise, p.x, p.y, p.z);
+                }
+            }
+            float zoneMask = smoothstep(u_CaveZoneThreshold[i] - 0.05, u_CaveZoneThreshold[i] + 0.05, zoneVal * 0.5 + 0.5);
+
+            if (zoneMask == 0.0)
+            {
+                caveSkipped++;
+            }
+            else
+            {
+                fnl_state caveNoise = fnlCreateState(u_Seed + i * 431);
+                caveNoise.noise_type = FNL_NOISE_OPENSIMPLEX2;
+                caveNoise.fractal_type = FNL_FRACTAL_RIDGED;
+                caveNoise.frequency = u_CaveFrequencies[i];
+                caveNoise.octaves = 2; 
+
+                float caveGain = u_CaveGains[i] * 2.0 * u_NumCaves * u_NumCaves;
+                float finalMask = zoneMask * heightMask;
+                float caveVal;
+                if (analytic)
+                {
+                    vec3 caveNoiseGradient;
+                    caveVal = fnlGetNoise3DDerivative(caveNoise, p.x, p.y, p.z, caveNoiseGradient);
+                    caveSDF = (caveThreshold - caveVal) * u_CaveGains[i] * 2.0 * u_NumCaves * u_NumCaves;
 
+                    // smoothstep' = 6t(1 - t) / (edge1 - edge0), on zoneVal * 0.5 + 0.5
+                    float t = clamp((zoneVal * 0.5 + 0.5 - (u_CaveZoneThreshold[i] - 0.05)) / 0.1, 0.0, 1.0);
+                    vec3 zoneMaskGradient = zoneGradient * (6.0 * t * (1.0 - t) / 0.1 * 0.5);
+                    vec3 finalMaskGradient = zoneMaskGradient * heightMask + heightMaskGradient * zoneMask;
+                    caveGradient = -caveGain * (caveNoiseGradient * warpJacobian) * finalMask + (caveSDF - 100.0) * finalMaskGradient;
+                }
+                else
+                {
+                    caveVal = fnlGetNoise3D(caveNoise, p.x, p.y, p.z);
+                    caveSDF = (caveThreshold - caveVal) * u_CaveGains[i] * 2.0 * u_NumCaves * u_NumCaves;
+                }
+
+                caveSDF = mix(100.0, caveSDF, finalMask);
+            }
+        }
+
+        gradient = sminGradient(currentDensity, caveSDF, 4.0, gradient, caveGradient);
         currentDensity = smin(currentDensity, caveSDF, 4.0);
     }
 
-    if (id.y < 3) { 
-        currentDensity = 100.0; // bedrock
+    return currentDensity;
+}
+
+void main() {
+    if (gl_LocalInvocationIndex == 0u)
+    {
+        s_caveSkipped = 0u;
+        s_zoneSkipped = 0u;
+    }
+    barrier();
+
+    // no early return: every invocation has to reach the barriers here and in storeDensity
+    uvec3 id = gl_GlobalInvocationID.xyz;
+    bool inBounds = id.x < densitySize && id.y < densitySize && id.z < densitySize;
+
+    // heightMask only falls with y, so if the lowest row of this 8^3 tile is above the ceiling
+    // no voxel in the tile can see a cave. uniform per workgroup, so no divergence
+    float tileMinY = float(gl_WorkGroupID.y * gl_WorkGroupSize.y) + u_Offset.y - 1.0;
+    bool tileAboveCeiling = clamp((u_CaveCeiling - tileMinY) * 0.15, 0.0, 1.0) == 0.0;
+
+    uint caveSkipped = 0u;
+    uint zoneSkipped = 0u;
+    float value = 0.0;
+    vec3 gradient;
+    if (inBounds)
+    {
+        value = evaluateDensity(id, tileAboveCeiling, caveSkipped, zoneSkipped, gradient);
     }
+    storeDensity(ivec3(id), value, inBounds);
 
-    // walls and floor around surface
-    if (id.x == 0 || id.x == densitySize - 1 || 
-        id.z == 0 || id.z == densitySize - 1 || 
-        id.y == 0)
+    // normalised -gradient, the same convention as computeNormal, so the mesher never reads neighbours
+    if (inBounds && u_AnalyticGradients == 1)
     {
-        currentDensity = -10.0;
+        vec3 n = length(gradient) < 0.0001 ? vec3(0.0, 1.0, 0.0) : normalize(-gradient);
+        int i = int(id.x + id.y * densitySize + id.z * densitySize * densitySize) * 3;
+        gradients[i] = n.x;
+        gradients[i + 1] = n.y;
+        gradients[i + 2] = n.z;
     }
 
-    density[index] = currentDensity;
-}
\ No newline at end of file
+    if (caveSkipped != 0u) atomicAdd(s_caveSkipped, caveSkipped);
+    if (zoneSkipped != 0u) atomicAdd(s_zoneSkipped, zoneSkipped);
+    barrier();
+
+    // one global atomic per workgroup
+    if (gl_LocalInvocationIndex == 0u)
+    {
+        atomicAdd(caveNoiseSkipped, s_caveSkipped);
+        atomicAdd(zoneNoiseSkipped, s_zoneSkipped);
+        if (tileAboveCeiling && u_NumCaves > 0) atomicAdd(tilesSkipped, 1u);
+    }
+}
@@ -0,0 +1,86 @@
+#version 460 core
+// density buffer access shared by the density passes and the mesher. mirrors DensityStorage
+// (include/densitystorage.h): float32 keeps one sample per uint, fp16 and int16 pack an x pair
+// per uint with rows padded to an even length, so an 8^3 workgroup owns whole words
+
+const int DENSITY_FLOAT32 = 0;
+const int DENSITY_FP16 = 1;
+const int DENSITY_INT16 = 2;
+
+layout(std430, binding = 0) buffer DensityBuffer {
+    uint densityWords[];
+};
+
+uniform int densitySize;
+uniform int u_DensityFormat;
+uniform float u_DensityScale; // int16 steps per unit of density
+
+// one slot per invocation of an 8x8x8 group, used to pair up x neighbours in storeDensity
+shared float s_densityStore[512];
+
+uint densityWordIndex(ivec3 p) {
+    if (u_DensityFormat == DENSITY_FLOAT32) {
+        return uint(p.x + p.y * densitySize + p.z * densitySize * densitySize);
+    }
+    int rowWords = (densitySize + 1) / 2;
+    return uint((p.x >> 1) + rowWords * (p.y + p.z * densitySize));
+}
+
+// the sign is kept exactly: negatives never round to zero, so cube indices match float32
+uint encodeDensityHalf(float value) {
+    if (u_DensityFormat == DENSITY_FP16) {
+        value = clamp(value, -65504.0, 65504.0);
+        if (value < 0.0) value = min(value, -6.2e-5);
+        return packHalf2x16(vec2(value, 0.0));
+    }
+    float q = clamp(round(value * u_DensityScale), -32767.0, 32767.0);
+    if (value < 0.0) q = min(q, -1.0);
+    return uint(int(q)) & 0xffffu;
+}
+
+float loadDensity(ivec3 p) {
+    uint word = densityWords[densityWordIndex(p)];
+    if (u_DensityFormat == DENSITY_FLOAT32) {
+        return uintBitsToFloat(word);
+    }
+    int offset = (p.x & 1) * 16;
+    if (u_DensityFormat == DENSITY_FP16) {
+        return unpackHalf2x16(bitfieldExtract(word, offset, 16)).x;
+    }
+    return float(bitfieldExtract(int(word), offset, 16)) / u_DensityScale;
+}
+
+// clamped read and the central-difference normal, shared by gradient.comp.glsl and the mesher
+float getDensity(int x, int y, int z) {
+    int xClamped = clamp(x, 0, densitySize - 1);
+    int yClamped = clamp(y, 0, densitySize - 1);
+    int zClamped = clamp(z, 0, densitySize - 1);
+    return loadDensity(ivec3(xClamped, yClamped, zClamped));
+}
+
+vec3 computeNormal(int x, int y, int z) {
+    float dX = getDensity(x - 1, y, z) - getDensity(x + 1, y, z);
+    float dY = getDensity(x, y - 1, z) - getDensity(x, y + 1, z);
+    float dZ = getDensity(x, y, z - 1) - getDensity(x, y, z + 1);
+    vec3 n = vec3(dX, dY, dZ);
+
+    if (length(n) < 0.0001) {
+        return vec3(0.0, 1.0, 0.0);
+    }
+    return normalize(n);
+}
+
+// has a barrier for the 16-bit formats: every invocation of the group must call it,
+// out of bounds ones with inBounds = false. the even x of each pair writes the word
+void storeDensity(ivec3 p, float value, bool inBounds) {
+    if (u_DensityFormat == DENSITY_FLOAT32) {
+        if (inBounds) densityWords[densityWordIndex(p)] = floatBitsToUint(value);
+    } else {
+        s_densityStore[gl_LocalInvocationIndex] = value;
+        barrier();
+        if (inBounds && (p.x & 1) == 0) {
+            float next = s_densityStore[gl_LocalInvocationIndex + 1u];
+            densityWords[densityWordIndex(p)] = encodeDensityHalf(value) | (encodeDensityHalf(next) << 16);
+        }
+    }
+}
@@ -0,0 +1,21 @@
+#version 460 core
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;
+
+// one normal per density sample, so the mesher fetches 8 gradients per cell instead of taking
+// 6 density reads at each of its 8 corners. densitySize and computeNormal come from densityStorage.glsl
+layout(std430, binding = 9) buffer GradientBuffer {
+    float gradients[];
+};
+
+void main() {
+    ivec3 id = ivec3(gl_GlobalInvocationID.xyz);
+    if (id.x >= densitySize || id.y >= densitySize || id.z >= densitySize) {
+        return;
+    }
+
+    vec3 n = computeNormal(id.x, id.y, id.z);
+    int i = (id.x + id.y * densitySize + id.z * densitySize * densitySize) * 3;
+    gradients[i] = n.x;
+    gradients[i + 1] = n.y;
+    gradients[i + 2] = n.z;
+}
@@ -0,0 +1,38 @@
+#version 460 core
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+// 2.5D terrain: one height per (x, z) column, read by density.comp.glsl when u_TerrainMode == 1
+layout(std430, binding = 5) buffer HeightmapBuffer {
+    float heightmap[];
+};
+
+uniform int densitySize;
+uniform int u_Seed;
+uniform vec3 u_Offset;
+
+void main() {
+    uvec2 id = gl_GlobalInvocationID.xy;
+    if (id.x >= densitySize || id.y >= densitySize) return;
+
+    vec2 worldXZ = vec2(id) + u_Offset.xz - vec2(1.0);
+
+    fnl_state warpNoise = fnlCreateState(u_Seed);
+    warpNoise.noise_type = FNL_NOISE_OPENSIMPLEX2;
+    warpNoise.domain_warp_type = FNL_DOMAIN_WARP_OPENSIMPLEX2;
+    warpNoise.frequency = 0.005;
+    warpNoise.domain_warp_amp = 5.0;
+
+    // warp on the y = 0 plane and keep only the xz displacement, so the height is constant per column
+    FNLfloat wx = worldXZ.x;
+    FNLfloat wy = 0.0;
+    FNLfloat wz = worldXZ.y;
+    fnlDomainWarp3D(warpNoise, wx, wy, wz);
+
+    fnl_state terrainNoise = fnlCreateState(u_Seed);
+    terrainNoise.noise_type = FNL_NOISE_OPENSIMPLEX2;
+    terrainNoise.fractal_type = FNL_FRACTAL_FBM;
+    terrainNoise.frequency = 0.01;
+    terrainNoise.octaves = 4;
+
+    heightmap[id.x + id.y * densitySize] = fnlGetNoise3D(terrainNoise, wx, 0.0, wz) * 40.0 + 20.0;
+}
@@ -0,0 +1,62 @@
+#version 460 core
+layout(local_size_x = 256) in;
+
+// HistoPyramid extraction: one thread per output vertex walks down the pyramid from
+// histoPyramidReduce.comp.glsl to the cell and the triangle corner it belongs to, then
+// interpolates that single edge. no atomics, and vertices come out in cell order, the same
+// order as the prefix-sum path and CpuMesher. densityStorage.glsl and meshCommon.glsl are prepended
+
+uniform int u_Levels;             // reductions above the base level
+uniform uint u_LevelOffsets[16];  // scanValues offset of each level, the per-cell counts first
+uniform uint u_VertexCapacity;
+
+const ivec3 cornerOffsets[8] = ivec3[8](
+    ivec3(0, 0, 0), ivec3(1, 0, 0), ivec3(1, 1, 0), ivec3(0, 1, 0),
+    ivec3(0, 0, 1), ivec3(1, 0, 1), ivec3(1, 1, 1), ivec3(0, 1, 1));
+
+// corners of each edge, interpolated in the same direction as marchingCube.comp.glsl
+const ivec2 edgeCorners[12] = ivec2[12](
+    ivec2(0, 1), ivec2(1, 2), ivec2(2, 3), ivec2(3, 0), ivec2(4, 5), ivec2(5, 6),
+    ivec2(6, 7), ivec2(7, 4), ivec2(0, 4), ivec2(1, 5), ivec2(2, 6), ivec2(3, 7));
+
+void main() {
+    uint vertex = gl_GlobalInvocationID.x;
+    if (vertex >= scanValues[3] || vertex >= u_VertexCapacity) {
+        return;
+    }
+
+    // at each level, skip whole children until the one whose range holds the vertex.
+    // only counted children can hold it, so the padding past a level's end is never read
+    uint k = vertex;
+    uint node = 0u;
+    for (int level = u_Levels - 1; level >= 0; --level) {
+        uint first = node * 8u;
+        for (uint c = 0u; c < 8u; ++c) {
+            uint count = scanValues[u_LevelOffsets[level] + first + c];
+            if (k < count) {
+                node = first + c;
+                break;
+            }
+            k -= count;
+        }
+    }
+
+    int cells = densitySize - 1;
+    int cell = int(node);
+    ivec3 pos = ivec3(cell % cells, (cell / cells) % cells, cell / (cells * cells));
+
+    float d[8];
+    int cubeIndex = 0;
+    for (int c = 0; c < 8; ++c) {
+        d[c] = loadDensity(pos + cornerOffsets[c]);
+        if (d[c] < isoLevel) cubeIndex |= 1 << c;
+    }
+
+    ivec2 edge = edgeCorners[triTable(cubeIndex, int(k))];
+    ivec3 a = pos + cornerOffsets[edge.x];
+    ivec3 b = pos + cornerOffsets[edge.y];
+    vec3 basePos = vec3(pos) - vec3(1.0);
+
+    storeVertex(vertex, interpolateVertex(basePos + vec3(cornerOffsets[edge.x]), basePos + vec3(cornerOffsets[edge.y]), d[edge.x], d[edge.y]),
+                interpolateNormal(cornerNormal(a.x, a.y, a.z), cornerNormal(b.x, b.y, b.z), d[edge.x], d[edge.y]));
+}
@@ -0,0 +1,42 @@
+#version 460 core
+layout(local_size_x = 256) in;
+
+// one HistoPyramid level: every entry is the sum of 8 consecutive entries of the level below.
+// the levels live in the scan buffer after a 4-uint header, which the top level fills in with
+// the indirect dispatch arguments for histoPyramidEmit.comp.glsl (one thread per vertex) and the total
+
+layout(std430, binding = 12) buffer ScanBuffer {
+    uint scanValues[];
+};
+
+// vertexCounter, indexCounter, as in meshCommon.glsl
+layout(std430, binding = 4) buffer CounterBuffer {
+    uint counters[2];
+};
+
+uniform uint u_InputOffset;
+uniform uint u_InputCount;
+uniform uint u_OutputOffset;
+uniform uint u_OutputCount;
+
+void main() {
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= u_OutputCount) {
+        return;
+    }
+
+    uint sum = 0u;
+    for (uint c = 0u; c < 8u; ++c) {
+        uint child = i * 8u + c;
+        if (child < u_InputCount) sum += scanValues[u_InputOffset + child];
+    }
+    scanValues[u_OutputOffset + i] = sum;
+
+    if (u_OutputCount == 1u) {
+        scanValues[0] = (sum + 255u) / 256u;
+        scanValues[1] = 1u;
+        scanValues[2] = 1u;
+        scanValues[3] = sum;
+        counters[0] = sum;
+    }
+}
@@ -0,0 +1,169 @@
+#version 460 core
+// buffers and edge interpolation shared by marchingCube.comp.glsl and the indexed mesher
+// (meshVertices.comp.glsl, meshIndices.comp.glsl). densitySize and computeNormal come from densityStorage.glsl
+
+struct VertexNormal {
+    vec4 position;
+    vec3 normal;
+    float pad; // padding for alignment (vec3 is 12 bytes; adding 4 bytes gives a 16-byte block)
+};
+
+// unified buffer for both vertices and normals.
+layout(std430, binding = 1) buffer VertexNormalBuffer {
+VertexNormal vertexNormals[];
+};
+
+// the same buffer with u_PackedVertices set: 12 bytes per vertex, see storeVertex
+layout(std430, binding = 1) buffer PackedVertexBuffer {
+uint packedVertices[];
+};
+
+// edgetable and tritable from include/edgetable.h and include/tritable.h, uploaded byte for byte:
+// two 16-bit edge masks per uint and four 8-bit triangle edges per uint. read them through
+// edgeTable() and triTable() below
+layout(std430, binding = 2) buffer EdgeTableBuffer {
+uint edgeTableWords[128];
+};
+
+layout(std430, binding = 3) buffer TriTableBuffer {
+uint triTableWords[256 * 4];
+};
+
+// indexCounter is only used by the indexed mesher
+layout(std430, binding = 4) buffer CounterBuffer {
+uint vertexCounter;
+uint indexCounter;
+};
+
+// normalised gradient per density sample from gradient.comp.glsl, 3 floats each
+layout(std430, binding = 9) buffer GradientBuffer {
+float gradients[];
+};
+
+// exclusive prefix sums from meshCount.comp.glsl + prefixScan.comp.glsl: where each cell's (or sample's)
+// output starts. replaces the counter atomics when u_UsePrefixSums is set, so the output order is fixed
+layout(std430, binding = 12) buffer ScanBuffer {
+uint scanValues[];
+};
+
+// cells classifyCells.comp.glsl found crossing the surface. the header doubles as the
+// glDispatchComputeIndirect arguments: one 8x8x8 group per 512 active cells
+layout(std430, binding = 13) buffer ActiveCellBuffer {
+uint activeGroupsX;
+uint activeGroupsY;
+uint activeGroupsZ;
+uint activeCellCount;
+uint activeCells[]; // cellIndex << 8 | cubeIndex
+};
+
+const float isoLevel = 0.0;
+
+int edgeTable(int cubeIndex) {
+    return int(bitfieldExtract(edgeTableWords[cubeIndex >> 1], (cubeIndex & 1) * 16, 16));
+}
+
+// the signed extract keeps the -1 terminators
+int triTable(int cubeIndex, int i) {
+    return bitfieldExtract(int(triTableWords[cubeIndex * 4 + (i >> 2)]), (i & 3) * 8, 8);
+}
+uniform int u_UseActiveCells; // 1 = dispatched indirectly over activeCells instead of the whole grid
+uniform int u_UseGradients; // 1 = read the gradient pass instead of central differences per corner
+uniform int u_PackedVertices;
+uniform int u_UsePrefixSums;
+uniform uint u_ScanBase;    // scanValues index of this pass's first cell or sample
+// chunked worlds: the x and z cell range [x, y] this chunk meshes; the padding cells past it are
+// meshed by the neighbouring chunk. y = 0 meshes the whole grid
+uniform ivec2 u_CellRange;
+
+bool cellInRange(ivec3 pos) {
+    return u_CellRange.y == 0 ||
+           (pos.x >= u_CellRange.x && pos.x <= u_CellRange.y && pos.z >= u_CellRange.x && pos.z <= u_CellRange.y);
+}
+
+// cells on the first or last x / z of the range, which the neighbouring chunk also has
+bool onCellRangeBorder(ivec3 pos) {
+    return u_CellRange.y != 0 &&
+           (pos.x == u_CellRange.x || pos.x == u_CellRange.y || pos.z == u_CellRange.x || pos.z == u_CellRange.y);
+}
+
+int cellIndex(ivec3 pos) {
+    int cells = densitySize - 1;
+    return pos.x + pos.y * cells + pos.z * cells * cells;
+}
+
+// the cell this invocation meshes, false if none. from the active cell list its cube index comes
+// along; over the whole grid cubeIndex is -1 and the caller still has to classify the cell
+bool meshCell(out ivec3 pos, out int cubeIndex) {
+    cubeIndex = -1;
+    if (u_UseActiveCells != 0) {
+        uint slot = gl_WorkGroupID.x * 512u + gl_LocalInvocationIndex;
+        if (slot >= activeCellCount) return false;
+        uint entry = activeCells[slot];
+        int cells = densitySize - 1;
+        int cell = int(entry >> 8);
+        pos = ivec3(cell % cells, (cell / cells) % cells, cell / (cells * cells));
+        cubeIndex = int(entry & 0xffu);
+        return true;
+    }
+    pos = ivec3(gl_GlobalInvocationID.xyz);
+    return pos.x < densitySize - 1 && pos.y < densitySize - 1 && pos.z < densitySize - 1 && cellInRange(pos);
+}
+
+vec3 interpolateVertex(vec3 p1, vec3 p2, float val1, float val2) {
+if(abs(isoLevel - val1) < 0.00001) return p1;
+if(abs(isoLevel - val2) < 0.00001) return p2;
+if(abs(val1 - val2) < 0.00001) return p1;
+float t = (isoLevel - val1) / (val2 - val1);
+return mix(p1, p2, clamp(t, 0.0, 1.0));
+}
+
+vec3 cornerNormal(int x, int y, int z) {
+    if (u_UseGradients != 0) {
+        int i = (x + y * densitySize + z * densitySize * densitySize) * 3;
+        return vec3(gradients[i], gradients[i + 1], gradients[i + 2]);
+    }
+    return computeNormal(x, y, z);
+}
+
+vec3 interpolateNormal(vec3 normal0, vec3 normal1, float val0, float val1) {
+    if(abs(isoLevel - val0) < 0.00001) return normal0;
+    if(abs(isoLevel - val1) < 0.00001) return normal1;
+    if(abs(val0 - val1) < 0.00001) return normal0;
+
+    float t = (isoLevel - val0) / (val1 - val0);
+    vec3 n = mix(normal0, normal1, t);
+
+    if (length(n) < 0.0001) {
+        return normal0;
+    }
+    return normalize(n);
+}
+
+// fixed-point steps per voxel of a packed position, and the offset that makes the lowest (-1) zero.
+// 16 bits cover -1..127 at 1/512 voxel, mirrored by packVertex in cpumesher.cpp and vertex.glsl
+const float PACKED_POSITION_SCALE = 512.0;
+const float PACKED_POSITION_OFFSET = 1.0;
+
+// unit vector onto the octahedron, folded into [-1, 1]^2
+vec2 octahedralEncode(vec3 n) {
+    n /= max(abs(n.x) + abs(n.y) + abs(n.z), 1e-6);
+    vec2 e = n.xy;
+    if (n.z < 0.0) {
+        e = (1.0 - abs(e.yx)) * vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return e;
+}
+
+// packed: uint16 x, y | uint16 z, spare (material / AO, 0 for now) | snorm16 octahedral normal
+void storeVertex(uint index, vec3 position, vec3 normal) {
+    if (u_PackedVertices != 0) {
+        uvec3 q = uvec3(clamp(round((position + PACKED_POSITION_OFFSET) * PACKED_POSITION_SCALE), 0.0, 65535.0));
+        packedVertices[index * 3u] = q.x | (q.y << 16);
+        packedVertices[index * 3u + 1u] = q.z;
+        packedVertices[index * 3u + 2u] = packSnorm2x16(octahedralEncode(normal));
+        return;
+    }
+    vertexNormals[index].position = vec4(position, 1.0);
+    vertexNormals[index].normal = normal;
+    vertexNormals[index].pad = 0.0;
+}
@@ -0,0 +1,50 @@
+#version 460 core
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;
+
+// count pass of the deterministic mesher: how much output each cell (and, for the indexed mesh, each
+// sample) will write, for prefixScan.comp.glsl to turn into offsets. the same cells and edges as
+// marchingCube.comp.glsl / meshIndices.comp.glsl and meshVertices.comp.glsl, so the offsets line up.
+// densityStorage.glsl and meshCommon.glsl are prepended
+
+uniform uint u_CellScanBase;
+uniform uint u_SampleScanBase;
+uniform int u_CountSamples; // 1 = also count the vertices on each sample's own edges (indexed mesh)
+
+void main() {
+    ivec3 pos = ivec3(gl_GlobalInvocationID.xyz);
+    if (pos.x >= densitySize || pos.y >= densitySize || pos.z >= densitySize) {
+        return;
+    }
+
+    float d0 = loadDensity(pos);
+
+    // vertices in the soup and indices in the indexed mesh: 3 per triangle either way
+    if (pos.x < densitySize - 1 && pos.y < densitySize - 1 && pos.z < densitySize - 1) {
+        int cubeIndex = 0;
+        if (d0 < isoLevel) cubeIndex |= 1;
+        if (loadDensity(pos + ivec3(1, 0, 0)) < isoLevel) cubeIndex |= 2;
+        if (loadDensity(pos + ivec3(1, 1, 0)) < isoLevel) cubeIndex |= 4;
+        if (loadDensity(pos + ivec3(0, 1, 0)) < isoLevel) cubeIndex |= 8;
+        if (loadDensity(pos + ivec3(0, 0, 1)) < isoLevel) cubeIndex |= 16;
+        if (loadDensity(pos + ivec3(1, 0, 1)) < isoLevel) cubeIndex |= 32;
+        if (loadDensity(pos + ivec3(1, 1, 1)) < isoLevel) cubeIndex |= 64;
+        if (loadDensity(pos + ivec3(0, 1, 1)) < isoLevel) cubeIndex |= 128;
+
+        uint count = 0u;
+        while (cellInRange(pos) && count < 15u && triTable(cubeIndex, int(count)) != -1) {
+            count += 3u;
+        }
+        scanValues[u_CellScanBase + uint(cellIndex(pos))] = count;
+    }
+
+    if (u_CountSamples != 0) {
+        uint count = 0u;
+        for (int axis = 0; axis < 3; ++axis) {
+            ivec3 other = pos;
+            other[axis] += 1;
+            if (other[axis] < densitySize && (d0 < isoLevel) != (loadDensity(other) < isoLevel)) count++;
+        }
+        int sampleIndex = pos.x + pos.y * densitySize + pos.z * densitySize * densitySize;
+        scanValues[u_SampleScanBase + uint(sampleIndex)] = count;
+    }
+}
@@ -0,0 +1,61 @@
+#version 460 core
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;
+
+// indexed mesher, pass 2: the triangles of each cell as indices into the vertices meshVertices.comp.glsl
+// wrote. densityStorage.glsl and meshCommon.glsl are prepended
+
+layout(std430, binding = 10) buffer EdgeVertexBuffer {
+    uint edgeVertices[];
+};
+
+layout(std430, binding = 11) buffer IndexBuffer {
+    uint meshIndices[];
+};
+
+// sample that owns each of the 12 cube edges (xyz, relative to the cell) and the edge's axis (w),
+// with the corner numbering of marchingCube.comp.glsl
+const ivec4 edgeOwners[12] = ivec4[12](
+    ivec4(0, 0, 0, 0), ivec4(1, 0, 0, 1), ivec4(0, 1, 0, 0), ivec4(0, 0, 0, 1),
+    ivec4(0, 0, 1, 0), ivec4(1, 0, 1, 1), ivec4(0, 1, 1, 0), ivec4(0, 0, 1, 1),
+    ivec4(0, 0, 0, 2), ivec4(1, 0, 0, 2), ivec4(1, 1, 0, 2), ivec4(0, 1, 0, 2));
+
+uint edgeVertex(ivec3 pos, int edge) {
+    ivec4 owner = edgeOwners[edge];
+    ivec3 p = pos + owner.xyz;
+    return edgeVertices[(p.x + p.y * densitySize + p.z * densitySize * densitySize) * 3 + owner.w];
+}
+
+void main() {
+    ivec3 pos;
+    int cubeIndex;
+    if (!meshCell(pos, cubeIndex)) {
+        return;
+    }
+
+    // the active cell list carries the cube index, so only a full-grid dispatch reads density here
+    if (cubeIndex < 0) {
+        cubeIndex = 0;
+        if (loadDensity(pos) < isoLevel) cubeIndex |= 1;
+        if (loadDensity(pos + ivec3(1, 0, 0)) < isoLevel) cubeIndex |= 2;
+        if (loadDensity(pos + ivec3(1, 1, 0)) < isoLevel) cubeIndex |= 4;
+        if (loadDensity(pos + ivec3(0, 1, 0)) < isoLevel) cubeIndex |= 8;
+        if (loadDensity(pos + ivec3(0, 0, 1)) < isoLevel) cubeIndex |= 16;
+        if (loadDensity(pos + ivec3(1, 0, 1)) < isoLevel) cubeIndex |= 32;
+        if (loadDensity(pos + ivec3(1, 1, 1)) < isoLevel) cubeIndex |= 64;
+        if (loadDensity(pos + ivec3(0, 1, 1)) < isoLevel) cubeIndex |= 128;
+    }
+
+    if (edgeTable(cubeIndex) == 0) return;
+
+    // one atomic per cell for all of its triangles, or the cell's prefix sum
+    int indexCount = 0;
+    while (indexCount < 15 && triTable(cubeIndex, indexCount) != -1) {
+        indexCount += 3;
+    }
+
+    uint startIndex = u_UsePrefixSums != 0 ? scanValues[u_ScanBase + uint(cellIndex(pos))]
+                                           : atomicAdd(indexCounter, uint(indexCount));
+    for (int i = 0; i < indexCount; ++i) {
+        meshIndices[startIndex + uint(i)] = edgeVertex(pos, triTable(cubeIndex, i));
+    }
+}
@@ -0,0 +1,41 @@
+#version 460 core
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;
+
+// indexed mesher, pass 1: one vertex per edge that crosses the surface. every sample owns the three
+// edges running from it in +x, +y and +z (its cell's "lower" edges), so each vertex is written once
+// and shared by the up to four cells around the edge. densityStorage.glsl and meshCommon.glsl are prepended
+
+// vertex index per owned edge, 3 slots per density sample. only slots of crossing edges are written,
+// and those are the only ones meshIndices.comp.glsl reads, so the buffer is never cleared
+layout(std430, binding = 10) buffer EdgeVertexBuffer {
+    uint edgeVertices[];
+};
+
+void main() {
+    ivec3 pos = ivec3(gl_GlobalInvocationID.xyz);
+    if (pos.x >= densitySize || pos.y >= densitySize || pos.z >= densitySize) {
+        return;
+    }
+
+    float d0 = loadDensity(pos);
+    vec3 p0 = vec3(pos) - vec3(1.0);
+    int sampleIndex = pos.x + pos.y * densitySize + pos.z * densitySize * densitySize;
+
+    // the prefix sums give this sample's first vertex; its edges follow in axis order
+    uint nextVertex = u_UsePrefixSums != 0 ? scanValues[u_ScanBase + uint(sampleIndex)] : 0u;
+
+    // always interpolated from this sample towards +axis, so every cell sees the same vertex
+    for (int axis = 0; axis < 3; ++axis) {
+        ivec3 other = pos;
+        other[axis] += 1;
+        if (other[axis] >= densitySize) continue;
+
+        float d1 = loadDensity(other);
+        if ((d0 < isoLevel) == (d1 < isoLevel)) continue;
+
+        uint vertex = u_UsePrefixSums != 0 ? nextVertex++ : atomicAdd(vertexCounter, 1u);
+        storeVertex(vertex, interpolateVertex(p0, vec3(other) - vec3(1.0), d0, d1),
+                    interpolateNormal(cornerNormal(pos.x, pos.y, pos.z), cornerNormal(other.x, other.y, other.z), d0, d1));
+        edgeVertices[sampleIndex * 3 + axis] = vertex;
+    }
+}
@@ -0,0 +1,80 @@
+#version 460 core
+layout(local_size_x = 256) in;
+
+// work-efficient (Blelloch) exclusive scan of u_Count uints at scanValues[u_DataOffset], in place,
+// 512 per workgroup. pass 0 scans each block and writes its total to scanValues[u_SumsOffset + block];
+// the host scans those totals the same way and pass 1 adds them back to every block
+
+layout(std430, binding = 12) buffer ScanBuffer {
+    uint scanValues[];
+};
+
+// vertexCounter, indexCounter, as in meshCommon.glsl
+layout(std430, binding = 4) buffer CounterBuffer {
+    uint counters[2];
+};
+
+uniform uint u_DataOffset;
+uniform uint u_SumsOffset;
+uniform uint u_Count;
+uniform int u_Pass;
+uniform int u_TotalCounter; // counters[] slot the grand total is copied to, -1 for none
+
+const uint BLOCK_SIZE = 512u;
+
+shared uint s_scan[BLOCK_SIZE];
+
+void main() {
+    uint t = gl_LocalInvocationID.x;
+    uint block = gl_WorkGroupID.x;
+    uint i0 = block * BLOCK_SIZE + t;
+    uint i1 = i0 + BLOCK_SIZE / 2u;
+
+    if (u_Pass == 1) {
+        uint blockOffset = scanValues[u_SumsOffset + block];
+        if (i0 < u_Count) scanValues[u_DataOffset + i0] += blockOffset;
+        if (i1 < u_Count) scanValues[u_DataOffset + i1] += blockOffset;
+        return;
+    }
+
+    s_scan[t] = i0 < u_Count ? scanValues[u_DataOffset + i0] : 0u;
+    s_scan[t + BLOCK_SIZE / 2u] = i1 < u_Count ? scanValues[u_DataOffset + i1] : 0u;
+
+    // up-sweep: partial sums up a balanced tree, the block total ends in the last slot
+    uint stride = 1u;
+    for (uint active = BLOCK_SIZE / 2u; active > 0u; active >>= 1) {
+        barrier();
+        if (t < active) {
+            uint a = stride * (2u * t + 1u) - 1u;
+            uint b = stride * (2u * t + 2u) - 1u;
+            s_scan[b] += s_scan[a];
+        }
+        stride <<= 1;
+    }
+
+    barrier();
+    if (t == 0u) {
+        uint total = s_scan[BLOCK_SIZE - 1u];
+        scanValues[u_SumsOffset + block] = total;
+        // a single block is the top level, so this is the sum of everything
+        if (u_TotalCounter >= 0 && gl_NumWorkGroups.x == 1u) counters[u_TotalCounter] = total;
+        s_scan[BLOCK_SIZE - 1u] = 0u;
+    }
+
+    // down-sweep: push the prefixes back down, turning the tree into an exclusive scan
+    for (uint active = 1u; active < BLOCK_SIZE; active <<= 1) {
+        stride >>= 1;
+        barrier();
+        if (t < active) {
+            uint a = stride * (2u * t + 1u) - 1u;
+            uint b = stride * (2u * t + 2u) - 1u;
+            uint left = s_scan[a];
+            s_scan[a] = s_scan[b];
+            s_scan[b] += left;
+        }
+    }
+
+    barrier();
+    if (i0 < u_Count) scanValues[u_DataOffset + i0] = s_scan[t];
+    if (i1 < u_Count) scanValues[u_DataOffset + i1] = s_scan[t + BLOCK_SIZE / 2u];
+}
@@ -0,0 +1,62 @@
+#version 460 core
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;
+
+// dual mesher, pass 2: every sample owns its +x, +y and +z edges; where one crosses the surface, the
+// vertices of the four cells around it form a quad, written as two triangles wound like marching
+// cubes. mirrors pass 2 of CpuMesher::meshSurfaceNets. densityStorage.glsl and meshCommon.glsl are prepended
+
+layout(std430, binding = 10) buffer CellVertexBuffer {
+    uint cellVertices[];
+};
+
+layout(std430, binding = 11) buffer IndexBuffer {
+    uint meshIndices[];
+};
+
+void main() {
+    ivec3 pos = ivec3(gl_GlobalInvocationID.xyz);
+    if (pos.x >= densitySize || pos.y >= densitySize || pos.z >= densitySize) {
+        return;
+    }
+    // chunked: only samples in (x, y] own edges here, so their quads use cells in [x, y] and every edge
+    // has exactly one owner across neighbouring chunks
+    if (u_CellRange.y != 0 && (pos.x <= u_CellRange.x || pos.x > u_CellRange.y || pos.z <= u_CellRange.x || pos.z > u_CellRange.y)) {
+        return;
+    }
+
+    int cells = densitySize - 1;
+    bool inside = loadDensity(pos) < isoLevel;
+    for (int axis = 0; axis < 3; ++axis) {
+        // u and v span the plane across the edge, so (axis, u, v) is right-handed. edges on the grid's
+        // outer faces lack some of their four cells and get no quad
+        int u = (axis + 1) % 3;
+        int v = (axis + 2) % 3;
+        if (pos[axis] >= cells || pos[u] < 1 || pos[u] >= cells || pos[v] < 1 || pos[v] >= cells) continue;
+
+        ivec3 other = pos;
+        other[axis] += 1;
+        if ((loadDensity(other) < isoLevel) == inside) continue;
+
+        // (0,0), (1,0), (1,1), (0,1) in (u, v), stepping back from this sample
+        uint quad[4];
+        for (int corner = 0; corner < 4; ++corner) {
+            ivec3 c = pos;
+            c[u] -= (corner == 0 || corner == 3) ? 1 : 0;
+            c[v] -= (corner == 0 || corner == 1) ? 1 : 0;
+            quad[corner] = cellVertices[cellIndex(c)];
+        }
+        if (inside) {
+            uint swap = quad[1];
+            quad[1] = quad[3];
+            quad[3] = swap;
+        }
+
+        uint start = atomicAdd(indexCounter, 6u);
+        meshIndices[start] = quad[0];
+        meshIndices[start + 1u] = quad[1];
+        meshIndices[start + 2u] = quad[2];
+        meshIndices[start + 3u] = quad[0];
+        meshIndices[start + 4u] = quad[2];
+        meshIndices[start + 5u] = quad[3];
+    }
+}
@@ -0,0 +1,137 @@
+#version 460 core
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;
+
+// dual mesher, pass 1: one vertex per cell that crosses the surface, at the mean of the points where
+// its edges cross (Naive Surface Nets) or, with u_DualContouring, at the minimiser of the QEF of the
+// tangent planes through those points, kept inside the cell. mirrors CpuMesher::dualVertex.
+// densityStorage.glsl and meshCommon.glsl are prepended
+
+// vertex index per cell for surfaceNetsQuads.comp.glsl. only crossing cells are written, and only
+// their entries are read, so the buffer is never cleared
+layout(std430, binding = 10) buffer CellVertexBuffer {
+    uint cellVertices[];
+};
+
+uniform int u_DualContouring;
+
+// pull towards the mass point, as QEF_BIAS in cpumesher.cpp. keeps cells whose planes are all
+// parallel (or meet in a line) from sliding along the surface
+const float QEF_BIAS = 0.05;
+
+const ivec3 cornerOffsets[8] = ivec3[8](
+    ivec3(0, 0, 0), ivec3(1, 0, 0), ivec3(1, 1, 0), ivec3(0, 1, 0),
+    ivec3(0, 0, 1), ivec3(1, 0, 1), ivec3(1, 1, 1), ivec3(0, 1, 1));
+
+// corners of each edge, interpolated in the same direction as marchingCube.comp.glsl
+const ivec2 edgeCorners[12] = ivec2[12](
+    ivec2(0, 1), ivec2(1, 2), ivec2(2, 3), ivec2(3, 0), ivec2(4, 5), ivec2(5, 6),
+    ivec2(6, 7), ivec2(7, 4), ivec2(0, 4), ivec2(1, 5), ivec2(2, 6), ivec2(3, 7));
+
+// Cramer's rule on (A^T A + QEF_BIAS I) delta = A^T b, relative to the mass point; ata is the upper
+// triangle xx, xy, xz, yy, yz, zz
+vec3 solveQef(float ata[6], vec3 atb, vec3 massPoint) {
+    float a00 = ata[0] + QEF_BIAS, a01 = ata[1], a02 = ata[2];
+    float a11 = ata[3] + QEF_BIAS, a12 = ata[4], a22 = ata[5] + QEF_BIAS;
+    float c0 = a11 * a22 - a12 * a12;
+    float c1 = a02 * a12 - a01 * a22;
+    float c2 = a01 * a12 - a02 * a11;
+    float det = a00 * c0 + a01 * c1 + a02 * c2;
+    if (abs(det) < 1e-12) return massPoint;
+    vec3 delta = vec3(c0 * atb.x + c1 * atb.y + c2 * atb.z,
+                      c1 * atb.x + (a00 * a22 - a02 * a02) * atb.y + (a02 * a01 - a00 * a12) * atb.z,
+                      c2 * atb.x + (a01 * a02 - a00 * a12) * atb.y + (a00 * a11 - a01 * a01) * atb.z) / det;
+    return massPoint + delta;
+}
+
+// central difference at a corner of a border cell, see CpuMesher::borderNormal: across the border only
+// the cell's own two samples, doubled to the scale of a central difference. cell is -1 on the axes
+// where the cell is not on the border
+vec3 borderNormal(ivec3 p, ivec2 cell) {
+    vec3 n = vec3(getDensity(p.x - 1, p.y, p.z) - getDensity(p.x + 1, p.y, p.z),
+                  getDensity(p.x, p.y - 1, p.z) - getDensity(p.x, p.y + 1, p.z),
+                  getDensity(p.x, p.y, p.z - 1) - getDensity(p.x, p.y, p.z + 1));
+    if (cell.x >= 0) n.x = 2.0 * (getDensity(cell.x, p.y, p.z) - getDensity(cell.x + 1, p.y, p.z));
+    if (cell.y >= 0) n.z = 2.0 * (getDensity(p.x, p.y, cell.y) - getDensity(p.x, p.y, cell.y + 1));
+    if (length(n) < 0.0001) {
+        return vec3(0.0, 1.0, 0.0);
+    }
+    return normalize(n);
+}
+
+void main() {
+    ivec3 pos;
+    int cubeIndex;
+    if (!meshCell(pos, cubeIndex)) {
+        return;
+    }
+
+    float d[8];
+    for (int c = 0; c < 8; ++c) {
+        d[c] = loadDensity(pos + cornerOffsets[c]);
+    }
+    if (cubeIndex < 0) {
+        cubeIndex = 0;
+        for (int c = 0; c < 8; ++c) {
+            if (d[c] < isoLevel) cubeIndex |= 1 << c;
+        }
+    }
+    int edges = edgeTable(cubeIndex);
+    if (edges == 0) return;
+
+    // a border cell is made by both chunks, and one of them has its corner on the first sample, where
+    // the gradient is one-sided; both take the difference inside the cell across the border instead
+    bool border = onCellRangeBorder(pos);
+    ivec2 borderCell = ivec2(pos.x == u_CellRange.x || pos.x == u_CellRange.y ? pos.x : -1,
+                             pos.z == u_CellRange.x || pos.z == u_CellRange.y ? pos.z : -1);
+    vec3 n[8];
+    for (int c = 0; c < 8; ++c) {
+        ivec3 p = pos + cornerOffsets[c];
+        n[c] = border ? borderNormal(p, borderCell) : cornerNormal(p.x, p.y, p.z);
+    }
+
+    // the crossing points and normals marching cubes would put on the same edges
+    vec3 basePos = vec3(pos) - vec3(1.0);
+    vec3 points[12];
+    vec3 normals[12];
+    int count = 0;
+    vec3 massPoint = vec3(0.0);
+    vec3 normalSum = vec3(0.0);
+    for (int e = 0; e < 12; ++e) {
+        if ((edges & (1 << e)) == 0) continue;
+        ivec2 corners = edgeCorners[e];
+        points[count] = interpolateVertex(basePos + vec3(cornerOffsets[corners.x]), basePos + vec3(cornerOffsets[corners.y]),
+                                          d[corners.x], d[corners.y]);
+        normals[count] = interpolateNormal(n[corners.x], n[corners.y], d[corners.x], d[corners.y]);
+        massPoint += points[count];
+        normalSum += normals[count];
+        count++;
+    }
+    massPoint /= float(count);
+
+    // a border cell's vertex is also made by the neighbouring chunk, whose gradient at the far corner
+    // is one-sided; the mass point depends on density alone, so both chunks put it in the same place
+    vec3 position = massPoint;
+    if (u_DualContouring != 0 && !onCellRangeBorder(pos)) {
+        float ata[6] = float[6](0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
+        vec3 atb = vec3(0.0);
+        for (int i = 0; i < count; ++i) {
+            vec3 m = normals[i];
+            float b = dot(m, points[i] - massPoint);
+            ata[0] += m.x * m.x;
+            ata[1] += m.x * m.y;
+            ata[2] += m.x * m.z;
+            ata[3] += m.y * m.y;
+            ata[4] += m.y * m.z;
+            ata[5] += m.z * m.z;
+            atb += m * b;
+        }
+        position = clamp(solveQef(ata, atb, massPoint), basePos, basePos + vec3(1.0));
+    }
+
+    float normalLength = length(normalSum);
+    vec3 normal = normalLength < 0.0001 ? normals[0] : normalSum / normalLength;
+
+    uint vertex = atomicAdd(vertexCounter, 1u);
+    storeVertex(vertex, position, normal);
+    cellVertices[cellIndex(pos)] = vertex;
+}
@@ -5,12 +5,30 @@ layout(location = 1) in vec3 normal;
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+// 1 = packed vertices (storeVertex in meshCommon.glsl): position is (x, y, z, spare) in 1/512 voxel
+// fixed point from -1, normal.xy an octahedral encoded normal
+uniform int u_PackedVertices;
 
 out vec3 fragPos;
 out vec3 fragNormal;
 
+vec3 octahedralDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(n);
+}
+
 void main() {
-    fragPos = vec3(model * position);
-    fragNormal = mat3(transpose(inverse(model))) * normal;
-    gl_Position = projection * view * model * position;
+    vec4 p = position;
+    vec3 n = normal;
+    if (u_PackedVertices != 0) {
+        p = vec4(position.xyz / 512.0 - 1.0, 1.0);
+        n = octahedralDecode(normal.xy);
+    }
+
+    fragPos = vec3(model * p);
+    fragNormal = mat3(transpose(inverse(model))) * n;
+    gl_Position = projection * view * model * p;
 }